@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/*
+ * Host tool to create "DLT1" patches for "fota delta <version>".
+ *
+ * cc -O2 -o delta_gen delta_gen.c
+ * ./delta_gen <running app_update.bin> <new app_update.bin> <patch>
+ *
+ * Matches are searched by a hash of DELTA_GEN_HASH_LEN bytes and
+ * extended as long as more than half of the bytes are equal (as bsdiff
+ * does). Equal matches are sent as COPY, similar ones as ADD, all other
+ * bytes as INSERT.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "delta_gen.h"
+
+#define DELTA_MAGIC "DLT1"
+#define DELTA_OPCODE_COPY 0x01
+#define DELTA_OPCODE_INSERT 0x02
+#define DELTA_OPCODE_ADD 0x03
+
+#define DELTA_GEN_HASH_LEN 8
+/* shorter matches are cheaper sent as INSERT */
+#define DELTA_GEN_MIN_MATCH 24
+/* stop extending a match, if the score drops by that value */
+#define DELTA_GEN_MAX_DROP 32
+/* maximum skip and count of an ADD run */
+#define DELTA_GEN_MAX_RUN 255
+
+struct delta_gen_buffer {
+   uint8_t *data;
+   size_t len;
+   size_t size;
+   bool error;
+};
+
+uint32_t delta_gen_crc32(const uint8_t *data, size_t len)
+{
+   uint32_t crc = 0xffffffff;
+
+   while (len--) {
+      crc ^= *data++;
+      for (int bit = 0; bit < 8; ++bit) {
+         crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+      }
+   }
+   return ~crc;
+}
+
+static void delta_gen_append(struct delta_gen_buffer *buf, const uint8_t *data, size_t len)
+{
+   if (buf->error) {
+      return;
+   }
+   if (buf->len + len > buf->size) {
+      size_t size = buf->size ? buf->size : 1024;
+      uint8_t *data;
+
+      while (buf->len + len > size) {
+         size *= 2;
+      }
+      data = realloc(buf->data, size);
+      if (!data) {
+         buf->error = true;
+         return;
+      }
+      buf->data = data;
+      buf->size = size;
+   }
+   memcpy(&buf->data[buf->len], data, len);
+   buf->len += len;
+}
+
+static void delta_gen_append_byte(struct delta_gen_buffer *buf, uint8_t value)
+{
+   delta_gen_append(buf, &value, 1);
+}
+
+static void delta_gen_append_be32(struct delta_gen_buffer *buf, uint32_t value)
+{
+   uint8_t data[4] = {value >> 24, value >> 16, value >> 8, value};
+
+   delta_gen_append(buf, data, sizeof(data));
+}
+
+static uint32_t delta_gen_hash(const uint8_t *data, unsigned int bits)
+{
+   uint64_t value = 0;
+
+   for (int index = 0; index < DELTA_GEN_HASH_LEN; ++index) {
+      value = (value << 8) | data[index];
+   }
+   return (uint32_t)((value * 0x9e3779b97f4a7c15ULL) >> (64 - bits));
+}
+
+/* length of the similar bytes, more than half of them are equal */
+static size_t delta_gen_extend(const uint8_t *source, size_t source_len, size_t s,
+                               const uint8_t *target, size_t target_len, size_t t)
+{
+   size_t max = source_len - s < target_len - t ? source_len - s : target_len - t;
+   long score = 0;
+   long best = 0;
+   size_t len = 0;
+
+   for (size_t index = 0; index < max; ++index) {
+      score += source[s + index] == target[t + index] ? 1 : -1;
+      if (score > best) {
+         best = score;
+         len = index + 1;
+      } else if (score < best - DELTA_GEN_MAX_DROP) {
+         break;
+      }
+   }
+   return len;
+}
+
+static void delta_gen_insert(struct delta_gen_buffer *buf, const uint8_t *data, size_t len)
+{
+   if (len) {
+      delta_gen_append_byte(buf, DELTA_OPCODE_INSERT);
+      delta_gen_append_be32(buf, len);
+      delta_gen_append(buf, data, len);
+   }
+}
+
+static void delta_gen_match(struct delta_gen_buffer *buf, const uint8_t *source, size_t s,
+                            const uint8_t *target, size_t t, size_t len)
+{
+   size_t index = 0;
+
+   if (!memcmp(&source[s], &target[t], len)) {
+      delta_gen_append_byte(buf, DELTA_OPCODE_COPY);
+      delta_gen_append_be32(buf, s);
+      delta_gen_append_be32(buf, len);
+      return;
+   }
+   source += s;
+   target += t;
+   delta_gen_append_byte(buf, DELTA_OPCODE_ADD);
+   delta_gen_append_be32(buf, s);
+   delta_gen_append_be32(buf, len);
+   while (index < len) {
+      size_t skip = 0;
+      size_t count = 0;
+
+      while (index + skip < len && skip < DELTA_GEN_MAX_RUN &&
+             source[index + skip] == target[index + skip]) {
+         ++skip;
+      }
+      index += skip;
+      while (index + count < len && count < DELTA_GEN_MAX_RUN) {
+         size_t equal = 0;
+
+         /* a new run costs 2 bytes, end the diff before 3 equal bytes */
+         while (equal < 3 && index + count + equal < len &&
+                source[index + count + equal] == target[index + count + equal]) {
+            ++equal;
+         }
+         if (equal == 3 || (equal && index + count + equal == len)) {
+            break;
+         }
+         ++count;
+      }
+      delta_gen_append_byte(buf, skip);
+      delta_gen_append_byte(buf, count);
+      for (size_t diff = 0; diff < count; ++diff) {
+         delta_gen_append_byte(buf, target[index + diff] - source[index + diff]);
+      }
+      index += count;
+   }
+}
+
+uint8_t *delta_gen_create(const uint8_t *source, size_t source_len,
+                          const uint8_t *target, size_t target_len,
+                          size_t *patch_len)
+{
+   struct delta_gen_buffer buf = {0};
+   unsigned int bits = 10;
+   uint32_t *table;
+   size_t literal = 0;
+   size_t t = 0;
+   long displacement = 0;
+
+   while (bits < 24 && ((size_t)1 << bits) < source_len * 2) {
+      ++bits;
+   }
+   table = calloc((size_t)1 << bits, sizeof(uint32_t));
+   if (!table) {
+      return NULL;
+   }
+   /* position + 1, the first position of a hash is kept */
+   for (size_t s = source_len; s >= DELTA_GEN_HASH_LEN; --s) {
+      size_t pos = s - DELTA_GEN_HASH_LEN;
+      table[delta_gen_hash(&source[pos], bits)] = pos + 1;
+   }
+
+   delta_gen_append(&buf, (const uint8_t *)DELTA_MAGIC, 4);
+   delta_gen_append_be32(&buf, source_len);
+   delta_gen_append_be32(&buf, delta_gen_crc32(source, source_len));
+   delta_gen_append_be32(&buf, target_len);
+
+   while (t + DELTA_GEN_HASH_LEN <= target_len) {
+      size_t best = 0;
+      size_t best_len = 0;
+      size_t s;
+
+      /* continue with the displacement of the last match */
+      if ((long)t + displacement >= 0 && (long)t + displacement < (long)source_len) {
+         s = t + displacement;
+         best_len = delta_gen_extend(source, source_len, s, target, target_len, t);
+         best = s;
+      }
+      s = table[delta_gen_hash(&target[t], bits)];
+      if (s && !memcmp(&source[s - 1], &target[t], DELTA_GEN_HASH_LEN)) {
+         size_t len = delta_gen_extend(source, source_len, s - 1, target, target_len, t);
+         if (len > best_len) {
+            best_len = len;
+            best = s - 1;
+         }
+      }
+      if (best_len < DELTA_GEN_MIN_MATCH) {
+         ++t;
+         continue;
+      }
+      delta_gen_insert(&buf, &target[literal], t - literal);
+      delta_gen_match(&buf, source, best, target, t, best_len);
+      displacement = (long)best - (long)t;
+      t += best_len;
+      literal = t;
+   }
+   delta_gen_insert(&buf, &target[literal], target_len - literal);
+   free(table);
+
+   if (buf.error) {
+      free(buf.data);
+      return NULL;
+   }
+   *patch_len = buf.len;
+   return buf.data;
+}
+
+#ifndef DELTA_GEN_NO_MAIN
+
+static uint8_t *delta_gen_read(const char *name, size_t *len)
+{
+   uint8_t *data = NULL;
+   long size;
+   FILE *file = fopen(name, "rb");
+
+   if (!file) {
+      perror(name);
+      return NULL;
+   }
+   if (!fseek(file, 0, SEEK_END) && (size = ftell(file)) > 0 && !fseek(file, 0, SEEK_SET)) {
+      data = malloc(size);
+      if (data && fread(data, 1, size, file) != (size_t)size) {
+         free(data);
+         data = NULL;
+      }
+      *len = size;
+   }
+   fclose(file);
+   if (!data) {
+      fprintf(stderr, "%s: read failed!\n", name);
+   }
+   return data;
+}
+
+int main(int argc, char **argv)
+{
+   uint8_t *source;
+   uint8_t *target;
+   uint8_t *patch = NULL;
+   size_t source_len = 0;
+   size_t target_len = 0;
+   size_t patch_len = 0;
+   FILE *file;
+   int rc = 1;
+
+   if (argc != 4) {
+      fprintf(stderr, "usage: %s <running image> <new image> <patch>\n", argv[0]);
+      return 1;
+   }
+   source = delta_gen_read(argv[1], &source_len);
+   target = delta_gen_read(argv[2], &target_len);
+   if (source && target) {
+      patch = delta_gen_create(source, source_len, target, target_len, &patch_len);
+   }
+   if (patch) {
+      file = fopen(argv[3], "wb");
+      if (file && fwrite(patch, 1, patch_len, file) == patch_len && !fclose(file)) {
+         printf("%s: %zu bytes, %zu%% of %zu bytes.\n", argv[3], patch_len,
+                patch_len * 100 / target_len, target_len);
+         rc = 0;
+      } else {
+         perror(argv[3]);
+      }
+   }
+   free(patch);
+   free(target);
+   free(source);
+   return rc;
+}
+
+#endif /* DELTA_GEN_NO_MAIN */
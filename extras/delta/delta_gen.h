@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#ifndef DELTA_GEN_H
+#define DELTA_GEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Create a "DLT1" patch, see src/appl_update_delta.h.
+ *
+ * @param source running image
+ * @param source_len length of the running image
+ * @param target new image
+ * @param target_len length of the new image
+ * @param patch_len length of the created patch
+ *
+ * @return patch, to be released with free(), or NULL, if out of memory.
+ */
+uint8_t *delta_gen_create(const uint8_t *source, size_t source_len,
+                          const uint8_t *target, size_t target_len,
+                          size_t *patch_len);
+
+/** CRC32 (IEEE), same as zephyr's crc32_ieee. */
+uint32_t delta_gen_crc32(const uint8_t *data, size_t len);
+
+#endif /* DELTA_GEN_H */
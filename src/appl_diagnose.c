@@ -13,6 +13,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <zephyr/drivers/hwinfo.h>
 #include <zephyr/drivers/watchdog.h>
 #include <zephyr/kernel.h>
@@ -33,7 +34,13 @@
 
 #include "appl_diagnose.h"
 #include "appl_settings.h"
+#ifdef CONFIG_USE_APPL_STORAGE
+#include "appl_storage.h"
+#endif /* CONFIG_USE_APPL_STORAGE */
 #include "appl_time.h"
+#ifdef CONFIG_COAP_UPLOAD
+#include "coap_upload.h"
+#endif /* CONFIG_COAP_UPLOAD */
 #include "parse.h"
 #include "sh_cmd.h"
 
@@ -136,6 +143,9 @@ static void appl_reboot_fn(void *p1, void *p2, void *p3)
          delay_ms = atomic_get(&shutdown_delay);
       }
    }
+#ifdef CONFIG_USE_APPL_STORAGE
+   appl_storage_sync(0);
+#endif /* CONFIG_USE_APPL_STORAGE */
    sys_reboot(SYS_REBOOT_COLD);
 }
 
@@ -360,6 +370,50 @@ int appl_reset_cause_description(char *buf, size_t len)
    return index;
 }
 
+#define REBOOT_INFOS 4
+
+#ifdef CONFIG_COAP_UPLOAD
+static size_t reboots_upload_offset = 0;
+static size_t reboots_upload_len = 0;
+static char reboots_upload_buf[REBOOT_INFOS * 64];
+
+static int reboots_upload_start(void)
+{
+   int err = 0;
+
+   reboots_upload_offset = 0;
+   reboots_upload_len = 0;
+   for (size_t index = 0; index < REBOOT_INFOS; ++index) {
+      err = appl_reboot_cause_description(index, 1, &reboots_upload_buf[reboots_upload_len],
+                                          sizeof(reboots_upload_buf) - reboots_upload_len);
+      if (err <= 0) {
+         break;
+      }
+      reboots_upload_len += err;
+      if (reboots_upload_len + 1 >= sizeof(reboots_upload_buf)) {
+         reboots_upload_len = sizeof(reboots_upload_buf) - 1;
+         break;
+      }
+      reboots_upload_buf[reboots_upload_len++] = '\n';
+   }
+   if (!reboots_upload_len) {
+      return err < 0 ? err : -ENODATA;
+   }
+   return reboots_upload_len;
+}
+
+static int reboots_upload_read(uint8_t *buf, size_t len)
+{
+   size_t res = MIN(reboots_upload_len - reboots_upload_offset, len);
+
+   memcpy(buf, &reboots_upload_buf[reboots_upload_offset], res);
+   reboots_upload_offset += res;
+   return res;
+}
+
+COAP_UPLOAD_PRODUCER(reboots, "reboot codes.", reboots_upload_start, reboots_upload_read, NULL);
+#endif /* CONFIG_COAP_UPLOAD */
+
 #ifdef CONFIG_SH_CMD
 
 static int sh_cmd_reboot(const char *parameter)
@@ -397,8 +451,6 @@ static void sh_cmd_reboot_help(void)
    LOG_INF("  reboot <n> : reboot device <n>, if <last> was not the same <n>.");
 }
 
-#define REBOOT_INFOS 4
-
 static int sh_cmd_read_reboots(const char *parameter)
 {
    ARG_UNUSED(parameter);
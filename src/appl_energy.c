@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "appl_energy.h"
+#include "sh_cmd.h"
+
+LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
+
+#define MSEC_PER_DAY (24 * 60 * 60 * MSEC_PER_SEC)
+
+/* currents in uA, charges in uA * ms = nAs */
+static const uint32_t phase_currents[APPL_ENERGY_PHASES] = {
+    CONFIG_APPL_ENERGY_SEARCH_CURRENT,
+    CONFIG_APPL_ENERGY_CONNECTED_CURRENT,
+    CONFIG_APPL_ENERGY_IDLE_CURRENT,
+    CONFIG_APPL_ENERGY_PSM_CURRENT,
+    CONFIG_APPL_ENERGY_HANDSHAKE_CURRENT,
+    CONFIG_APPL_ENERGY_TRANSFER_CURRENT,
+    CONFIG_APPL_ENERGY_GNSS_CURRENT,
+    CONFIG_APPL_ENERGY_SENSOR_CURRENT,
+};
+
+static const char *phase_names[APPL_ENERGY_PHASES] = {
+    "search", "connected", "idle", "psm", "handshake", "tx/rx", "gnss", "sensor"};
+
+static K_MUTEX_DEFINE(energy_mutex);
+
+static int64_t phase_times[APPL_ENERGY_PHASES];
+static uint64_t message_start_charge;
+static uint64_t message_charge;
+static uint32_t messages;
+
+/* call with energy_mutex locked */
+static uint64_t appl_energy_charge(void)
+{
+   uint64_t charge = 0;
+
+   for (int phase = 0; phase < APPL_ENERGY_PHASES; ++phase) {
+      charge += (uint64_t)phase_times[phase] * phase_currents[phase];
+   }
+   return charge;
+}
+
+void appl_energy_add(appl_energy_phase_t phase, int64_t time_ms)
+{
+   if (phase < APPL_ENERGY_PHASES && time_ms > 0) {
+      k_mutex_lock(&energy_mutex, K_FOREVER);
+      phase_times[phase] += time_ms;
+      k_mutex_unlock(&energy_mutex);
+   }
+}
+
+void appl_energy_message(void)
+{
+   uint64_t charge;
+
+   k_mutex_lock(&energy_mutex, K_FOREVER);
+   charge = appl_energy_charge();
+   message_charge = charge - message_start_charge;
+   message_start_charge = charge;
+   ++messages;
+   k_mutex_unlock(&energy_mutex);
+}
+
+static int appl_energy_print_charge(char *buf, size_t len, uint64_t charge)
+{
+   return snprintf(buf, len, "%u.%03u", (uint32_t)(charge / 1000000), (uint32_t)((charge / 1000) % 1000));
+}
+
+int appl_energy_desc(char *buf, size_t len)
+{
+   int index = 0;
+   int64_t uptime = k_uptime_get();
+   uint64_t charge;
+   uint64_t last;
+   uint32_t count;
+
+   k_mutex_lock(&energy_mutex, K_FOREVER);
+   charge = appl_energy_charge();
+   last = message_charge;
+   count = messages;
+   k_mutex_unlock(&energy_mutex);
+
+   index += snprintf(buf + index, len - index, "Energy: ");
+   index += appl_energy_print_charge(buf + index, len - index, last);
+   index += snprintf(buf + index, len - index, " mAs/msg, avg. ");
+   index += appl_energy_print_charge(buf + index, len - index, count ? charge / count : 0);
+   index += snprintf(buf + index, len - index, " mAs/msg (%u), ", count);
+   if (uptime > 0) {
+      // average current in nA, times seconds per day
+      uint64_t average = charge * 1000 / uptime;
+      index += appl_energy_print_charge(buf + index, len - index, average * (MSEC_PER_DAY / MSEC_PER_SEC));
+   } else {
+      index += snprintf(buf + index, len - index, "0.000");
+   }
+   index += snprintf(buf + index, len - index, " mAs/day");
+   return index;
+}
+
+#ifdef CONFIG_SH_CMD
+
+static int sh_cmd_energy(const char *parameter)
+{
+   (void)parameter;
+   char buf[128];
+   int64_t times[APPL_ENERGY_PHASES];
+   int64_t uptime = k_uptime_get();
+   int64_t other = uptime;
+
+   appl_energy_desc(buf, sizeof(buf));
+   LOG_INF("%s", buf);
+
+   k_mutex_lock(&energy_mutex, K_FOREVER);
+   memcpy(times, phase_times, sizeof(times));
+   k_mutex_unlock(&energy_mutex);
+
+   for (int phase = 0; phase < APPL_ENERGY_PHASES; ++phase) {
+      if (phase <= APPL_ENERGY_PSM) {
+         other -= times[phase];
+      }
+      appl_energy_print_charge(buf, sizeof(buf), (uint64_t)times[phase] * phase_currents[phase]);
+      LOG_INF("%-10s: %7lld s, %6u uA, %s mAs", phase_names[phase], times[phase] / MSEC_PER_SEC,
+              phase_currents[phase], buf);
+   }
+   LOG_INF("%-10s: %7lld s, not accounted", "other", other > 0 ? other / MSEC_PER_SEC : 0);
+   return 0;
+}
+
+SH_CMD(energy, NULL, "show energy accounting.", sh_cmd_energy, NULL, 0);
+
+#endif /* CONFIG_SH_CMD */
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#ifndef APPL_ENERGY_H
+#define APPL_ENERGY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The modem phases search, connected, idle and psm exclude each other.
+ * The phases handshake, transfer, gnss and sensor are accounted with
+ * their additional current on top of the modem phases.
+ */
+typedef enum {
+   APPL_ENERGY_SEARCH,
+   APPL_ENERGY_CONNECTED,
+   APPL_ENERGY_IDLE,
+   APPL_ENERGY_PSM,
+   APPL_ENERGY_HANDSHAKE,
+   APPL_ENERGY_TRANSFER,
+   APPL_ENERGY_GNSS,
+   APPL_ENERGY_SENSOR,
+   APPL_ENERGY_PHASES
+} appl_energy_phase_t;
+
+#ifdef CONFIG_APPL_ENERGY
+
+/**
+ * Add time to a phase.
+ *
+ * @param phase phase of the time
+ * @param time_ms time in milliseconds
+ */
+void appl_energy_add(appl_energy_phase_t phase, int64_t time_ms);
+
+/**
+ * Finish the accounting of a message.
+ *
+ * The charge since the last message is assigned to this message.
+ */
+void appl_energy_message(void);
+
+/**
+ * Describe the charge of the last message, the average per message and per day.
+ *
+ * @param buf buffer for the text
+ * @param len length of the buffer
+ * @return length of the text
+ */
+int appl_energy_desc(char *buf, size_t len);
+
+#else /* CONFIG_APPL_ENERGY */
+
+static inline void appl_energy_add(appl_energy_phase_t phase, int64_t time_ms)
+{
+   (void)phase;
+   (void)time_ms;
+}
+
+static inline void appl_energy_message(void)
+{
+}
+
+static inline int appl_energy_desc(char *buf, size_t len)
+{
+   (void)buf;
+   (void)len;
+   return 0;
+}
+
+#endif /* CONFIG_APPL_ENERGY */
+
+#endif /* APPL_ENERGY_H */
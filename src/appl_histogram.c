@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "appl_histogram.h"
+#include "parse.h"
+#include "sh_cmd.h"
+
+LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
+
+#define SUB_BUCKET_BITS 2
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+
+static struct k_spinlock histogram_lock;
+
+static int appl_histogram_index(uint32_t value)
+{
+   int index;
+   int exp;
+
+   if (value < SUB_BUCKETS) {
+      return value;
+   }
+   exp = 31 - __builtin_clz(value);
+   index = (exp - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + ((value >> (exp - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+   if (index >= APPL_HISTOGRAM_BUCKETS) {
+      index = APPL_HISTOGRAM_BUCKETS - 1;
+   }
+   return index;
+}
+
+/* highest value of the bucket */
+static uint32_t appl_histogram_bucket_max(int index)
+{
+   int exp;
+   int sub;
+
+   if (index < SUB_BUCKETS) {
+      return index;
+   }
+   exp = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+   sub = index % SUB_BUCKETS;
+   return ((SUB_BUCKETS + sub + 1) << (exp - SUB_BUCKET_BITS)) - 1;
+}
+
+void appl_histogram_add(struct appl_histogram *histogram, uint32_t value)
+{
+   int index = appl_histogram_index(value);
+
+   K_SPINLOCK(&histogram_lock)
+   {
+      histogram->buckets[index]++;
+      histogram->count++;
+      histogram->sum += value;
+      if (histogram->max < value) {
+         histogram->max = value;
+      }
+   }
+}
+
+void appl_histogram_merge(struct appl_histogram *histogram, const struct appl_histogram *other)
+{
+   K_SPINLOCK(&histogram_lock)
+   {
+      for (int index = 0; index < APPL_HISTOGRAM_BUCKETS; ++index) {
+         histogram->buckets[index] += other->buckets[index];
+      }
+      histogram->count += other->count;
+      histogram->sum += other->sum;
+      if (histogram->max < other->max) {
+         histogram->max = other->max;
+      }
+   }
+}
+
+void appl_histogram_reset(struct appl_histogram *histogram)
+{
+   K_SPINLOCK(&histogram_lock)
+   {
+      memset(histogram->buckets, 0, sizeof(histogram->buckets));
+      histogram->count = 0;
+      histogram->sum = 0;
+      histogram->max = 0;
+   }
+}
+
+void appl_histogram_copy(struct appl_histogram *histogram, const struct appl_histogram *other)
+{
+   K_SPINLOCK(&histogram_lock)
+   {
+      *histogram = *other;
+   }
+}
+
+uint32_t appl_histogram_percentile(const struct appl_histogram *histogram, int percent)
+{
+   uint32_t limit;
+   uint32_t count = 0;
+   uint32_t value = histogram->max;
+
+   if (!histogram->count) {
+      return 0;
+   }
+   if (percent < 0) {
+      percent = 0;
+   } else if (percent > 100) {
+      percent = 100;
+   }
+   limit = (uint32_t)(((uint64_t)histogram->count * percent + 99) / 100);
+   if (!limit) {
+      limit = 1;
+   }
+   for (int index = 0; index < APPL_HISTOGRAM_BUCKETS; ++index) {
+      count += histogram->buckets[index];
+      if (count >= limit) {
+         value = appl_histogram_bucket_max(index);
+         break;
+      }
+   }
+   return value < histogram->max ? value : histogram->max;
+}
+
+int appl_histogram_desc(const struct appl_histogram *histogram, char *buf, size_t len)
+{
+   struct appl_histogram copy;
+
+   appl_histogram_copy(&copy, histogram);
+   if (!copy.count) {
+      return snprintf(buf, len, "%s: no values", copy.name);
+   }
+   return snprintf(buf, len, "%s: %u#, avg. %u, p50 %u, p90 %u, p99 %u, max. %u %s", copy.name, copy.count,
+                   (uint32_t)(copy.sum / copy.count), appl_histogram_percentile(&copy, 50),
+                   appl_histogram_percentile(&copy, 90), appl_histogram_percentile(&copy, 99), copy.max, copy.unit);
+}
+
+int appl_histogram_desc_all(char *buf, size_t len)
+{
+   int index = 0;
+   struct appl_histogram copy;
+
+   STRUCT_SECTION_FOREACH(appl_histogram, histogram)
+   {
+      appl_histogram_copy(&copy, histogram);
+      if (copy.count && index < len) {
+         index += snprintf(buf + index, len - index, "%s%s:%u,%u,%u,%u", index ? " " : "", copy.name, copy.count,
+                           appl_histogram_percentile(&copy, 50), appl_histogram_percentile(&copy, 90), copy.max);
+      }
+   }
+   return index < len ? index : len - 1;
+}
+
+#ifdef CONFIG_SH_CMD
+
+static int sh_cmd_histogram(const char *parameter)
+{
+   char buf[128];
+   const char *cur = parameter;
+   bool reset = false;
+
+   memset(buf, 0, sizeof(buf));
+   cur = parse_next_text(cur, ' ', buf, sizeof(buf));
+   if (buf[0]) {
+      if (!stricmp("reset", buf)) {
+         reset = true;
+      } else {
+         return -EINVAL;
+      }
+   }
+   STRUCT_SECTION_FOREACH(appl_histogram, histogram)
+   {
+      if (reset) {
+         appl_histogram_reset(histogram);
+      } else {
+         appl_histogram_desc(histogram, buf, sizeof(buf));
+         LOG_INF("%s", buf);
+      }
+   }
+   if (reset) {
+      LOG_INF("histograms reset.");
+   }
+   return 0;
+}
+
+static void sh_cmd_histogram_help(void)
+{
+   LOG_INF("> help hist:");
+   LOG_INF("  hist       : show latency histograms.");
+   LOG_INF("  hist reset : reset latency histograms.");
+}
+
+SH_CMD(hist, NULL, "show latency histograms.", sh_cmd_histogram, sh_cmd_histogram_help, 0);
+
+#endif /* CONFIG_SH_CMD */
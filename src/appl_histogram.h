@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#ifndef APPL_HISTOGRAM_H
+#define APPL_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+/*
+ * Log2 buckets with 4 sub-buckets each, values 0 to 3 are exact.
+ * The resolution is 25%, the last bucket collects all values above 131071.
+ */
+#define APPL_HISTOGRAM_BUCKETS 64
+
+struct appl_histogram {
+   const char *name;
+   const char *unit;
+   uint32_t buckets[APPL_HISTOGRAM_BUCKETS];
+   uint32_t count;
+   uint32_t max;
+   uint64_t sum;
+};
+
+#ifdef CONFIG_APPL_HISTOGRAM
+
+#define APPL_HISTOGRAM_DEFINE(_name, _unit)                               \
+   static STRUCT_SECTION_ITERABLE(appl_histogram, histogram_##_name) = { \
+       .name = #_name,                                                   \
+       .unit = _unit,                                                    \
+   }
+
+#define APPL_HISTOGRAM_ADD(_name, _value) appl_histogram_add(&histogram_##_name, _value)
+
+/* start time for APPL_HISTOGRAM_ADD_US */
+#define APPL_HISTOGRAM_START() k_cycle_get_32()
+
+#define APPL_HISTOGRAM_ADD_US(_name, _start) \
+   appl_histogram_add(&histogram_##_name, k_cyc_to_us_floor32(k_cycle_get_32() - (_start)))
+
+void appl_histogram_add(struct appl_histogram *histogram, uint32_t value);
+
+void appl_histogram_merge(struct appl_histogram *histogram, const struct appl_histogram *other);
+
+void appl_histogram_reset(struct appl_histogram *histogram);
+
+/* copy the histogram consistently */
+void appl_histogram_copy(struct appl_histogram *histogram, const struct appl_histogram *other);
+
+/**
+ * Get the percentile of the values.
+ *
+ * @param histogram histogram
+ * @param percent percent, 0 to 100
+ * @return upper bound of the bucket with the percentile, at most the maximum value
+ */
+uint32_t appl_histogram_percentile(const struct appl_histogram *histogram, int percent);
+
+/**
+ * Describe the histogram, "<name>: <count>#, avg. <avg>, p50 <p50>, p90 <p90>, p99 <p99>, max. <max> <unit>".
+ *
+ * @return length of the text
+ */
+int appl_histogram_desc(const struct appl_histogram *histogram, char *buf, size_t len);
+
+/**
+ * Describe all histograms with values compact, "<name>:<count>,<p50>,<p90>,<max>" separated by blanks.
+ *
+ * @return length of the text
+ */
+int appl_histogram_desc_all(char *buf, size_t len);
+
+#else /* CONFIG_APPL_HISTOGRAM */
+
+#define APPL_HISTOGRAM_DEFINE(_name, _unit)
+#define APPL_HISTOGRAM_ADD(_name, _value) (void)(_value)
+#define APPL_HISTOGRAM_START() 0
+#define APPL_HISTOGRAM_ADD_US(_name, _start) (void)(_start)
+
+#endif /* CONFIG_APPL_HISTOGRAM */
+
+#endif /* APPL_HISTOGRAM_H */
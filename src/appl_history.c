@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "appl_history.h"
+#include "appl_storage.h"
+#include "appl_storage_config.h"
+#include "appl_time.h"
+#include "io_job_queue.h"
+#include "modem.h"
+#include "parse.h"
+#include "power_manager.h"
+
+#include "sh_cmd.h"
+
+#ifdef CONFIG_COAP_UPLOAD
+#include "coap_upload.h"
+#endif /* CONFIG_COAP_UPLOAD */
+
+LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
+
+static K_MUTEX_DEFINE(history_mutex);
+
+/* last recorded scan summary, recorded again only if changed */
+static uint8_t history_scan[HISTORY_VALUE_SIZE];
+static size_t history_scan_len = 0;
+
+int appl_history_snapshot(const char *cause)
+{
+   int rc;
+   int res = 0;
+   size_t len;
+   uint16_t voltage = PM_INVALID_VOLTAGE;
+   uint8_t data[HISTORY_VALUE_SIZE + 1];
+
+   if (!power_manager_voltage(&voltage, NULL) && voltage != PM_INVALID_VOLTAGE) {
+      sys_put_be16(voltage, data);
+      rc = appl_storage_write_record(HISTORY_ID, APPL_HISTORY_BATTERY, data, sizeof(uint16_t));
+      if (rc) {
+         LOG_INF("History: add battery failed, %d (%s)", rc, strerror(-rc));
+         return rc;
+      }
+      ++res;
+   }
+
+   len = modem_get_last_neighbor_cell_meas((char *)data, sizeof(data));
+   if (len > 0) {
+      k_mutex_lock(&history_mutex, K_FOREVER);
+      if (len != history_scan_len || memcmp(data, history_scan, len)) {
+         rc = appl_storage_write_record(HISTORY_ID, APPL_HISTORY_SCAN, data, len);
+         if (!rc) {
+            history_scan_len = len;
+            memcpy(history_scan, data, len);
+            ++res;
+         } else {
+            LOG_INF("History: add scan failed, %d (%s)", rc, strerror(-rc));
+         }
+      }
+      k_mutex_unlock(&history_mutex);
+   }
+   if (res) {
+      LOG_INF("History: %d records added, %s", res, cause ? cause : "");
+   }
+   return res;
+}
+
+int appl_history_print_record(char *buf, size_t len, int64_t time, uint8_t type, const uint8_t *data, size_t data_len)
+{
+   int index = appl_format_time(time, buf, len);
+
+   switch (type) {
+      case APPL_HISTORY_BATTERY:
+         if (data_len < sizeof(uint16_t)) {
+            return -EINVAL;
+         }
+         index += snprintf(buf + index, len - index, " %u mV", sys_get_be16(data));
+         break;
+      case APPL_HISTORY_SCAN:
+         index += snprintf(buf + index, len - index, " %.*s", (int)data_len, (const char *)data);
+         break;
+      default:
+         index += snprintf(buf + index, len - index, " type %u, %u bytes", type, (unsigned int)data_len);
+         break;
+   }
+   return index;
+}
+
+static void appl_history_sample_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(appl_history_sample_work, appl_history_sample_fn);
+
+static void appl_history_sample_fn(struct k_work *work)
+{
+   (void)work;
+   appl_history_snapshot("interval");
+   work_schedule_for_io_queue(&appl_history_sample_work, K_MINUTES(CONFIG_APPL_HISTORY_INTERVAL));
+}
+
+static int appl_history_start(void)
+{
+   work_schedule_for_io_queue(&appl_history_sample_work, K_MINUTES(CONFIG_APPL_HISTORY_INTERVAL));
+   return 0;
+}
+
+SYS_INIT(appl_history_start, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#ifdef CONFIG_COAP_UPLOAD
+/* all records as text, one per line, newest first */
+static struct appl_storage_iterator history_upload_iter;
+static size_t history_upload_offset = 0;
+static size_t history_upload_len = 0;
+static char history_upload_line[HISTORY_VALUE_SIZE + 40];
+
+static int appl_history_upload_start(void)
+{
+   history_upload_offset = 0;
+   history_upload_len = 0;
+   /* size unknown */
+   return appl_storage_iterator_init(&history_upload_iter, HISTORY_ID, 0, INT64_MAX);
+}
+
+static int appl_history_upload_read(uint8_t *buf, size_t len)
+{
+   int rc;
+   size_t res = 0;
+   int64_t time = 0;
+   uint8_t type = 0;
+   uint8_t data[HISTORY_VALUE_SIZE];
+
+   while (res < len) {
+      if (history_upload_offset == history_upload_len) {
+         rc = appl_storage_iterator_next(&history_upload_iter, &time, &type, data, sizeof(data));
+         if (rc == -ENODATA) {
+            break;
+         } else if (rc < 0) {
+            return rc;
+         }
+         rc = appl_history_print_record(history_upload_line, sizeof(history_upload_line) - 1,
+                                        time, type, data, MIN(rc, sizeof(data)));
+         if (rc <= 0) {
+            continue;
+         }
+         /* snprintf returns the untruncated length */
+         history_upload_len = MIN(rc, sizeof(history_upload_line) - 2);
+         history_upload_line[history_upload_len++] = '\n';
+         history_upload_offset = 0;
+      }
+      rc = MIN(history_upload_len - history_upload_offset, len - res);
+      memcpy(&buf[res], &history_upload_line[history_upload_offset], rc);
+      history_upload_offset += rc;
+      res += rc;
+   }
+   return res;
+}
+
+COAP_UPLOAD_PRODUCER(history, "battery and scan history.", appl_history_upload_start,
+                     appl_history_upload_read, NULL);
+#endif /* CONFIG_COAP_UPLOAD */
+
+#ifdef CONFIG_SH_CMD
+
+#define HISTORY_DEFAULT_HOURS 24
+
+static int sh_cmd_history(const char *parameter)
+{
+   int rc;
+   int count = 0;
+   long hours = HISTORY_DEFAULT_HOURS;
+   int64_t now = 0;
+   int64_t time = 0;
+   uint8_t type = 0;
+   uint8_t data[HISTORY_VALUE_SIZE];
+   char line[HISTORY_VALUE_SIZE + 40];
+   struct appl_storage_iterator iter;
+   const char *cur = parse_next_long(parameter, 10, &hours);
+
+   while (*cur == ' ') {
+      ++cur;
+   }
+   if (*cur || hours <= 0) {
+      return -EINVAL;
+   }
+   appl_get_now(&now);
+   rc = appl_storage_iterator_init(&iter, HISTORY_ID, now - hours * MSEC_PER_SEC * 60 * 60, now);
+   while (!rc) {
+      rc = appl_storage_iterator_next(&iter, &time, &type, data, sizeof(data));
+      if (rc >= 0) {
+         rc = appl_history_print_record(line, sizeof(line), time, type, data, MIN(rc, sizeof(data)));
+         if (rc > 0) {
+            LOG_INF("%s", line);
+            ++count;
+         }
+         rc = 0;
+      }
+   }
+   LOG_INF("History: %d records within %ld hours.", count, hours);
+   return rc == -ENODATA ? 0 : rc;
+}
+
+static void sh_cmd_history_help(void)
+{
+   LOG_INF("> help history:");
+   LOG_INF("  history         : show battery and scan history of the last %d hours.", HISTORY_DEFAULT_HOURS);
+   LOG_INF("  history <hours> : show battery and scan history of the last <hours>.");
+}
+
+SH_CMD(history, NULL, "show battery and scan history.", sh_cmd_history, sh_cmd_history_help, 0);
+
+#endif /* CONFIG_SH_CMD */
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#ifndef APPL_HISTORY_H
+#define APPL_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+   /* battery voltage in mV, 2 bytes big endian */
+   APPL_HISTORY_BATTERY = 'B',
+   /* summary of the last network scan, text */
+   APPL_HISTORY_SCAN = 'N',
+} appl_history_type_t;
+
+/**
+ * Append the battery voltage and a changed network scan summary to the
+ * history.
+ *
+ * @param cause cause for logging
+ * @return number of appended records, < 0 on failure
+ */
+int appl_history_snapshot(const char *cause);
+
+/**
+ * Print a history record.
+ *
+ * @param buf buffer for the text
+ * @param len length of the buffer
+ * @param time time of the record in milliseconds
+ * @param type type of the record
+ * @param data value of the record
+ * @param data_len length of the value
+ * @return length of the text, < 0 on failure
+ */
+int appl_history_print_record(char *buf, size_t len, int64_t time, uint8_t type, const uint8_t *data, size_t data_len);
+
+#endif /* APPL_HISTORY_H */
@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "appl_queue.h"
+#include "appl_storage.h"
+#include "appl_storage_config.h"
+#include "environment_sensor.h"
+#include "io_job_queue.h"
+
+#ifdef CONFIG_LOCATION_ENABLE
+#include "location.h"
+#endif
+
+#ifdef CONFIG_NAU7802_SCALE
+#include "nau7802.h"
+#endif
+
+#include "sh_cmd.h"
+
+LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
+
+/*
+ * Sample item:
+ * [0..1] sequence number, big endian
+ * [2]    type
+ * [3..]  values, big endian
+ *
+ * Delivered item:
+ * [0..1] sequence number of last delivered sample
+ */
+#define QUEUE_HEADER_SIZE 3
+#define QUEUE_ITEM_SIZE (QUEUE_HEADER_SIZE + APPL_QUEUE_PAYLOAD_SIZE)
+
+/* items read with a single storage read */
+#define QUEUE_READ_ITEMS 8
+
+/* reserve space for a single line, e.g. "!65535,1700000000,L,-90.000000,-180.000000,65535" */
+#define QUEUE_LINE_SIZE 50
+
+static K_MUTEX_DEFINE(queue_mutex);
+
+static bool queue_initialized = false;
+static uint16_t queue_seq = 0;
+static uint16_t queue_delivered_seq = 0;
+static uint16_t queue_prepared_seq = 0;
+static int queue_prepared = 0;
+static int queue_pending = 0;
+
+static int32_t appl_queue_round(double value)
+{
+   return (int32_t)(value < 0 ? value - 0.5 : value + 0.5);
+}
+
+static int appl_queue_print_scaled(char *buf, size_t len, int32_t value, int32_t scale)
+{
+   int prec = 0;
+   uint32_t abs_value = value < 0 ? -value : value;
+
+   for (int32_t factor = scale; factor > 1; factor /= 10) {
+      ++prec;
+   }
+   if (!prec) {
+      return snprintf(buf, len, "%d", value);
+   }
+   return snprintf(buf, len, "%s%u.%0*u", value < 0 ? "-" : "", abs_value / scale, prec, abs_value % scale);
+}
+
+/* call with queue_mutex locked */
+static void appl_queue_init(void)
+{
+   int rc;
+   int pending = 0;
+   int64_t time = 0;
+   uint8_t values[QUEUE_READ_ITEMS][QUEUE_ITEM_SIZE];
+
+   if (queue_initialized) {
+      return;
+   }
+   queue_initialized = true;
+
+   rc = appl_storage_read_bytes_item(QUEUE_MARK_ID, 0, &time, values[0], sizeof(uint16_t));
+   if (rc >= (int)sizeof(uint16_t)) {
+      queue_delivered_seq = sys_get_be16(values[0]);
+   }
+   rc = appl_storage_read_bytes_item(QUEUE_ID, 0, &time, values[0], QUEUE_ITEM_SIZE);
+   if (rc >= QUEUE_HEADER_SIZE) {
+      uint16_t max = sys_get_be16(values[0]) - queue_delivered_seq;
+
+      queue_seq = sys_get_be16(values[0]);
+      /* the oldest samples may already be overwritten */
+      while (pending < max) {
+         rc = appl_storage_read_bytes_items(QUEUE_ID, pending, NULL, &values[0][0], QUEUE_ITEM_SIZE,
+                                            MIN(QUEUE_READ_ITEMS, max - pending));
+         if (rc <= 0) {
+            break;
+         }
+         for (int item = 0; item < rc && pending < max; ++item) {
+            if (sys_get_be16(values[item]) == queue_delivered_seq) {
+               max = pending;
+            } else {
+               ++pending;
+            }
+         }
+         if (rc < QUEUE_READ_ITEMS) {
+            break;
+         }
+      }
+   } else {
+      queue_seq = queue_delivered_seq;
+   }
+   queue_pending = pending;
+   LOG_INF("Queue: %d pending samples (seq %u, delivered %u).", pending, queue_seq, queue_delivered_seq);
+}
+
+int appl_queue_add(appl_queue_type_t type, const uint8_t *data, size_t len)
+{
+   int rc;
+   uint8_t value[QUEUE_ITEM_SIZE];
+
+   if (len > APPL_QUEUE_PAYLOAD_SIZE) {
+      return -EINVAL;
+   }
+   memset(value, 0, sizeof(value));
+   k_mutex_lock(&queue_mutex, K_FOREVER);
+   appl_queue_init();
+   sys_put_be16(queue_seq + 1, value);
+   value[2] = type;
+   memcpy(&value[QUEUE_HEADER_SIZE], data, len);
+   rc = appl_storage_write_bytes_item(QUEUE_ID, value, sizeof(value));
+   if (!rc) {
+      ++queue_seq;
+      ++queue_pending;
+   }
+   k_mutex_unlock(&queue_mutex);
+   if (rc) {
+      LOG_INF("Queue: add %c failed, %d (%s)", type, rc, strerror(-rc));
+   }
+   return rc;
+}
+
+int appl_queue_snapshot(const char *cause)
+{
+   int res = 0;
+   uint8_t data[APPL_QUEUE_PAYLOAD_SIZE];
+
+   (void)data;
+
+#ifdef CONFIG_ENVIRONMENT_SENSOR
+   {
+      double value = 0.0;
+      int16_t temperature = INT16_MIN;
+      int16_t humidity = INT16_MIN;
+      int16_t pressure = INT16_MIN;
+
+      if (!environment_get_temperature(&value)) {
+         temperature = environment_scale_value(value, ENVIRONMENT_TEMPERATURE_SCALE);
+      }
+      if (!environment_get_humidity(&value)) {
+         humidity = environment_scale_value(value, ENVIRONMENT_HUMIDITY_SCALE);
+      }
+      if (!environment_get_pressure(&value)) {
+         pressure = environment_scale_value(value, ENVIRONMENT_PRESSURE_SCALE);
+      }
+      if (temperature != INT16_MIN || humidity != INT16_MIN || pressure != INT16_MIN) {
+         sys_put_be16(temperature, &data[0]);
+         sys_put_be16(humidity, &data[2]);
+         sys_put_be16(pressure, &data[4]);
+         if (!appl_queue_add(APPL_QUEUE_ENV, data, 6)) {
+            ++res;
+         }
+      }
+   }
+#endif /* CONFIG_ENVIRONMENT_SENSOR */
+
+#ifdef CONFIG_NAU7802_SCALE
+   {
+      double valueA = 0.0;
+      double valueB = 0.0;
+      double temperatureA = 0.0;
+      double temperatureB = 0.0;
+      int rc = scale_sample(&valueA, &valueB, &temperatureA, &temperatureB);
+
+      if (rc > 0) {
+         /* grams, INT32_MIN for not available */
+         sys_put_be32(rc & 1 ? appl_queue_round(valueA * 1000) : INT32_MIN, &data[0]);
+         sys_put_be32(rc & 2 ? appl_queue_round(valueB * 1000) : INT32_MIN, &data[4]);
+         if (!appl_queue_add(APPL_QUEUE_SCALE, data, 8)) {
+            ++res;
+         }
+      }
+   }
+#endif /* CONFIG_NAU7802_SCALE */
+
+#ifdef CONFIG_LOCATION_ENABLE
+   {
+      bool pending = false;
+      struct modem_gnss_state result;
+
+      if (location_get(&result, &pending) == MODEM_GNSS_POSITION && result.valid) {
+         float accuracy = result.position.accuracy;
+
+         sys_put_be32(appl_queue_round(result.position.latitude * 1000000), &data[0]);
+         sys_put_be32(appl_queue_round(result.position.longitude * 1000000), &data[4]);
+         sys_put_be16(accuracy < UINT16_MAX ? (uint16_t)appl_queue_round(accuracy) : UINT16_MAX, &data[8]);
+         if (!appl_queue_add(APPL_QUEUE_LOCATION, data, 10)) {
+            ++res;
+         }
+      }
+   }
+#endif /* CONFIG_LOCATION_ENABLE */
+
+   if (res) {
+      LOG_INF("Queue: %d samples added, %s", res, cause ? cause : "");
+   }
+   return res;
+}
+
+static int appl_queue_print_sample(char *buf, size_t len, int64_t time, const uint8_t *value)
+{
+   int index = 0;
+   uint8_t type = value[2];
+   const uint8_t *data = &value[QUEUE_HEADER_SIZE];
+
+   index = snprintf(buf, len, "!%u,%lu,%c", sys_get_be16(value), (unsigned long)(time / MSEC_PER_SEC), type);
+   switch (type) {
+#ifdef CONFIG_ENVIRONMENT_SENSOR
+      case APPL_QUEUE_ENV: {
+         static const int32_t scales[] = {
+             ENVIRONMENT_TEMPERATURE_SCALE, ENVIRONMENT_HUMIDITY_SCALE, ENVIRONMENT_PRESSURE_SCALE};
+         for (int i = 0; i < 3; ++i) {
+            int16_t v = (int16_t)sys_get_be16(&data[i * 2]);
+            buf[index++] = ',';
+            if (v != INT16_MIN) {
+               index += appl_queue_print_scaled(buf + index, len - index, v, scales[i]);
+            }
+         }
+         break;
+      }
+#endif /* CONFIG_ENVIRONMENT_SENSOR */
+      case APPL_QUEUE_SCALE:
+         for (int i = 0; i < 2; ++i) {
+            int32_t v = (int32_t)sys_get_be32(&data[i * 4]);
+            buf[index++] = ',';
+            if (v != INT32_MIN) {
+               index += appl_queue_print_scaled(buf + index, len - index, v, 1000);
+            }
+         }
+         break;
+      case APPL_QUEUE_LOCATION:
+         buf[index++] = ',';
+         index += appl_queue_print_scaled(buf + index, len - index, (int32_t)sys_get_be32(&data[0]), 1000000);
+         buf[index++] = ',';
+         index += appl_queue_print_scaled(buf + index, len - index, (int32_t)sys_get_be32(&data[4]), 1000000);
+         index += snprintf(buf + index, len - index, ",%u", sys_get_be16(&data[8]));
+         break;
+      default:
+         break;
+   }
+   return index;
+}
+
+int appl_queue_prepare(char *buf, size_t len)
+{
+   int rc;
+   int index = 0;
+   int samples = 0;
+   int lost = 0;
+   int64_t times[QUEUE_READ_ITEMS];
+   uint8_t values[QUEUE_READ_ITEMS][QUEUE_ITEM_SIZE];
+
+   k_mutex_lock(&queue_mutex, K_FOREVER);
+   appl_queue_init();
+   queue_prepared = 0;
+   if (queue_pending) {
+      int item = queue_pending;
+      int end = MAX(queue_pending - CONFIG_APPL_STORE_FORWARD_BATCH, 0);
+
+      index = snprintf(buf, len, "Queue: %d samples", queue_pending);
+      /* oldest pending sample first, read in chunks */
+      while (item > end && (index + QUEUE_LINE_SIZE) < len) {
+         int count = MIN(item - end, QUEUE_READ_ITEMS);
+         rc = appl_storage_read_bytes_items(QUEUE_ID, item - count, times, &values[0][0], QUEUE_ITEM_SIZE, count);
+         if (rc < 0) {
+            break;
+         }
+         /* the oldest are overwritten or erased */
+         lost += count - rc;
+         while (rc > 0 && (index + QUEUE_LINE_SIZE) < len) {
+            --rc;
+            buf[index++] = '\n';
+            index += appl_queue_print_sample(buf + index, len - index, times[rc], values[rc]);
+            queue_prepared_seq = sys_get_be16(values[rc]);
+            ++samples;
+         }
+         item -= count;
+      }
+      queue_prepared = samples + lost;
+      if (!samples) {
+         index = 0;
+      }
+   }
+   k_mutex_unlock(&queue_mutex);
+   if (queue_prepared) {
+      LOG_INF("Queue: prepared %d samples, %d lost.", samples, lost);
+   }
+   return index;
+}
+
+int appl_queue_delivered(void)
+{
+   int rc = 0;
+   int delivered = 0;
+   uint8_t value[sizeof(uint16_t)];
+
+   k_mutex_lock(&queue_mutex, K_FOREVER);
+   delivered = queue_prepared;
+   if (queue_prepared) {
+      if (queue_pending > queue_prepared) {
+         queue_pending -= queue_prepared;
+      } else {
+         queue_pending = 0;
+      }
+      queue_prepared = 0;
+      queue_delivered_seq = queue_prepared_seq;
+      sys_put_be16(queue_delivered_seq, value);
+      rc = appl_storage_write_bytes_item(QUEUE_MARK_ID, value, sizeof(value));
+      LOG_INF("Queue: delivered up to %u, %d pending.", queue_delivered_seq, queue_pending);
+   }
+   k_mutex_unlock(&queue_mutex);
+   if (rc) {
+      LOG_INF("Queue: mark delivered failed, %d (%s)", rc, strerror(-rc));
+   }
+   return delivered;
+}
+
+void appl_queue_discard(void)
+{
+   k_mutex_lock(&queue_mutex, K_FOREVER);
+   queue_prepared = 0;
+   k_mutex_unlock(&queue_mutex);
+}
+
+int appl_queue_pending(void)
+{
+   int pending;
+
+   k_mutex_lock(&queue_mutex, K_FOREVER);
+   appl_queue_init();
+   pending = queue_pending;
+   k_mutex_unlock(&queue_mutex);
+   return pending;
+}
+
+#if CONFIG_APPL_STORE_FORWARD_INTERVAL > 0
+
+static void appl_queue_sample_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(appl_queue_sample_work, appl_queue_sample_fn);
+
+static void appl_queue_sample_fn(struct k_work *work)
+{
+   (void)work;
+   appl_queue_snapshot("interval");
+   work_schedule_for_io_queue(&appl_queue_sample_work, K_MINUTES(CONFIG_APPL_STORE_FORWARD_INTERVAL));
+}
+
+static int appl_queue_start(void)
+{
+   work_schedule_for_io_queue(&appl_queue_sample_work, K_MINUTES(CONFIG_APPL_STORE_FORWARD_INTERVAL));
+   return 0;
+}
+
+SYS_INIT(appl_queue_start, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#endif /* CONFIG_APPL_STORE_FORWARD_INTERVAL > 0 */
+
+#ifdef CONFIG_SH_CMD
+
+static int sh_cmd_queue(const char *parameter)
+{
+   (void)parameter;
+   int res = appl_queue_snapshot("sh-cmd");
+   LOG_INF("Queue: %d samples added, %d pending.", res, appl_queue_pending());
+   return 0;
+}
+
+SH_CMD(queue, NULL, "add current samples to store-and-forward queue.", sh_cmd_queue, NULL, 0);
+
+#endif /* CONFIG_SH_CMD */
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#ifndef APPL_QUEUE_H
+#define APPL_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define APPL_QUEUE_PAYLOAD_SIZE 13
+
+typedef enum {
+   APPL_QUEUE_ENV = 'E',
+   APPL_QUEUE_SCALE = 'S',
+   APPL_QUEUE_LOCATION = 'L',
+} appl_queue_type_t;
+
+/**
+ * Append a sample to the queue.
+ *
+ * @param type type of the sample
+ * @param data encoded sample values, big endian
+ * @param len length of the values, at most APPL_QUEUE_PAYLOAD_SIZE
+ * @return 0 on success, < 0 on failure
+ */
+int appl_queue_add(appl_queue_type_t type, const uint8_t *data, size_t len);
+
+/**
+ * Append the current sensor values, scale readings and GNSS fix.
+ *
+ * @param cause cause for logging
+ * @return number of appended samples, < 0 on failure
+ */
+int appl_queue_snapshot(const char *cause);
+
+/**
+ * Prepare the text payload with the oldest pending samples.
+ *
+ * Format "!<seq>,<unix-time>,<type>,<values>", one line per sample.
+ * The samples are only marked as delivered with appl_queue_delivered.
+ *
+ * @param buf buffer for the text
+ * @param len length of the buffer
+ * @return length of the text, 0, if no sample is pending.
+ */
+int appl_queue_prepare(char *buf, size_t len);
+
+/**
+ * Mark the samples of the last prepared payload as delivered.
+ *
+ * @return number of delivered samples, 0, if no sample was prepared.
+ */
+int appl_queue_delivered(void);
+
+/**
+ * Discard the last prepared payload.
+ *
+ * The samples stay pending. Used, if the payload isn't sent with the
+ * request, or the request failed.
+ */
+void appl_queue_discard(void);
+
+/**
+ * Check for pending samples.
+ *
+ * @return number of pending samples
+ */
+int appl_queue_pending(void);
+
+#endif /* APPL_QUEUE_H */
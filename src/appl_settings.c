@@ -56,6 +56,8 @@ LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
 #define SETTINGS_KEY_APN "apn"
 #define SETTINGS_KEY_BATTERY_PROFILE "bat"
 #define SETTINGS_KEY_REBOOTS "reboots"
+#define SETTINGS_KEY_DOWNLOAD "download"
+#define SETTINGS_KEY_DTLS_SESSION "session"
 
 #define SETTINGS_KEY_PSK_ID "psk_id"
 #define SETTINGS_KEY_PSK_KEY "psk_key"
@@ -94,6 +96,20 @@ static char coap_query[MAX_SETTINGS_VALUE_LENGTH] = {0};
 
 static uint8_t reboot_codes[REBOOT_SIZE * REBOOT_HISTORY];
 
+static uint8_t download_progress[APPL_SETTINGS_MAX_DOWNLOAD_PROGRESS_LENGTH];
+static uint8_t download_progress_len = 0;
+
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+#define DTLS_SESSION_KEY_LENGTH 16
+#define DTLS_SESSION_NONCE_LENGTH 12
+#define DTLS_SESSION_MAC_LENGTH 8
+#define DTLS_SESSION_STORE_LENGTH (DTLS_SESSION_NONCE_LENGTH + APPL_SETTINGS_MAX_DTLS_SESSION_LENGTH + DTLS_SESSION_MAC_LENGTH)
+
+/* nonce, encrypted session, mac */
+static uint8_t dtls_session[DTLS_SESSION_STORE_LENGTH];
+static uint8_t dtls_session_len = 0;
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
+
 #ifdef CONFIG_SH_CMD_UNLOCK
 static unsigned char unlock_password[DTLS_PSK_MAX_KEY_LEN + 1] = {0};
 #endif /* CONFIG_SH_CMD_UNLOCK */
@@ -540,6 +556,26 @@ static int appl_settings_handle_set(const char *name, size_t len, settings_read_
          return 0;
       }
 
+      if (appl_settings_key_match(name, SETTINGS_KEY_DOWNLOAD, name_len)) {
+         k_mutex_lock(&settings_mutex, K_FOREVER);
+         res = read_cb(cb_arg, download_progress, sizeof(download_progress));
+         download_progress_len = res > 0 ? res : 0;
+         k_mutex_unlock(&settings_mutex);
+         LOG_INF("download: %d bytes", res);
+         return 0;
+      }
+
+      if (appl_settings_key_match(name, SETTINGS_KEY_DTLS_SESSION, name_len)) {
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+         k_mutex_lock(&settings_mutex, K_FOREVER);
+         res = read_cb(cb_arg, dtls_session, sizeof(dtls_session));
+         dtls_session_len = res > 0 ? res : 0;
+         k_mutex_unlock(&settings_mutex);
+         LOG_INF("dtls session: %d bytes", res);
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
+         return 0;
+      }
+
       if (appl_settings_key_match(name, SETTINGS_KEY_ID, name_len)) {
          res = read_cb(cb_arg, &buf, sizeof(device_id) - 1);
          k_mutex_lock(&settings_mutex, K_FOREVER);
@@ -656,6 +692,14 @@ static int appl_settings_handle_export(int (*cb)(const char *name,
    (void)cb(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_COAP_PATH, coap_path, strlen(coap_path));
    (void)cb(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_COAP_QUERY, coap_query, strlen(coap_query));
    (void)cb(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_REBOOTS, reboot_codes, sizeof(reboot_codes));
+   if (download_progress_len) {
+      (void)cb(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_DOWNLOAD, download_progress, download_progress_len);
+   }
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+   if (dtls_session_len) {
+      (void)cb(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_DTLS_SESSION, dtls_session, dtls_session_len);
+   }
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
    (void)cb(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_APN, apn, strlen(apn));
    (void)cb(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_BATTERY_PROFILE, &battery_profile, sizeof(battery_profile));
 #ifdef CONFIG_SH_CMD_UNLOCK
@@ -1367,6 +1411,167 @@ int appl_settings_add_reboot_code(uint16_t reboot_code)
    return settings_save_one(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_REBOOTS, reboot_codes, sizeof(reboot_codes));
 }
 
+int appl_settings_get_download_progress(uint8_t *buf, size_t len)
+{
+   int res = 0;
+
+   k_mutex_lock(&settings_mutex, K_FOREVER);
+   if (download_progress_len) {
+      if (download_progress_len > len) {
+         res = -ENOMEM;
+      } else {
+         memcpy(buf, download_progress, download_progress_len);
+         res = download_progress_len;
+      }
+   }
+   k_mutex_unlock(&settings_mutex);
+
+   return res;
+}
+
+int appl_settings_set_download_progress(const uint8_t *buf, size_t len)
+{
+   if (len > sizeof(download_progress)) {
+      return -ENOMEM;
+   }
+   k_mutex_lock(&settings_mutex, K_FOREVER);
+   if (len) {
+      memcpy(download_progress, buf, len);
+   }
+   download_progress_len = len;
+   k_mutex_unlock(&settings_mutex);
+   if (len) {
+      return settings_save_one(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_DOWNLOAD, buf, len);
+   } else {
+      return settings_delete(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_DOWNLOAD);
+   }
+}
+
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+/* the session key is derived from the device's credentials, call with settings_mutex locked */
+static int appl_settings_dtls_session_key(uint8_t *key)
+{
+   dtls_hmac_context_t hmac;
+   uint8_t digest[DTLS_HMAC_DIGEST_SIZE];
+   const unsigned char *secret = NULL;
+   size_t secret_len = 0;
+
+#ifdef DTLS_PSK
+   if (psk_key_length) {
+      secret = psk_key;
+      secret_len = psk_key_length;
+   }
+#endif /* DTLS_PSK */
+#ifdef DTLS_ECC
+   if (!secret && !is_zero(ecdsa_priv_key, sizeof(ecdsa_priv_key))) {
+      secret = ecdsa_priv_key;
+      secret_len = sizeof(ecdsa_priv_key);
+   }
+#endif /* DTLS_ECC */
+   if (!secret) {
+      return -ENOENT;
+   }
+   dtls_hmac_init(&hmac, secret, secret_len);
+   dtls_hmac_update(&hmac, (const unsigned char *)SETTINGS_KEY_DTLS_SESSION, strlen(SETTINGS_KEY_DTLS_SESSION));
+   dtls_hmac_finalize(&hmac, digest);
+   memcpy(key, digest, DTLS_SESSION_KEY_LENGTH);
+   memset(digest, 0, sizeof(digest));
+   return 0;
+}
+
+int appl_settings_get_dtls_session(uint8_t *buf, size_t len)
+{
+   uint8_t key[DTLS_SESSION_KEY_LENGTH];
+   uint8_t plain[APPL_SETTINGS_MAX_DTLS_SESSION_LENGTH + DTLS_SESSION_MAC_LENGTH];
+   int res = 0;
+
+   k_mutex_lock(&settings_mutex, K_FOREVER);
+   if (dtls_session_len > DTLS_SESSION_NONCE_LENGTH + DTLS_SESSION_MAC_LENGTH) {
+      res = appl_settings_dtls_session_key(key);
+      if (!res) {
+         res = dtls_decrypt(dtls_session + DTLS_SESSION_NONCE_LENGTH,
+                            dtls_session_len - DTLS_SESSION_NONCE_LENGTH,
+                            plain, dtls_session, key, sizeof(key), NULL, 0);
+         if (res < 0) {
+            res = -EBADMSG;
+         } else if (res > len) {
+            res = -ENOMEM;
+         } else {
+            memcpy(buf, plain, res);
+         }
+      }
+   }
+   k_mutex_unlock(&settings_mutex);
+   memset(key, 0, sizeof(key));
+   memset(plain, 0, sizeof(plain));
+
+   return res;
+}
+
+int appl_settings_set_dtls_session(const uint8_t *buf, size_t len)
+{
+   uint8_t key[DTLS_SESSION_KEY_LENGTH];
+   int res = 0;
+
+   if (len > APPL_SETTINGS_MAX_DTLS_SESSION_LENGTH) {
+      return -ENOMEM;
+   }
+   k_mutex_lock(&settings_mutex, K_FOREVER);
+   if (len) {
+      res = appl_settings_dtls_session_key(key);
+      if (!res) {
+         dtls_prng(dtls_session, DTLS_SESSION_NONCE_LENGTH);
+         res = dtls_encrypt(buf, len, dtls_session + DTLS_SESSION_NONCE_LENGTH,
+                            dtls_session, key, sizeof(key), NULL, 0);
+         if (res < 0) {
+            res = -EINVAL;
+         } else {
+            dtls_session_len = DTLS_SESSION_NONCE_LENGTH + res;
+            res = settings_save_one(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_DTLS_SESSION, dtls_session, dtls_session_len);
+         }
+      }
+      memset(key, 0, sizeof(key));
+   } else if (dtls_session_len) {
+      dtls_session_len = 0;
+      res = settings_delete(SETTINGS_SERVICE_NAME "/" SETTINGS_KEY_DTLS_SESSION);
+   }
+   k_mutex_unlock(&settings_mutex);
+
+   return res;
+}
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
+
+#ifdef CONFIG_UDP_WAKEUP_ENABLE
+int appl_settings_wakeup_mac(const uint8_t *data, size_t len, uint8_t *mac, size_t mac_len)
+{
+   int res = -ENOENT;
+#ifdef DTLS_PSK
+   dtls_hmac_context_t hmac;
+   uint8_t digest[DTLS_HMAC_DIGEST_SIZE];
+
+   if (mac_len > sizeof(digest)) {
+      return -EINVAL;
+   }
+   k_mutex_lock(&settings_mutex, K_FOREVER);
+   if (psk_key_length) {
+      dtls_hmac_init(&hmac, psk_key, psk_key_length);
+      dtls_hmac_update(&hmac, data, len);
+      dtls_hmac_finalize(&hmac, digest);
+      memcpy(mac, digest, mac_len);
+      memset(digest, 0, sizeof(digest));
+      res = mac_len;
+   }
+   k_mutex_unlock(&settings_mutex);
+#else  /* DTLS_PSK */
+   (void)data;
+   (void)len;
+   (void)mac;
+   (void)mac_len;
+#endif /* DTLS_PSK */
+   return res;
+}
+#endif /* CONFIG_UDP_WAKEUP_ENABLE */
+
 #if defined(DTLS_ECC)
 
 static uint8 *
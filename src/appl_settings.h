@@ -20,6 +20,12 @@
 
 #define MAX_SETTINGS_VALUE_LENGTH 64
 
+/* maximum length of the plain persisted DTLS session */
+#define APPL_SETTINGS_MAX_DTLS_SESSION_LENGTH 128
+
+/* maximum length of the persisted download progress */
+#define APPL_SETTINGS_MAX_DOWNLOAD_PROGRESS_LENGTH 96
+
 int appl_settings_init(const char *imei, dtls_handler_t* handler);
 
 int appl_settings_get_apn(char* buf, size_t len);
@@ -36,6 +42,14 @@ int appl_settings_get_battery_profile(void);
 int appl_settings_get_reboot_code(size_t index, int64_t* time, uint16_t* code);
 int appl_settings_add_reboot_code(uint16_t reboot_code);
 
+int appl_settings_get_download_progress(uint8_t* buf, size_t len);
+int appl_settings_set_download_progress(const uint8_t* buf, size_t len);
+
+int appl_settings_get_dtls_session(uint8_t* buf, size_t len);
+int appl_settings_set_dtls_session(const uint8_t* buf, size_t len);
+
+int appl_settings_wakeup_mac(const uint8_t* data, size_t len, uint8_t* mac, size_t mac_len);
+
 int appl_settings_get_provisioning(char *buf, size_t len);
 bool appl_settings_is_provisioning(void);
 void appl_settings_provisioning_done(void);
@@ -21,6 +21,7 @@
 #include <stddef.h>
 #include <stdio.h>
 
+#include "appl_histogram.h"
 #include "appl_storage.h"
 #include "appl_storage_config.h"
 #include "appl_time.h"
@@ -46,6 +47,27 @@ LOG_MODULE_REGISTER(STORAGE, CONFIG_STORAGE_LOG_LEVEL);
 #define MAX_ITEM_SIZE (TIME_SIZE + MAX_VALUE_SIZE)
 #define HEADER_SIZE 10
 
+/*
+ * Flash storages start each page with a sequence number, incremented for
+ * every page entered. The pages of the ring are therefore sorted by their
+ * sequence number, with one step down at the current write page, and that
+ * page is found by binary search.
+ */
+#define PAGE_SEQ_SIZE 4
+
+/* used to read several items with a single device read */
+#define BULK_READ_SIZE 256
+
+/*
+ * Records start with the length of the record, the type and the time in
+ * seconds, and end with the length again to read them backwards. Records
+ * don't cross pages, the rest of a page is left erased.
+ */
+#define RECORD_HEADER_SIZE 6
+#define RECORD_OVERHEAD (RECORD_HEADER_SIZE + 1)
+#define MAX_RECORD_LEN (RECORD_OVERHEAD + MAX_RECORD_SIZE)
+#define RECORDS_HEADER_FLAG 0x8000
+
 enum storage_init_state {
    STORAGE_NOT_INITIALIZED,
    STORAGE_INITIALIZED,
@@ -57,12 +79,24 @@ struct storage_setup {
    uint8_t header[HEADER_SIZE];
    uint8_t erase_value;
    enum storage_init_state init_state;
+   bool paged;
    size_t page_size;
+   size_t block_size;
    size_t item_size;
+   size_t items;
+   uint32_t page_seq;
    off_t headers_offset;
    off_t start_offset;
    off_t current_offset;
    off_t end_offset;
+   uint32_t device_writes;
+   uint32_t item_writes;
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+   /* appended items, not yet written */
+   off_t cache_offset;
+   size_t cache_len;
+   uint8_t cache[CONFIG_APPL_STORAGE_WRITE_CACHE];
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
 };
 
 static size_t storage_setups_count = 0;
@@ -139,6 +173,9 @@ static int appl_eeprom_storage_get_page_info_by_offs(off_t mem_addr, struct flas
 
 #if defined(CONFIG_FLASH_APPL_STORAGE)
 
+APPL_HISTOGRAM_DEFINE(flash_write, "us");
+APPL_HISTOGRAM_DEFINE(flash_erase, "us");
+
 static int appl_flash_storage_read_memory(const struct device *storage_device, off_t mem_addr, uint8_t *data, size_t num_bytes)
 {
    int rc = flash_read(storage_device, mem_addr, data, num_bytes);
@@ -152,7 +189,9 @@ static int appl_flash_storage_read_memory(const struct device *storage_device, o
 
 static int appl_flash_storage_write_memory(const struct device *storage_device, off_t mem_addr, const uint8_t *data, size_t num_bytes)
 {
+   uint32_t start = APPL_HISTOGRAM_START();
    int rc = flash_write(storage_device, mem_addr, data, num_bytes);
+   APPL_HISTOGRAM_ADD_US(flash_write, start);
    if (rc) {
       LOG_INF("Storage: writing %d@0x%lx failed, %d", num_bytes, mem_addr, rc);
       k_sleep(K_MSEC(1000));
@@ -164,7 +203,9 @@ static int appl_flash_storage_write_memory(const struct device *storage_device,
 
 static int appl_flash_storage_erase_memory(const struct device *storage_device, off_t mem_addr, size_t num_bytes)
 {
+   uint32_t start = APPL_HISTOGRAM_START();
    int rc = flash_erase(storage_device, mem_addr, num_bytes);
+   APPL_HISTOGRAM_ADD_US(flash_erase, start);
    if (rc) {
       LOG_INF("Storage: erasing %d@0x%lx failed, %d", num_bytes, mem_addr, rc);
    } else {
@@ -279,6 +320,103 @@ static bool is_erased(const uint8_t *data, size_t len, uint8_t erase_value)
    return true;
 }
 
+/*
+ * Paged storages use a block per page, otherwise the whole storage area
+ * is a single block. Items don't cross block boundaries.
+ */
+static off_t appl_storage_block_start(const struct storage_setup *setup, off_t offset)
+{
+   return setup->headers_offset + ((offset - setup->headers_offset) / setup->block_size) * setup->block_size;
+}
+
+static off_t appl_storage_block_first_item(const struct storage_setup *setup, off_t block)
+{
+   if (block == setup->headers_offset) {
+      return setup->start_offset;
+   }
+   return block + PAGE_SEQ_SIZE;
+}
+
+static off_t appl_storage_block_last_item(const struct storage_setup *setup, off_t block)
+{
+   off_t first = appl_storage_block_first_item(setup, block);
+   return first + ((block + setup->block_size - first) / setup->item_size - 1) * setup->item_size;
+}
+
+static off_t appl_storage_page_seq_offset(const struct storage_setup *setup, off_t block)
+{
+   if (block == setup->headers_offset) {
+      return block + HEADER_SIZE;
+   }
+   return block;
+}
+
+static off_t appl_storage_next_offset(const struct storage_setup *setup, off_t offset)
+{
+   off_t block = appl_storage_block_start(setup, offset);
+
+   offset += setup->item_size;
+   if (offset + setup->item_size > block + setup->block_size) {
+      block += setup->block_size;
+      if (block >= setup->end_offset) {
+         block = setup->headers_offset;
+      }
+      offset = appl_storage_block_first_item(setup, block);
+   }
+   return offset;
+}
+
+static off_t appl_storage_prev_offset(const struct storage_setup *setup, off_t offset)
+{
+   off_t block = appl_storage_block_start(setup, offset);
+
+   if (offset == appl_storage_block_first_item(setup, block)) {
+      if (block == setup->headers_offset) {
+         block = setup->end_offset;
+      }
+      block -= setup->block_size;
+      return appl_storage_block_last_item(setup, block);
+   }
+   return offset - setup->item_size;
+}
+
+static int appl_storage_read_page_seq(const struct storage_setup *setup, off_t block, uint32_t *seq)
+{
+   uint8_t data[PAGE_SEQ_SIZE];
+   int rc = appl_storage_read_memory(setup->config, appl_storage_page_seq_offset(setup, block), data, sizeof(data));
+   if (!rc) {
+      if (is_erased(data, sizeof(data), setup->erase_value)) {
+         rc = -ENODATA;
+      } else {
+         *seq = sys_get_be32(data);
+      }
+   }
+   return rc;
+}
+
+/* call with storage_mutex locked, writes the sequence number on entering a page */
+static int appl_storage_enter_page(struct storage_setup *setup, off_t offset)
+{
+   int rc = 0;
+   uint32_t seq = 0;
+   off_t block = appl_storage_block_start(setup, offset);
+
+   if (setup->paged && offset == appl_storage_block_first_item(setup, block)) {
+      rc = appl_storage_read_page_seq(setup, block, &seq);
+      if (rc == -ENODATA) {
+         uint8_t data[PAGE_SEQ_SIZE];
+
+         seq = setup->page_seq + 1;
+         sys_put_be32(seq, data);
+         rc = appl_storage_write_memory(setup->config, appl_storage_page_seq_offset(setup, block), data, sizeof(data));
+      }
+      if (!rc) {
+         setup->page_seq = seq;
+      }
+   }
+   return rc;
+}
+
 static void appl_storage_init_headers(const struct storage_setup *setup)
 {
    appl_storage_write_memory(setup->config, setup->headers_offset, setup->header, sizeof(setup->header));
@@ -296,40 +434,262 @@ static int appl_storage_format(struct storage_setup *setup)
    } else {
       appl_storage_init_headers(setup);
       setup->current_offset = setup->start_offset;
+      setup->page_seq = 0;
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+      setup->cache_len = 0;
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
       LOG_INF("Storage %s: format ready.", setup->config->desc);
    }
    k_mutex_unlock(&storage_mutex);
    return rc;
 }
 
+/* call with storage_mutex locked, writes consecutive items of a block */
+static int appl_storage_write_block(struct storage_setup *setup, off_t offset, const uint8_t *data, size_t len)
+{
+   int rc;
+   uint8_t next_data = 0;
+   off_t next = appl_storage_next_offset(setup, offset + len - setup->item_size);
+
+   rc = appl_storage_read_memory(setup->config, next, &next_data, sizeof(next_data));
+   if (!rc) {
+      if (next_data != setup->erase_value) {
+         if (setup->config->is_flash_device) {
+            struct flash_pages_info info;
+            rc = appl_storage_get_page_info_by_offs(setup->config, next, &info);
+            rc = rc || appl_storage_erase_memory(setup->config, info.start_offset, info.size);
+            if (!rc && info.start_offset == setup->headers_offset) {
+               appl_storage_init_headers(setup);
+            }
+         } else {
+            rc = appl_storage_erase_memory(setup->config, next, 1);
+         }
+      }
+      rc = rc || appl_storage_enter_page(setup, offset);
+      rc = rc || appl_storage_write_memory(setup->config, offset, data, len);
+      if (!rc) {
+         setup->device_writes++;
+      }
+   }
+   return rc;
+}
+
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+/* call with storage_mutex locked */
+static int appl_storage_flush(struct storage_setup *setup)
+{
+   int rc = 0;
+
+   if (setup->cache_len) {
+      if (setup->config->records) {
+         /* the page is entered with the first record */
+         rc = appl_storage_write_memory(setup->config, setup->cache_offset, setup->cache, setup->cache_len);
+         if (!rc) {
+            setup->device_writes++;
+         }
+      } else {
+         rc = appl_storage_write_block(setup, setup->cache_offset, setup->cache, setup->cache_len);
+      }
+      if (rc) {
+         /* keep the ring consistent, the cached items are lost */
+         LOG_INF("Storage %s: flush %u bytes failed, %d", setup->config->desc, setup->cache_len, rc);
+         setup->current_offset = setup->cache_offset;
+      }
+      setup->cache_len = 0;
+   }
+   return rc;
+}
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+
+/* call with storage_mutex locked, returns 1, if no free item is found */
+static int appl_storage_scan_offset(struct storage_setup *setup, off_t from, off_t to)
+{
+   int rc = 0;
+   uint8_t data[BULK_READ_SIZE];
+   off_t block = appl_storage_block_start(setup, from);
+   off_t offset = appl_storage_block_first_item(setup, block);
+
+   while (offset < to) {
+      off_t last = appl_storage_block_last_item(setup, block);
+      /* read the items of the block in chunks */
+      while (offset <= last) {
+         size_t items = MIN((last - offset) / setup->item_size + 1, sizeof(data) / setup->item_size);
+         rc = appl_storage_read_memory(setup->config, offset, data, items * setup->item_size);
+         if (rc) {
+            return rc;
+         }
+         for (int index = 0; index < items * setup->item_size; index += setup->item_size) {
+            if (is_erased(&data[index], TIME_SIZE, setup->erase_value)) {
+               setup->current_offset = offset + index;
+               return 0;
+            }
+         }
+         offset += items * setup->item_size;
+      }
+      block += setup->block_size;
+      offset = appl_storage_block_first_item(setup, block);
+   }
+   return 1;
+}
+
+/* call with storage_mutex locked, binary search for the last page of the ring */
+static int appl_storage_search_page(struct storage_setup *setup, off_t *page)
+{
+   int rc;
+   uint32_t first = 0;
+   uint32_t seq = 0;
+   size_t low = 0;
+   size_t high = (setup->end_offset - setup->headers_offset) / setup->block_size;
+
+   rc = appl_storage_read_page_seq(setup, setup->headers_offset, &first);
+   if (rc) {
+      return rc;
+   }
+   setup->page_seq = first;
+   /* pages [0, low] are in sequence, pages [high, end) are not */
+   while (high - low > 1) {
+      size_t mid = low + (high - low) / 2;
+      rc = appl_storage_read_page_seq(setup, setup->headers_offset + mid * setup->block_size, &seq);
+      if (!rc && seq == first + mid) {
+         low = mid;
+         setup->page_seq = seq;
+      } else if (!rc || rc == -ENODATA) {
+         high = mid;
+      } else {
+         return rc;
+      }
+   }
+   *page = setup->headers_offset + low * setup->block_size;
+   return 0;
+}
+
+/* call with storage_mutex locked */
+static void appl_storage_max_page_seq(struct storage_setup *setup)
+{
+   uint32_t seq = 0;
+
+   setup->page_seq = 0;
+   for (off_t block = setup->headers_offset; block < setup->end_offset; block += setup->block_size) {
+      if (!appl_storage_read_page_seq(setup, block, &seq) && (int32_t)(seq - setup->page_seq) > 0) {
+         setup->page_seq = seq;
+      }
+   }
+}
+
+/* call with storage_mutex locked, returns 1, if the page is full */
+static int appl_storage_scan_records(struct storage_setup *setup, off_t block)
+{
+   int rc = 0;
+   uint8_t data[BULK_READ_SIZE];
+   off_t end = block + setup->block_size;
+   off_t offset = appl_storage_block_first_item(setup, block);
+   off_t chunk = end;
+   size_t chunk_len = 0;
+
+   while (offset + RECORD_OVERHEAD <= end) {
+      uint8_t len;
+
+      if (offset >= chunk + chunk_len) {
+         chunk = offset;
+         chunk_len = MIN(sizeof(data), end - offset);
+         rc = appl_storage_read_memory(setup->config, chunk, data, chunk_len);
+         if (rc) {
+            return rc;
+         }
+      }
+      len = data[offset - chunk];
+      if (len == setup->erase_value) {
+         setup->current_offset = offset;
+         return 0;
+      }
+      if (len < RECORD_OVERHEAD || offset + len > end) {
+         LOG_INF("Storage %s: invalid record 0x%lx", setup->config->desc, offset);
+         break;
+      }
+      offset += len;
+   }
+   return 1;
+}
+
+/* call with storage_mutex locked */
+static int appl_storage_init_records(struct storage_setup *setup)
+{
+   off_t page = setup->headers_offset;
+   int rc = appl_storage_search_page(setup, &page);
+
+   if (rc == -ENODATA) {
+      /* first page not entered, use the page with the highest sequence number */
+      uint32_t seq = 0;
+
+      setup->page_seq = 0;
+      for (off_t block = setup->headers_offset; block < setup->end_offset; block += setup->block_size) {
+         if (!appl_storage_read_page_seq(setup, block, &seq) &&
+             (!setup->page_seq || (int32_t)(seq - setup->page_seq) > 0)) {
+            setup->page_seq = seq;
+            page = block;
+         }
+      }
+      if (!setup->page_seq) {
+         setup->current_offset = setup->start_offset;
+         return 0;
+      }
+      rc = 0;
+   }
+   if (!rc) {
+      rc = appl_storage_scan_records(setup, page);
+      if (rc == 1) {
+         /* page full, the next page is erased on entering it */
+         page += setup->block_size;
+         if (page >= setup->end_offset) {
+            page = setup->headers_offset;
+         }
+         setup->current_offset = appl_storage_block_first_item(setup, page);
+         rc = 0;
+      }
+      LOG_DBG("Storage %s: page 0x%lx, seq %u", setup->config->desc, page, setup->page_seq);
+   }
+   return rc;
+}
+
 static int appl_storage_init_offset(struct storage_setup *setup)
 {
    int rc = 0;
-   uint8_t data[MAX_ITEM_SIZE];
+   uint8_t data[HEADER_SIZE];
 
    k_mutex_lock(&storage_mutex, K_FOREVER);
-   if (!(rc = appl_storage_read_memory(setup->config, setup->headers_offset, data, sizeof(setup->header)))) {
+   if (!(rc = appl_storage_read_memory(setup->config, setup->headers_offset, data, sizeof(data)))) {
       if (memcmp(data, setup->header, sizeof(setup->header)) != 0) {
          LOG_HEXDUMP_DBG(setup->header, sizeof(setup->header), "Storage: header expected");
-         LOG_HEXDUMP_DBG(data, sizeof(setup->header), "Storage: header read");
+         LOG_HEXDUMP_DBG(data, sizeof(data), "Storage: header read");
          rc = appl_storage_format(setup);
+      } else if (setup->config->records) {
+         rc = appl_storage_init_records(setup);
       } else {
-         int addr;
-         for (addr = setup->start_offset; addr < setup->end_offset; addr += sizeof(data)) {
-            if (!(rc = appl_storage_read_memory(setup->config, addr, data, sizeof(data)))) {
-               for (int index = 0;
-                    index < sizeof(data) && (addr + index) < setup->end_offset;
-                    index += setup->item_size) {
-                  if (is_erased(&data[index], TIME_SIZE, setup->erase_value)) {
-                     setup->current_offset = addr + index;
-                     k_mutex_unlock(&storage_mutex);
-                     return rc;
-                  }
+         off_t page = 0;
+         if (setup->paged && !appl_storage_search_page(setup, &page)) {
+            rc = appl_storage_scan_offset(setup, page, page + setup->block_size);
+            if (rc == 1) {
+               /* page full, the next page is erased in advance */
+               setup->current_offset = appl_storage_next_offset(setup, appl_storage_block_last_item(setup, page));
+               rc = 0;
+            }
+            if (!rc) {
+               rc = appl_storage_read_memory(setup->config, setup->current_offset, data, TIME_SIZE);
+               if (!rc && is_erased(data, TIME_SIZE, setup->erase_value)) {
+                  LOG_DBG("Storage %s: page 0x%lx, seq %u", setup->config->desc, page, setup->page_seq);
+                  k_mutex_unlock(&storage_mutex);
+                  return rc;
                }
             }
          }
-         LOG_INF("Storage %s: missing free entry!", setup->config->desc);
-         rc = appl_storage_format(setup);
+         /* not paged or inconsistent pages, scan all items */
+         rc = appl_storage_scan_offset(setup, setup->headers_offset, setup->end_offset);
+         if (rc == 1) {
+            LOG_INF("Storage %s: missing free entry!", setup->config->desc);
+            rc = appl_storage_format(setup);
+         } else if (setup->paged) {
+            appl_storage_max_page_seq(setup);
+         }
       }
    }
    k_mutex_unlock(&storage_mutex);
@@ -379,22 +739,42 @@ static int appl_storage_init_setup(struct storage_setup *setup, const struct sto
 {
    struct flash_pages_info info;
    int rc = appl_storage_get_page_info_by_offs(config, end, &info);
+   if (!rc && config->records &&
+       (!config->is_flash_device || config->pages < 2 || config->value_size > MAX_RECORD_SIZE)) {
+      LOG_WRN("Storage %s: records require 2 flash pages and up to %d bytes", config->desc, MAX_RECORD_SIZE);
+      return -ENOTSUP;
+   }
    if (!rc) {
       setup->config = config;
       setup->erase_value = appl_storage_get_erase_value(config);
+      setup->paged = config->is_flash_device;
       setup->page_size = info.size;
-      setup->item_size = (config->value_size + TIME_SIZE);
-      size_t header_size = setup->item_size;
-      while (header_size < HEADER_SIZE) {
-         header_size += setup->item_size;
+      setup->item_size = config->records ? 0 : (config->value_size + TIME_SIZE);
+      size_t header_size = HEADER_SIZE + PAGE_SEQ_SIZE;
+      if (!config->records) {
+         header_size = setup->item_size;
+         while (header_size < HEADER_SIZE + (setup->paged ? PAGE_SEQ_SIZE : 0)) {
+            header_size += setup->item_size;
+         }
       }
       setup->headers_offset = end;
       setup->start_offset = end + header_size;
       setup->current_offset = setup->start_offset;
       setup->end_offset = setup->headers_offset + config->pages * info.size;
+      setup->block_size = setup->paged ? info.size : setup->end_offset - setup->headers_offset;
+      setup->page_seq = 0;
+      setup->device_writes = 0;
+      setup->item_writes = 0;
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+      setup->cache_len = 0;
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+      setup->items = 0;
+      for (off_t block = setup->headers_offset; block < setup->end_offset && !config->records; block += setup->block_size) {
+         setup->items += (appl_storage_block_last_item(setup, block) - appl_storage_block_first_item(setup, block)) / setup->item_size + 1;
+      }
       sys_put_be32(config->magic, setup->header);
       sys_put_be32(config->version, &(setup->header[4]));
-      sys_put_be16(config->value_size, &(setup->header[8]));
+      sys_put_be16(config->value_size | (config->records ? RECORDS_HEADER_FLAG : 0), &(setup->header[8]));
       rc = appl_storage_init_offset(setup);
       LOG_INF("Storage %s: page-size 0x%x, off 0x%lx, index 0x%x", config->desc,
               info.size, info.start_offset, info.index);
@@ -421,6 +801,7 @@ int appl_storage_add(const struct storage_config *config)
    {
       uint8_t data[16];
       size_t index_setup = 0;
+      off_t start = 0;
       struct storage_setup *setup = NULL;
 
       for (; index_setup < storage_setups_count; ++index_setup) {
@@ -432,24 +813,38 @@ int appl_storage_add(const struct storage_config *config)
 
       if (setup) {
          LOG_INF("Storage reinit %s at %d", config->desc, index_setup);
-      } else {
+         /* keep the area, other storages may follow on the device */
+         start = setup->headers_offset;
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+         if (setup->init_state == STORAGE_INITIALIZED) {
+            appl_storage_flush(setup);
+         }
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+      } else if (index_setup < MAX_STORAGE_SETUPS) {
          setup = &storage_setups[index_setup];
          LOG_INF("Storage add %s at %d", config->desc, index_setup);
+      } else {
+         LOG_WRN("Storage %s: no setup left, max. %d", config->desc, MAX_STORAGE_SETUPS);
+         rc = -ENOMEM;
+         goto exit_add;
       }
 
-      rc = appl_storage_init_setup(setup, config, 0);
+      rc = appl_storage_init_setup(setup, config, start);
       if (rc) {
          setup->init_state = STORAGE_INITIALIZE_ERROR;
          goto exit_add;
       }
       setup->init_state = STORAGE_INITIALIZED;
 
-      for (off_t addr = setup->headers_offset; addr < setup->end_offset; addr += sizeof(data)) {
-         rc = appl_storage_read_memory(setup->config, addr, data, sizeof(data));
-         if (!rc && !is_erased(data, sizeof(data), setup->erase_value)) {
-            char label[48];
-            snprintf(label, sizeof(label), "Storage %s: @0x%lx", config->desc, addr);
-            LOG_HEXDUMP_DBG(data, sizeof(data), label);
+      /* dumping reads the whole area */
+      if (Z_LOG_CONST_LEVEL_CHECK(LOG_LEVEL_DBG)) {
+         for (off_t addr = setup->headers_offset; addr < setup->end_offset; addr += sizeof(data)) {
+            if (!appl_storage_read_memory(setup->config, addr, data, sizeof(data)) &&
+                !is_erased(data, sizeof(data), setup->erase_value)) {
+               char label[48];
+               snprintf(label, sizeof(label), "Storage %s: @0x%lx", config->desc, addr);
+               LOG_HEXDUMP_DBG(data, sizeof(data), label);
+            }
          }
       }
       if (storage_setups_count == index_setup) {
@@ -481,7 +876,13 @@ static int appl_storage_init(void)
          ok = !appl_storage_check_config(config);
       }
       if (ok) {
-         struct storage_setup *setup = &storage_setups[index_setup];
+         struct storage_setup *setup = NULL;
+         if (index_setup >= MAX_STORAGE_SETUPS) {
+            LOG_WRN("Storage %s: no setup left, max. %d", config->desc, MAX_STORAGE_SETUPS);
+            storage_setups_count = index_setup;
+            return -ENOMEM;
+         }
+         setup = &storage_setups[index_setup];
          rc = appl_storage_init_setup(setup, config, end);
          if (rc) {
             storage_setups[index_setup].init_state = STORAGE_INITIALIZE_ERROR;
@@ -500,7 +901,7 @@ static int appl_storage_init(void)
 
    while (index_setup < storage_setups_count && !rc) {
       struct storage_setup *setup = &storage_setups[index_setup++];
-      if (setup->init_state == STORAGE_INITIALIZED) {
+      if (setup->init_state == STORAGE_INITIALIZED && Z_LOG_CONST_LEVEL_CHECK(LOG_LEVEL_DBG)) {
          for (off_t addr = setup->headers_offset; addr < setup->end_offset; addr += sizeof(data)) {
             rc = appl_storage_read_memory(setup->config, addr, data, sizeof(data));
             if (!rc && !is_erased(data, sizeof(data), setup->erase_value)) {
@@ -519,78 +920,122 @@ SYS_INIT(appl_storage_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
 
 static int appl_storage_write_item(struct storage_setup *setup, int64_t time, const uint8_t *value, size_t value_size)
 {
-   int rc;
-   int next;
-   int data_size = setup->item_size + 1;
-   uint8_t data[MAX_ITEM_SIZE + 1];
+   int rc = 0;
+   off_t next;
+   uint8_t data[MAX_ITEM_SIZE];
 
    memset(data, 0, sizeof(data));
+   time = (time / MSEC_PER_SEC) & 0x7fffffffffffL;
+   sys_put_be48(time, data);
+   value_size = MIN(value_size, setup->config->value_size);
+   memmove(&data[TIME_SIZE], value, value_size);
+
    k_mutex_lock(&storage_mutex, K_FOREVER);
-   if (setup->current_offset + data_size <= setup->end_offset) {
-      rc = appl_storage_read_memory(setup->config, setup->current_offset, data, data_size);
-      next = setup->current_offset + setup->item_size;
-   } else {
-      rc = appl_storage_read_memory(setup->config, setup->current_offset, data, setup->item_size);
-      next = setup->start_offset;
-      rc = rc || appl_storage_read_memory(setup->config, next, &data[setup->item_size], 1);
-   }
-   if (!rc) {
-      if (data[setup->item_size] != setup->erase_value) {
-         if (setup->config->is_flash_device) {
-            struct flash_pages_info info;
-            rc = appl_storage_get_page_info_by_offs(setup->config, next, &info);
-            rc = rc || appl_storage_erase_memory(setup->config, info.start_offset, info.size);
-            if (!rc && info.start_offset == setup->headers_offset) {
-               appl_storage_init_headers(setup);
-            }
-         } else {
-            rc = appl_storage_erase_memory(setup->config, next, 1);
-         }
+   next = appl_storage_next_offset(setup, setup->current_offset);
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+   if (setup->item_size <= sizeof(setup->cache)) {
+      if (!setup->cache_len) {
+         setup->cache_offset = setup->current_offset;
       }
-      time = (time / MSEC_PER_SEC) & 0x7fffffffffffL;
-      sys_put_be48(time, data);
-      value_size = MIN(value_size, setup->config->value_size);
-      memmove(&data[TIME_SIZE], value, value_size);
-      rc = rc || appl_storage_write_memory(setup->config, setup->current_offset, data, setup->item_size);
-      if (!rc) {
-         setup->current_offset = next;
+      memmove(&setup->cache[setup->cache_len], data, setup->item_size);
+      setup->cache_len += setup->item_size;
+      setup->current_offset = next;
+      setup->item_writes++;
+      if (next != setup->cache_offset + setup->cache_len ||
+          setup->cache_len + setup->item_size > sizeof(setup->cache)) {
+         /* end of block or cache full */
+         rc = appl_storage_flush(setup);
       }
+      k_mutex_unlock(&storage_mutex);
+      return rc;
+   }
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+   rc = appl_storage_write_block(setup, setup->current_offset, data, setup->item_size);
+   if (!rc) {
+      setup->current_offset = next;
+      setup->item_writes++;
    }
    k_mutex_unlock(&storage_mutex);
 
    return rc;
 }
 
-static int appl_storage_read_item(const struct storage_setup *setup, off_t *current, int64_t *times, uint8_t *value, size_t value_size)
+/* read items and apply the not yet written items of the cache */
+static int appl_storage_read_cached(const struct storage_setup *setup, off_t offset, uint8_t *data, size_t len)
 {
-   int rc = 0;
-   off_t offset;
-   uint8_t data[MAX_ITEM_SIZE];
+   int rc;
 
-   offset = *current;
-   if (offset == setup->start_offset) {
-      offset = setup->end_offset;
+   k_mutex_lock(&storage_mutex, K_FOREVER);
+   rc = appl_storage_read_memory(setup->config, offset, data, len);
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+   if (!rc && setup->cache_len) {
+      off_t start = MAX(offset, setup->cache_offset);
+      off_t end = MIN(offset + len, setup->cache_offset + setup->cache_len);
+      if (start < end) {
+         memmove(&data[start - offset], &setup->cache[start - setup->cache_offset], end - start);
+      }
    }
-   offset -= setup->item_size;
-   rc = appl_storage_read_memory(setup->config, offset, data, setup->item_size);
-   if (!rc) {
-      if (is_erased(data, TIME_SIZE, setup->erase_value)) {
-         rc = 0;
-      } else {
-         rc = setup->config->value_size;
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+   k_mutex_unlock(&storage_mutex);
+   return rc;
+}
+
+/*
+ * Read up to count items, newest first, starting with the item before the
+ * offset. Consecutive items of a block are read with a single device read.
+ * Returns the number of read items, stops at the first erased item.
+ */
+static int appl_storage_read_items(const struct storage_setup *setup, off_t *current, int64_t *times,
+                                   uint8_t *values, size_t value_size, size_t count)
+{
+   int rc = 0;
+   size_t read = 0;
+   off_t offset = *current;
+   uint8_t data[BULK_READ_SIZE];
+
+   value_size = MIN(value_size, setup->config->value_size);
+   while (read < count) {
+      off_t last = appl_storage_prev_offset(setup, offset);
+      off_t first = appl_storage_block_first_item(setup, appl_storage_block_start(setup, last));
+      size_t items = MIN((last - first) / setup->item_size + 1, sizeof(data) / setup->item_size);
+
+      items = MIN(items, count - read);
+      offset = last - (items - 1) * setup->item_size;
+      rc = appl_storage_read_cached(setup, offset, data, items * setup->item_size);
+      if (rc) {
+         break;
+      }
+      /* newest item at the end */
+      for (int index = (items - 1) * setup->item_size; index >= 0; index -= setup->item_size) {
+         if (is_erased(&data[index], TIME_SIZE, setup->erase_value)) {
+            return read;
+         }
          if (times) {
-            *times = sys_get_be48(data) * MSEC_PER_SEC;
+            times[read] = sys_get_be48(&data[index]) * MSEC_PER_SEC;
          }
-         if (value) {
-            rc = MIN(value_size, rc);
-            memmove(value, &data[TIME_SIZE], rc);
+         if (values) {
+            memmove(&values[read * value_size], &data[index + TIME_SIZE], value_size);
          }
+         *current = offset + index;
+         ++read;
       }
    }
-   if (current) {
-      *current = offset;
+   return read ? read : rc;
+}
+
+/* offset after the item with the index, newest item 0 */
+static int appl_storage_read_offset(const struct storage_setup *setup, size_t index, off_t *offset)
+{
+   if (index >= setup->items) {
+      return -ENODATA;
    }
-   return rc;
+   k_mutex_lock(&storage_mutex, K_FOREVER);
+   *offset = setup->current_offset;
+   k_mutex_unlock(&storage_mutex);
+   while (index--) {
+      *offset = appl_storage_prev_offset(setup, *offset);
+   }
+   return 0;
 }
 
 int appl_storage_write_int_item(size_t id, uint16_t code)
@@ -606,30 +1051,29 @@ int appl_storage_read_int_items(size_t id, size_t index, int64_t *times, uint16_
    int rc = -EINVAL;
    const struct storage_setup *setup = appl_storage_setup(id);
    if (setup) {
+      uint8_t data[sizeof(uint16_t) * 16];
       size_t read = 0;
-      off_t current;
-      uint8_t data[sizeof(uint16_t)];
+      off_t offset;
 
-      k_mutex_lock(&storage_mutex, K_FOREVER);
-      current = setup->current_offset;
-      k_mutex_unlock(&storage_mutex);
+      if (appl_storage_read_offset(setup, index, &offset)) {
+         return 0;
+      }
+      count = MIN(count, setup->items - index);
       while (read < count) {
+         size_t items = MIN(count - read, sizeof(data) / sizeof(uint16_t));
          LOG_DBG("Read %s %d/%d", setup->config->desc, read, count);
-         rc = appl_storage_read_item(setup, &current, times, data, sizeof(data));
+         rc = appl_storage_read_items(setup, &offset, times ? &times[read] : NULL, data, sizeof(uint16_t), items);
          if (rc <= 0) {
             break;
          }
-         if (index > 0) {
-            --index;
-         } else {
-            if (times) {
-               ++times;
-            }
-            if (codes) {
-               *codes = sys_get_be16(data);
-               ++codes;
+         if (codes) {
+            for (int item = 0; item < rc; ++item) {
+               codes[read + item] = sys_get_be16(&data[item * sizeof(uint16_t)]);
             }
-            ++read;
+         }
+         read += rc;
+         if (rc < items) {
+            break;
          }
       }
       if (read) {
@@ -642,7 +1086,7 @@ int appl_storage_read_int_items(size_t id, size_t index, int64_t *times, uint16_
 int appl_storage_write_bytes_item(size_t id, uint8_t *data, size_t data_size)
 {
    struct storage_setup *setup = appl_storage_setup(id);
-   if (setup) {
+   if (setup && !setup->config->records) {
       int64_t now = 0;
       appl_get_now(&now);
       return appl_storage_write_item(setup, now, data, data_size);
@@ -656,20 +1100,20 @@ int appl_storage_read_bytes_item(size_t id, size_t index, int64_t *time, uint8_t
    int rc = -EINVAL;
    const struct storage_setup *setup = appl_storage_setup(id);
    if (setup) {
-      off_t current;
+      uint8_t value[MAX_VALUE_SIZE];
+      off_t offset;
 
-      k_mutex_lock(&storage_mutex, K_FOREVER);
-      current = setup->current_offset;
-      k_mutex_unlock(&storage_mutex);
-      rc = 1;
-      while (index--) {
-         rc = appl_storage_read_item(setup, &current, NULL, NULL, 0);
-         if (rc <= 0) {
-            break;
-         }
+      rc = appl_storage_read_offset(setup, index, &offset);
+      if (rc) {
+         return 0;
       }
+      rc = appl_storage_read_items(setup, &offset, time, value, sizeof(value), 1);
       if (rc > 0) {
-         rc = appl_storage_read_item(setup, &current, time, data, data_size);
+         rc = setup->config->value_size;
+         if (data) {
+            rc = MIN(data_size, rc);
+            memmove(data, value, rc);
+         }
       }
       if (rc < 0) {
          LOG_INF("Read %s: failed, %d (%s)", setup->config->desc, rc, strerror(-rc));
@@ -680,6 +1124,311 @@ int appl_storage_read_bytes_item(size_t id, size_t index, int64_t *time, uint8_t
    return rc;
 }
 
+int appl_storage_read_bytes_items(size_t id, size_t index, int64_t *times, uint8_t *data, size_t data_size, size_t count)
+{
+   int rc = -EINVAL;
+   const struct storage_setup *setup = appl_storage_setup(id);
+   if (setup) {
+      off_t offset;
+
+      if (appl_storage_read_offset(setup, index, &offset)) {
+         return 0;
+      }
+      count = MIN(count, setup->items - index);
+      rc = appl_storage_read_items(setup, &offset, times, data, data_size, count);
+      if (rc < 0) {
+         LOG_INF("Read %s: failed, %d (%s)", setup->config->desc, rc, strerror(-rc));
+      } else {
+         LOG_DBG("Read %s: %d items", setup->config->desc, rc);
+      }
+   }
+   return rc;
+}
+
+/* call with storage_mutex locked, erases a page of old records and writes the sequence number */
+static int appl_storage_enter_records_page(struct storage_setup *setup, off_t block)
+{
+   uint32_t seq = 0;
+   uint8_t data[PAGE_SEQ_SIZE];
+   int rc = appl_storage_read_page_seq(setup, block, &seq);
+
+   if (!rc && seq == setup->page_seq) {
+      /* already entered */
+      return 0;
+   }
+   if (!rc) {
+      rc = appl_storage_erase_memory(setup->config, block, setup->block_size);
+      if (!rc && block == setup->headers_offset) {
+         appl_storage_init_headers(setup);
+      }
+   } else if (rc == -ENODATA) {
+      rc = 0;
+   }
+   if (!rc) {
+      seq = setup->page_seq + 1;
+      sys_put_be32(seq, data);
+      rc = appl_storage_write_memory(setup->config, appl_storage_page_seq_offset(setup, block), data, sizeof(data));
+   }
+   if (!rc) {
+      setup->page_seq = seq;
+   }
+   return rc;
+}
+
+/* call with storage_mutex locked */
+static int appl_storage_append_record(struct storage_setup *setup, const uint8_t *data, size_t len)
+{
+   int rc = 0;
+   bool cached = false;
+   off_t block = appl_storage_block_start(setup, setup->current_offset);
+
+   if (setup->current_offset + len > block + setup->block_size) {
+      block += setup->block_size;
+      if (block >= setup->end_offset) {
+         block = setup->headers_offset;
+      }
+      setup->current_offset = appl_storage_block_first_item(setup, block);
+   }
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+   if (setup->cache_len && (setup->cache_offset + setup->cache_len != setup->current_offset ||
+                            setup->cache_len + len > sizeof(setup->cache))) {
+      /* other page or cache full */
+      rc = appl_storage_flush(setup);
+      if (rc) {
+         return rc;
+      }
+   }
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+   if (setup->current_offset == appl_storage_block_first_item(setup, block)) {
+      rc = appl_storage_enter_records_page(setup, block);
+      if (rc) {
+         return rc;
+      }
+   }
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+   if (len <= sizeof(setup->cache)) {
+      if (!setup->cache_len) {
+         setup->cache_offset = setup->current_offset;
+      }
+      memmove(&setup->cache[setup->cache_len], data, len);
+      setup->cache_len += len;
+      cached = true;
+   }
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+   if (!cached) {
+      rc = appl_storage_write_memory(setup->config, setup->current_offset, data, len);
+      if (rc) {
+         return rc;
+      }
+      setup->device_writes++;
+   }
+   setup->current_offset += len;
+   setup->item_writes++;
+   if (setup->current_offset + RECORD_OVERHEAD > block + setup->block_size) {
+      /* page full, the next page is entered with the next record */
+      block += setup->block_size;
+      if (block >= setup->end_offset) {
+         block = setup->headers_offset;
+      }
+      setup->current_offset = appl_storage_block_first_item(setup, block);
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+      rc = appl_storage_flush(setup);
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+   }
+   return rc;
+}
+
+int appl_storage_write_record(size_t id, uint8_t type, const uint8_t *data, size_t data_size)
+{
+   int rc = -EINVAL;
+   struct storage_setup *setup = appl_storage_setup(id);
+
+   if (setup && setup->config->records && data_size <= setup->config->value_size) {
+      int64_t now = 0;
+      uint8_t record[MAX_RECORD_LEN];
+      size_t len = data_size + RECORD_OVERHEAD;
+
+      appl_get_now(&now);
+      record[0] = len;
+      record[1] = type;
+      sys_put_be32(now / MSEC_PER_SEC, &record[2]);
+      memmove(&record[RECORD_HEADER_SIZE], data, data_size);
+      record[len - 1] = len;
+
+      k_mutex_lock(&storage_mutex, K_FOREVER);
+      rc = appl_storage_append_record(setup, record, len);
+      k_mutex_unlock(&storage_mutex);
+   }
+   return rc;
+}
+
+int appl_storage_iterator_init(struct appl_storage_iterator *iter, size_t id, int64_t from, int64_t to)
+{
+   const struct storage_setup *setup = appl_storage_setup(id);
+
+   if (!setup || !setup->config->records) {
+      return -EINVAL;
+   }
+   iter->id = id;
+   iter->from = from;
+   iter->to = to;
+   iter->done = false;
+   k_mutex_lock(&storage_mutex, K_FOREVER);
+   iter->offset = setup->current_offset;
+   iter->block = appl_storage_block_start(setup, iter->offset);
+   iter->page_seq = setup->page_seq;
+   if (iter->offset == appl_storage_block_first_item(setup, iter->block)) {
+      /* page not entered yet */
+      iter->page_seq++;
+   }
+   k_mutex_unlock(&storage_mutex);
+   return 0;
+}
+
+/* call with storage_mutex locked, continues with the end of the previous page */
+static int appl_storage_prev_records_page(const struct storage_setup *setup, struct appl_storage_iterator *iter)
+{
+   uint8_t data[BULK_READ_SIZE];
+   uint32_t seq = 0;
+   off_t block = (iter->block == setup->headers_offset ? setup->end_offset : iter->block) - setup->block_size;
+   off_t first = appl_storage_block_first_item(setup, block);
+   off_t end = block + setup->block_size;
+   int rc = appl_storage_read_page_seq(setup, block, &seq);
+
+   if (rc) {
+      return rc;
+   } else if (seq != iter->page_seq - 1) {
+      return -ENODATA;
+   }
+   iter->block = block;
+   iter->page_seq = seq;
+   iter->offset = first;
+   /* the last record ends with its length, followed by erased bytes */
+   while (end > first) {
+      size_t len = MIN(sizeof(data), end - first);
+
+      rc = appl_storage_read_cached(setup, end - len, data, len);
+      if (rc) {
+         return rc;
+      }
+      for (int index = len - 1; index >= 0; --index) {
+         if (data[index] != setup->erase_value) {
+            iter->offset = end - len + index + 1;
+            return 0;
+         }
+      }
+      end -= len;
+   }
+   return 0;
+}
+
+int appl_storage_iterator_next(struct appl_storage_iterator *iter, int64_t *time, uint8_t *type, uint8_t *data, size_t data_size)
+{
+   int rc = 0;
+   uint32_t seq = 0;
+   uint8_t record[MAX_RECORD_LEN];
+   const struct storage_setup *setup = appl_storage_setup(iter->id);
+
+   if (!setup || !setup->config->records) {
+      return -EINVAL;
+   }
+   k_mutex_lock(&storage_mutex, K_FOREVER);
+   while (!iter->done) {
+      off_t first = appl_storage_block_first_item(setup, iter->block);
+      off_t start = MAX(first, iter->offset - (off_t)sizeof(record));
+      size_t len;
+      int64_t record_time;
+
+      if (iter->offset <= first) {
+         rc = appl_storage_prev_records_page(setup, iter);
+         if (rc) {
+            break;
+         }
+         continue;
+      }
+      /* the page may be overwritten in the meantime */
+      rc = appl_storage_read_page_seq(setup, iter->block, &seq);
+      if (!rc && seq != iter->page_seq) {
+         rc = -ENODATA;
+      }
+      rc = rc || appl_storage_read_cached(setup, start, record, iter->offset - start);
+      if (rc) {
+         break;
+      }
+      len = record[iter->offset - start - 1];
+      if (len < RECORD_OVERHEAD || len > iter->offset - start || record[iter->offset - start - len] != len) {
+         LOG_INF("Storage %s: invalid record 0x%lx", setup->config->desc, iter->offset);
+         rc = -ENODATA;
+         break;
+      }
+      iter->offset -= len;
+      memmove(record, &record[iter->offset - start], len);
+      record_time = sys_get_be32(&record[2]) * MSEC_PER_SEC;
+      if (record_time > iter->to) {
+         continue;
+      } else if (record_time < iter->from) {
+         rc = -ENODATA;
+         break;
+      }
+      len -= RECORD_OVERHEAD;
+      if (time) {
+         *time = record_time;
+      }
+      if (type) {
+         *type = record[1];
+      }
+      if (data) {
+         memmove(data, &record[RECORD_HEADER_SIZE], MIN(len, data_size));
+      }
+      k_mutex_unlock(&storage_mutex);
+      return len;
+   }
+   if (rc) {
+      iter->done = true;
+   } else {
+      rc = -ENODATA;
+   }
+   k_mutex_unlock(&storage_mutex);
+   return rc;
+}
+
+int appl_storage_sync(size_t id)
+{
+   int rc = 0;
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+   k_mutex_lock(&storage_mutex, K_FOREVER);
+   for (int index = 0; index < storage_setups_count; ++index) {
+      struct storage_setup *setup = &storage_setups[index];
+      if (setup->init_state == STORAGE_INITIALIZED && (!id || setup->config->id == id)) {
+         int err = appl_storage_flush(setup);
+         if (err && !rc) {
+            rc = err;
+         }
+      }
+   }
+   k_mutex_unlock(&storage_mutex);
+#else  /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+   (void)id;
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+   return rc;
+}
+
+int appl_storage_get_writes(size_t id, uint32_t *items, uint32_t *writes)
+{
+   int rc = -EINVAL;
+   const struct storage_setup *setup;
+
+   k_mutex_lock(&storage_mutex, K_FOREVER);
+   setup = appl_storage_setup(id);
+   if (setup) {
+      *items = setup->item_writes;
+      *writes = setup->device_writes;
+      rc = 0;
+   }
+   k_mutex_unlock(&storage_mutex);
+   return rc;
+}
+
 #ifdef CONFIG_SH_CMD
 
 static int appl_storage_list(const char *parameter)
@@ -691,11 +1440,13 @@ static int appl_storage_list(const char *parameter)
    for (int index = 0; index < storage_setups_count; ++index) {
       const struct storage_setup *setup = &storage_setups[index];
       const struct storage_config *config = setup->config;
-      LOG_INF("Storage %s, ID %d at %d, %d bytes/value, %d bytes/pages",
-              config->desc, config->id, index, config->value_size, setup->page_size);
+      LOG_INF("Storage %s, ID %d at %d, %d bytes/%s, %d bytes/pages",
+              config->desc, config->id, index, config->value_size,
+              config->records ? "record max." : "value", setup->page_size);
       LOG_INF("Storage %s: 0x%lx-0x%lx, cur: 0x%lx (0x%02x erase-value)",
               config->desc, setup->headers_offset, setup->end_offset,
               setup->current_offset, setup->erase_value);
+      LOG_INF("Storage %s: %u items in %u writes", config->desc, setup->item_writes, setup->device_writes);
    }
 
    return 0;
@@ -784,4 +1535,52 @@ int appl_storage_read_bytes_item(size_t id, size_t index, int64_t *time, uint8_t
    return -ENOTSUP;
 }
 
+int appl_storage_sync(size_t id)
+{
+   (void)id;
+   return -ENOTSUP;
+}
+
+int appl_storage_get_writes(size_t id, uint32_t *items, uint32_t *writes)
+{
+   (void)items;
+   (void)writes;
+   return -ENOTSUP;
+}
+
+int appl_storage_read_bytes_items(size_t id, size_t index, int64_t *times, uint8_t *data, size_t data_size, size_t count)
+{
+   (void)times;
+   (void)data;
+   (void)data_size;
+   (void)count;
+   return -ENOTSUP;
+}
+
+int appl_storage_write_record(size_t id, uint8_t type, const uint8_t *data, size_t data_size)
+{
+   (void)type;
+   (void)data;
+   (void)data_size;
+   return -ENOTSUP;
+}
+
+int appl_storage_iterator_init(struct appl_storage_iterator *iter, size_t id, int64_t from, int64_t to)
+{
+   (void)iter;
+   (void)from;
+   (void)to;
+   return -ENOTSUP;
+}
+
+int appl_storage_iterator_next(struct appl_storage_iterator *iter, int64_t *time, uint8_t *type, uint8_t *data, size_t data_size)
+{
+   (void)iter;
+   (void)time;
+   (void)type;
+   (void)data;
+   (void)data_size;
+   return -ENOTSUP;
+}
+
 #endif /* defined(STORAGE_DEV_FLASH) || defined(STORAGE_DEV_EEPROM) */
\ No newline at end of file
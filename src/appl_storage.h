@@ -14,12 +14,25 @@
 #ifndef APPL_STORAGE_H
 #define APPL_STORAGE_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 #define MAX_VALUE_SIZE 26
+#define MAX_RECORD_SIZE 240
 
 struct storage_config;
 
+struct appl_storage_iterator {
+   size_t id;
+   int64_t from;
+   int64_t to;
+   off_t block;
+   off_t offset;
+   uint32_t page_seq;
+   bool done;
+};
+
 int appl_storage_add(const struct storage_config* cfg);
 
 int appl_storage_read_memory(const struct storage_config* cfg, off_t mem_addr, uint8_t *data, size_t num_bytes);
@@ -32,4 +45,31 @@ int appl_storage_read_int_items(size_t id, size_t index, int64_t* times, uint16_
 int appl_storage_write_bytes_item(size_t id, uint8_t* data, size_t data_size);
 int appl_storage_read_bytes_item(size_t id, size_t index, int64_t* time, uint8_t* data, size_t data_size);
 
+/* write the cached items of the storage with the id, 0 for all storages */
+int appl_storage_sync(size_t id);
+
+/* number of written items and device writes since the storage was added */
+int appl_storage_get_writes(size_t id, uint32_t* items, uint32_t* writes);
+
+/* read up to count items, newest first, data receives count * data_size bytes */
+int appl_storage_read_bytes_items(size_t id, size_t index, int64_t* times, uint8_t* data, size_t data_size, size_t count);
+
+/*
+ * Storages configured with records keep variable-length, typed records
+ * instead of fixed size items. A record uses 7 bytes in addition to its
+ * value and a value may have up to MAX_RECORD_SIZE bytes. A 2 bytes
+ * reading uses 9 bytes, one more than an item of a storage with
+ * value_size 2, but values of different types and sizes share one
+ * storage. Records are read with an iterator, newest first.
+ */
+
+/* append a record with the type, returns 0 on success */
+int appl_storage_write_record(size_t id, uint8_t type, const uint8_t* data, size_t data_size);
+
+/* iterate the records with times in [from, to] in milliseconds */
+int appl_storage_iterator_init(struct appl_storage_iterator* iter, size_t id, int64_t from, int64_t to);
+
+/* read the next record, returns the value length, -ENODATA at the end */
+int appl_storage_iterator_next(struct appl_storage_iterator* iter, int64_t* time, uint8_t* type, uint8_t* data, size_t data_size);
+
 #endif /* APPL_STORAGE_H */
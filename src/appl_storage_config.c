@@ -31,10 +31,45 @@ const struct storage_config storage_configs[] = {
      .is_flash_device = STORAGE_FLASH_DEVICE,
      .id = REBOOT_CODE_ID,
      .magic = 0x01200340,
-     .version = 2,
+     .version = 3,
      .value_size = sizeof(uint16_t),
      .pages = 4
-    }
+    },
+#ifdef CONFIG_APPL_STORE_FORWARD
+    {
+     .storage_device = DEVICE_DT_GET_OR_NULL(DT_STORAGE_DEV),
+     .desc = "queue",
+     .is_flash_device = STORAGE_FLASH_DEVICE,
+     .id = QUEUE_ID,
+     .magic = 0x01200341,
+     .version = 2,
+     .value_size = 16,
+     .pages = CONFIG_APPL_STORE_FORWARD_PAGES
+    },
+    {
+     .storage_device = DEVICE_DT_GET_OR_NULL(DT_STORAGE_DEV),
+     .desc = "queue-mark",
+     .is_flash_device = STORAGE_FLASH_DEVICE,
+     .id = QUEUE_MARK_ID,
+     .magic = 0x01200342,
+     .version = 2,
+     .value_size = sizeof(uint16_t),
+     .pages = 2
+    },
+#endif /* CONFIG_APPL_STORE_FORWARD */
+#ifdef CONFIG_APPL_HISTORY
+    {
+     .storage_device = DEVICE_DT_GET_OR_NULL(DT_STORAGE_DEV),
+     .desc = "history",
+     .is_flash_device = STORAGE_FLASH_DEVICE,
+     .id = HISTORY_ID,
+     .magic = 0x01200343,
+     .version = 1,
+     .value_size = HISTORY_VALUE_SIZE,
+     .pages = CONFIG_APPL_HISTORY_PAGES,
+     .records = true
+    },
+#endif /* CONFIG_APPL_HISTORY */
 #endif     
 };
 
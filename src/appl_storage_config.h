@@ -24,6 +24,16 @@
 #define CALIBRATION_B_ID 3
 #endif /* CONFIG_NAU7802_SCALE */
 
+#if defined(CONFIG_APPL_STORE_FORWARD)
+#define QUEUE_ID 4
+#define QUEUE_MARK_ID 5
+#endif /* CONFIG_APPL_STORE_FORWARD */
+
+#if defined(CONFIG_APPL_HISTORY)
+#define HISTORY_ID 6
+#define HISTORY_VALUE_SIZE 100
+#endif /* CONFIG_APPL_HISTORY */
+
 struct device;
 
 struct storage_config {
@@ -34,7 +44,10 @@ struct storage_config {
     int magic;
     int version;
     size_t pages;
+    /* maximum value size for records */
     size_t value_size;
+    /* variable-length, typed records instead of fixed size items, flash only */
+    bool records;
 };
 
 extern const struct storage_config storage_configs[];
@@ -15,9 +15,12 @@
 #include <stdio.h>
 #include <zephyr/dfu/flash_img.h>
 #include <zephyr/dfu/mcuboot.h>
+#include <zephyr/drivers/flash.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/storage/flash_map.h>
+#include <zephyr/storage/stream_flash.h>
+#include <zephyr/sys/crc.h>
 
 #include "appl_diagnose.h"
 #include "appl_update.h"
@@ -28,12 +31,15 @@ LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
 static struct flash_img_context dfu_context;
 static volatile int dfu_flash_area_id = -1;
 static volatile int64_t dfu_time = -1;
+/* offset of the stream, if a download is resumed */
+static size_t dfu_offset = 0;
 
 static int appl_update_init_context(void)
 {
    int rc;
 
    dfu_flash_area_id = -1;
+   dfu_offset = 0;
    memset(&dfu_context, 0, sizeof(dfu_context));
    rc = flash_img_init(&dfu_context);
    if (!rc) {
@@ -238,13 +244,92 @@ int appl_update_start(void)
    return rc;
 }
 
+#ifdef CONFIG_COAP_UPDATE_RESUME
+int appl_update_resume(size_t offset)
+{
+   const struct flash_area *fa;
+   int rc = appl_update_start();
+
+   if (!rc) {
+      fa = dfu_context.flash_area;
+      if (offset < fa->fa_size) {
+         /* continue the stream at the start of a flash page, */
+         /* the page is erased again by the next write */
+         rc = stream_flash_init(&dfu_context.stream, flash_area_get_device(fa),
+                                dfu_context.buf, sizeof(dfu_context.buf),
+                                fa->fa_off + offset, fa->fa_size - offset, NULL);
+      } else {
+         rc = -EINVAL;
+      }
+      if (rc) {
+         LOG_INF("Resume update at 0x%x failed, %d", offset, rc);
+         memset(&dfu_context, 0, sizeof(dfu_context));
+         dfu_flash_area_id = -1;
+         dfu_offset = 0;
+      } else {
+         dfu_offset = offset;
+      }
+   }
+   return rc;
+}
+
+int appl_update_written_page(size_t *offset)
+{
+   struct flash_pages_info info;
+   off_t area_offset;
+   int rc;
+
+   if (appl_reboots()) {
+      return -ESHUTDOWN;
+   }
+   if (!dfu_context.flash_area) {
+      return -EINVAL;
+   }
+   area_offset = dfu_context.flash_area->fa_off;
+   rc = flash_get_page_info_by_offs(flash_area_get_device(dfu_context.flash_area),
+                                    area_offset + dfu_offset + flash_img_bytes_written(&dfu_context),
+                                    &info);
+   if (!rc) {
+      *offset = info.start_offset - area_offset;
+   }
+   return rc;
+}
+
+int appl_update_crc(size_t offset, size_t len, uint32_t *crc)
+{
+   uint8_t buf[64];
+   uint32_t value = *crc;
+   int rc = 0;
+
+   if (appl_reboots()) {
+      return -ESHUTDOWN;
+   }
+   if (!dfu_context.flash_area) {
+      return -EINVAL;
+   }
+   while (len > 0) {
+      size_t chunk = MIN(len, sizeof(buf));
+      rc = flash_area_read(dfu_context.flash_area, offset, buf, chunk);
+      if (rc) {
+         LOG_INF("Read flash at 0x%x failed, %d", offset, rc);
+         return rc;
+      }
+      value = crc32_ieee_update(value, buf, chunk);
+      offset += chunk;
+      len -= chunk;
+   }
+   *crc = value;
+   return rc;
+}
+#endif /* CONFIG_COAP_UPDATE_RESUME */
+
 size_t appl_update_written(void)
 {
    if (appl_reboots()) {
       return -ESHUTDOWN;
    }
    if (dfu_context.flash_area) {
-      return flash_img_bytes_written(&dfu_context);
+      return dfu_offset + flash_img_bytes_written(&dfu_context);
    } else {
       return 0;
    }
@@ -279,7 +364,7 @@ int appl_update_finish(void)
       return -ESHUTDOWN;
    }
 
-   written = flash_img_bytes_written(&dfu_context);
+   written = dfu_offset + flash_img_bytes_written(&dfu_context);
    rc = flash_img_buffered_write(&dfu_context, NULL, 0, true);
    if (!rc) {
       if (dfu_time > -1) {
@@ -306,8 +391,11 @@ int appl_update_cancel(void)
       } else {
          LOG_INF("Transfer canceled");
       }
-      dfu_flash_area_id = -1;
    }
+   /* release the flash area, a new update starts from scratch */
+   memset(&dfu_context, 0, sizeof(dfu_context));
+   dfu_flash_area_id = -1;
+   dfu_offset = 0;
    return rc;
 }
 
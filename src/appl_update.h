@@ -37,6 +37,12 @@ int appl_update_cancel(void);
 int appl_update_reboot(void);
 int64_t appl_update_time(void);
 
+#ifdef CONFIG_COAP_UPDATE_RESUME
+int appl_update_resume(size_t offset);
+int appl_update_written_page(size_t *offset);
+int appl_update_crc(size_t offset, size_t len, uint32_t *crc);
+#endif /* CONFIG_COAP_UPDATE_RESUME */
+
 int appl_update_get_pending_version(char *buf, size_t len);
 int appl_update_dump_pending_image(void);
 int appl_update_request_upgrade(void);
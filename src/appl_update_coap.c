@@ -13,14 +13,19 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/crc.h>
 
 #include "appl_diagnose.h"
+#include "appl_settings.h"
 #include "appl_update.h"
 #include "appl_update_coap.h"
+#ifdef CONFIG_COAP_UPDATE_DELTA
+#include "appl_update_delta.h"
+#endif /* CONFIG_COAP_UPDATE_DELTA */
 #include "coap_client.h"
 #include "io_job_queue.h"
 #include "modem.h"
@@ -44,20 +49,25 @@ LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
 
 #define APP_COAP_MAX_UPDATE_SIZE (0x70000)
 
+/* tinydtls, DTLS_MAX_BUF */
+#define APP_COAP_DTLS_MAX_RECORD 1400
+
+/* CoAP header, token, ETag, Block2, Size2, Content-Format and payload marker */
+#define APP_COAP_RESPONSE_OVERHEAD 48
+
+#define APP_COAP_MAX_BLOCK_DATAGRAM MIN(DTLS_CLIENT_MAX_APPL_BUF, APP_COAP_DTLS_MAX_RECORD)
+
+#define APP_COAP_WRITE_BUFFERS 2
+#define APP_COAP_WRITE_BUFFER_SIZE 1024
+
+/* bytes written to flash between two persisted download checkpoints */
+#define APP_COAP_RESUME_INTERVAL 0x8000
+
 static K_SEM_DEFINE(appl_update_coap_ready, 0, 1);
 static K_MUTEX_DEFINE(appl_update_coap_mutex);
 
 static COAP_CONTEXT(update_context, 128);
 
-enum cancel_reason {
-   REASON_NOT_AVAILABLE,
-   REASON_CMD,
-   REASON_CHANGED,
-   REASON_BLOCK_OPTION,
-   REASON_BLOCK_NO,
-   REASON_NO_CONTENT,
-};
-
 static uint8_t coap_resource_path[APP_COAP_MAX_RES_PATH_LEN];
 static uint8_t coap_etag[COAP_TOKEN_MAX_LEN + 1];
 static int coap_content_format = -1;
@@ -67,27 +77,226 @@ static bool coap_download_request = false;
 static bool coap_download_canceled = false;
 static bool coap_download_ready = false;
 static bool coap_apply_update = false;
+static bool coap_delta = false;
 static struct coap_block_context coap_block_context;
 static uint32_t coap_current_block = 0;
-static enum cancel_reason coap_download_cancel_reason = REASON_NOT_AVAILABLE;
+static enum update_cancel_reason coap_download_cancel_reason = UPDATE_CANCEL_NOT_AVAILABLE;
+
+struct appl_update_coap_write_buffer {
+   struct k_work work;
+   size_t len;
+   uint8_t data[APP_COAP_WRITE_BUFFER_SIZE];
+};
+
+static struct appl_update_coap_write_buffer coap_write_buffers[APP_COAP_WRITE_BUFFERS];
+static uint8_t coap_write_index = 0;
+static atomic_t coap_write_error = ATOMIC_INIT(0);
+static K_SEM_DEFINE(appl_update_coap_write_free, APP_COAP_WRITE_BUFFERS, APP_COAP_WRITE_BUFFERS);
+
+#ifdef CONFIG_COAP_UPDATE_RESUME
+struct appl_update_coap_resume {
+   uint32_t offset;
+   uint32_t crc;
+   int16_t content_format;
+   uint8_t block_size;
+   uint8_t apply;
+   uint8_t etag[COAP_TOKEN_MAX_LEN + 1];
+   char resource[APP_COAP_MAX_RES_PATH_LEN];
+} __packed;
+
+BUILD_ASSERT(sizeof(struct appl_update_coap_resume) <= APPL_SETTINGS_MAX_DOWNLOAD_PROGRESS_LENGTH,
+             "Download progress exceeds settings");
+
+static struct appl_update_coap_resume coap_resume;
+#endif /* CONFIG_COAP_UPDATE_RESUME */
 
-static int appl_update_coap_cancel_download(bool cancel, enum cancel_reason reason);
+static int appl_update_coap_cancel_download(bool cancel, enum update_cancel_reason reason);
 static int appl_update_coap_start(const char *resource);
 
+#ifdef CONFIG_COAP_UPDATE_RESUME
+static void appl_update_coap_resume_clear(void)
+{
+   bool clear;
+
+   k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
+   clear = coap_resume.offset > 0;
+   memset(&coap_resume, 0, sizeof(coap_resume));
+   k_mutex_unlock(&appl_update_coap_mutex);
+   if (clear || appl_settings_get_download_progress(NULL, 0)) {
+      appl_settings_set_download_progress(NULL, 0);
+   }
+}
+
+/* persist the download progress, called on the io_job_queue after writing a block */
+static void appl_update_coap_checkpoint(void)
+{
+   struct appl_update_coap_resume resume;
+   size_t offset = 0;
+   uint32_t crc;
+   bool save = false;
+
+   k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
+   resume = coap_resume;
+   k_mutex_unlock(&appl_update_coap_mutex);
+
+   if (coap_delta) {
+      /* the patch is not resumable */
+      return;
+   }
+   if (appl_update_written_page(&offset) || offset < resume.offset + APP_COAP_RESUME_INTERVAL) {
+      return;
+   }
+   /* read back the flash, the crc verifies the written pages on resume */
+   crc = resume.crc;
+   if (appl_update_crc(resume.offset, offset - resume.offset, &crc)) {
+      return;
+   }
+   resume.offset = offset;
+   resume.crc = crc;
+
+   k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
+   if (coap_download) {
+      resume.content_format = coap_content_format;
+      resume.block_size = coap_block_context.block_size;
+      resume.apply = coap_apply_update;
+      memcpy(resume.etag, coap_etag, sizeof(resume.etag));
+      strncpy(resume.resource, (const char *)coap_resource_path, sizeof(resume.resource) - 1);
+      coap_resume = resume;
+      save = true;
+   }
+   k_mutex_unlock(&appl_update_coap_mutex);
+
+   if (save) {
+      appl_settings_set_download_progress((const uint8_t *)&resume, sizeof(resume));
+      LOG_INF("Download, checkpoint 0x%x", offset);
+   }
+}
+#endif /* CONFIG_COAP_UPDATE_RESUME */
+
+static void appl_update_coap_write_fn(struct k_work *work)
+{
+   struct appl_update_coap_write_buffer *buffer = CONTAINER_OF(work, struct appl_update_coap_write_buffer, work);
+
+   if (!atomic_get(&coap_write_error)) {
+      int res;
+#ifdef CONFIG_COAP_UPDATE_DELTA
+      if (coap_delta) {
+         res = appl_update_delta_write(buffer->data, buffer->len);
+      } else
+#endif /* CONFIG_COAP_UPDATE_DELTA */
+      {
+         res = appl_update_write(buffer->data, buffer->len);
+      }
+      if (res) {
+         LOG_INF("Download, write flash failed, %d", res);
+         atomic_set(&coap_write_error, res);
+      }
+#ifdef CONFIG_COAP_UPDATE_RESUME
+      else {
+         appl_update_coap_checkpoint();
+      }
+#endif /* CONFIG_COAP_UPDATE_RESUME */
+   }
+   k_sem_give(&appl_update_coap_write_free);
+}
+
+/* hands the block over to the io_job_queue, the next block is requested while flash is written */
+static int appl_update_coap_write(const uint8_t *data, size_t len)
+{
+   struct appl_update_coap_write_buffer *buffer;
+
+   if (len > APP_COAP_WRITE_BUFFER_SIZE) {
+      return -ENOMEM;
+   }
+   if (k_sem_take(&appl_update_coap_write_free, K_SECONDS(10))) {
+      LOG_INF("Download, write flash timeout.");
+      return -ETIMEDOUT;
+   }
+   buffer = &coap_write_buffers[coap_write_index];
+   coap_write_index = (coap_write_index + 1) % APP_COAP_WRITE_BUFFERS;
+   memcpy(buffer->data, data, len);
+   buffer->len = len;
+   work_submit_to_io_queue(&buffer->work);
+   return (int)atomic_get(&coap_write_error);
+}
+
+static void appl_update_coap_write_init(void)
+{
+   for (int index = 0; index < APP_COAP_WRITE_BUFFERS; ++index) {
+      k_work_init(&coap_write_buffers[index].work, appl_update_coap_write_fn);
+   }
+   coap_write_index = 0;
+   atomic_set(&coap_write_error, 0);
+}
+
+static enum coap_block_size appl_update_coap_block_size(void)
+{
+   enum coap_block_size block_size = COAP_BLOCK_1024;
+   int scale = modem_get_time_scale();
+
+   /* largest block, which fits into the receive buffer and a DTLS record */
+   while (block_size > COAP_BLOCK_16 &&
+          coap_block_size_to_bytes(block_size) + COAP_DTLS_RECORD_OVERHEAD +
+                  APP_COAP_RESPONSE_OVERHEAD >
+              APP_COAP_MAX_BLOCK_DATAGRAM) {
+      --block_size;
+   }
+   /* smaller blocks on bad coverage, see modem_get_time_scale */
+   if (scale >= 350) {
+      block_size = MIN(block_size, COAP_BLOCK_256);
+   } else if (scale >= 200) {
+      block_size = MIN(block_size, COAP_BLOCK_512);
+   }
+   return block_size;
+}
+
+/* larger blocks only at positions aligned to the larger block size */
+static void appl_update_coap_adapt_block_size(struct coap_block_context *block_context,
+                                              enum coap_block_size block_size)
+{
+   if (block_size < block_context->block_size ||
+       (block_size > block_context->block_size &&
+        !(block_context->current % coap_block_size_to_bytes(block_size)))) {
+      LOG_INF("Download, block size %d => %d", coap_block_size_to_bytes(block_context->block_size),
+              coap_block_size_to_bytes(block_size));
+      block_context->block_size = block_size;
+   }
+}
+
+static bool coap_abort_delta = false;
+
+/* queued behind the pending writes */
+static void appl_update_coap_abort_fn(struct k_work *work)
+{
+#ifdef CONFIG_COAP_UPDATE_DELTA
+   if (coap_abort_delta) {
+      appl_update_delta_cancel();
+   }
+#endif /* CONFIG_COAP_UPDATE_DELTA */
+   appl_update_cancel();
+}
+
+static K_WORK_DEFINE(appl_update_coap_abort_work, appl_update_coap_abort_fn);
+
+/* waits until a canceled update is aborted */
+static void appl_update_coap_abort_wait(void)
+{
+   struct k_work_sync sync;
+
+   k_work_flush(&appl_update_coap_abort_work, &sync);
+}
+
 static void appl_update_coap_erase_fn(struct k_work *work)
 {
    LOG_INF("Download, erase flash ...");
    k_sleep(K_MSEC(200));
+   appl_update_coap_abort_wait();
 
    if (!appl_update_erase()) {
-      enum coap_block_size block_size = COAP_BLOCK_1024;
-      int scale = modem_get_time_scale();
-      if (scale >= 350) {
-         block_size = COAP_BLOCK_256;
-      } else if (scale >= 250) {
-         block_size = COAP_BLOCK_512;
-      }
-      LOG_INF("Download, erase flash done.");
+      enum coap_block_size block_size = appl_update_coap_block_size();
+
+      appl_update_coap_write_init();
+      LOG_INF("Download, erase flash done, block size %d.", coap_block_size_to_bytes(block_size));
       k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
       if (coap_download) {
          coap_block_transfer_init(&coap_block_context, block_size, 0);
@@ -97,14 +306,29 @@ static void appl_update_coap_erase_fn(struct k_work *work)
       k_mutex_unlock(&appl_update_coap_mutex);
       sh_cmd_append("send", K_MSEC(2000));
    } else {
-      appl_update_coap_cancel_download(true, REASON_NOT_AVAILABLE);
+      appl_update_coap_cancel_download(true, UPDATE_CANCEL_NOT_AVAILABLE);
       appl_update_cmd("erase");
    }
 }
 
 static K_WORK_DELAYABLE_DEFINE(appl_update_coap_erase_work, appl_update_coap_erase_fn);
 
-static int appl_update_coap_cancel_download(bool cancel, enum cancel_reason reason)
+#ifdef CONFIG_COAP_UPDATE_RESUME
+/* the download is continued later, if it's not canceled by the content */
+static bool appl_update_coap_resumable(enum update_cancel_reason reason)
+{
+   switch (reason) {
+      case UPDATE_CANCEL_FAILED:
+      case UPDATE_CANCEL_NO_TRANSACTION:
+      case UPDATE_CANCEL_TIMEOUT:
+         return true;
+      default:
+         return false;
+   }
+}
+#endif /* CONFIG_COAP_UPDATE_RESUME */
+
+static int appl_update_coap_cancel_download(bool cancel, enum update_cancel_reason reason)
 {
    int res = 0;
    bool canceled;
@@ -122,8 +346,15 @@ static int appl_update_coap_cancel_download(bool cancel, enum cancel_reason reas
    }
    k_mutex_unlock(&appl_update_coap_mutex);
    if (canceled && cancel) {
-      res = appl_update_cancel();
+      /* don't wait for the pending writes */
+      coap_abort_delta = coap_delta;
+      work_submit_to_io_queue(&appl_update_coap_abort_work);
    }
+#ifdef CONFIG_COAP_UPDATE_RESUME
+   if (canceled && (!cancel || !appl_update_coap_resumable(reason))) {
+      appl_update_coap_resume_clear();
+   }
+#endif /* CONFIG_COAP_UPDATE_RESUME */
    return res;
 }
 
@@ -183,6 +414,17 @@ bool appl_update_coap_pending(void)
    return download;
 }
 
+bool appl_update_coap_downloaded(void)
+{
+   bool ready;
+
+   k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
+   ready = coap_download_ready;
+   k_mutex_unlock(&appl_update_coap_mutex);
+
+   return ready;
+}
+
 bool appl_update_coap_reboot(void)
 {
    bool reboot;
@@ -205,7 +447,7 @@ int appl_update_coap_status(uint8_t *buf, size_t len)
 
    k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
    if (coap_download) {
-      index = snprintf(buf, len, "Downloading %s", coap_resource_path);
+      index = snprintf(buf, len, "Downloading %s%s", coap_resource_path, coap_delta ? " delta" : "");
       if (coap_block_context.total_size > 0) {
          index += snprintf(buf + index, len - index, ", %d%%",
                            (coap_block_context.current) * 100 / coap_block_context.total_size);
@@ -218,23 +460,32 @@ int appl_update_coap_status(uint8_t *buf, size_t len)
    } else if (coap_download_canceled) {
       const char *reason = NULL;
       switch (coap_download_cancel_reason) {
-         case REASON_NOT_AVAILABLE:
+         case UPDATE_CANCEL_NOT_AVAILABLE:
             break;
-         case REASON_CMD:
+         case UPDATE_CANCEL_CMD:
             reason = "cmd";
             break;
-         case REASON_CHANGED:
+         case UPDATE_CANCEL_CHANGED:
             reason = "content changed";
             break;
-         case REASON_BLOCK_OPTION:
+         case UPDATE_CANCEL_BLOCK_OPTION:
             reason = "block option error";
             break;
-         case REASON_BLOCK_NO:
+         case UPDATE_CANCEL_BLOCK_NO:
             reason = "block option no";
             break;
-         case REASON_NO_CONTENT:
+         case UPDATE_CANCEL_NO_CONTENT:
             reason = "no content";
             break;
+         case UPDATE_CANCEL_FAILED:
+            reason = "request failed";
+            break;
+         case UPDATE_CANCEL_NO_TRANSACTION:
+            reason = "no transaction";
+            break;
+         case UPDATE_CANCEL_TIMEOUT:
+            reason = "timeout";
+            break;
       }
       index = snprintf(buf, len, "Update Canceled %s", coap_resource_path);
       if (reason) {
@@ -269,10 +520,18 @@ int appl_update_coap_cmd(const char *config)
    }
    if (!stricmp(cmd, "download")) {
       coap_apply_update = false;
+      coap_delta = false;
       rc = appl_update_coap_start(version);
    } else if (!stricmp(cmd, "update")) {
       coap_apply_update = true;
+      coap_delta = false;
+      rc = appl_update_coap_start(version);
+#ifdef CONFIG_COAP_UPDATE_DELTA
+   } else if (!stricmp(cmd, "delta")) {
+      coap_apply_update = true;
+      coap_delta = true;
       rc = appl_update_coap_start(version);
+#endif /* CONFIG_COAP_UPDATE_DELTA */
    } else if (!stricmp(cmd, "apply")) {
       k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
       if (!coap_resource_path[0]) {
@@ -298,7 +557,7 @@ int appl_update_coap_cmd(const char *config)
          LOG_INF("CoAP download version %s doesn't match %s!", version, coap_resource_path);
          rc = -EINVAL;
       } else {
-         appl_update_coap_cancel_download(true, REASON_CMD);
+         appl_update_coap_cancel_download(true, UPDATE_CANCEL_CMD);
          work_reschedule_for_cmd_queue(&appl_update_coap_erase_work, K_MSEC(100));
       }
    } else {
@@ -334,10 +593,83 @@ static int appl_update_coap_set_resource(const char *resource)
    return rc;
 }
 
+#ifdef CONFIG_COAP_UPDATE_RESUME
+static int appl_update_coap_resume_download(const char *resource)
+{
+   struct appl_update_coap_resume resume;
+   uint32_t crc = 0;
+   int rc;
+
+   memset(&resume, 0, sizeof(resume));
+   rc = appl_settings_get_download_progress((uint8_t *)&resume, sizeof(resume));
+   if (rc != sizeof(resume) || !resume.offset) {
+      appl_update_coap_resume_clear();
+      return -ENOENT;
+   }
+   resume.resource[sizeof(resume.resource) - 1] = 0;
+   if (strcmp(resume.resource, resource)) {
+      LOG_INF("Download, progress of %s discarded.", resume.resource);
+      appl_update_coap_resume_clear();
+      return -ENOENT;
+   }
+   rc = appl_update_resume(resume.offset);
+   if (rc) {
+      return rc;
+   }
+   rc = appl_update_crc(0, resume.offset, &crc);
+   if (!rc && crc != resume.crc) {
+      LOG_INF("Download, verify 0x%x bytes failed.", resume.offset);
+      rc = -EINVAL;
+   }
+   if (rc) {
+      appl_update_cancel();
+      appl_update_coap_resume_clear();
+      return rc;
+   }
+
+   appl_update_coap_write_init();
+   k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
+   coap_resume = resume;
+   coap_content_format = resume.content_format;
+   memcpy(coap_etag, resume.etag, sizeof(coap_etag));
+   coap_block_transfer_init(&coap_block_context, resume.block_size, 0);
+   coap_block_context.current = resume.offset;
+   coap_current_block = resume.offset / coap_block_size_to_bytes(resume.block_size);
+   coap_download_request = true;
+   k_mutex_unlock(&appl_update_coap_mutex);
+
+   LOG_INF("Resume downloading %s at 0x%x.", resource, resume.offset);
+   sh_cmd_append("send", K_MSEC(2000));
+   return 0;
+}
+
+static void appl_update_coap_resume_fn(struct k_work *work)
+{
+   struct appl_update_coap_resume resume;
+   int rc;
+
+   memset(&resume, 0, sizeof(resume));
+   rc = appl_settings_get_download_progress((uint8_t *)&resume, sizeof(resume));
+   if (rc == sizeof(resume) && resume.offset) {
+      resume.resource[sizeof(resume.resource) - 1] = 0;
+      LOG_INF("Download, continue %s after reboot.", resume.resource);
+      coap_apply_update = resume.apply;
+      coap_delta = false;
+      rc = appl_update_coap_start(resume.resource);
+      if (rc && rc != -EBUSY) {
+         appl_update_coap_resume_clear();
+      }
+   }
+}
+
+static K_WORK_DELAYABLE_DEFINE(appl_update_coap_resume_work, appl_update_coap_resume_fn);
+#endif /* CONFIG_COAP_UPDATE_RESUME */
+
 static int appl_update_coap_start(const char *resource)
 {
    int rc = 0;
 
+   appl_update_coap_abort_wait();
    rc = appl_update_coap_set_resource(resource);
 
    if (rc) {
@@ -345,22 +677,80 @@ static int appl_update_coap_start(const char *resource)
    }
 
    memset(coap_etag, 0, sizeof(coap_etag));
+#ifdef CONFIG_COAP_UPDATE_RESUME
+   if (coap_delta) {
+      appl_update_coap_resume_clear();
+   } else if (!appl_update_coap_resume_download(resource)) {
+      return 0;
+   }
+#endif /* CONFIG_COAP_UPDATE_RESUME */
+#ifdef CONFIG_COAP_UPDATE_DELTA
+   if (coap_delta) {
+      rc = appl_update_delta_start();
+      if (rc) {
+         return rc;
+      }
+   }
+#endif /* CONFIG_COAP_UPDATE_DELTA */
    rc = appl_update_start();
    if (!rc) {
-      LOG_INF("Start downloading %s.", coap_resource_path);
+      LOG_INF("Start downloading %s%s.", coap_resource_path, coap_delta ? " delta" : "");
       work_reschedule_for_cmd_queue(&appl_update_coap_erase_work, K_MSEC(1000));
    }
    return rc;
 }
 
-int appl_update_coap_cancel(void)
+int appl_update_coap_cancel(enum update_cancel_reason reason)
 {
    if (appl_reboots()) {
       return -ESHUTDOWN;
    }
-   return appl_update_coap_cancel_download(true, REASON_NOT_AVAILABLE);
+   return appl_update_coap_cancel_download(true, reason);
 }
 
+/* queued behind the pending writes */
+static void appl_update_coap_finish_fn(struct k_work *work)
+{
+   bool download;
+   int res = (int)atomic_get(&coap_write_error);
+
+   k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
+   download = coap_download;
+   k_mutex_unlock(&appl_update_coap_mutex);
+   if (!download) {
+      /* canceled */
+      return;
+   }
+#ifdef CONFIG_COAP_UPDATE_DELTA
+   if (!res && coap_delta) {
+      res = appl_update_delta_finish();
+   }
+#endif /* CONFIG_COAP_UPDATE_DELTA */
+   if (!res) {
+      res = appl_update_finish();
+   }
+   if (!res) {
+      res = appl_update_coap_verify_version();
+   }
+   if (!res) {
+      res = appl_update_request_upgrade();
+   }
+   if (res) {
+      LOG_INF("CoAP transfer failed. %d", res);
+      appl_update_coap_cancel_download(true, UPDATE_CANCEL_NOT_AVAILABLE);
+   } else {
+      LOG_INF("CoAP transfer succeeded.");
+      if (coap_apply_update) {
+         LOG_INF("Reboot to apply update.");
+      } else {
+         LOG_INF("Reboot required to apply update.");
+      }
+      appl_update_coap_cancel_download(false, UPDATE_CANCEL_NOT_AVAILABLE);
+   }
+}
+
+static K_WORK_DEFINE(appl_update_coap_finish_work, appl_update_coap_finish_fn);
+
 static int appl_update_coap_resonse(struct coap_packet *reply, struct coap_block_context *block_context, size_t current)
 {
    int res;
@@ -377,7 +767,7 @@ static int appl_update_coap_resonse(struct coap_packet *reply, struct coap_block
 
    if (COAP_RESPONSE_CODE_CONTENT != coap_header_get_code(reply)) {
       LOG_INF("Download missing content!");
-      appl_update_coap_cancel_download(true, REASON_NO_CONTENT);
+      appl_update_coap_cancel_download(true, UPDATE_CANCEL_NO_CONTENT);
       return -EINVAL;
    }
 
@@ -387,7 +777,7 @@ static int appl_update_coap_resonse(struct coap_packet *reply, struct coap_block
       if (0 <= coap_content_format) {
          if (coap_content_format != format) {
             LOG_INF("Download content format changed!");
-            appl_update_coap_cancel_download(true, REASON_CHANGED);
+            appl_update_coap_cancel_download(true, UPDATE_CANCEL_CHANGED);
             return -EINVAL;
          }
       } else {
@@ -403,7 +793,7 @@ static int appl_update_coap_resonse(struct coap_packet *reply, struct coap_block
             LOG_INF("Download content changed, new etag!");
             LOG_HEXDUMP_INF(&etag[1], etag[0], "new etag");
             LOG_HEXDUMP_INF(&coap_etag[1], coap_etag[0], "previous etag");
-            appl_update_coap_cancel_download(true, REASON_CHANGED);
+            appl_update_coap_cancel_download(true, UPDATE_CANCEL_CHANGED);
             return -EINVAL;
          }
       } else {
@@ -415,7 +805,7 @@ static int appl_update_coap_resonse(struct coap_packet *reply, struct coap_block
    if (block2 == -ENOENT) {
       if (current != 0) {
          LOG_INF("Download without block2, current pos 0x%x", current);
-         appl_update_coap_cancel_download(true, REASON_BLOCK_OPTION);
+         appl_update_coap_cancel_download(true, UPDATE_CANCEL_BLOCK_OPTION);
          return -EINVAL;
       }
    } else {
@@ -423,54 +813,41 @@ static int appl_update_coap_resonse(struct coap_packet *reply, struct coap_block
       res = coap_update_from_block(reply, block_context);
       if (res < 0) {
          LOG_INF("Download update block failed, %d", res);
-         appl_update_coap_cancel_download(true, REASON_BLOCK_OPTION);
+         appl_update_coap_cancel_download(true, UPDATE_CANCEL_BLOCK_OPTION);
          return res;
       }
       if (block_context->total_size > APP_COAP_MAX_UPDATE_SIZE) {
          LOG_INF("Download size 0x%x exceeds max. 0x%x.", block_context->total_size, APP_COAP_MAX_UPDATE_SIZE);
-         appl_update_coap_cancel_download(true, REASON_BLOCK_OPTION);
+         appl_update_coap_cancel_download(true, UPDATE_CANCEL_BLOCK_OPTION);
          return -ENOMEM;
       }
       if (current != block_context->current) {
          LOG_INF("Download block 0x%x mismatch 0x%x", current, block_context->current);
-         appl_update_coap_cancel_download(true, REASON_BLOCK_NO);
+         appl_update_coap_cancel_download(true, UPDATE_CANCEL_BLOCK_NO);
          return -EINVAL;
       }
       block2_bytes = coap_block_size_to_bytes(block_context->block_size);
       if (payload_len > block2_bytes) {
          LOG_INF("Download block size exceeded, %d > %d", payload_len, block2_bytes);
-         appl_update_coap_cancel_download(true, REASON_BLOCK_OPTION);
+         appl_update_coap_cancel_download(true, UPDATE_CANCEL_BLOCK_OPTION);
          return -EINVAL;
       }
       if (payload_len < block2_bytes && !ready) {
          LOG_INF("Download block size too small, %d < %d", payload_len, block2_bytes);
-         appl_update_coap_cancel_download(true, REASON_BLOCK_OPTION);
+         appl_update_coap_cancel_download(true, UPDATE_CANCEL_BLOCK_OPTION);
          return -EINVAL;
       }
    }
    if (payload_len > 0) {
-      appl_update_write(payload, payload_len);
-   }
-   if (ready) {
-      res = appl_update_finish();
-      if (!res) {
-         res = appl_update_coap_verify_version();
-      }
-      if (!res) {
-         res = appl_update_request_upgrade();
-      }
+      res = appl_update_coap_write(payload, payload_len);
       if (res) {
-         LOG_INF("CoAP transfer failed. %d", res);
-         appl_update_coap_cancel_download(true, REASON_NOT_AVAILABLE);
-      } else {
-         LOG_INF("CoAP transfer succeeded.");
-         if (coap_apply_update) {
-            LOG_INF("Reboot to apply update.");
-         } else {
-            LOG_INF("Reboot required to apply update.");
-         }
-         appl_update_coap_cancel_download(false, REASON_NOT_AVAILABLE);
+         appl_update_coap_cancel_download(true, UPDATE_CANCEL_NOT_AVAILABLE);
+         return res;
       }
+   }
+   if (ready) {
+      /* don't wait for the pending writes */
+      work_submit_to_io_queue(&appl_update_coap_finish_work);
    } else {
       k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
       if (current == coap_block_context.current) {
@@ -545,16 +922,19 @@ int appl_update_coap_next(void)
    int rc = 0;
    bool request_next = false;
    struct coap_block_context block_context;
+   enum coap_block_size block_size;
 
    if (appl_reboots()) {
       return -ESHUTDOWN;
    }
 
+   block_size = appl_update_coap_block_size();
    k_mutex_lock(&appl_update_coap_mutex, K_FOREVER);
    if (coap_download) {
       request_next = coap_download_request;
       if (request_next) {
          coap_download_request = false;
+         appl_update_coap_adapt_block_size(&coap_block_context, block_size);
          block_context = coap_block_context;
       }
    } else {
@@ -602,6 +982,18 @@ int appl_update_coap_next(void)
          LOG_WRN("Failed to encode CoAP URI-PATH resource, %d", rc);
          return rc;
       }
+#ifdef CONFIG_COAP_UPDATE_DELTA
+      if (coap_delta) {
+         /* patch from the running version */
+         rc = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
+                                        IMAGE_VERSION,
+                                        strlen(IMAGE_VERSION));
+         if (rc < 0) {
+            LOG_WRN("Failed to encode CoAP URI-PATH version, %d", rc);
+            return rc;
+         }
+      }
+#endif /* CONFIG_COAP_UPDATE_DELTA */
       rc = coap_append_block2_option(&request, &block_context);
       update_context.message_len = request.offset;
       rc = request.offset;
@@ -627,6 +1019,17 @@ coap_handler_t coap_update_client_handler = {
     .parse_data = appl_update_coap_parse_data,
 };
 
+#ifdef CONFIG_COAP_UPDATE_RESUME
+static int appl_update_coap_init(void)
+{
+   /* settings are loaded, continue an interrupted download */
+   work_schedule_for_cmd_queue(&appl_update_coap_resume_work, K_SECONDS(30));
+   return 0;
+}
+
+SYS_INIT(appl_update_coap_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+#endif /* CONFIG_COAP_UPDATE_RESUME */
+
 #ifdef CONFIG_SH_CMD
 
 static int sh_cmd_fota(const char *parameter)
@@ -641,6 +1044,9 @@ static void sh_cmd_fota_help(void)
    LOG_INF("  fota apply <version>    : apply an already downloaded version.");
    LOG_INF("  fota download <version> : download a version.");
    LOG_INF("  fota update <version>   : download and apply a version.");
+#ifdef CONFIG_COAP_UPDATE_DELTA
+   LOG_INF("  fota delta <version>    : download and apply a patch from the running version.");
+#endif /* CONFIG_COAP_UPDATE_DELTA */
    LOG_INF("  fota cancel <version>   : cancel downloading a version.");
 }
 
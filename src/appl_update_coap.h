@@ -19,11 +19,24 @@
 
 #include "coap_client.h"
 
+enum update_cancel_reason {
+   UPDATE_CANCEL_NOT_AVAILABLE,
+   UPDATE_CANCEL_CMD,
+   UPDATE_CANCEL_CHANGED,
+   UPDATE_CANCEL_BLOCK_OPTION,
+   UPDATE_CANCEL_BLOCK_NO,
+   UPDATE_CANCEL_NO_CONTENT,
+   UPDATE_CANCEL_FAILED,
+   UPDATE_CANCEL_NO_TRANSACTION,
+   UPDATE_CANCEL_TIMEOUT,
+};
+
 bool appl_update_coap_pending(void);
+bool appl_update_coap_downloaded(void);
 bool appl_update_coap_reboot(void);
 int appl_update_coap_status(uint8_t *data, size_t len);
 int appl_update_coap_cmd(const char* config);
-int appl_update_coap_cancel(void);
+int appl_update_coap_cancel(enum update_cancel_reason reason);
 int appl_update_coap_parse_data(uint8_t *data, size_t len);
 bool appl_update_coap_pending_next(void);
 int appl_update_coap_next(void);
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#include "appl_update.h"
+#include "appl_update_delta.h"
+
+LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
+
+#define DELTA_SOURCE_PARTITION_ID FIXED_PARTITION_ID(slot0_partition)
+
+#define DELTA_HEADER_SIZE 16
+#define DELTA_COPY_SIZE 8
+#define DELTA_INSERT_SIZE 4
+#define DELTA_ADD_SIZE 8
+#define DELTA_RUN_SIZE 2
+
+/* bounded RAM, source is copied in chunks of this size */
+#define DELTA_COPY_BUFFER_SIZE 64
+
+enum delta_state {
+   DELTA_HEADER,
+   DELTA_OPCODE,
+   DELTA_ARGUMENTS,
+   DELTA_INSERT,
+   DELTA_ADD_RUN,
+   DELTA_ADD_DIFF,
+   DELTA_DONE,
+   DELTA_ERROR,
+};
+
+static const struct flash_area *delta_source = NULL;
+static enum delta_state delta_state = DELTA_ERROR;
+static uint8_t delta_opcode = 0;
+static uint8_t delta_field[DELTA_HEADER_SIZE];
+static size_t delta_field_len = 0;
+static size_t delta_field_size = DELTA_HEADER_SIZE;
+static uint32_t delta_source_size = 0;
+static uint32_t delta_target_size = 0;
+static uint32_t delta_written = 0;
+static uint32_t delta_insert = 0;
+static uint32_t delta_add_offset = 0;
+static uint32_t delta_add_len = 0;
+static uint32_t delta_add_diff = 0;
+
+static void appl_update_delta_close(void)
+{
+   if (delta_source) {
+      flash_area_close(delta_source);
+      delta_source = NULL;
+   }
+}
+
+static int appl_update_delta_error(int res, const char *cause)
+{
+   LOG_INF("Delta: %s, %d (target 0x%x of 0x%x)", cause, res, delta_written, delta_target_size);
+   delta_state = DELTA_ERROR;
+   return res;
+}
+
+static int appl_update_delta_output(const uint8_t *data, size_t len)
+{
+   int res;
+
+   if (len > delta_target_size - delta_written) {
+      return appl_update_delta_error(-EINVAL, "target size exceeded");
+   }
+   res = appl_update_write(data, len);
+   if (res) {
+      return appl_update_delta_error(res, "write failed");
+   }
+   delta_written += len;
+   return 0;
+}
+
+static int appl_update_delta_verify_source(uint32_t crc)
+{
+   uint8_t buf[DELTA_COPY_BUFFER_SIZE];
+   uint32_t value = 0;
+   size_t offset = 0;
+
+   if (delta_source_size > delta_source->fa_size) {
+      return appl_update_delta_error(-EINVAL, "source size exceeded");
+   }
+   while (offset < delta_source_size) {
+      size_t chunk = MIN(delta_source_size - offset, sizeof(buf));
+      int res = flash_area_read(delta_source, offset, buf, chunk);
+      if (res) {
+         return appl_update_delta_error(res, "read source failed");
+      }
+      value = crc32_ieee_update(value, buf, chunk);
+      offset += chunk;
+   }
+   if (value != crc) {
+      return appl_update_delta_error(-EINVAL, "source mismatch");
+   }
+   return 0;
+}
+
+static int appl_update_delta_copy(uint32_t offset, uint32_t len)
+{
+   uint8_t buf[DELTA_COPY_BUFFER_SIZE];
+
+   if (offset > delta_source_size || len > delta_source_size - offset) {
+      return appl_update_delta_error(-EINVAL, "copy exceeds source");
+   }
+   while (len > 0) {
+      size_t chunk = MIN(len, sizeof(buf));
+      int res = flash_area_read(delta_source, offset, buf, chunk);
+      if (res) {
+         return appl_update_delta_error(res, "read source failed");
+      }
+      res = appl_update_delta_output(buf, chunk);
+      if (res) {
+         return res;
+      }
+      offset += chunk;
+      len -= chunk;
+   }
+   return 0;
+}
+
+static int appl_update_delta_add(const uint8_t *diff, size_t len)
+{
+   uint8_t buf[DELTA_COPY_BUFFER_SIZE];
+   int res = flash_area_read(delta_source, delta_add_offset, buf, len);
+
+   if (res) {
+      return appl_update_delta_error(res, "read source failed");
+   }
+   for (size_t index = 0; index < len; ++index) {
+      buf[index] += diff[index];
+   }
+   res = appl_update_delta_output(buf, len);
+   if (!res) {
+      delta_add_offset += len;
+      delta_add_len -= len;
+      delta_add_diff -= len;
+   }
+   return res;
+}
+
+static void appl_update_delta_next(enum delta_state state, size_t size)
+{
+   if (delta_written == delta_target_size && state == DELTA_OPCODE) {
+      state = DELTA_DONE;
+   }
+   delta_state = state;
+   delta_field_len = 0;
+   delta_field_size = size;
+}
+
+/* field completed, returns 0 or a negative error */
+static int appl_update_delta_field(void)
+{
+   int res = 0;
+
+   switch (delta_state) {
+      case DELTA_HEADER:
+         if (memcmp(delta_field, DELTA_MAGIC, 4)) {
+            return appl_update_delta_error(-EINVAL, "no delta patch");
+         }
+         delta_source_size = sys_get_be32(&delta_field[4]);
+         delta_target_size = sys_get_be32(&delta_field[12]);
+         res = appl_update_delta_verify_source(sys_get_be32(&delta_field[8]));
+         if (!res) {
+            LOG_INF("Delta: source 0x%x, target 0x%x", delta_source_size, delta_target_size);
+            appl_update_delta_next(DELTA_OPCODE, 1);
+         }
+         break;
+      case DELTA_OPCODE:
+         delta_opcode = delta_field[0];
+         if (delta_opcode == DELTA_OPCODE_COPY) {
+            appl_update_delta_next(DELTA_ARGUMENTS, DELTA_COPY_SIZE);
+         } else if (delta_opcode == DELTA_OPCODE_INSERT) {
+            appl_update_delta_next(DELTA_ARGUMENTS, DELTA_INSERT_SIZE);
+         } else if (delta_opcode == DELTA_OPCODE_ADD) {
+            appl_update_delta_next(DELTA_ARGUMENTS, DELTA_ADD_SIZE);
+         } else {
+            res = appl_update_delta_error(-EINVAL, "unknown opcode");
+         }
+         break;
+      case DELTA_ARGUMENTS:
+         if (delta_opcode == DELTA_OPCODE_COPY) {
+            res = appl_update_delta_copy(sys_get_be32(&delta_field[0]), sys_get_be32(&delta_field[4]));
+            if (!res) {
+               appl_update_delta_next(DELTA_OPCODE, 1);
+            }
+         } else if (delta_opcode == DELTA_OPCODE_ADD) {
+            delta_add_offset = sys_get_be32(&delta_field[0]);
+            delta_add_len = sys_get_be32(&delta_field[4]);
+            if (delta_add_offset > delta_source_size ||
+                delta_add_len > delta_source_size - delta_add_offset) {
+               res = appl_update_delta_error(-EINVAL, "add exceeds source");
+            } else if (delta_add_len) {
+               appl_update_delta_next(DELTA_ADD_RUN, DELTA_RUN_SIZE);
+            } else {
+               appl_update_delta_next(DELTA_OPCODE, 1);
+            }
+         } else {
+            delta_insert = sys_get_be32(&delta_field[0]);
+            appl_update_delta_next(delta_insert ? DELTA_INSERT : DELTA_OPCODE, 1);
+         }
+         break;
+      case DELTA_ADD_RUN:
+         if (delta_field[0] + delta_field[1] > delta_add_len) {
+            return appl_update_delta_error(-EINVAL, "run exceeds add");
+         }
+         res = appl_update_delta_copy(delta_add_offset, delta_field[0]);
+         if (!res) {
+            delta_add_offset += delta_field[0];
+            delta_add_len -= delta_field[0];
+            delta_add_diff = delta_field[1];
+            if (delta_add_diff) {
+               appl_update_delta_next(DELTA_ADD_DIFF, 1);
+            } else if (delta_add_len) {
+               appl_update_delta_next(DELTA_ADD_RUN, DELTA_RUN_SIZE);
+            } else {
+               appl_update_delta_next(DELTA_OPCODE, 1);
+            }
+         }
+         break;
+      default:
+         break;
+   }
+   return res;
+}
+
+int appl_update_delta_start(void)
+{
+   int res;
+
+   appl_update_delta_close();
+   res = flash_area_open(DELTA_SOURCE_PARTITION_ID, &delta_source);
+   if (res) {
+      delta_source = NULL;
+      delta_state = DELTA_ERROR;
+      LOG_INF("Delta: open source failed, %d", res);
+      return res;
+   }
+   delta_source_size = 0;
+   delta_target_size = 0;
+   delta_written = 0;
+   delta_insert = 0;
+   delta_add_offset = 0;
+   delta_add_len = 0;
+   delta_add_diff = 0;
+   appl_update_delta_next(DELTA_HEADER, DELTA_HEADER_SIZE);
+   return 0;
+}
+
+int appl_update_delta_write(const uint8_t *data, size_t len)
+{
+   int res = 0;
+
+   while (len > 0 && !res) {
+      if (delta_state == DELTA_ERROR) {
+         return -EINVAL;
+      } else if (delta_state == DELTA_DONE) {
+         return appl_update_delta_error(-EINVAL, "data after target");
+      } else if (delta_state == DELTA_INSERT) {
+         size_t chunk = MIN(len, delta_insert);
+         res = appl_update_delta_output(data, chunk);
+         delta_insert -= chunk;
+         data += chunk;
+         len -= chunk;
+         if (!delta_insert) {
+            appl_update_delta_next(DELTA_OPCODE, 1);
+         }
+      } else if (delta_state == DELTA_ADD_DIFF) {
+         size_t chunk = MIN(MIN(len, delta_add_diff), DELTA_COPY_BUFFER_SIZE);
+         res = appl_update_delta_add(data, chunk);
+         data += chunk;
+         len -= chunk;
+         if (!res && !delta_add_diff) {
+            appl_update_delta_next(delta_add_len ? DELTA_ADD_RUN : DELTA_OPCODE,
+                                   delta_add_len ? DELTA_RUN_SIZE : 1);
+         }
+      } else {
+         size_t chunk = MIN(len, delta_field_size - delta_field_len);
+         memcpy(&delta_field[delta_field_len], data, chunk);
+         delta_field_len += chunk;
+         data += chunk;
+         len -= chunk;
+         if (delta_field_len == delta_field_size) {
+            res = appl_update_delta_field();
+         }
+      }
+   }
+   return res;
+}
+
+int appl_update_delta_finish(void)
+{
+   int res = 0;
+
+   if (delta_state != DELTA_DONE) {
+      res = appl_update_delta_error(-EINVAL, "incomplete");
+   } else {
+      LOG_INF("Delta: 0x%x bytes created.", delta_written);
+   }
+   appl_update_delta_close();
+   return res;
+}
+
+void appl_update_delta_cancel(void)
+{
+   appl_update_delta_close();
+   delta_state = DELTA_ERROR;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#ifndef APPL_UPDATE_DELTA_H
+#define APPL_UPDATE_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Delta patch format, all values are 32 bit big endian.
+ *
+ * header:  "DLT1", source size, source CRC32 (IEEE), target size
+ * COPY:    0x01, source offset, length
+ *          copy length bytes of the running image starting at the offset.
+ * INSERT:  0x02, length, followed by length bytes
+ *          append the following bytes.
+ * ADD:     0x03, source offset, length, followed by runs
+ *          append length bytes of the running image starting at the offset,
+ *          with the diff bytes of the runs added (modulo 256).
+ *          A run is a 1 byte skip and a 1 byte count, followed by count
+ *          diff bytes. The skip bytes are copied unchanged.
+ *
+ * The commands are applied in order and must create exactly the target
+ * size bytes. ADD covers code, which is moved, and so only the addresses
+ * are changed. Patches are created with extras/delta/delta_gen.c.
+ */
+#define DELTA_MAGIC "DLT1"
+#define DELTA_OPCODE_COPY 0x01
+#define DELTA_OPCODE_INSERT 0x02
+#define DELTA_OPCODE_ADD 0x03
+
+int appl_update_delta_start(void);
+int appl_update_delta_write(const uint8_t *data, size_t len);
+int appl_update_delta_finish(void);
+void appl_update_delta_cancel(void);
+
+#endif /* APPL_UPDATE_DELTA_H */
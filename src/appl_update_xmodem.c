@@ -12,6 +12,7 @@
  */
 
 #include <errno.h>
+#include <string.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/crc.h>
@@ -24,58 +25,121 @@ LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
 #define XMODEM_HEADER_LEN 3
 #define XMODEM_TYPE 0
 #define XMODEM_BLOCK 1
+#define XMODEM_BUFFER_SIZE (XMODEM_HEADER_LEN + 1024 + 2)
+/*
+ * With IMG_ERASE_PROGRESSIVELY the first write into a 4K flash page
+ * erases it, which takes about 85ms and more. At 115200 baud a 1K block
+ * takes about 89ms, so YMODEM-g without ACKs requires to buffer some
+ * blocks until the erase of a page is done. 4 buffers covers one erase
+ * per 4 blocks.
+ */
+#define XMODEM_BUFFERS 4
+
+struct xmodem_buffer {
+   atomic_t ready;
+   volatile size_t len;
+   uint8_t data[XMODEM_BUFFER_SIZE];
+};
 
 static volatile bool xmodem_crc = false;
-static volatile size_t xmodem_len = 0;
+static volatile bool xmodem_stream = false;
+static volatile bool xmodem_error = false;
 static volatile uint8_t xmodem_block = 0;
-static size_t xmodem_buffer_size = 0;
-static uint8_t *xmodem_buffer = NULL;
+/* the next block is received into xmodem_buffers[xmodem_rx], while
+   xmodem_buffers[xmodem_wr] and the following are verified and written to flash */
+static volatile int xmodem_rx = 0;
+static volatile int xmodem_wr = 0;
+static struct xmodem_buffer xmodem_buffers[XMODEM_BUFFERS];
 
-int appl_update_xmodem_start(uint8_t *buffer, size_t size, bool crc)
+int appl_update_xmodem_start(bool crc, bool stream)
 {
-   xmodem_len = 0;
+   for (int index = 0; index < XMODEM_BUFFERS; ++index) {
+      xmodem_buffers[index].len = 0;
+      atomic_clear(&xmodem_buffers[index].ready);
+   }
+   xmodem_rx = 0;
+   xmodem_wr = 0;
+   xmodem_error = false;
    xmodem_block = 1;
-   xmodem_buffer = buffer;
-   xmodem_buffer_size = size;
    xmodem_crc = crc;
+   xmodem_stream = stream;
    return 0;
 }
 
-int appl_update_xmodem_append(const uint8_t *data, size_t len)
+static size_t appl_update_xmodem_block_len(const uint8_t *data)
 {
-   if (xmodem_len + len < xmodem_buffer_size) {
-      uint8_t s;
-      memmove(&xmodem_buffer[xmodem_len], data, len);
-      xmodem_len += len;
-      s = xmodem_buffer[XMODEM_TYPE];
-      if (s == XMODEM_SOH || s == XMODEM_STX) {
-         if (xmodem_len < XMODEM_HEADER_LEN) {
-            return XMODEM_NONE;
-         }
-         uint8_t b = xmodem_buffer[XMODEM_BLOCK];
-         uint8_t c = xmodem_buffer[XMODEM_BLOCK + 1] ^ ~b;
-         if (c == 0) {
-            int crc_len = xmodem_crc ? 2 : 1;
-            int block_len = s == XMODEM_SOH ? 128 : 1024;
-            if (xmodem_len < (XMODEM_HEADER_LEN + block_len + crc_len)) {
-               return XMODEM_NONE;
-            }
-            LOG_DBG("Block %d %u ready", block_len, b);
-            return XMODEM_BLOCK_READY;
-         } else {
+   return data[XMODEM_TYPE] == XMODEM_SOH ? 128 : 1024;
+}
+
+int appl_update_xmodem_append(const uint8_t *data, size_t len, size_t *used)
+{
+   struct xmodem_buffer *buf = &xmodem_buffers[xmodem_rx];
+   size_t size = XMODEM_HEADER_LEN;
+
+   *used = len;
+   if (xmodem_error) {
+      return XMODEM_NOT_OK;
+   }
+   if (data[XMODEM_TYPE] == XMODEM_EOT && len == 1 && (!buf->len || atomic_get(&buf->ready))) {
+      LOG_INF("Transfer ready.");
+      return XMODEM_READY;
+   }
+   if (atomic_get(&buf->ready)) {
+      LOG_INF("Block overflow, flash write pending.");
+      xmodem_error = true;
+      return XMODEM_NOT_OK;
+   }
+   *used = 0;
+   while (*used < len) {
+      size_t chunk;
+
+      if (buf->len >= XMODEM_HEADER_LEN) {
+         size = XMODEM_HEADER_LEN + appl_update_xmodem_block_len(buf->data) + (xmodem_crc ? 2 : 1);
+      }
+      chunk = MIN(size - buf->len, len - *used);
+      memmove(&buf->data[buf->len], &data[*used], chunk);
+      buf->len += chunk;
+      *used += chunk;
+      if (buf->len == XMODEM_HEADER_LEN) {
+         uint8_t s = buf->data[XMODEM_TYPE];
+         uint8_t b = buf->data[XMODEM_BLOCK];
+         uint8_t c = buf->data[XMODEM_BLOCK + 1] ^ ~b;
+         if (s != XMODEM_SOH && s != XMODEM_STX) {
+            LOG_INF("Invalid type 0x%02x", s);
+            xmodem_error = true;
+         } else if (c != 0) {
             LOG_INF("Block # failure, %u != %u!", b, c);
+            xmodem_error = true;
          }
-      } else if (s == XMODEM_EOT && xmodem_len == 1) {
-         LOG_INF("Transfer ready.");
-         return XMODEM_READY;
+         if (xmodem_error) {
+            *used = len;
+            return XMODEM_NOT_OK;
+         }
+      } else if (buf->len == size) {
+         LOG_DBG("Block %d %u ready", (int)size, buf->data[XMODEM_BLOCK]);
+         atomic_set(&buf->ready, 1);
+         xmodem_rx = (xmodem_rx + 1) % XMODEM_BUFFERS;
+         return XMODEM_BLOCK_READY;
       }
    }
-   return XMODEM_NOT_OK;
+   return XMODEM_NONE;
 }
 
 void appl_update_xmodem_retry(void)
 {
-   xmodem_len = 0;
+   struct xmodem_buffer *buf = &xmodem_buffers[xmodem_rx];
+
+   if (!atomic_get(&buf->ready)) {
+      buf->len = 0;
+   }
+   xmodem_error = false;
+}
+
+static void appl_update_xmodem_release(struct xmodem_buffer *buf)
+{
+   buf->len = 0;
+   atomic_clear(&buf->ready);
+   xmodem_wr = (xmodem_wr + 1) % XMODEM_BUFFERS;
 }
 
 static bool appl_update_xmodem_crc(const uint8_t *data, int block_len)
@@ -92,58 +156,87 @@ static bool appl_update_xmodem_crc(const uint8_t *data, int block_len)
    }
 }
 
-int appl_update_xmodem_write_block(void)
+static bool appl_update_xmodem_checksum(const uint8_t *data, int block_len)
 {
-   uint8_t s = xmodem_buffer[XMODEM_TYPE];
-   uint8_t b = xmodem_buffer[XMODEM_BLOCK];
-   int rc = -EINVAL;
-   int crc_len = xmodem_crc ? 2 : 1;
-   int block_len;
+   uint8_t b = data[XMODEM_BLOCK];
+   const uint8_t *cur = &data[XMODEM_HEADER_LEN];
+   int sum = 0;
 
-   if (s == XMODEM_SOH) {
-      block_len = 128;
-   } else if (s == XMODEM_STX) {
-      block_len = 1024;
+   for (int i = 0; i < block_len; ++i) {
+      sum += *cur++;
+   }
+   if (*cur == (uint8_t)sum) {
+      LOG_INF("Block %d %u verified", block_len, b);
+      return true;
    } else {
-      LOG_INF("Invalid type 0x%02x", s);
-      return -EINVAL;
+      LOG_INF("Block %d %u checksum error %u != %u", block_len, b, (uint8_t)sum, *cur);
+      return false;
    }
-   if (xmodem_len < XMODEM_HEADER_LEN + block_len + crc_len) {
-      LOG_INF("Invalid length %d, expected %d", xmodem_len,
-              (XMODEM_HEADER_LEN + block_len + crc_len));
-      return -EINVAL;
+}
+
+static void appl_update_xmodem_header(const uint8_t *data, int block_len)
+{
+   const char *name = (const char *)&data[XMODEM_HEADER_LEN];
+   size_t name_len = strnlen(name, block_len);
+
+   if (!name_len) {
+      LOG_INF("YMODEM batch end.");
+   } else if (name_len + 1 < block_len) {
+      const char *size = name + name_len + 1;
+      LOG_INF("YMODEM %.*s, %.*s", (int)name_len, name,
+              (int)strnlen(size, block_len - name_len - 1), size);
    }
+}
+
+int appl_update_xmodem_verify_block(void)
+{
+   struct xmodem_buffer *buf = &xmodem_buffers[xmodem_wr];
+   int rc = -EBADMSG;
+   int block_len;
+   bool ok;
+   uint8_t b;
+
+   if (!atomic_get(&buf->ready)) {
+      return XMODEM_NONE;
+   }
+   b = buf->data[XMODEM_BLOCK];
+   block_len = appl_update_xmodem_block_len(buf->data);
    if (xmodem_crc) {
-      if (!appl_update_xmodem_crc(xmodem_buffer, block_len)) {
-         return -EBADMSG;
-      }
+      ok = appl_update_xmodem_crc(buf->data, block_len);
    } else {
-      int sum = 0;
-      const uint8_t *cur = &xmodem_buffer[XMODEM_HEADER_LEN];
-
-      for (int i = 0; i < block_len; ++i) {
-         sum += *cur++;
-      }
-      if (*cur == (uint8_t)sum) {
-         LOG_INF("Block 128 %u verified", b);
-      } else {
-         LOG_INF("Block 128 %u checksum error %u != %u", b, (uint8_t)sum, *cur);
-         return -EBADMSG;
-      }
+      ok = appl_update_xmodem_checksum(buf->data, block_len);
+   }
+   if (!ok) {
+      appl_update_xmodem_release(buf);
+      return rc;
    }
 
    if (xmodem_block == b) {
-      rc = appl_update_write(&xmodem_buffer[XMODEM_HEADER_LEN], block_len);
+      // keep buffer for appl_update_xmodem_write_block
+      return XMODEM_BLOCK_READY;
+   }
+   if (xmodem_stream && b == 0 && (xmodem_block == 1 || !buf->data[XMODEM_HEADER_LEN])) {
+      // YMODEM header, file name and size, or empty for batch end
+      appl_update_xmodem_header(buf->data, block_len);
+      rc = XMODEM_HEADER;
+   } else if (xmodem_block == (uint8_t)(b + 1)) {
+      // b already processed, next block expected
+      rc = XMODEM_DUPLICATE;
+   }
+   appl_update_xmodem_release(buf);
+   return rc;
+}
+
+int appl_update_xmodem_write_block(void)
+{
+   struct xmodem_buffer *buf = &xmodem_buffers[xmodem_wr];
+   int rc = -EINVAL;
+
+   if (atomic_get(&buf->ready)) {
+      rc = appl_update_write(&buf->data[XMODEM_HEADER_LEN],
+                             appl_update_xmodem_block_len(buf->data));
       ++xmodem_block;
-   } else {
-      ++b;
-      if (xmodem_block == b) {
-         // b already processed, next block expected
-         rc = XMODEM_DUPLICATE;
-      } else {
-         return -EBADMSG;
-      }
+      appl_update_xmodem_release(buf);
    }
-   xmodem_len = 0;
    return rc;
 }
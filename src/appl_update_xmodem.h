@@ -14,6 +14,7 @@
 #ifndef APPL_UPDATE_XMODEM_H
 #define APPL_UPDATE_XMODEM_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -22,7 +23,9 @@
 #define XMODEM_EOT 0x04
 #define XMODEM_ACK 0x06
 #define XMODEM_NAK 0x15
+#define XMODEM_CAN 0x18
 #define XMODEM_CRC 'C'
+#define XMODEM_STREAM 'G'
 
 enum xmodem_state {
    XMODEM_NONE,
@@ -30,11 +33,13 @@ enum xmodem_state {
    XMODEM_BLOCK_READY,
    XMODEM_READY,
    XMODEM_DUPLICATE,
+   XMODEM_HEADER,
 };
 
-int appl_update_xmodem_start(uint8_t *buffer, size_t size, bool crc);
-int appl_update_xmodem_append(const uint8_t *data, size_t len);
+int appl_update_xmodem_start(bool crc, bool stream);
+int appl_update_xmodem_append(const uint8_t *data, size_t len, size_t *used);
 void appl_update_xmodem_retry(void);
+int appl_update_xmodem_verify_block(void);
 int appl_update_xmodem_write_block(void);
 
 #endif /* APPL_UPDATE_XMODEM_H */
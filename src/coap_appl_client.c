@@ -28,9 +28,12 @@
 #include "power_manager.h"
 
 #include "appl_diagnose.h"
+#include "appl_energy.h"
+#include "appl_histogram.h"
 #include "appl_settings.h"
 #include "appl_time.h"
 #include "environment_sensor.h"
+#include "io_job_queue.h"
 
 #include "sh_cmd.h"
 
@@ -46,6 +49,14 @@
 #include "nau7802.h"
 #endif
 
+#ifdef CONFIG_COAP_SENML
+#include "coap_appl_senml.h"
+#endif
+
+#ifdef CONFIG_APPL_STORE_FORWARD
+#include "appl_queue.h"
+#endif
+
 #define APP_COAP_LOG_PAYLOAD_SIZE 128
 
 #define COAP_OPTION_NO_RESPONSE 0x102
@@ -63,6 +74,17 @@ static COAP_CONTEXT(appl_context, 1280);
 
 static uint8_t coap_read_etag[COAP_TOKEN_MAX_LEN + 1];
 
+/* sensor sections, prepared while the modem attaches */
+#define PREBUILD_SIZE 1024
+#define PREBUILD_MAX_AGE_MS (30 * MSEC_PER_SEC)
+
+static K_MUTEX_DEFINE(prebuild_mutex);
+static bool prebuild_pending;
+static int prebuild_flags;
+static int prebuild_len;
+static int64_t prebuild_time;
+static char prebuild_buf[PREBUILD_SIZE];
+
 LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
 
 static int coap_appl_client_encode_time(struct coap_packet *request)
@@ -503,9 +525,6 @@ int coap_appl_client_prepare_net_info(char *buf, size_t len, int flags)
             buf[index++] = '\n';
          }
          start = index;
-         if (strstart(params.network_info.local_ip6, "0000:0000:0000:0000:", false)) {
-            modem_read_pdn_info(&params.network_info);
-         }
          if (params.network_info.local_ip[0] && params.network_info.local_ip6[0]) {
             index += snprintf(buf + index, len - index, "PDN: %s,%s,%s",
                               params.network_info.apn, params.network_info.local_ip, params.network_info.local_ip6);
@@ -631,7 +650,7 @@ int coap_appl_client_prepare_net_stats(char *buf, size_t len, int flags)
 
    if (!(flags & COAP_SEND_FLAG_MINIMAL)) {
       memset(&params, 0, sizeof(params));
-      if (modem_read_statistic(&params.network_statistic) >= 0) {
+      if (modem_get_statistic(&params.network_statistic) >= 0) {
          if (index) {
             buf[index++] = '\n';
          }
@@ -654,20 +673,62 @@ int coap_appl_client_prepare_net_stats(char *buf, size_t len, int flags)
                            params.network_statistic.connected_time, params.network_statistic.asleep_time);
          dtls_info("%s", buf + start);
       }
+#ifdef CONFIG_APPL_HISTOGRAM
+      char latency[200];
+      if (appl_histogram_desc_all(latency, sizeof(latency)) > 0) {
+         if (index) {
+            buf[index++] = '\n';
+         }
+         start = index;
+         index += snprintf(buf + index, len - index, "Latency: %s", latency);
+         dtls_info("%s", buf + start);
+      }
+#endif /* CONFIG_APPL_HISTOGRAM */
    }
 
    return index;
 }
 
 #if defined(CONFIG_ENVIRONMENT_SENSOR)
-static int coap_appl_client_prepare_env_history(const double *values, size_t size, int prec, char *buf, size_t len)
+#if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
+/* too large for the stack of the callers */
+static K_MUTEX_DEFINE(env_history_mutex);
+static int16_t env_history_values[CONFIG_ENVIRONMENT_HISTORY_SIZE];
+static uint16_t env_history_iaqs[CONFIG_ENVIRONMENT_HISTORY_SIZE];
+#endif
+
+static int coap_appl_client_print_scaled(char *buf, size_t len, int value, int scale)
+{
+   int prec = 0;
+   unsigned int abs_value = value < 0 ? -value : value;
+
+   for (int factor = scale; factor > 1; factor /= 10) {
+      ++prec;
+   }
+   if (!prec) {
+      return snprintf(buf, len, "%d", value);
+   }
+   return snprintf(buf, len, "%s%u.%0*u", value < 0 ? "-" : "", abs_value / scale, prec, abs_value % scale);
+}
+
+/* reserve space for a single value, e.g. ",-327.68" */
+#define ENV_HISTORY_VALUE_SIZE 10
+
+static int coap_appl_client_prepare_env_history(const int16_t *values, size_t size, int scale, char *buf, size_t len)
 {
    int index = 0;
-   int history_index = 0;
-   for (; history_index < size; ++history_index) {
-      index += snprintf(buf + index, len - index, "%.*f,", prec, values[history_index]);
+   int history_index = 1;
+
+   index = coap_appl_client_print_scaled(buf, len, values[0], scale);
+   for (; history_index < size && (index + ENV_HISTORY_VALUE_SIZE) < len; ++history_index) {
+#ifdef CONFIG_ENVIRONMENT_HISTORY_DELTA
+      index += snprintf(buf + index, len - index, "%c%d", history_index == 1 ? ';' : ',',
+                        values[history_index] - values[history_index - 1]);
+#else  /* CONFIG_ENVIRONMENT_HISTORY_DELTA */
+      buf[index++] = ',';
+      index += coap_appl_client_print_scaled(buf + index, len - index, values[history_index], scale);
+#endif /* CONFIG_ENVIRONMENT_HISTORY_DELTA */
    }
-   --index;
    return index;
 }
 #endif
@@ -681,22 +742,26 @@ int coap_appl_client_prepare_env_info(char *buf, size_t len, int flags)
    int start = 0;
    int32_t int_value = 0;
    uint8_t byte_value = 0;
+   double value = 0.0;
 
 #if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
-   double values[CONFIG_ENVIRONMENT_HISTORY_SIZE];
-   uint16_t iaqs[CONFIG_ENVIRONMENT_HISTORY_SIZE];
+   int16_t *values = env_history_values;
+   uint16_t *iaqs = env_history_iaqs;
+
+   k_mutex_lock(&env_history_mutex, K_FOREVER);
 #else
-   double values[1];
+   int16_t values[1];
 #endif
 
 #if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
    res = environment_get_temperature_history(values, CONFIG_ENVIRONMENT_HISTORY_SIZE);
 #endif
-   if (res <= 0 && environment_get_temperature(&values[0]) == 0) {
+   if (res <= 0 && environment_get_temperature(&value) == 0) {
+      values[0] = environment_scale_value(value, ENVIRONMENT_TEMPERATURE_SCALE);
       res = 1;
    }
    if (res > 0) {
-      index += coap_appl_client_prepare_env_history(values, res, 2, buf + index, len - index);
+      index += coap_appl_client_prepare_env_history(values, res, ENVIRONMENT_TEMPERATURE_SCALE, buf + index, len - index);
       index += snprintf(buf + index, len - index, " C");
       dtls_info("%s", buf);
    }
@@ -706,7 +771,8 @@ int coap_appl_client_prepare_env_info(char *buf, size_t len, int flags)
 #else
    res = 0;
 #endif
-   if (res <= 0 && environment_get_humidity(&values[0]) == 0) {
+   if (res <= 0 && environment_get_humidity(&value) == 0) {
+      values[0] = environment_scale_value(value, ENVIRONMENT_HUMIDITY_SCALE);
       res = 1;
    }
    if (res > 0) {
@@ -714,7 +780,7 @@ int coap_appl_client_prepare_env_info(char *buf, size_t len, int flags)
          buf[index++] = '\n';
       }
       start = index;
-      index += coap_appl_client_prepare_env_history(values, res, 2, buf + index, len - index);
+      index += coap_appl_client_prepare_env_history(values, res, ENVIRONMENT_HUMIDITY_SCALE, buf + index, len - index);
       index += snprintf(buf + index, len - index, " %%H");
       dtls_info("%s", buf + start);
    }
@@ -724,7 +790,8 @@ int coap_appl_client_prepare_env_info(char *buf, size_t len, int flags)
 #else
    res = 0;
 #endif
-   if (res <= 0 && environment_get_pressure(&values[0]) == 0) {
+   if (res <= 0 && environment_get_pressure(&value) == 0) {
+      values[0] = environment_scale_value(value, ENVIRONMENT_PRESSURE_SCALE);
       res = 1;
    }
    if (res > 0) {
@@ -732,7 +799,7 @@ int coap_appl_client_prepare_env_info(char *buf, size_t len, int flags)
          buf[index++] = '\n';
       }
       start = index;
-      index += coap_appl_client_prepare_env_history(values, res, 0, buf + index, len - index);
+      index += coap_appl_client_prepare_env_history(values, res, ENVIRONMENT_PRESSURE_SCALE, buf + index, len - index);
       index += snprintf(buf + index, len - index, " hPa");
       dtls_info("%s", buf + start);
    }
@@ -746,7 +813,7 @@ int coap_appl_client_prepare_env_info(char *buf, size_t len, int flags)
          buf[index++] = '\n';
       }
       start = index;
-      for (history_index = 0; history_index < int_value; ++history_index) {
+      for (history_index = 0; history_index < res && (index + ENV_HISTORY_VALUE_SIZE) < len; ++history_index) {
          index += snprintf(buf + index, len - index, "%d;%d,", IAQ_VALUE(iaqs[history_index]), IAQ_ACCURANCY(iaqs[history_index]));
       }
       --index;
@@ -763,18 +830,19 @@ int coap_appl_client_prepare_env_info(char *buf, size_t len, int flags)
       index += snprintf(buf + index, len - index, "!%d;%d Q (%s)", int_value, byte_value, desc);
       dtls_info("%s", buf + start);
    }
+#if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
+   k_mutex_unlock(&env_history_mutex);
+#endif
 #else  /* CONFIG_ENVIRONMENT_SENSOR */
 
-   res = modem_at_cmd(buf + index, len - index, "%XTEMP: ", "AT%XTEMP?");
-   if (res > 0) {
-      index += res;
-      index += snprintf(buf + index, len - index, " C");
+   int temperature = 0;
+
+   res = modem_get_temperature(&temperature);
+   if (!res) {
+      index = snprintf(buf, len, "%d C", temperature);
       dtls_info("%s", buf);
-   } else {
-      if (res < 0) {
-         dtls_warn("Failed to read XTEMP.");
-      }
-      index = 0;
+   } else if (res != -ENODATA) {
+      dtls_warn("Failed to read XTEMP.");
    }
 #endif /* CONFIG_ENVIRONMENT_SENSOR */
    return index;
@@ -876,6 +944,104 @@ int coap_appl_client_prepare_location_info(char *buf, size_t len, int flags)
    return index;
 }
 
+/* location, environment and scale sections, each starting with a new line */
+static int coap_appl_client_build_sensors(char *buf, size_t len, int flags)
+{
+   int err;
+   int index = 0;
+   int start = 0;
+   int64_t time = k_uptime_get();
+
+#ifdef CONFIG_LOCATION_ENABLE
+   if (flags & COAP_SEND_FLAG_LOCATION_INFO) {
+      buf[index] = '\n';
+      start = index + 1;
+      err = coap_appl_client_prepare_location_info(buf + start, len - start, flags);
+      if (err > 0) {
+         index = start + err;
+      }
+   }
+#endif /* CONFIG_LOCATION_ENABLE */
+
+   if (flags & COAP_SEND_FLAG_ENV_INFO) {
+      buf[index] = '\n';
+      start = index + 1;
+      err = coap_appl_client_prepare_env_info(buf + start, len - start, flags);
+      if (err > 0) {
+         index = start + err;
+      }
+   }
+
+#ifdef CONFIG_ADC_SCALE
+   if (flags & COAP_SEND_FLAG_SCALE_INFO) {
+      buf[index] = '\n';
+      start = index + 1;
+      err = scale_sample_desc(buf + start, len - start, true);
+      if (err > 0) {
+         index = start + err;
+      }
+   }
+#endif /* CONFIG_ADC_SCALE */
+
+   appl_energy_add(APPL_ENERGY_SENSOR, k_uptime_get() - time);
+   return index;
+}
+
+static void coap_appl_client_prebuild_fn(struct k_work *work)
+{
+   k_mutex_lock(&prebuild_mutex, K_FOREVER);
+   if (!prebuild_pending) {
+      /* already consumed by the send path */
+      k_mutex_unlock(&prebuild_mutex);
+      return;
+   }
+   prebuild_len = coap_appl_client_build_sensors(prebuild_buf, sizeof(prebuild_buf), prebuild_flags);
+   prebuild_time = k_uptime_get();
+   prebuild_pending = false;
+   k_mutex_unlock(&prebuild_mutex);
+   dtls_info("Prebuild %d bytes.", prebuild_len);
+}
+
+static K_WORK_DEFINE(prebuild_work, coap_appl_client_prebuild_fn);
+
+void coap_appl_client_prebuild(int flags)
+{
+   if ((flags & (COAP_SEND_FLAG_SENML | COAP_SEND_FLAG_SET_PAYLOAD)) ||
+       !(flags & (COAP_SEND_FLAG_LOCATION_INFO | COAP_SEND_FLAG_ENV_INFO | COAP_SEND_FLAG_SCALE_INFO))) {
+      return;
+   }
+   k_mutex_lock(&prebuild_mutex, K_FOREVER);
+   prebuild_flags = flags;
+   prebuild_time = 0;
+   prebuild_pending = true;
+   k_mutex_unlock(&prebuild_mutex);
+   /* not on the io queue, the scale sampling would delay the flash writes */
+   work_submit_to_cmd_queue(&prebuild_work);
+}
+
+int coap_appl_client_prepare_sensors(char *buf, size_t len, int flags)
+{
+   int res = 0;
+
+   /*
+    * a not yet started prebuild is done here, a running one is awaited.
+    * A prebuild, which starts after this, finds it consumed.
+    */
+   k_work_cancel(&prebuild_work);
+   k_mutex_lock(&prebuild_mutex, K_FOREVER);
+   if (prebuild_time && prebuild_flags == flags && prebuild_len <= len &&
+       (k_uptime_get() - prebuild_time) < PREBUILD_MAX_AGE_MS) {
+      memcpy(buf, prebuild_buf, prebuild_len);
+      res = prebuild_len;
+   } else {
+      res = coap_appl_client_build_sensors(buf, len, flags);
+   }
+   prebuild_time = 0;
+   prebuild_pending = false;
+   k_mutex_unlock(&prebuild_mutex);
+   return res;
+}
+
 int coap_appl_client_prepare_post(char *buf, size_t len, int flags, const char *trigger)
 {
    int err;
@@ -885,12 +1051,28 @@ int coap_appl_client_prepare_post(char *buf, size_t len, int flags, const char *
    uint8_t *token = (uint8_t *)&appl_context.token;
    char value[MAX_SETTINGS_VALUE_LENGTH];
    struct coap_packet request;
+   int format = COAP_CONTENT_FORMAT_TEXT_PLAIN;
 
    appl_context.message_len = 0;
 
+   /* the payload is served from the status snapshot, only outdated parts are read */
+   modem_refresh_status(false);
+
+#ifdef CONFIG_APPL_STORE_FORWARD
+   /* samples of a previous payload, which wasn't acknowledged */
+   appl_queue_discard();
+#endif /* CONFIG_APPL_STORE_FORWARD */
+
+#ifdef CONFIG_COAP_SENML
+   if ((flags & COAP_SEND_FLAG_SENML) && !(flags & COAP_SEND_FLAG_SET_PAYLOAD)) {
+      /* encoded later directly into the request */
+      format = COAP_CONTENT_FORMAT_SENML_CBOR;
+   }
+#endif /* CONFIG_COAP_SENML */
+
    if (flags & COAP_SEND_FLAG_SET_PAYLOAD) {
       index = len;
-   } else {
+   } else if (format == COAP_CONTENT_FORMAT_TEXT_PLAIN) {
       if (flags & COAP_SEND_FLAG_MODEM_INFO) {
          err = coap_appl_client_prepare_modem_info(buf, len, flags, trigger);
          if (err > 0) {
@@ -925,45 +1107,51 @@ int coap_appl_client_prepare_post(char *buf, size_t len, int flags, const char *
          }
       }
 
-#ifdef CONFIG_LOCATION_ENABLE
-      if (flags & COAP_SEND_FLAG_LOCATION_INFO) {
-         buf[index] = '\n';
-         start = index + 1;
-         err = coap_appl_client_prepare_location_info(buf + start, len - start, flags);
-         if (err > 0) {
-            index = start + err;
-         }
+      err = coap_appl_client_prepare_sensors(buf + index, len - index, flags);
+      if (err > 0) {
+         index += err;
       }
-#endif /* CONFIG_LOCATION_ENABLE */
 
-      if (flags & COAP_SEND_FLAG_ENV_INFO) {
+      if (flags & COAP_SEND_FLAG_NET_SCAN_INFO) {
          buf[index] = '\n';
          start = index + 1;
-         err = coap_appl_client_prepare_env_info(buf + start, len - start, flags);
+         err = modem_get_last_neighbor_cell_meas(buf + start, len - start);
          if (err > 0) {
             index = start + err;
          }
       }
 
-#ifdef CONFIG_ADC_SCALE
-      if (flags & COAP_SEND_FLAG_SCALE_INFO) {
+#ifdef CONFIG_APPL_ENERGY
+      if (flags & COAP_SEND_FLAG_ENERGY) {
          buf[index] = '\n';
          start = index + 1;
-         err = scale_sample_desc(buf + start, len - start, true);
+         err = appl_energy_desc(buf + start, len - start);
          if (err > 0) {
             index = start + err;
          }
       }
-#endif /* CONFIG_ADC_SCALE */
+#endif /* CONFIG_APPL_ENERGY */
 
-      if (flags & COAP_SEND_FLAG_NET_SCAN_INFO) {
+#ifdef CONFIG_APPL_STORE_FORWARD
+      if (flags & COAP_SEND_FLAG_QUEUE) {
          buf[index] = '\n';
          start = index + 1;
-         err = modem_get_last_neighbor_cell_meas(buf + start, len - start);
+         err = appl_queue_prepare(buf + start, len - start);
          if (err > 0) {
             index = start + err;
          }
       }
+#endif /* CONFIG_APPL_STORE_FORWARD */
+
+#ifdef CONFIG_UDP_WAKEUP_ENABLE
+      /* result of the cmd of a wakeup message */
+      buf[index] = '\n';
+      start = index + 1;
+      err = sh_cmd_get_reported_result(buf + start, len - start);
+      if (err > 0) {
+         index = start + err;
+      }
+#endif /* CONFIG_UDP_WAKEUP_ENABLE */
    }
 
    appl_context.token = coap_client_next_token();
@@ -988,8 +1176,7 @@ int coap_appl_client_prepare_post(char *buf, size_t len, int flags, const char *
       }
    }
 
-   err = coap_append_option_int(&request, COAP_OPTION_CONTENT_FORMAT,
-                                COAP_CONTENT_FORMAT_TEXT_PLAIN);
+   err = coap_append_option_int(&request, COAP_OPTION_CONTENT_FORMAT, format);
    if (err < 0) {
       dtls_warn("Failed to encode CoAP CONTENT_FORMAT option, %d", err);
       return err;
@@ -1112,6 +1299,21 @@ int coap_appl_client_prepare_post(char *buf, size_t len, int flags, const char *
          return err;
       }
    }
+#ifdef CONFIG_COAP_SENML
+   if (format == COAP_CONTENT_FORMAT_SENML_CBOR) {
+      err = coap_packet_append_payload_marker(&request);
+      if (err < 0) {
+         dtls_warn("Failed to encode CoAP payload-marker, %d", err);
+         return err;
+      }
+      err = coap_appl_senml_encode(request.data + request.offset, request.max_len - request.offset, flags, trigger);
+      if (err < 0) {
+         dtls_warn("Failed to encode SenML payload, %d", err);
+         return err;
+      }
+      request.offset += err;
+   }
+#endif /* CONFIG_COAP_SENML */
    appl_context.message_len = request.offset;
    dtls_info("CoAP request prepared, token 0x%02x%02x%02x%02x, %u bytes", token[0], token[1], token[2], token[3], request.offset);
 
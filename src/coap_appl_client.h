@@ -32,6 +32,9 @@
 #define COAP_SEND_FLAG_ENV_INFO 512
 #define COAP_SEND_FLAG_SCALE_INFO 1024
 #define COAP_SEND_FLAG_NET_SCAN_INFO 2048
+#define COAP_SEND_FLAG_SENML 4096
+#define COAP_SEND_FLAG_QUEUE 8192
+#define COAP_SEND_FLAG_ENERGY 16384
 
 #ifdef CONFIG_COAP_SEND_MODEM_INFO
 #define COAP_SEND_FLAG_MODEM_INFO_ COAP_SEND_FLAG_MODEM_INFO
@@ -69,15 +72,27 @@
 #define COAP_SEND_FLAG_SCALE_INFO_ 0
 #endif
 
+#ifdef CONFIG_APPL_STORE_FORWARD
+#define COAP_SEND_FLAG_QUEUE_ COAP_SEND_FLAG_QUEUE
+#else
+#define COAP_SEND_FLAG_QUEUE_ 0
+#endif
+
 #define COAP_SEND_FLAGS_ALL (COAP_SEND_FLAG_MODEM_INFO_ | COAP_SEND_FLAG_SIM_INFO_ |    \
                              COAP_SEND_FLAG_NET_INFO_ | COAP_SEND_FLAG_NET_STATS_ |     \
                              COAP_SEND_FLAG_LOCATION_INFO_ | COAP_SEND_FLAG_ENV_INFO | \
-                             COAP_SEND_FLAG_SCALE_INFO_)
+                             COAP_SEND_FLAG_SCALE_INFO_ | COAP_SEND_FLAG_QUEUE_)
+
+#ifdef CONFIG_COAP_SEND_SENML
+#define COAP_SEND_FLAG_SENML_ COAP_SEND_FLAG_SENML
+#else
+#define COAP_SEND_FLAG_SENML_ 0
+#endif
 
 #ifdef CONFIG_COAP_SEND_MINIMAL
-#define COAP_SEND_FLAGS (COAP_SEND_FLAG_MINIMAL | COAP_SEND_FLAGS_ALL)
+#define COAP_SEND_FLAGS (COAP_SEND_FLAG_MINIMAL | COAP_SEND_FLAGS_ALL | COAP_SEND_FLAG_SENML_)
 #else
-#define COAP_SEND_FLAGS COAP_SEND_FLAGS_ALL
+#define COAP_SEND_FLAGS (COAP_SEND_FLAGS_ALL | COAP_SEND_FLAG_SENML_)
 #endif
 
 int coap_appl_client_parse_data(uint8_t *data, size_t len);
@@ -92,6 +107,15 @@ int coap_appl_client_prepare_net_stats(char *buf, size_t len, int flags);
 
 int coap_appl_client_prepare_env_info(char *buf, size_t len, int flags);
 
+/*
+ * start to prepare the sensor sections of the next text payload on the cmd queue,
+ * sampling the scale on the io queue would delay the storage flash writes
+ */
+void coap_appl_client_prebuild(int flags);
+
+/* sensor sections, uses the prebuild sections, if available */
+int coap_appl_client_prepare_sensors(char *buf, size_t len, int flags);
+
 int coap_appl_client_prepare_post(char *buf, size_t len, int flags, const char* trigger);
 
 int coap_appl_client_message(const uint8_t **buffer);
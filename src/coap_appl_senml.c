@@ -0,0 +1,571 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+
+/* auto generated header file during west build */
+#include "ncs_version.h"
+
+#include "appl_diagnose.h"
+#include "appl_time.h"
+#include "coap_appl_client.h"
+#include "coap_appl_senml.h"
+#include "dtls_client.h"
+#include "dtls_debug.h"
+#include "environment_sensor.h"
+#include "modem.h"
+#include "modem_desc.h"
+#include "modem_sim.h"
+#include "power_manager.h"
+#include "sh_cmd.h"
+
+#ifdef CONFIG_LOCATION_ENABLE
+#include "location.h"
+#endif
+
+#ifdef CONFIG_NAU7802_SCALE
+#include "nau7802.h"
+#endif
+
+LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
+
+#define CBOR_MAJOR_UINT 0
+#define CBOR_MAJOR_NINT 1
+#define CBOR_MAJOR_TEXT 3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP 5
+
+#define CBOR_FLOAT32 0xfa
+#define CBOR_FLOAT64 0xfb
+
+/* RFC 8428, 6. CBOR Representation, labels */
+#define SENML_LABEL_BASE_NAME -2
+#define SENML_LABEL_BASE_TIME -3
+#define SENML_LABEL_BASE_UNIT -4
+#define SENML_LABEL_NAME 0
+#define SENML_LABEL_UNIT 1
+#define SENML_LABEL_VALUE 2
+#define SENML_LABEL_STRING_VALUE 3
+#define SENML_LABEL_TIME 6
+
+/* definite array with 16 bit length, patched when finished */
+#define SENML_PACK_HEADER_SIZE 3
+
+typedef enum {
+   SENML_INT,
+   SENML_FLOAT,
+   SENML_DOUBLE,
+   SENML_TEXT,
+} senml_value_type_t;
+
+typedef struct senml_writer {
+   uint8_t *buf;
+   size_t len;
+   size_t index;
+   uint16_t records;
+   bool overflow;
+   int64_t base_time;
+} senml_writer_t;
+
+static void senml_put(senml_writer_t *writer, const uint8_t *data, size_t len)
+{
+   if (writer->overflow || writer->index + len > writer->len) {
+      writer->overflow = true;
+      return;
+   }
+   memcpy(&writer->buf[writer->index], data, len);
+   writer->index += len;
+}
+
+static void cbor_put_head(senml_writer_t *writer, uint8_t major, uint32_t value)
+{
+   uint8_t head[5];
+   size_t len = 1;
+
+   major <<= 5;
+   if (value < 24) {
+      head[0] = major | value;
+   } else if (value <= 0xff) {
+      head[0] = major | 24;
+      head[1] = value;
+      len = 2;
+   } else if (value <= 0xffff) {
+      head[0] = major | 25;
+      sys_put_be16(value, &head[1]);
+      len = 3;
+   } else {
+      head[0] = major | 26;
+      sys_put_be32(value, &head[1]);
+      len = 5;
+   }
+   senml_put(writer, head, len);
+}
+
+static void cbor_put_int(senml_writer_t *writer, int32_t value)
+{
+   if (value < 0) {
+      cbor_put_head(writer, CBOR_MAJOR_NINT, (uint32_t)(-1 - value));
+   } else {
+      cbor_put_head(writer, CBOR_MAJOR_UINT, (uint32_t)value);
+   }
+}
+
+static void cbor_put_text(senml_writer_t *writer, const char *value)
+{
+   size_t len = strlen(value);
+
+   cbor_put_head(writer, CBOR_MAJOR_TEXT, len);
+   senml_put(writer, (const uint8_t *)value, len);
+}
+
+static void cbor_put_float(senml_writer_t *writer, float value)
+{
+   uint8_t data[5];
+   uint32_t bits;
+
+   memcpy(&bits, &value, sizeof(bits));
+   data[0] = CBOR_FLOAT32;
+   sys_put_be32(bits, &data[1]);
+   senml_put(writer, data, sizeof(data));
+}
+
+static void cbor_put_double(senml_writer_t *writer, double value)
+{
+   uint8_t data[9];
+   uint64_t bits;
+
+   memcpy(&bits, &value, sizeof(bits));
+   data[0] = CBOR_FLOAT64;
+   sys_put_be64(bits, &data[1]);
+   senml_put(writer, data, sizeof(data));
+}
+
+/* the first record carries the base time */
+static void senml_put_record_head(senml_writer_t *writer, uint32_t fields)
+{
+   bool base_time = !writer->records && writer->base_time > 0;
+
+   cbor_put_head(writer, CBOR_MAJOR_MAP, base_time ? fields + 1 : fields);
+   if (base_time) {
+      cbor_put_int(writer, SENML_LABEL_BASE_TIME);
+      cbor_put_int(writer, (int32_t)writer->base_time);
+   }
+}
+
+static void senml_add_record(senml_writer_t *writer, const char *name, const char *unit,
+                             senml_value_type_t type, int32_t int_value, double value, const char *text)
+{
+   uint32_t fields = 2;
+
+   if (unit) {
+      ++fields;
+   }
+   senml_put_record_head(writer, fields);
+   cbor_put_int(writer, SENML_LABEL_NAME);
+   cbor_put_text(writer, name);
+   if (unit) {
+      cbor_put_int(writer, SENML_LABEL_UNIT);
+      cbor_put_text(writer, unit);
+   }
+   if (type == SENML_TEXT) {
+      cbor_put_int(writer, SENML_LABEL_STRING_VALUE);
+      cbor_put_text(writer, text);
+   } else {
+      cbor_put_int(writer, SENML_LABEL_VALUE);
+      if (type == SENML_INT) {
+         cbor_put_int(writer, int_value);
+      } else if (type == SENML_FLOAT) {
+         cbor_put_float(writer, (float)value);
+      } else {
+         cbor_put_double(writer, value);
+      }
+   }
+   ++writer->records;
+}
+
+static inline void senml_add_int(senml_writer_t *writer, const char *name, const char *unit, int32_t value)
+{
+   senml_add_record(writer, name, unit, SENML_INT, value, 0.0, NULL);
+}
+
+static inline void senml_add_float(senml_writer_t *writer, const char *name, const char *unit, double value)
+{
+   senml_add_record(writer, name, unit, SENML_FLOAT, 0, value, NULL);
+}
+
+static inline void senml_add_double(senml_writer_t *writer, const char *name, const char *unit, double value)
+{
+   senml_add_record(writer, name, unit, SENML_DOUBLE, 0, value, NULL);
+}
+
+static inline void senml_add_text(senml_writer_t *writer, const char *name, const char *value)
+{
+   if (value && *value) {
+      senml_add_record(writer, name, NULL, SENML_TEXT, 0, 0.0, value);
+   }
+}
+
+static void senml_encode_modem_info(senml_writer_t *writer, int flags, const char *trigger)
+{
+   uint8_t battery_level = PM_INVALID_LEVEL;
+   uint16_t battery_voltage = PM_INVALID_VOLTAGE;
+   struct lte_modem_info modem_info;
+
+   senml_add_int(writer, "up", "s", (int32_t)(k_uptime_get() / MSEC_PER_SEC));
+   senml_add_text(writer, "fw", appl_get_version());
+   senml_add_int(writer, "fail", NULL, failures);
+   senml_add_text(writer, "trigger", trigger);
+
+   if ((flags & COAP_SEND_FLAG_INITIAL) || !(flags & COAP_SEND_FLAG_MINIMAL)) {
+      memset(&modem_info, 0, sizeof(modem_info));
+      if (!modem_get_modem_info(&modem_info)) {
+         senml_add_text(writer, "ncs", NCS_VERSION_STRING);
+         senml_add_text(writer, "hw", modem_info.version);
+         senml_add_text(writer, "mfw", modem_info.firmware);
+         senml_add_text(writer, "imei", modem_info.imei);
+      }
+   }
+
+   if (!power_manager_status(&battery_level, &battery_voltage, NULL, NULL)) {
+      if (battery_voltage != PM_INVALID_VOLTAGE) {
+         senml_add_float(writer, "bat", "V", battery_voltage / 1000.0);
+      }
+      if (battery_level != PM_INVALID_LEVEL) {
+         senml_add_int(writer, "batlvl", "%EL", battery_level);
+      }
+   }
+
+   if (coap_rtt_ms > 0) {
+      senml_add_int(writer, "retrans", NULL, retransmissions);
+      senml_add_int(writer, "rtt", "ms", coap_rtt_ms);
+   }
+   if (connect_time_ms > 0) {
+      senml_add_int(writer, "ct", "ms", connect_time_ms);
+   }
+}
+
+static void senml_encode_sim_info(senml_writer_t *writer, int flags)
+{
+   struct lte_sim_info sim_info;
+
+   memset(&sim_info, 0, sizeof(sim_info));
+   if (modem_sim_get_info(&sim_info) >= 0 && sim_info.valid) {
+      if ((flags & COAP_SEND_FLAG_INITIAL) || !(flags & COAP_SEND_FLAG_MINIMAL)) {
+         senml_add_text(writer, "iccid", sim_info.iccid);
+      }
+      senml_add_text(writer, "imsi", sim_info.imsi);
+   }
+}
+
+static void senml_encode_net_info(senml_writer_t *writer, int flags)
+{
+   struct lte_network_info network_info;
+   struct lte_lc_psm_cfg psm;
+   int time;
+
+   memset(&network_info, 0, sizeof(network_info));
+   if (!modem_get_network_info(&network_info)) {
+      senml_add_text(writer, "mode", modem_get_network_mode_description(network_info.mode));
+      if (network_info.registered == LTE_NETWORK_STATE_ON) {
+         senml_add_int(writer, "band", NULL, network_info.band);
+         senml_add_text(writer, "plmn", network_info.provider);
+         if (!(flags & COAP_SEND_FLAG_MINIMAL)) {
+            senml_add_int(writer, "tac", NULL, network_info.tac);
+         }
+         senml_add_int(writer, "cell", NULL, network_info.cell);
+         senml_add_int(writer, "earfcn", NULL, network_info.earfcn);
+      }
+   }
+   if (!(flags & COAP_SEND_FLAG_MINIMAL)) {
+      memset(&psm, 0, sizeof(psm));
+      if (modem_get_psm_status(&psm) == 0 && psm.active_time >= 0) {
+         senml_add_int(writer, "tau", "s", psm.tau);
+         senml_add_int(writer, "act", "s", psm.active_time);
+      }
+      time = modem_get_release_time();
+      if (time >= 0) {
+         senml_add_int(writer, "rel", "ms", time);
+      }
+   }
+}
+
+static void senml_encode_net_stats(senml_writer_t *writer, int flags)
+{
+   struct lte_ce_info ce_info;
+   struct lte_network_statistic statistic;
+
+   memset(&ce_info, 0, sizeof(ce_info));
+   if (modem_get_coverage_enhancement_info(&ce_info) >= 0) {
+      if (ce_info.ce_supported && !(flags & COAP_SEND_FLAG_MINIMAL)) {
+         senml_add_int(writer, "ce_dl", NULL, ce_info.downlink_repetition);
+         senml_add_int(writer, "ce_ul", NULL, ce_info.uplink_repetition);
+      }
+      if (ce_info.rsrp < INVALID_SIGNAL_VALUE) {
+         senml_add_int(writer, "rsrp", "dBm", ce_info.rsrp);
+      }
+      if (ce_info.rsrq < INVALID_SIGNAL_VALUE && !(flags & COAP_SEND_FLAG_MINIMAL)) {
+         senml_add_float(writer, "rsrq", "dB", ce_info.rsrq / 2.0);
+      }
+      if (ce_info.cinr < INVALID_SIGNAL_VALUE && !(flags & COAP_SEND_FLAG_MINIMAL)) {
+         senml_add_int(writer, "cinr", "dB", ce_info.cinr);
+      }
+      if (ce_info.snr < INVALID_SIGNAL_VALUE) {
+         senml_add_int(writer, "snr", "dB", ce_info.snr);
+      }
+   }
+   if (!(flags & COAP_SEND_FLAG_MINIMAL)) {
+      memset(&statistic, 0, sizeof(statistic));
+      if (modem_get_statistic(&statistic) >= 0) {
+         senml_add_int(writer, "tx", "B", statistic.transmitted * 1024);
+         senml_add_int(writer, "rx", "B", statistic.received * 1024);
+         senml_add_int(writer, "searchs", NULL, statistic.searchs);
+         senml_add_int(writer, "search", "s", statistic.search_time);
+         senml_add_int(writer, "wakeups", NULL, statistic.wakeups);
+         senml_add_int(writer, "connected", "s", statistic.connected_time);
+         senml_add_int(writer, "asleep", "s", statistic.asleep_time);
+         senml_add_int(writer, "handshakes", NULL, dtls_handshakes);
+      }
+   }
+}
+
+#ifdef CONFIG_ENVIRONMENT_SENSOR
+#if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
+/* too large for the stack of the callers */
+static K_MUTEX_DEFINE(senml_env_history_mutex);
+static int16_t senml_env_history_values[CONFIG_ENVIRONMENT_HISTORY_SIZE];
+#endif
+
+/*
+ * The first record of a series sets name and unit as base values, the
+ * following records carry only value and relative time. Base values apply
+ * to all following records of the pack, therefore the series are
+ * encoded last.
+ */
+static void senml_encode_env_history(senml_writer_t *writer, const char *name, const char *unit,
+                                     const int16_t *values, int size, double factor)
+{
+   for (int index = 0; index < size; ++index) {
+      int32_t time = -index * CONFIG_ENVIRONMENT_HISTORY_INTERVAL_S;
+
+      senml_put_record_head(writer, index ? 2 : 3);
+      if (!index) {
+         cbor_put_int(writer, SENML_LABEL_BASE_NAME);
+         cbor_put_text(writer, name);
+         cbor_put_int(writer, SENML_LABEL_BASE_UNIT);
+         cbor_put_text(writer, unit);
+      }
+      cbor_put_int(writer, SENML_LABEL_VALUE);
+      cbor_put_float(writer, (float)(values[index] * factor));
+      if (index) {
+         cbor_put_int(writer, SENML_LABEL_TIME);
+         cbor_put_int(writer, time);
+      }
+      ++writer->records;
+   }
+}
+#endif /* CONFIG_ENVIRONMENT_SENSOR */
+
+static void senml_encode_env_info(senml_writer_t *writer, int flags)
+{
+#ifdef CONFIG_ENVIRONMENT_SENSOR
+   int res = 0;
+   double value = 0.0;
+#if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
+   int16_t *values = senml_env_history_values;
+
+   k_mutex_lock(&senml_env_history_mutex, K_FOREVER);
+#else
+   int16_t values[1];
+#endif
+
+#if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
+   res = environment_get_temperature_history(values, CONFIG_ENVIRONMENT_HISTORY_SIZE);
+#endif
+   if (res <= 0 && environment_get_temperature(&value) == 0) {
+      values[0] = environment_scale_value(value, ENVIRONMENT_TEMPERATURE_SCALE);
+      res = 1;
+   }
+   senml_encode_env_history(writer, "temp", "Cel", values, res, 1.0 / ENVIRONMENT_TEMPERATURE_SCALE);
+
+#if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
+   res = environment_get_humidity_history(values, CONFIG_ENVIRONMENT_HISTORY_SIZE);
+#else
+   res = 0;
+#endif
+   if (res <= 0 && environment_get_humidity(&value) == 0) {
+      values[0] = environment_scale_value(value, ENVIRONMENT_HUMIDITY_SCALE);
+      res = 1;
+   }
+   senml_encode_env_history(writer, "hum", "%RH", values, res, 1.0 / ENVIRONMENT_HUMIDITY_SCALE);
+
+#if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
+   res = environment_get_pressure_history(values, CONFIG_ENVIRONMENT_HISTORY_SIZE);
+#else
+   res = 0;
+#endif
+   if (res <= 0 && environment_get_pressure(&value) == 0) {
+      values[0] = environment_scale_value(value, ENVIRONMENT_PRESSURE_SCALE);
+      res = 1;
+   }
+   /* hPa => Pa */
+   senml_encode_env_history(writer, "press", "Pa", values, res, 100.0 / ENVIRONMENT_PRESSURE_SCALE);
+#if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
+   k_mutex_unlock(&senml_env_history_mutex);
+#endif
+#else  /* CONFIG_ENVIRONMENT_SENSOR */
+   (void)writer;
+#endif /* CONFIG_ENVIRONMENT_SENSOR */
+   (void)flags;
+}
+
+static void senml_encode_scale_info(senml_writer_t *writer)
+{
+#ifdef CONFIG_ADC_SCALE
+   double scaleA = 0;
+   double scaleB = 0;
+   double temperatureA = 0;
+   double temperatureB = 0;
+   int res = scale_sample(&scaleA, &scaleB, &temperatureA, &temperatureB);
+
+   if (res > 0) {
+      if (res & 1) {
+         senml_add_float(writer, "cha", "kg", scaleA);
+         senml_add_float(writer, "cha_temp", "Cel", temperatureA);
+      }
+      if (res & 2) {
+         senml_add_float(writer, "chb", "kg", scaleB);
+         senml_add_float(writer, "chb_temp", "Cel", temperatureB);
+      }
+   }
+#else  /* CONFIG_ADC_SCALE */
+   (void)writer;
+#endif /* CONFIG_ADC_SCALE */
+}
+
+static void senml_encode_net_scan_info(senml_writer_t *writer)
+{
+   /* text head with 16 bit length, the text is copied in place */
+   const size_t head = 3;
+   size_t start;
+   int len = modem_get_last_neighbor_cell_meas(NULL, 0xffff);
+
+   if (len <= 0) {
+      return;
+   }
+   senml_put_record_head(writer, 2);
+   cbor_put_int(writer, SENML_LABEL_NAME);
+   cbor_put_text(writer, "ncells");
+   cbor_put_int(writer, SENML_LABEL_STRING_VALUE);
+   start = writer->index;
+   /* the copy is terminated with a '\0' */
+   if (writer->overflow || start + head + len + 1 > writer->len) {
+      writer->overflow = true;
+      return;
+   }
+   len = modem_get_last_neighbor_cell_meas((char *)&writer->buf[start + head], len + 1);
+   writer->buf[start] = (CBOR_MAJOR_TEXT << 5) | 25;
+   sys_put_be16(len, &writer->buf[start + 1]);
+   writer->index = start + head + len;
+   ++writer->records;
+}
+
+static void senml_encode_location_info(senml_writer_t *writer, int flags)
+{
+#ifdef CONFIG_LOCATION_ENABLE
+   struct modem_gnss_state result;
+   bool pending;
+
+   if (location_get(&result, &pending) == MODEM_GNSS_POSITION && result.valid) {
+      senml_add_double(writer, "lat", "lat", result.position.latitude);
+      senml_add_double(writer, "lon", "lon", result.position.longitude);
+      senml_add_float(writer, "acc", "m", result.position.accuracy);
+   }
+#else  /* CONFIG_LOCATION_ENABLE */
+   (void)writer;
+#endif /* CONFIG_LOCATION_ENABLE */
+   (void)flags;
+}
+
+static void senml_encode_cmd_result(senml_writer_t *writer)
+{
+#ifdef CONFIG_UDP_WAKEUP_ENABLE
+   /* result of the cmd of a wakeup message, "Cmd: <cmd> => <result>" */
+   char result[128];
+   const char *value = result;
+
+   if (sh_cmd_get_reported_result(result, sizeof(result)) > 0) {
+      if (!strncmp(value, "Cmd: ", 5)) {
+         value += 5;
+      }
+      senml_add_text(writer, "cmd", value);
+   }
+#else  /* CONFIG_UDP_WAKEUP_ENABLE */
+   (void)writer;
+#endif /* CONFIG_UDP_WAKEUP_ENABLE */
+}
+
+int coap_appl_senml_encode(uint8_t *buf, size_t len, int flags, const char *trigger)
+{
+   senml_writer_t writer;
+
+   if (len < SENML_PACK_HEADER_SIZE) {
+      return -ENOMEM;
+   }
+
+   memset(&writer, 0, sizeof(writer));
+   writer.buf = buf;
+   writer.len = len;
+   writer.index = SENML_PACK_HEADER_SIZE;
+   appl_get_now(&writer.base_time);
+   writer.base_time /= MSEC_PER_SEC;
+
+   if (flags & COAP_SEND_FLAG_MODEM_INFO) {
+      senml_encode_modem_info(&writer, flags, trigger);
+   }
+   if (flags & COAP_SEND_FLAG_SIM_INFO) {
+      senml_encode_sim_info(&writer, flags);
+   }
+   if (flags & COAP_SEND_FLAG_NET_INFO) {
+      senml_encode_net_info(&writer, flags);
+   }
+   if (flags & COAP_SEND_FLAG_NET_STATS) {
+      senml_encode_net_stats(&writer, flags);
+   }
+   if (flags & COAP_SEND_FLAG_LOCATION_INFO) {
+      senml_encode_location_info(&writer, flags);
+   }
+   if (flags & COAP_SEND_FLAG_SCALE_INFO) {
+      senml_encode_scale_info(&writer);
+   }
+   if (flags & COAP_SEND_FLAG_NET_SCAN_INFO) {
+      senml_encode_net_scan_info(&writer);
+   }
+   senml_encode_cmd_result(&writer);
+   /* last, the history series use base name and unit */
+   if (flags & COAP_SEND_FLAG_ENV_INFO) {
+      senml_encode_env_info(&writer, flags);
+   }
+
+   if (writer.overflow) {
+      dtls_warn("SenML: %u records exceeds %u bytes.", writer.records, len);
+      return -ENOMEM;
+   }
+
+   buf[0] = (CBOR_MAJOR_ARRAY << 5) | 25;
+   sys_put_be16(writer.records, &buf[1]);
+   dtls_info("SenML: %u records, %u bytes.", writer.records, writer.index);
+
+   return writer.index;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#ifndef COAP_APPL_SENML_H
+#define COAP_APPL_SENML_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Encode the sections selected by the flags as SenML-CBOR pack.
+ *
+ * @param buf buffer for the encoded pack.
+ *
+ * @param len length of the buffer.
+ *
+ * @param flags COAP_SEND_FLAG_* selecting the sections.
+ *
+ * @param trigger trigger description. May be NULL.
+ *
+ * @return number of encoded bytes, or -ENOMEM, if the buffer is too small.
+ */
+int coap_appl_senml_encode(uint8_t *buf, size_t len, int flags, const char *trigger);
+
+#endif /* COAP_APPL_SENML_H */
@@ -11,9 +11,11 @@
  * SPDX-License-Identifier: EPL-2.0
  */
 
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 #include <version.h>
+#include <zephyr/sys/byteorder.h>
 #if KERNELVERSION < 0x3050000
 #include <zephyr/random/rand32.h>
 #else
@@ -34,6 +36,11 @@ static atomic_t token_factory = ATOMIC_INIT(0);
 
 static COAP_CONTEXT(ack_context, 4);
 
+#if (COAP_MAX_TRANSACTIONS > 0)
+static coap_transaction_t transactions[COAP_MAX_TRANSACTIONS];
+static K_MUTEX_DEFINE(transactions_mutex);
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
+
 LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
 
 int coap_client_decode_etag(const struct coap_option *option, uint8_t *etag)
@@ -91,6 +98,9 @@ int coap_client_decode_content_format(const struct coap_option *option)
       case COAP_CONTENT_FORMAT_APP_CBOR:
          desc = "appl/cbor";
          break;
+      case COAP_CONTENT_FORMAT_SENML_CBOR:
+         desc = "appl/senml+cbor";
+         break;
       default:
          break;
    }
@@ -210,6 +220,140 @@ long coap_client_next_token(void)
    return atomic_inc(&token_factory);
 }
 
+#if (COAP_MAX_TRANSACTIONS > 0)
+static int coap_client_transaction_header(const uint8_t *data, size_t len, uint16_t *mid, uint32_t *token)
+{
+   uint8_t token_len;
+
+   /* version, type, token length, code, mid */
+   if (len < 4) {
+      return -EINVAL;
+   }
+   token_len = data[0] & 0xf;
+   *mid = sys_get_be16(&data[2]);
+   if (data[1] == COAP_CODE_EMPTY) {
+      return 0;
+   }
+   if (token_len != sizeof(*token) || len < 4 + sizeof(*token)) {
+      return -EINVAL;
+   }
+   /* tokens are sent in host byte order */
+   memcpy(token, &data[4], sizeof(*token));
+   return 1;
+}
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
+
+int coap_client_transaction_add(const coap_handler_t *handler, uint16_t timeout)
+{
+   int res = -ENOMEM;
+#if (COAP_MAX_TRANSACTIONS > 0)
+   const uint8_t *data = NULL;
+   uint32_t token = 0;
+   uint16_t mid = 0;
+   int len = handler->get_message(&data);
+
+   if (len <= 0 || coap_client_transaction_header(data, len, &mid, &token) <= 0) {
+      return -EINVAL;
+   }
+
+   k_mutex_lock(&transactions_mutex, K_FOREVER);
+   for (int index = 0; index < COAP_MAX_TRANSACTIONS; ++index) {
+      coap_transaction_t *transaction = &transactions[index];
+      if (!transaction->in_use) {
+         transaction->handler = *handler;
+         transaction->token = token;
+         transaction->mid = mid;
+         transaction->timeout = timeout;
+         transaction->timeout_time = k_uptime_get() + timeout * MSEC_PER_SEC;
+         transaction->retransmission = 0;
+         transaction->in_use = 1;
+         res = index;
+         break;
+      }
+   }
+   k_mutex_unlock(&transactions_mutex);
+#else  /* COAP_MAX_TRANSACTIONS > 0 */
+   (void)handler;
+   (void)timeout;
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
+   return res;
+}
+
+coap_transaction_t *coap_client_transaction_find(const uint8_t *data, size_t len)
+{
+   coap_transaction_t *res = NULL;
+#if (COAP_MAX_TRANSACTIONS > 0)
+   uint32_t token = 0;
+   uint16_t mid = 0;
+   int header = coap_client_transaction_header(data, len, &mid, &token);
+
+   if (header < 0) {
+      return NULL;
+   }
+
+   k_mutex_lock(&transactions_mutex, K_FOREVER);
+   for (int index = 0; index < COAP_MAX_TRANSACTIONS; ++index) {
+      coap_transaction_t *transaction = &transactions[index];
+      if (transaction->in_use) {
+         if (header ? (transaction->token == token) : (transaction->mid == mid)) {
+            res = transaction;
+            break;
+         }
+      }
+   }
+   k_mutex_unlock(&transactions_mutex);
+#else  /* COAP_MAX_TRANSACTIONS > 0 */
+   (void)data;
+   (void)len;
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
+   return res;
+}
+
+coap_transaction_t *coap_client_transaction_expired(int64_t now)
+{
+   coap_transaction_t *res = NULL;
+#if (COAP_MAX_TRANSACTIONS > 0)
+   k_mutex_lock(&transactions_mutex, K_FOREVER);
+   for (int index = 0; index < COAP_MAX_TRANSACTIONS; ++index) {
+      coap_transaction_t *transaction = &transactions[index];
+      if (transaction->in_use && (now - transaction->timeout_time) >= 0) {
+         res = transaction;
+         break;
+      }
+   }
+   k_mutex_unlock(&transactions_mutex);
+#else  /* COAP_MAX_TRANSACTIONS > 0 */
+   (void)now;
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
+   return res;
+}
+
+void coap_client_transaction_remove(coap_transaction_t *transaction)
+{
+#if (COAP_MAX_TRANSACTIONS > 0)
+   k_mutex_lock(&transactions_mutex, K_FOREVER);
+   transaction->in_use = 0;
+   k_mutex_unlock(&transactions_mutex);
+#else  /* COAP_MAX_TRANSACTIONS > 0 */
+   (void)transaction;
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
+}
+
+int coap_client_transactions_pending(void)
+{
+   int res = 0;
+#if (COAP_MAX_TRANSACTIONS > 0)
+   k_mutex_lock(&transactions_mutex, K_FOREVER);
+   for (int index = 0; index < COAP_MAX_TRANSACTIONS; ++index) {
+      if (transactions[index].in_use) {
+         ++res;
+      }
+   }
+   k_mutex_unlock(&transactions_mutex);
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
+   return res;
+}
+
 int coap_client_message(const uint8_t **buffer)
 {
    if (buffer) {
@@ -18,6 +18,12 @@
 
 #include "dtls_client.h"
 
+/* RFC 8428, application/senml+cbor */
+#define COAP_CONTENT_FORMAT_SENML_CBOR 112
+
+/* DTLS 1.2 record header, CID, explicit nonce and CCM-8 MAC */
+#define COAP_DTLS_RECORD_OVERHEAD (13 + 16 + 8 + 8)
+
 typedef enum { PARSE_NONE = 0,
                PARSE_IGN,
                PARSE_RST,
@@ -41,6 +47,23 @@ typedef struct coap_handler {
    coap_client_parse_data_handler_t parse_data;
 } coap_handler_t;
 
+#if (CONFIG_COAP_NSTART > 1)
+/* concurrent transactions in addition to the main request */
+#define COAP_MAX_TRANSACTIONS (CONFIG_COAP_NSTART - 1)
+#else
+#define COAP_MAX_TRANSACTIONS 0
+#endif
+
+typedef struct coap_transaction {
+   coap_handler_t handler;
+   int64_t timeout_time;
+   uint32_t token;
+   uint16_t mid;
+   uint16_t timeout;
+   uint8_t retransmission;
+   uint8_t in_use;
+} coap_transaction_t;
+
 int coap_client_decode_content_format(const struct coap_option *option);
 
 int coap_client_decode_etag(const struct coap_option *option, uint8_t *etag);
@@ -57,6 +80,41 @@ int coap_client_message(const uint8_t **buffer);
 
 long coap_client_next_token(void);
 
+/** Add transaction for the current message of the handler to the table.
+ *
+ * @param handler handler of the request. The token and message id are
+ *                taken from the message of the handler.
+ * @param timeout initial response timeout in seconds.
+ *
+ * @return index of the transaction, -EINVAL, if the message is not a
+ *         request, -ENOMEM, if the table is full.
+ */
+int coap_client_transaction_add(const coap_handler_t *handler, uint16_t timeout);
+
+/** Find transaction for received message.
+ *
+ * Empty messages (ACK, RST) are matched by the message id, responses by
+ * the token.
+ *
+ * @param data received CoAP message.
+ * @param len length of received message.
+ *
+ * @return transaction, or NULL, if no transaction matches.
+ */
+coap_transaction_t *coap_client_transaction_find(const uint8_t *data, size_t len);
+
+/** Get transaction with expired response timeout.
+ *
+ * @param now current uptime in milliseconds.
+ *
+ * @return transaction, or NULL, if no response timeout expired.
+ */
+coap_transaction_t *coap_client_transaction_expired(int64_t now);
+
+void coap_client_transaction_remove(coap_transaction_t *transaction);
+
+int coap_client_transactions_pending(void);
+
 int coap_client_init(void);
 
 #endif /* COAP_CLIENT_H */
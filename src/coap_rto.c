@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "coap_rto.h"
+
+LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
+
+/* CoCoA, draft-ietf-core-cocoa */
+#define RTO_MIN_MS 1000
+#define RTO_MAX_MS 60000
+#define RTO_STRONG_K 4
+#define RTO_WEAK_K 1
+#define RTO_MAX_WEAK_RETRANSMISSIONS 2
+
+typedef struct coap_rto_estimator {
+   uint32_t srtt;
+   uint32_t rttvar;
+   uint32_t rto;
+} coap_rto_estimator_t;
+
+typedef struct coap_rto_state {
+   coap_rto_estimator_t strong;
+   coap_rto_estimator_t weak;
+   uint32_t rto;
+   int64_t time;
+   uint16_t measurements;
+} coap_rto_state_t;
+
+static const char *profile_names[COAP_RTO_PROFILES] = {
+    "LTE-M conn.", "LTE-M idle", "NB-IoT conn.", "NB-IoT idle"};
+
+/* kept in RAM, the application core keeps running during PSM */
+static coap_rto_state_t rto_states[COAP_RTO_PROFILES];
+static K_MUTEX_DEFINE(rto_mutex);
+
+static uint32_t coap_rto_limit(uint32_t rto)
+{
+   if (rto < RTO_MIN_MS) {
+      return RTO_MIN_MS;
+   } else if (rto > RTO_MAX_MS) {
+      return RTO_MAX_MS;
+   }
+   return rto;
+}
+
+static uint32_t coap_rto_estimate(coap_rto_estimator_t *estimator, uint32_t rtt, int k)
+{
+   if (!estimator->rto) {
+      estimator->srtt = rtt;
+      estimator->rttvar = rtt / 2;
+   } else {
+      uint32_t delta = estimator->srtt > rtt ? estimator->srtt - rtt : rtt - estimator->srtt;
+      // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+      estimator->rttvar = (estimator->rttvar * 3 + delta) / 4;
+      estimator->srtt = (estimator->srtt * 7 + rtt) / 8;
+   }
+   estimator->rto = coap_rto_limit(estimator->srtt + k * estimator->rttvar);
+   return estimator->rto;
+}
+
+/* large RTOs decay without new measurements, call with rto_mutex locked */
+static void coap_rto_aging(coap_rto_state_t *state, int64_t now)
+{
+   if (state->rto > 3000 && (now - state->time) > state->rto * 4) {
+      state->rto = coap_rto_limit((state->rto + 2000) / 2);
+      state->time = now;
+   }
+}
+
+coap_rto_profile_t coap_rto_profile(bool nbiot, bool connected)
+{
+   if (nbiot) {
+      return connected ? COAP_RTO_NBIOT_CONNECTED : COAP_RTO_NBIOT_IDLE;
+   } else {
+      return connected ? COAP_RTO_LTE_M_CONNECTED : COAP_RTO_LTE_M_IDLE;
+   }
+}
+
+uint32_t coap_rto_get(coap_rto_profile_t profile)
+{
+   uint32_t rto = 0;
+
+   if (profile < COAP_RTO_PROFILES) {
+      k_mutex_lock(&rto_mutex, K_FOREVER);
+      if (rto_states[profile].measurements) {
+         coap_rto_aging(&rto_states[profile], k_uptime_get());
+         rto = rto_states[profile].rto;
+      }
+      k_mutex_unlock(&rto_mutex);
+   }
+   return rto;
+}
+
+void coap_rto_update(coap_rto_profile_t profile, uint32_t rtt_ms, int retransmissions)
+{
+   coap_rto_state_t *state;
+   uint32_t rto;
+
+   if (profile >= COAP_RTO_PROFILES || retransmissions > RTO_MAX_WEAK_RETRANSMISSIONS) {
+      return;
+   }
+   state = &rto_states[profile];
+   k_mutex_lock(&rto_mutex, K_FOREVER);
+   if (retransmissions == 0) {
+      rto = coap_rto_estimate(&state->strong, rtt_ms, RTO_STRONG_K);
+      state->rto = state->measurements ? (rto + state->rto) / 2 : rto;
+   } else {
+      rto = coap_rto_estimate(&state->weak, rtt_ms, RTO_WEAK_K);
+      state->rto = state->measurements ? (rto + state->rto * 3) / 4 : rto;
+   }
+   state->rto = coap_rto_limit(state->rto);
+   state->time = k_uptime_get();
+   if (state->measurements < UINT16_MAX) {
+      state->measurements++;
+   }
+   rto = state->rto;
+   k_mutex_unlock(&rto_mutex);
+   LOG_DBG("RTO %s: rtt %u ms, retrans. %d => rto %u ms", profile_names[profile], rtt_ms, retransmissions, rto);
+}
+
+uint16_t coap_rto_backoff(uint16_t timeout)
+{
+   if (timeout > 3) {
+      // RTO > 3s, factor 1.5
+      return (timeout * 3 + 1) / 2;
+   }
+   // the RTO is at least 1s, factor 3 for RTO < 1s doesn't apply
+   return timeout * 2;
+}
+
+int coap_rto_dump(char *buf, size_t len)
+{
+   int index = 0;
+   coap_rto_state_t states[COAP_RTO_PROFILES];
+
+   k_mutex_lock(&rto_mutex, K_FOREVER);
+   memcpy(states, rto_states, sizeof(states));
+   k_mutex_unlock(&rto_mutex);
+
+   for (int profile = 0; profile < COAP_RTO_PROFILES; ++profile) {
+      if (states[profile].measurements) {
+         if (index) {
+            index += snprintf(buf + index, len - index, ", ");
+         }
+         index += snprintf(buf + index, len - index, "%s %u ms (%u)", profile_names[profile],
+                           states[profile].rto, states[profile].measurements);
+      }
+   }
+   return index;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#ifndef COAP_RTO_H
+#define COAP_RTO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+   COAP_RTO_LTE_M_CONNECTED,
+   COAP_RTO_LTE_M_IDLE,
+   COAP_RTO_NBIOT_CONNECTED,
+   COAP_RTO_NBIOT_IDLE,
+   COAP_RTO_PROFILES
+} coap_rto_profile_t;
+
+coap_rto_profile_t coap_rto_profile(bool nbiot, bool connected);
+
+/**
+ * Get the retransmission timeout of the profile.
+ *
+ * @param profile profile of the network state
+ * @return retransmission timeout in milliseconds, 0, if no RTT is measured yet.
+ */
+uint32_t coap_rto_get(coap_rto_profile_t profile);
+
+/**
+ * Update the estimator with a measured RTT.
+ *
+ * Without retransmission the strong estimator is updated, with up to 2
+ * retransmissions the weak one. RTTs with more retransmissions are ignored.
+ *
+ * @param profile profile of the network state
+ * @param rtt_ms RTT in milliseconds, measured from the first transmission
+ * @param retransmissions number of retransmissions
+ */
+void coap_rto_update(coap_rto_profile_t profile, uint32_t rtt_ms, int retransmissions);
+
+/**
+ * Apply the variable backoff to a retransmission timeout.
+ *
+ * @param timeout timeout in seconds
+ * @return next timeout in seconds
+ */
+uint16_t coap_rto_backoff(uint16_t timeout);
+
+int coap_rto_dump(char *buf, size_t len);
+
+#endif /* COAP_RTO_H */
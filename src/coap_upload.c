@@ -0,0 +1,519 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "appl_diagnose.h"
+#include "coap_client.h"
+#include "coap_upload.h"
+#include "parse.h"
+#include "sh_cmd.h"
+
+LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
+
+#define APP_COAP_UPLOAD_PATH "upload"
+
+#define APP_COAP_UPLOAD_MAX_BLOCK 1024
+#define APP_COAP_UPLOAD_MAX_FAILURES 3
+
+/* CoAP header, token, URI-PATH, Content-Format, Block1, Size1 and payload marker */
+#define APP_COAP_UPLOAD_OVERHEAD 64
+/* IPv6 and UDP header */
+#define APP_COAP_UPLOAD_IP_OVERHEAD 48
+
+static K_MUTEX_DEFINE(coap_upload_mutex);
+
+static COAP_CONTEXT(upload_context, APP_COAP_UPLOAD_MAX_BLOCK + APP_COAP_UPLOAD_OVERHEAD);
+
+static const struct coap_upload_producer *coap_upload_producer = NULL;
+static size_t coap_upload_size = 0;
+
+static bool coap_upload = false;
+static bool coap_upload_request = false;
+static bool coap_upload_suspended = false;
+static bool coap_upload_more = false;
+static uint8_t coap_upload_failures = 0;
+static enum coap_block_size coap_upload_block_size = COAP_BLOCK_512;
+static uint32_t coap_upload_current = 0;
+static uint16_t coap_upload_block_len = 0;
+
+/* data of the current block, and read ahead to detect the end */
+static size_t coap_upload_data_len = 0;
+static uint8_t coap_upload_data[APP_COAP_UPLOAD_MAX_BLOCK * 2];
+
+static void coap_upload_finish(bool success)
+{
+   const struct coap_upload_producer *producer = NULL;
+
+   k_mutex_lock(&coap_upload_mutex, K_FOREVER);
+   if (coap_upload) {
+      producer = coap_upload_producer;
+      coap_upload = false;
+      coap_upload_request = false;
+      coap_upload_suspended = false;
+      coap_upload_producer = NULL;
+      if (success) {
+         LOG_INF("Upload %s succeeded, %u bytes.", producer->name, coap_upload_current);
+      } else {
+         LOG_INF("Upload %s canceled, %u bytes.", producer->name, coap_upload_current);
+      }
+   }
+   k_mutex_unlock(&coap_upload_mutex);
+
+   if (producer && producer->finish) {
+      producer->finish(success);
+   }
+}
+
+static enum coap_block_size coap_upload_max_block_size(void)
+{
+   /* largest block, which fits into the path MTU */
+   int max_payload = CONFIG_DTLS_PATH_MTU - APP_COAP_UPLOAD_IP_OVERHEAD -
+                     COAP_DTLS_RECORD_OVERHEAD - APP_COAP_UPLOAD_OVERHEAD;
+   enum coap_block_size block_size = COAP_BLOCK_1024;
+
+   while (block_size > COAP_BLOCK_16 && coap_block_size_to_bytes(block_size) > max_payload) {
+      --block_size;
+   }
+   return block_size;
+}
+
+static const struct coap_upload_producer *coap_upload_find(const char *name)
+{
+   STRUCT_SECTION_FOREACH(coap_upload_producer, producer)
+   {
+      if (!stricmp(name, producer->name)) {
+         return producer;
+      }
+   }
+   return NULL;
+}
+
+int coap_upload_start(const char *name)
+{
+   int rc = 0;
+   const struct coap_upload_producer *producer = NULL;
+
+   if (appl_reboots()) {
+      return -ESHUTDOWN;
+   }
+   if (!name) {
+      return -EINVAL;
+   }
+   producer = coap_upload_find(name);
+   if (!producer) {
+      return -ENOENT;
+   }
+
+   k_mutex_lock(&coap_upload_mutex, K_FOREVER);
+   if (coap_upload) {
+      rc = -EBUSY;
+   } else {
+      rc = producer->start();
+      if (rc >= 0) {
+         coap_upload_producer = producer;
+         coap_upload_size = rc;
+         coap_upload_block_size = coap_upload_max_block_size();
+         coap_upload_current = 0;
+         coap_upload_block_len = 0;
+         coap_upload_data_len = 0;
+         coap_upload_failures = 0;
+         coap_upload_more = false;
+         coap_upload_suspended = false;
+         coap_upload_request = true;
+         coap_upload = true;
+         rc = 0;
+      }
+   }
+   k_mutex_unlock(&coap_upload_mutex);
+
+   if (!rc) {
+      LOG_INF("Start uploading %s, %u bytes, block %u.", producer->name, coap_upload_size,
+              coap_block_size_to_bytes(coap_upload_block_size));
+   } else if (rc != -EBUSY) {
+      LOG_INF("Start uploading %s failed, %d.", producer->name, rc);
+   }
+   return rc;
+}
+
+static int coap_upload_restart(void)
+{
+   int rc = -EINVAL;
+
+   k_mutex_lock(&coap_upload_mutex, K_FOREVER);
+   if (coap_upload) {
+      /* prepare the data again, if the producer supports that */
+      rc = coap_upload_producer->start();
+      if (rc >= 0) {
+         coap_upload_size = rc;
+         coap_upload_current = 0;
+         coap_upload_block_len = 0;
+         coap_upload_data_len = 0;
+         coap_upload_failures = 0;
+         coap_upload_more = false;
+         coap_upload_request = true;
+         rc = 0;
+         LOG_INF("Upload %s restarted.", coap_upload_producer->name);
+      }
+   }
+   k_mutex_unlock(&coap_upload_mutex);
+   return rc;
+}
+
+int coap_upload_cancel(void)
+{
+   if (!coap_upload_pending()) {
+      return -EINVAL;
+   }
+   coap_upload_finish(false);
+   return 0;
+}
+
+void coap_upload_failed(void)
+{
+   bool cancel = false;
+
+   k_mutex_lock(&coap_upload_mutex, K_FOREVER);
+   if (coap_upload) {
+      if (++coap_upload_failures >= APP_COAP_UPLOAD_MAX_FAILURES) {
+         cancel = true;
+      } else {
+         /* keep the unacknowledged block for resume */
+         coap_upload_suspended = true;
+         coap_upload_request = false;
+         LOG_INF("Upload %s suspended at 0x%x.", coap_upload_producer->name, coap_upload_current);
+      }
+   }
+   k_mutex_unlock(&coap_upload_mutex);
+
+   if (cancel) {
+      coap_upload_finish(false);
+   }
+}
+
+void coap_upload_resume(void)
+{
+   k_mutex_lock(&coap_upload_mutex, K_FOREVER);
+   if (coap_upload && coap_upload_suspended) {
+      coap_upload_suspended = false;
+      coap_upload_request = true;
+      LOG_INF("Upload %s resumed at 0x%x.", coap_upload_producer->name, coap_upload_current);
+   }
+   k_mutex_unlock(&coap_upload_mutex);
+}
+
+bool coap_upload_pending(void)
+{
+   bool upload;
+
+   k_mutex_lock(&coap_upload_mutex, K_FOREVER);
+   upload = coap_upload;
+   k_mutex_unlock(&coap_upload_mutex);
+
+   return upload;
+}
+
+bool coap_upload_pending_next(void)
+{
+   bool request = false;
+
+   if (!appl_reboots()) {
+      k_mutex_lock(&coap_upload_mutex, K_FOREVER);
+      if (coap_upload) {
+         request = coap_upload_request;
+      }
+      k_mutex_unlock(&coap_upload_mutex);
+   }
+
+   return request;
+}
+
+static int coap_upload_fill(coap_upload_read_t read, size_t block_bytes)
+{
+   while (coap_upload_data_len <= block_bytes) {
+      int rc = read(&coap_upload_data[coap_upload_data_len],
+                    sizeof(coap_upload_data) - coap_upload_data_len);
+      if (rc < 0) {
+         LOG_INF("Upload read failed, %d", rc);
+         return rc;
+      } else if (rc == 0) {
+         break;
+      }
+      coap_upload_data_len += rc;
+   }
+   return coap_upload_data_len;
+}
+
+static int coap_upload_encode(const char *resource, size_t block_bytes)
+{
+   int rc;
+   uint8_t *token = (uint8_t *)&upload_context.token;
+   uint32_t block1;
+   struct coap_packet request;
+
+   upload_context.token = coap_client_next_token();
+   upload_context.mid = coap_next_id();
+
+   rc = coap_packet_init(&request, upload_context.message_buf, sizeof(upload_context.message_buf),
+                         COAP_VERSION_1, COAP_TYPE_CON,
+                         sizeof(upload_context.token), token,
+                         COAP_METHOD_POST, upload_context.mid);
+   if (rc < 0) {
+      LOG_WRN("Failed to create CoAP request, %d", rc);
+      return rc;
+   }
+
+   rc = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
+                                  APP_COAP_UPLOAD_PATH,
+                                  strlen(APP_COAP_UPLOAD_PATH));
+   if (rc < 0) {
+      LOG_WRN("Failed to encode CoAP URI-PATH prefix, %d", rc);
+      return rc;
+   }
+
+   rc = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
+                                  resource, strlen(resource));
+   if (rc < 0) {
+      LOG_WRN("Failed to encode CoAP URI-PATH resource, %d", rc);
+      return rc;
+   }
+
+   rc = coap_append_option_int(&request, COAP_OPTION_CONTENT_FORMAT,
+                               COAP_CONTENT_FORMAT_APP_OCTET_STREAM);
+   if (rc < 0) {
+      LOG_WRN("Failed to encode CoAP CONTENT_FORMAT option, %d", rc);
+      return rc;
+   }
+
+   /* NUM, M and SZX, RFC 7959 */
+   block1 = ((coap_upload_current / block_bytes) << 4) | (coap_upload_more ? 0x8 : 0) |
+            coap_upload_block_size;
+   rc = coap_append_option_int(&request, COAP_OPTION_BLOCK1, block1);
+   if (rc < 0) {
+      LOG_WRN("Failed to encode CoAP BLOCK1 option, %d", rc);
+      return rc;
+   }
+
+   if (!coap_upload_current && coap_upload_size) {
+      rc = coap_append_option_int(&request, COAP_OPTION_SIZE1, coap_upload_size);
+      if (rc < 0) {
+         LOG_WRN("Failed to encode CoAP SIZE1 option, %d", rc);
+         return rc;
+      }
+   }
+
+   if (coap_upload_block_len) {
+      rc = coap_packet_append_payload_marker(&request);
+      if (rc < 0) {
+         LOG_WRN("Failed to encode CoAP payload-marker, %d", rc);
+         return rc;
+      }
+      rc = coap_packet_append_payload(&request, coap_upload_data, coap_upload_block_len);
+      if (rc < 0) {
+         LOG_WRN("Failed to encode CoAP payload, %d", rc);
+         return rc;
+      }
+   }
+   upload_context.message_len = request.offset;
+   return request.offset;
+}
+
+int coap_upload_next(void)
+{
+   int rc = 0;
+   bool request_next = false;
+   coap_upload_read_t read = NULL;
+   const char *resource = NULL;
+
+   if (appl_reboots()) {
+      return -ESHUTDOWN;
+   }
+
+   k_mutex_lock(&coap_upload_mutex, K_FOREVER);
+   if (coap_upload) {
+      request_next = coap_upload_request;
+      coap_upload_request = false;
+      read = coap_upload_producer->read;
+      resource = coap_upload_producer->name;
+   } else {
+      rc = -EINVAL;
+   }
+   k_mutex_unlock(&coap_upload_mutex);
+
+   if (request_next) {
+      size_t block_bytes = coap_block_size_to_bytes(coap_upload_block_size);
+
+      upload_context.message_len = 0;
+
+      rc = coap_upload_fill(read, block_bytes);
+      if (rc < 0) {
+         coap_upload_finish(false);
+         return rc;
+      }
+      coap_upload_more = coap_upload_data_len > block_bytes;
+      coap_upload_block_len = MIN(coap_upload_data_len, block_bytes);
+
+      rc = coap_upload_encode(resource, block_bytes);
+      if (rc < 0) {
+         /* the request is already consumed, no retry */
+         coap_upload_finish(false);
+         return rc;
+      }
+      LOG_INF("Upload block %u, pos 0x%x, %u bytes%s", coap_upload_current / block_bytes,
+              coap_upload_current, coap_upload_block_len, coap_upload_more ? "" : ", last");
+   }
+   return rc;
+}
+
+static int coap_upload_response(struct coap_packet *reply)
+{
+   int code = coap_header_get_code(reply);
+   int block1 = coap_get_option_int(reply, COAP_OPTION_BLOCK1);
+   size_t block_bytes;
+
+   upload_context.message_len = 0;
+
+   if (COAP_RESPONSE_CODE_INCOMPLETE == code && coap_upload_current) {
+      /* the server has dropped the previous blocks, e.g. during PSM */
+      LOG_INF("Upload incomplete at 0x%x.", coap_upload_current);
+      if (!coap_upload_restart()) {
+         return 0;
+      }
+   } else if (!coap_upload_more) {
+      if (COAP_RESPONSE_CODE_CHANGED == code || COAP_RESPONSE_CODE_CREATED == code) {
+         coap_upload_current += coap_upload_block_len;
+         coap_upload_finish(true);
+         return 0;
+      }
+   } else if (COAP_RESPONSE_CODE_CONTINUE == code) {
+      if (block1 < 0) {
+         LOG_INF("Upload without block1 response.");
+         coap_upload_finish(false);
+         return -EINVAL;
+      }
+      /* the acknowledged NUM is in units of the returned SZX */
+      block_bytes = coap_block_size_to_bytes(GET_BLOCK_SIZE(block1));
+      if (GET_BLOCK_NUM(block1) * block_bytes != coap_upload_current) {
+         LOG_INF("Upload block %u mismatch 0x%x", GET_BLOCK_NUM(block1), coap_upload_current);
+         coap_upload_finish(false);
+         return -EINVAL;
+      }
+      if (GET_BLOCK_SIZE(block1) < coap_upload_block_size) {
+         /* server requests smaller blocks, the sent block is accepted */
+         coap_upload_block_size = GET_BLOCK_SIZE(block1);
+      }
+      /* the server has accepted the whole sent block */
+      block_bytes = coap_upload_block_len;
+      coap_upload_data_len -= block_bytes;
+      memmove(coap_upload_data, &coap_upload_data[block_bytes], coap_upload_data_len);
+      k_mutex_lock(&coap_upload_mutex, K_FOREVER);
+      coap_upload_current += block_bytes;
+      coap_upload_failures = 0;
+      coap_upload_request = coap_upload;
+      k_mutex_unlock(&coap_upload_mutex);
+      return 0;
+   }
+   LOG_INF("Upload failed, response %d.%02d", (code >> 5) & 7, code & 0x1f);
+   coap_upload_finish(false);
+   return -EINVAL;
+}
+
+int coap_upload_parse_data(uint8_t *data, size_t len)
+{
+   int res;
+   struct coap_packet reply;
+
+   if (appl_reboots()) {
+      return -ESHUTDOWN;
+   }
+
+   res = coap_packet_parse(&reply, data, len, NULL, 0);
+   if (res < 0) {
+      LOG_DBG("Malformed response received: %d", res);
+      return res;
+   }
+
+   res = coap_client_match(&reply, upload_context.mid, upload_context.token);
+   if (res < PARSE_RESPONSE) {
+      return res;
+   }
+
+   if (coap_upload_pending()) {
+      coap_upload_response(&reply);
+   }
+
+   if (PARSE_CON_RESPONSE == res) {
+      res = coap_client_prepare_ack(&reply);
+   }
+   return res;
+}
+
+int coap_upload_message(const uint8_t **buffer)
+{
+   if (buffer) {
+      *buffer = upload_context.message_buf;
+   }
+   return upload_context.message_len;
+}
+
+coap_handler_t coap_upload_client_handler = {
+    .get_message = coap_upload_message,
+    .parse_data = coap_upload_parse_data,
+};
+
+#ifdef CONFIG_SH_CMD
+
+static int sh_cmd_upload(const char *parameter)
+{
+   char value[16];
+   const char *cur = parameter;
+
+   memset(value, 0, sizeof(value));
+   cur = parse_next_text(cur, ' ', value, sizeof(value));
+   if (!stricmp("cancel", value)) {
+      return coap_upload_cancel();
+   } else if (value[0]) {
+      return coap_upload_start(value);
+   }
+
+   k_mutex_lock(&coap_upload_mutex, K_FOREVER);
+   if (coap_upload) {
+      LOG_INF("Upload %s%s, 0x%x of %u bytes, block %u.", coap_upload_producer->name,
+              coap_upload_suspended ? " suspended" : "", coap_upload_current,
+              coap_upload_size, coap_block_size_to_bytes(coap_upload_block_size));
+   } else {
+      LOG_INF("No upload pending.");
+   }
+   k_mutex_unlock(&coap_upload_mutex);
+
+   STRUCT_SECTION_FOREACH(coap_upload_producer, producer)
+   {
+      LOG_INF("  %-10s: %s", producer->name, producer->desc);
+   }
+   return 0;
+}
+
+static void sh_cmd_upload_help(void)
+{
+   LOG_INF("> help upload:");
+   LOG_INF("  upload          : show upload status and available uploads.");
+   LOG_INF("  upload <name>   : start upload to the server.");
+   LOG_INF("  upload cancel   : cancel pending upload.");
+}
+
+SH_CMD(upload, NULL, "upload diagnostics.", sh_cmd_upload, sh_cmd_upload_help, 0);
+
+#endif /* CONFIG_SH_CMD */
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#ifndef COAP_UPLOAD_H
+#define COAP_UPLOAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#include "coap_client.h"
+
+/** Prepare the data for upload.
+ *
+ * Called again to restart the upload from the beginning, if the server
+ * has dropped the already received blocks.
+ *
+ * @return size of the data, 0, if unknown, or negative error.
+ */
+typedef int (*coap_upload_start_t)(void);
+
+/** Read next data for upload.
+ *
+ * @param buf buffer for the data
+ * @param len size of the buffer
+ *
+ * @return number of bytes, 0 at the end of the data, or negative error.
+ */
+typedef int (*coap_upload_read_t)(uint8_t *buf, size_t len);
+
+/** Upload finished or canceled.
+ *
+ * @param success true, if the data is completely acknowledged by the server.
+ */
+typedef void (*coap_upload_finish_t)(bool success);
+
+struct coap_upload_producer {
+   const char *name;
+   const char *desc;
+   const coap_upload_start_t start;
+   const coap_upload_read_t read;
+   const coap_upload_finish_t finish;
+};
+
+/**
+ * Register upload producer.
+ *
+ * The data is uploaded to "upload/<name>".
+ * The finish callback is optional.
+ */
+#define COAP_UPLOAD_PRODUCER(_name, _desc, _start, _read, _finish)                      \
+   static const STRUCT_SECTION_ITERABLE(coap_upload_producer, upload_producer_##_name) = { \
+       .name = #_name,                                                                   \
+       .desc = _desc,                                                                    \
+       .start = _start,                                                                  \
+       .read = _read,                                                                    \
+       .finish = _finish,                                                                \
+   }
+
+/** Start upload.
+ *
+ * The data is sent in the background with CoAP Block1 POST requests
+ * to "upload/<name>", when no other request is pending.
+ *
+ * @param name name of registered producer
+ *
+ * @return 0 on success, -ENOENT, if the producer is not available,
+ *         -EBUSY, if an upload is already pending.
+ */
+int coap_upload_start(const char *name);
+int coap_upload_cancel(void);
+
+/** Report failed upload request.
+ *
+ * The upload is suspended and the unacknowledged block is kept
+ * to resume the upload after the next successful exchange.
+ * After too many failures in a row, the upload is canceled.
+ */
+void coap_upload_failed(void);
+
+/** Resume suspended upload. */
+void coap_upload_resume(void);
+
+bool coap_upload_pending(void);
+bool coap_upload_pending_next(void);
+int coap_upload_next(void);
+int coap_upload_message(const uint8_t **buffer);
+int coap_upload_parse_data(uint8_t *data, size_t len);
+
+extern coap_handler_t coap_upload_client_handler;
+
+#endif /* COAP_UPLOAD_H */
@@ -16,13 +16,25 @@
 #include <errno.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <zephyr/net/coap.h>
 #include <zephyr/net/socket.h>
 #include <zephyr/spinlock.h>
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+#include <zephyr/sys/crc.h>
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
 
 #include "appl_diagnose.h"
+#ifdef CONFIG_APPL_STORE_FORWARD
+#include "appl_queue.h"
+#endif /* CONFIG_APPL_STORE_FORWARD */
+#include "appl_energy.h"
+#include "appl_histogram.h"
 #include "appl_settings.h"
+#ifdef CONFIG_USE_APPL_STORAGE
+#include "appl_storage.h"
+#endif /* CONFIG_USE_APPL_STORAGE */
 #include "appl_time.h"
 #ifdef CONFIG_UPDATE
 #include "appl_update.h"
@@ -35,6 +47,12 @@
 #endif
 #include "coap_appl_client.h"
 #include "coap_client.h"
+#ifdef CONFIG_COAP_ADAPTIVE_RTO
+#include "coap_rto.h"
+#endif /* CONFIG_COAP_ADAPTIVE_RTO */
+#ifdef CONFIG_COAP_UPLOAD
+#include "coap_upload.h"
+#endif /* CONFIG_COAP_UPLOAD */
 #include "dtls.h"
 #include "dtls_client.h"
 #include "dtls_debug.h"
@@ -48,6 +66,14 @@
 #include "sh_cmd.h"
 #include "ui.h"
 
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+#ifdef DTLS_PEERS_NOHASH
+#include "utlist.h"
+#else /* DTLS_PEERS_NOHASH */
+#include "uthash.h"
+#endif /* DTLS_PEERS_NOHASH */
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
+
 #ifdef CONFIG_LOCATION_ENABLE
 #include "location.h"
 #endif
@@ -133,8 +159,10 @@ typedef struct dtls_app_data_t {
    uint8_t dtls_pending : 1;
    uint8_t dtls_next_flight : 1;
    uint8_t dtls_cid : 1;
+   uint8_t dtls_resumed : 1;
    uint8_t no_response : 1;
    uint8_t rai : 1;
+   uint8_t rto_connected : 1;
    uint8_t dtls_flight;
 #ifdef CONFIG_COAP_UPDATE
    uint8_t download_progress;
@@ -195,13 +223,18 @@ static bool lte_power_on_off = false;
 static volatile bool moved = false;
 #endif
 
-/* merge dtls flight records to single UDP message */
-#define MAX_DTLS_BUF 512
+/* merge dtls flight records to UDP messages up to the path MTU */
+#define DTLS_IPV4_UDP_OVERHEAD (20 + 8)
+#define DTLS_IPV6_UDP_OVERHEAD (40 + 8)
+#define MAX_DTLS_BUF (CONFIG_DTLS_PATH_MTU - DTLS_IPV4_UDP_OVERHEAD)
 static uint8_t dtls_buffer[MAX_DTLS_BUF];
 static size_t dtls_buffer_len = 0;
+static uint16_t dtls_buffer_records = 0;
+static uint16_t dtls_handshake_datagrams = 0;
+static int64_t dtls_handshake_time = 0;
 static K_MUTEX_DEFINE(dtls_buffer_mutex);
 
-#define MAX_APPL_BUF 1600
+#define MAX_APPL_BUF DTLS_CLIENT_MAX_APPL_BUF
 static uint8_t appl_buffer[MAX_APPL_BUF];
 
 #define MAX_SEND_BUF 1024
@@ -215,6 +248,22 @@ static struct k_spinlock send_buffer_lock;
 // last item for maximum rtt
 static unsigned int rtts[RTT_SLOTS + 2] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
+APPL_HISTOGRAM_DEFINE(connect, "ms");
+APPL_HISTOGRAM_DEFINE(handshake, "ms");
+APPL_HISTOGRAM_DEFINE(rtt, "ms");
+
+#ifdef CONFIG_COAP_EXCHANGE_STATISTIC
+struct exchange_statistic {
+   uint16_t tx_datagrams;
+   uint16_t rx_datagrams;
+   uint32_t tx_bytes;
+   uint32_t rx_bytes;
+   uint16_t handshakes;
+};
+
+static struct exchange_statistic exchange_statistic;
+#endif /* CONFIG_COAP_EXCHANGE_STATISTIC */
+
 unsigned int transmissions[COAP_MAX_RETRANSMISSION + 1];
 unsigned int connect_time_ms;
 unsigned int coap_rtt_ms;
@@ -335,7 +384,8 @@ static void dtls_power_management(void)
       suspend = atomic_test_bit(&general_states, LTE_SLEEPING) &&
                 !atomic_test_bit(&general_states, PM_PREVENT_SUSPEND) &&
                 !atomic_test_bit(&general_states, SETUP_MODE) &&
-                app_data_context.request_state == NONE;
+                app_data_context.request_state == NONE &&
+                !coap_client_transactions_pending();
    }
 
    if (suspend) {
@@ -358,6 +408,12 @@ static int dtls_low_voltage(const k_timeout_t timeout)
    const int64_t start_time_low_voltage = k_uptime_get();
    int64_t timeout_ms = k_ticks_to_ms_floor64(timeout.ticks);
 
+#ifdef CONFIG_USE_APPL_STORAGE
+   if (atomic_test_bit(&general_states, LTE_LOW_VOLTAGE)) {
+      appl_storage_sync(0);
+   }
+#endif /* CONFIG_USE_APPL_STORAGE */
+
    while (!atomic_test_bit(&general_states, TRIGGER_DURATION) && atomic_test_bit(&general_states, LTE_LOW_VOLTAGE)) {
       uint16_t battery_voltage = 0; // = 0 for raw voltage!
       power_manager_status_t battery_status = POWER_UNKNOWN;
@@ -698,6 +754,8 @@ static void dtls_trigger(const char *cause, bool send)
          {
             send_trigger = cause;
          }
+         // sample sensors while the modem attaches
+         coap_appl_client_prebuild(coap_send_flags_next);
       }
       dtls_info("trigger %s%s", cause, send ? " send message" : "");
       atomic_set_bit_to(&general_states, TRIGGER_SEND, send);
@@ -792,6 +850,53 @@ static void dtls_timer_trigger_fn(struct k_work *work)
    atomic_cas(&send_interval, interval, interval & 0xffffff);
 }
 
+static inline void dtls_exchange_statistic_sent(int bytes)
+{
+#ifdef CONFIG_COAP_EXCHANGE_STATISTIC
+   if (bytes > 0) {
+      exchange_statistic.tx_datagrams++;
+      exchange_statistic.tx_bytes += bytes;
+   }
+#else  /* CONFIG_COAP_EXCHANGE_STATISTIC */
+   (void)bytes;
+#endif /* CONFIG_COAP_EXCHANGE_STATISTIC */
+}
+
+static inline void dtls_exchange_statistic_received(int bytes)
+{
+#ifdef CONFIG_COAP_EXCHANGE_STATISTIC
+   if (bytes > 0) {
+      exchange_statistic.rx_datagrams++;
+      exchange_statistic.rx_bytes += bytes;
+   }
+#else  /* CONFIG_COAP_EXCHANGE_STATISTIC */
+   (void)bytes;
+#endif /* CONFIG_COAP_EXCHANGE_STATISTIC */
+}
+
+static inline void dtls_exchange_statistic_handshake(void)
+{
+#ifdef CONFIG_COAP_EXCHANGE_STATISTIC
+   exchange_statistic.handshakes++;
+#endif /* CONFIG_COAP_EXCHANGE_STATISTIC */
+}
+
+static void dtls_exchange_statistic_finish(dtls_app_data_t *app, const char *result, int connect_ms, int rtt_ms)
+{
+#ifdef CONFIG_COAP_EXCHANGE_STATISTIC
+   dtls_info("exchange %s: tx %u (%u bytes), rx %u (%u bytes), %u hs, connect %d ms, rtt %d ms, %u retrans.",
+             result, exchange_statistic.tx_datagrams, exchange_statistic.tx_bytes,
+             exchange_statistic.rx_datagrams, exchange_statistic.rx_bytes,
+             exchange_statistic.handshakes, connect_ms, rtt_ms, app->retransmission);
+   memset(&exchange_statistic, 0, sizeof(exchange_statistic));
+#else  /* CONFIG_COAP_EXCHANGE_STATISTIC */
+   (void)app;
+   (void)result;
+   (void)connect_ms;
+   (void)rtt_ms;
+#endif /* CONFIG_COAP_EXCHANGE_STATISTIC */
+}
+
 static int dtls_coap_inc_failures(void)
 {
    if (current_failures == handled_failures) {
@@ -825,6 +930,131 @@ static bool dtls_pending(dtls_app_data_t *app)
 
 static void dtls_coap_set_request_state(const char *desc, dtls_app_data_t *app, request_state_t request_state);
 
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+#define DTLS_SESSION_VERSION 1
+
+typedef struct dtls_client_session {
+   uint8_t version;
+   uint16_t security_size;
+   uint32_t destination;
+   dtls_security_parameters_t security;
+} dtls_client_session_t;
+
+BUILD_ASSERT(sizeof(dtls_client_session_t) <= APPL_SETTINGS_MAX_DTLS_SESSION_LENGTH,
+             "DTLS session exceeds settings");
+
+/* record sequence numbers up to this value are reserved by the stored session */
+static uint64_t dtls_session_reserved = 0;
+static bool dtls_session_resume = true;
+
+static const char *dtls_get_cipher_suite_name(const dtls_security_parameters_t *security_params);
+
+static uint32_t dtls_session_destination(const session_t *session)
+{
+   return crc32_ieee((const uint8_t *)&session->addr, session->size);
+}
+
+static void dtls_session_save(const session_t *destination, const dtls_peer_t *peer)
+{
+   dtls_client_session_t session;
+   int res;
+
+   if (!peer || !peer->security_params[0] || !peer->security_params[0]->write_cid_length) {
+      // without CID a new address requires a handshake anyway
+      return;
+   }
+   memset(&session, 0, sizeof(session));
+   session.version = DTLS_SESSION_VERSION;
+   session.security_size = sizeof(dtls_security_parameters_t);
+   session.destination = dtls_session_destination(destination);
+   session.security = *peer->security_params[0];
+   // a restored session continues after the reserved sequence numbers
+   session.security.rseq += CONFIG_DTLS_SESSION_PERSIST_RECORDS;
+   res = appl_settings_set_dtls_session((const uint8_t *)&session, sizeof(session));
+   if (res) {
+      dtls_warn("dtls session not saved, %d", res);
+      dtls_session_reserved = 0;
+   } else {
+      dtls_session_reserved = session.security.rseq;
+      dtls_info("dtls session saved, epoch %u, reserved seqn %u", session.security.epoch, (uint32_t)dtls_session_reserved);
+   }
+   memset(&session, 0, sizeof(session));
+}
+
+static void dtls_session_clear(void)
+{
+   if (dtls_session_reserved) {
+      dtls_session_reserved = 0;
+      appl_settings_set_dtls_session(NULL, 0);
+      dtls_info("dtls session cleared");
+   }
+}
+
+/* save the session again, before the reserved sequence numbers are exhausted */
+static void dtls_session_check(dtls_app_data_t *app, dtls_context_t *ctx)
+{
+   dtls_peer_t *peer;
+
+   if (!ctx || app->dtls_pending || !dtls_session_reserved) {
+      return;
+   }
+   peer = dtls_get_peer(ctx, &app->destination);
+   if (peer && peer->security_params[0]->rseq + 1 >= dtls_session_reserved) {
+      dtls_session_save(&app->destination, peer);
+   }
+}
+
+/* restore the stored session once after startup */
+static bool dtls_session_restore(dtls_app_data_t *app, dtls_context_t *ctx)
+{
+   dtls_client_session_t session;
+   dtls_peer_t *peer;
+   int res;
+
+   if (!dtls_session_resume) {
+      return false;
+   }
+   dtls_session_resume = false;
+
+   res = appl_settings_get_dtls_session((uint8_t *)&session, sizeof(session));
+   if (!res) {
+      return false;
+   }
+   if (res != sizeof(session) || session.version != DTLS_SESSION_VERSION ||
+       session.security_size != sizeof(dtls_security_parameters_t) ||
+       session.destination != dtls_session_destination(&app->destination)) {
+      dtls_info("dtls session not restored, %d", res);
+      appl_settings_set_dtls_session(NULL, 0);
+      return false;
+   }
+   peer = dtls_new_peer(&app->destination);
+   if (!peer) {
+      return false;
+   }
+   peer->role = DTLS_CLIENT;
+   peer->state = DTLS_STATE_CONNECTED;
+   *peer->security_params[0] = session.security;
+   // same as the internal dtls_add_peer of tinydtls
+#ifdef DTLS_PEERS_NOHASH
+   LL_PREPEND(ctx->peers, peer);
+#else  /* DTLS_PEERS_NOHASH */
+   HASH_ADD(hh, ctx->peers, session, sizeof(session_t), peer);
+#endif /* DTLS_PEERS_NOHASH */
+   memset(&session, 0, sizeof(session));
+
+   dtls_session_reserved = peer->security_params[0]->rseq;
+   app->dtls_pending = 0;
+   app->dtls_next_flight = 0;
+   app->dtls_flight = 0;
+   app->dtls_cid = 1;
+   app->dtls_resumed = 1;
+   app->dtls_cipher_suite = dtls_get_cipher_suite_name(peer->security_params[0]);
+   dtls_info("dtls session restored, epoch %u, seqn %u", peer->security_params[0]->epoch,
+             (uint32_t)dtls_session_reserved);
+   return true;
+}
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
+
 static void dtls_coap_next(dtls_app_data_t *app, int interval)
 {
    bool pending = false;
@@ -842,6 +1072,9 @@ static void dtls_coap_next(dtls_app_data_t *app, int interval)
 #ifdef CONFIG_COAP_UPDATE
    if (app->download_progress == DOWNLOAD_PROGRESS_REBOOT) {
       appl_update_coap_reboot();
+   } else if (app->download_progress == DOWNLOAD_PROGRESS_LAST_STATUS_MESSAGE && interval <= 0) {
+      // download finished by a concurrent transaction
+      interval = 2;
    }
 #endif
 
@@ -878,6 +1111,31 @@ static int dtls_app_coap_result_handler(struct dtls_app_data_t *app, bool succes
       coap_send_flags &= ~COAP_SEND_FLAG_INITIAL;
       coap_send_flags_next = coap_send_flags;
    }
+#ifdef CONFIG_UDP_WAKEUP_ENABLE
+   if (success) {
+      // result of a wakeup cmd acknowledged, otherwise sent again
+      sh_cmd_reported_result_delivered();
+   }
+#endif /* CONFIG_UDP_WAKEUP_ENABLE */
+#ifdef CONFIG_APPL_STORE_FORWARD
+   if (success) {
+      // only, if the report carried samples
+      if (appl_queue_delivered() > 0 && appl_queue_pending()) {
+         // drain next batch
+         return 2;
+      }
+   } else {
+      appl_queue_discard();
+      // keep the values of the lost report
+      appl_queue_snapshot("request failed");
+   }
+#endif /* CONFIG_APPL_STORE_FORWARD */
+#ifdef CONFIG_COAP_UPLOAD
+   if (success) {
+      // continue suspended upload with last acknowledged block
+      coap_upload_resume();
+   }
+#endif /* CONFIG_COAP_UPLOAD */
    return 0;
 }
 
@@ -905,13 +1163,57 @@ static int dtls_app_download_result_handler(struct dtls_app_data_t *app, bool su
       }
    } else {
       app->download_progress = 0;
-      appl_update_coap_cancel();
+      appl_update_coap_cancel(UPDATE_CANCEL_FAILED);
       return 2;
    }
    return 0;
 }
 #endif /* CONFIG_COAP_UPDATE */
 
+#ifdef CONFIG_COAP_UPLOAD
+static int dtls_app_upload_result_handler(struct dtls_app_data_t *app, bool success)
+{
+   if (!success) {
+      coap_upload_failed();
+   }
+   return 0;
+}
+
+static bool dtls_upload_next(dtls_app_data_t *app)
+{
+#ifdef CONFIG_COAP_UPDATE
+   if (app->download_progress) {
+      return false;
+   }
+#endif /* CONFIG_COAP_UPDATE */
+   if (!coap_upload_pending_next() || coap_upload_next() <= 0) {
+      return false;
+   }
+   dtls_coap_set_request_state("upload", app, SEND);
+   app->retransmission = 0;
+   app->no_response = 0;
+   app->coap_handler = coap_upload_client_handler;
+   app->result_handler = dtls_app_upload_result_handler;
+   app->rai = 0;
+   app->start_time = k_uptime_get();
+   return true;
+}
+#endif /* CONFIG_COAP_UPLOAD */
+
+#ifdef CONFIG_COAP_ADAPTIVE_RTO
+static coap_rto_profile_t
+network_rto_profile(dtls_app_data_t *app)
+{
+   struct lte_network_info info;
+   bool nbiot = false;
+
+   if (!modem_get_network_info(&info)) {
+      nbiot = info.mode == LTE_LC_LTE_MODE_NBIOT;
+   }
+   return coap_rto_profile(nbiot, app->rto_connected);
+}
+#endif /* CONFIG_COAP_ADAPTIVE_RTO */
+
 static void dtls_coap_success(dtls_app_data_t *app)
 {
    int interval = 0;
@@ -919,6 +1221,8 @@ static void dtls_coap_success(dtls_app_data_t *app)
    int time1 = (int)(atomic_get(&connected_time) - app->start_time);
    int time2 = (int)(app->response_time - app->start_time);
 
+   app->dtls_resumed = 0;
+
    if (time1 < 0) {
       time1 = -1;
    }
@@ -951,11 +1255,27 @@ static void dtls_coap_success(dtls_app_data_t *app)
    }
 
    dtls_info("%dms/%dms: success", time1, time2);
+   dtls_exchange_statistic_finish(app, "success", connect_time_ms, coap_rtt_ms);
+   modem_schedule_status_refresh();
+   appl_energy_add(APPL_ENERGY_TRANSFER, coap_rtt_ms);
+   appl_energy_message();
+   if (time1 > 0) {
+      APPL_HISTOGRAM_ADD(connect, time1);
+   }
+   if (time2 >= 0) {
+      APPL_HISTOGRAM_ADD(rtt, coap_rtt_ms);
+   }
    if (app->retransmission <= COAP_MAX_RETRANSMISSION) {
       transmissions[app->retransmission]++;
    }
 
    if (time2 >= 0) {
+#ifdef CONFIG_COAP_ADAPTIVE_RTO
+      if (!app->dtls_flight) {
+         // the response timeout starts, when the modem is connected
+         coap_rto_update(network_rto_profile(app), time1 > 0 ? time2 - time1 : time2, app->retransmission);
+      }
+#endif /* CONFIG_COAP_ADAPTIVE_RTO */
       retransmissions = app->retransmission;
       if (retransmissions == 0) {
          modem_set_psm(0, K_NO_WAIT);
@@ -1025,6 +1345,12 @@ static void dtls_coap_failure(dtls_app_data_t *app, const char *cause)
       work_reschedule_for_io_queue(&dtls_power_management_suspend_work, K_SECONDS(10));
    }
    dtls_info("%dms/%dms: failure, %s", time1, time2, cause);
+   dtls_exchange_statistic_finish(app, "failure", time1, time2 >= 0 && time1 > 0 ? time2 - time1 : time2);
+   modem_schedule_status_refresh();
+   if (app->start_time) {
+      appl_energy_add(APPL_ENERGY_TRANSFER, k_uptime_get() - app->start_time - (time1 > 0 ? time1 : 0));
+   }
+   appl_energy_message();
    failures++;
    if (atomic_test_bit(&general_states, APPL_INITIAL_SUCCESS)) {
       int f = dtls_coap_inc_failures();
@@ -1032,6 +1358,19 @@ static void dtls_coap_failure(dtls_app_data_t *app, const char *cause)
    }
    interval = app->result_handler(app, false);
 
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+   if (app->dtls_resumed) {
+      // the server may have lost the restored session
+      dtls_info("dtls, restored session failed.");
+      app->dtls_resumed = 0;
+      dtls_session_clear();
+      dtls_pending(app);
+      if (interval == 0) {
+         interval = 5;
+      }
+   }
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
+
    if (app->dtls_pending) {
       dtls_info("dtls, restart handshake.");
       app->dtls_next_flight = 0;
@@ -1093,7 +1432,14 @@ network_additional_timeout(void)
 static bool
 network_adjust_initial_timeout(dtls_app_data_t *app, bool set)
 {
-   const uint16_t timeout = network_timeout_scale(coap_timeout);
+   uint16_t timeout = network_timeout_scale(coap_timeout);
+#ifdef CONFIG_COAP_ADAPTIVE_RTO
+   uint32_t rto = coap_rto_get(network_rto_profile(app));
+   if (rto) {
+      // estimated RTO replaces the scaled initial timeout
+      timeout = (uint16_t)((rto + MSEC_PER_SEC - 1) / MSEC_PER_SEC);
+   }
+#endif /* CONFIG_COAP_ADAPTIVE_RTO */
    bool res = set || timeout > app->timeout;
    if (res) {
       app->timeout = timeout;
@@ -1102,28 +1448,232 @@ network_adjust_initial_timeout(dtls_app_data_t *app, bool set)
 }
 
 #if defined(CONFIG_UDP_WAKEUP_ENABLE)
+#ifdef CONFIG_SH_CMD
+/* truncated HMAC-SHA256 of wakeup messages with cmd */
+#define WAKEUP_MAC_LEN 8
+#define WAKEUP_MAX_MESSAGE_LEN 128
+/* sequence numbers are seconds since epoch, if the device time is known */
+#define WAKEUP_TIME_KNOWN_S 1000000000LL
+#define WAKEUP_MAX_TIME_DEVIATION_S 300
+
+static unsigned long wakeup_last_seq = 0;
+
+static const char *
+check_wakeup_mac(const char *msg)
+{
+   /* "<mac> <seq> <cmd>", mac of "<seq> <cmd>" with the PSK */
+   uint8_t mac[WAKEUP_MAC_LEN];
+   uint8_t mac_check[WAKEUP_MAC_LEN];
+   uint8_t diff = 0;
+   const char *cur = strchr(msg, ' ');
+   char *end = NULL;
+   unsigned long seq;
+   int64_t now;
+
+   if (!cur || (cur - msg) != WAKEUP_MAC_LEN * 2 ||
+       hex2bin(msg, WAKEUP_MAC_LEN * 2, mac, sizeof(mac)) != sizeof(mac)) {
+      dtls_info("wakeup cmd without mac.");
+      return NULL;
+   }
+   ++cur;
+   if (appl_settings_wakeup_mac(cur, strlen(cur), mac_check, sizeof(mac_check)) < 0) {
+      dtls_info("wakeup cmd mac not supported.");
+      return NULL;
+   }
+   for (int index = 0; index < sizeof(mac); ++index) {
+      diff |= mac[index] ^ mac_check[index];
+   }
+   if (diff) {
+      dtls_info("wakeup cmd mac mismatch.");
+      return NULL;
+   }
+   seq = strtoul(cur, &end, 10);
+   if (end == cur || *end != ' ') {
+      dtls_info("wakeup cmd without sequence number.");
+      return NULL;
+   }
+   if (seq <= wakeup_last_seq) {
+      dtls_info("wakeup cmd %lu replayed, last %lu.", seq, wakeup_last_seq);
+      return NULL;
+   }
+   appl_get_now(&now);
+   now /= MSEC_PER_SEC;
+   if (now < WAKEUP_TIME_KNOWN_S) {
+      /* wakeup_last_seq starts with 0 after a reboot */
+      dtls_info("wakeup cmd %lu rejected, device time unknown.", seq);
+      return NULL;
+   }
+   if (llabs(now - (int64_t)seq) > WAKEUP_MAX_TIME_DEVIATION_S) {
+      dtls_info("wakeup cmd %lu outdated, %lld s.", seq, now - (int64_t)seq);
+      return NULL;
+   }
+   if ((int64_t)seq <= now - k_uptime_get() / MSEC_PER_SEC) {
+      /* sent before the last reboot, maybe replayed */
+      dtls_info("wakeup cmd %lu before reboot.", seq);
+      return NULL;
+   }
+   wakeup_last_seq = seq;
+   return end + 1;
+}
+
+static bool
+check_wakeup_cmd(const uint8_t *buffer, size_t len, bool secure)
+{
+   char msg[WAKEUP_MAX_MESSAGE_LEN];
+   const char *cmd = msg;
+
+   while (len && (buffer[len - 1] == '\n' || buffer[len - 1] == '\r')) {
+      --len;
+   }
+   if (len >= sizeof(msg)) {
+      dtls_info("wakeup cmd too large, %u bytes.", len);
+      return false;
+   }
+   memcpy(msg, buffer, len);
+   msg[len] = 0;
+   if (!secure) {
+      cmd = check_wakeup_mac(msg);
+      if (!cmd) {
+         return false;
+      }
+   }
+   cmd += strspn(cmd, " \t");
+   if (!*cmd) {
+      return false;
+   }
+   dtls_info("wakeup cmd %s", cmd);
+   if (sh_cmd_append_reported(cmd, K_NO_WAIT)) {
+      return false;
+   }
+   /* the report carries the result */
+   if (sh_cmd_append("send", K_NO_WAIT)) {
+      dtls_cmd_trigger("wakeup", false, 1);
+   }
+   return true;
+}
+#endif /* CONFIG_SH_CMD */
+
 static void
-check_wakeup(uint8_t *buffer, size_t len)
+check_wakeup(uint8_t *buffer, size_t len, bool secure)
 {
    LOG_HEXDUMP_INF(buffer, len, "incoming data");
    if ((len == 2 || len == 3) && memcmp(buffer, "up", 2) == 0) {
       atomic_clear_bit(&general_states, LTE_INCOMING_CONNECT);
       dtls_cmd_trigger("wakeup", false, 1);
+#ifdef CONFIG_SH_CMD
+   } else if (len > 3 && memcmp(buffer, "up ", 3) == 0) {
+      if (check_wakeup_cmd(buffer + 3, len - 3, secure)) {
+         atomic_clear_bit(&general_states, LTE_INCOMING_CONNECT);
+      }
+#endif /* CONFIG_SH_CMD */
    }
 }
 #endif /* CONFIG_UDP_WAKEUP_ENABLE */
 
+#if (COAP_MAX_TRANSACTIONS > 0)
+static int send_to_peer(dtls_app_data_t *app, const uint8_t *data, size_t len);
+
+static int dtls_coap_transaction_send(dtls_app_data_t *app, dtls_context_t *ctx, const uint8_t *data, size_t len)
+{
+   int result;
+
+   if (ctx) {
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+      dtls_session_check(app, ctx);
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
+      result = dtls_write(ctx, &app->destination, (uint8_t *)data, len);
+   } else {
+      result = send_to_peer(app, data, len);
+   }
+   if (result < 0) {
+      dtls_warn("Failed to send CoAP transaction with %d bytes, %d (%s)",
+                len, errno, strerror(errno));
+   }
+   return result;
+}
+
+static void dtls_coap_transaction_result(dtls_app_data_t *app, coap_transaction_t *transaction, bool success)
+{
+   const coap_handler_t handler = transaction->handler;
+
+   coap_client_transaction_remove(transaction);
+#ifdef CONFIG_COAP_UPDATE
+   if (handler.parse_data == coap_update_client_handler.parse_data) {
+      int interval = dtls_app_download_result_handler(app, success);
+      if (interval > 0 && dtls_no_pending_request(app->request_state)) {
+         work_reschedule_for_io_queue(&dtls_timer_trigger_work, K_SECONDS(interval));
+      }
+   }
+#else  /* CONFIG_COAP_UPDATE */
+   (void)app;
+   (void)handler;
+   (void)success;
+#endif /* CONFIG_COAP_UPDATE */
+}
+
 static int
-read_from_peer(dtls_app_data_t *app, session_t *session, uint8 *data, size_t len)
+read_transaction_from_peer(dtls_app_data_t *app, dtls_context_t *ctx, coap_transaction_t *transaction, uint8 *data, size_t len)
+{
+   const uint8_t *ack_buf = NULL;
+   uint16_t mid = transaction->mid;
+   int err = transaction->handler.parse_data(data, len);
+
+   if (err < 0) {
+      dtls_info("CoAP transaction %u failed, %d.", mid, err);
+      dtls_coap_transaction_result(app, transaction, false);
+      return err;
+   }
+
+   switch (err) {
+      case PARSE_NONE:
+         break;
+      case PARSE_IGN:
+         break;
+      case PARSE_RST:
+         dtls_info("CoAP transaction %u rst.", mid);
+         dtls_coap_transaction_result(app, transaction, false);
+         break;
+      case PARSE_ACK:
+         // wait for separate response, no retransmission
+         transaction->retransmission = COAP_MAX_RETRANSMISSION;
+         transaction->timeout_time = k_uptime_get() + 60 * MSEC_PER_SEC;
+         break;
+      case PARSE_CON_RESPONSE:
+         len = coap_client_message(&ack_buf);
+         if (len) {
+            dtls_coap_transaction_send(app, ctx, ack_buf, len);
+         }
+         /* fall through */
+      case PARSE_RESPONSE:
+         dtls_info("CoAP transaction %u succeeded, retrans. %u.", mid, transaction->retransmission);
+         dtls_coap_transaction_result(app, transaction, true);
+         break;
+   }
+
+   return 0;
+}
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
+
+static int
+read_from_peer(dtls_app_data_t *app, dtls_context_t *ctx, session_t *session, uint8 *data, size_t len)
 {
    (void)session;
+#if (COAP_MAX_TRANSACTIONS > 0)
+   coap_transaction_t *transaction = coap_client_transaction_find(data, len);
+   if (transaction) {
+      return read_transaction_from_peer(app, ctx, transaction, data, len);
+   }
+#else  /* COAP_MAX_TRANSACTIONS > 0 */
+   (void)ctx;
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
    int err = app->coap_handler.parse_data(data, len);
 
    if (err < 0) {
       if (INCOMING_DATA == app->request_state) {
          dtls_info("incoming data: %d bytes", len);
 #if defined(CONFIG_UDP_WAKEUP_ENABLE)
-         check_wakeup(data, len);
+         /* data received with the DTLS session is already authenticated */
+         check_wakeup(data, len, ctx != NULL);
 #endif /* CONFIG_UDP_WAKEUP_ENABLE */
       }
       return err;
@@ -1166,7 +1716,7 @@ static int
 dtls_read_from_peer(dtls_context_t *ctx, session_t *session, uint8 *data, size_t len)
 {
    dtls_app_data_t *app = dtls_get_app_data(ctx);
-   return read_from_peer(app, session, data, len);
+   return read_from_peer(app, ctx, session, data, len);
 }
 
 static int
@@ -1199,6 +1749,10 @@ send_to_peer(dtls_app_data_t *app, const uint8_t *data, size_t len)
       }
       return result;
    }
+   dtls_exchange_statistic_sent(result);
+   if (app->dtls_flight) {
+      ++dtls_handshake_datagrams;
+   }
    connected = atomic_test_bit(&general_states, LTE_CONNECTED);
    if (connected) {
       modem_set_transmission_time();
@@ -1212,6 +1766,7 @@ send_to_peer(dtls_app_data_t *app, const uint8_t *data, size_t len)
       app->dtls_flight += 2;
    }
    if (first) {
+      app->rto_connected = connected ? 1 : 0;
       network_adjust_initial_timeout(app, true);
       dtls_info("%sinitial response timeout %d s", tag, app->timeout);
    }
@@ -1224,6 +1779,30 @@ send_to_peer(dtls_app_data_t *app, const uint8_t *data, size_t len)
    return result;
 }
 
+static size_t
+dtls_flight_payload(const dtls_app_data_t *app)
+{
+   if (app->destination.addr.sa.sa_family == AF_INET6) {
+      return CONFIG_DTLS_PATH_MTU - DTLS_IPV6_UDP_OVERHEAD;
+   }
+   return MAX_DTLS_BUF;
+}
+
+/* send the buffered records of a flight, call with dtls_buffer_mutex locked */
+static int
+dtls_send_flight(dtls_app_data_t *app)
+{
+   int result = 0;
+
+   if (dtls_buffer_len) {
+      dtls_info("hs_flight datagram, %u records, %u bytes", dtls_buffer_records, dtls_buffer_len);
+      result = send_to_peer(app, dtls_buffer, dtls_buffer_len);
+      dtls_buffer_len = 0;
+      dtls_buffer_records = 0;
+   }
+   return result;
+}
+
 static int
 dtls_send_to_peer(dtls_context_t *ctx,
                   session_t *session, uint8 *data, size_t len)
@@ -1231,14 +1810,14 @@ dtls_send_to_peer(dtls_context_t *ctx,
    (void)session;
    int result = 0;
    dtls_app_data_t *app = dtls_get_app_data(ctx);
-   if (app->dtls_flight > 1) {
+   if (app->dtls_flight > 1 && len <= dtls_flight_payload(app)) {
       k_mutex_lock(&dtls_buffer_mutex, K_FOREVER);
-      if (dtls_buffer_len + len > sizeof(dtls_buffer)) {
-         send_to_peer(app, dtls_buffer, dtls_buffer_len);
-         dtls_buffer_len = 0;
+      if (dtls_buffer_len + len > dtls_flight_payload(app)) {
+         dtls_send_flight(app);
       }
       memmove(&dtls_buffer[dtls_buffer_len], data, len);
       dtls_buffer_len += len;
+      dtls_buffer_records++;
       result = len;
       k_mutex_unlock(&dtls_buffer_mutex);
       if (result) {
@@ -1276,6 +1855,20 @@ static const struct cipher_entry ciphers_map[] = {
 #endif /* DTLS_ECC */
     {.name = NULL, .cipher = TLS_NULL_WITH_NULL_NULL}};
 
+static const char *dtls_get_cipher_suite_name(const dtls_security_parameters_t *security_params)
+{
+   const dtls_cipher_t cipher = dtls_get_cipher_suite(security_params->cipher_index);
+   const struct cipher_entry *cur = ciphers_map;
+
+   while (cur && cur->cipher != TLS_NULL_WITH_NULL_NULL) {
+      if (cur->cipher == cipher) {
+         return cur->name;
+      }
+      ++cur;
+   }
+   return "none";
+}
+
 static int
 dtls_handle_event(dtls_context_t *ctx, session_t *session,
                   dtls_alert_level_t level, unsigned short code)
@@ -1301,21 +1894,23 @@ dtls_handle_event(dtls_context_t *ctx, session_t *session,
          app->dtls_flight = 0;
          k_mutex_lock(&dtls_buffer_mutex, K_FOREVER);
          dtls_buffer_len = 0;
+         dtls_buffer_records = 0;
          k_mutex_unlock(&dtls_buffer_mutex);
+         dtls_info("dtls handshake, %u datagrams sent", dtls_handshake_datagrams);
+         if (dtls_handshake_time) {
+            int64_t time = k_uptime_get() - dtls_handshake_time;
+            appl_energy_add(APPL_ENERGY_HANDSHAKE, time);
+            APPL_HISTOGRAM_ADD(handshake, (uint32_t)time);
+            dtls_handshake_time = 0;
+         }
          peer = dtls_get_peer(ctx, session);
          if (peer) {
             const dtls_security_parameters_t *security_params = peer->security_params[0];
-            const dtls_cipher_t cipher = dtls_get_cipher_suite(security_params->cipher_index);
-            const struct cipher_entry *cur = ciphers_map;
             app->dtls_cid = security_params->write_cid_length > 0 ? 1 : 0;
-            app->dtls_cipher_suite = "none";
-            while (cur && cur->cipher != TLS_NULL_WITH_NULL_NULL) {
-               if (cur->cipher == cipher) {
-                  app->dtls_cipher_suite = cur->name;
-                  break;
-               }
-               ++cur;
-            }
+            app->dtls_cipher_suite = dtls_get_cipher_suite_name(security_params);
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+            dtls_session_save(session, peer);
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
          }
          ui_led_op(LED_COLOR_RED, LED_CLEAR);
          ui_led_op(LED_COLOR_GREEN, LED_CLEAR);
@@ -1325,6 +1920,7 @@ dtls_handle_event(dtls_context_t *ctx, session_t *session,
          app->dtls_pending = 1;
          app->dtls_cipher_suite = NULL;
          app->dtls_cid = 0;
+         app->dtls_resumed = 0;
          ui_led_op(LED_COLOR_BLUE, LED_CLEAR);
          ui_led_op(LED_COLOR_RED, LED_SET);
          ui_led_op(LED_COLOR_GREEN, LED_SET);
@@ -1359,6 +1955,7 @@ recvfrom_peer(dtls_app_data_t *app, dtls_context_t *ctx)
       modem_set_transmission_time();
    }
    dtls_info("received_from_peer %d bytes", result);
+   dtls_exchange_statistic_received(result);
    if (ctx) {
       if (app->dtls_flight) {
          app->dtls_next_flight = 1;
@@ -1368,15 +1965,14 @@ recvfrom_peer(dtls_app_data_t *app, dtls_context_t *ctx)
          k_mutex_lock(&dtls_buffer_mutex, K_FOREVER);
          if (dtls_buffer_len) {
             dtls_coap_set_request_state("dtls handle receive", app, SEND);
-            result = send_to_peer(app, dtls_buffer, dtls_buffer_len);
-            dtls_buffer_len = 0;
+            result = dtls_send_flight(app);
          }
          k_mutex_unlock(&dtls_buffer_mutex);
          dtls_coap_set_request_state("dtls received", app, RECEIVE);
       }
       return result;
    } else {
-      return read_from_peer(app, &session, appl_buffer, result);
+      return read_from_peer(app, NULL, &session, appl_buffer, result);
    }
 }
 
@@ -1398,7 +1994,8 @@ recvfrom_peer2(dtls_app_data_t *app)
       return result;
    }
    dtls_info("received_from_peer2 %d bytes", result);
-   check_wakeup(appl_buffer, result);
+   dtls_exchange_statistic_received(result);
+   check_wakeup(appl_buffer, result, false);
    return result;
 }
 #endif /* CONFIG_UDP_WAKEUP_ENABLE && (CONFIG_UDP_WAKEUP_PORT != 0) */
@@ -1418,17 +2015,26 @@ sendto_peer(dtls_app_data_t *app, struct dtls_context_t *ctx)
          k_mutex_lock(&dtls_buffer_mutex, K_FOREVER);
          if (dtls_buffer_len) {
             dtls_coap_set_request_state("dtls resend", app, SEND);
-            result = send_to_peer(app, dtls_buffer, dtls_buffer_len);
-            dtls_buffer_len = 0;
+            result = dtls_send_flight(app);
          }
          k_mutex_unlock(&dtls_buffer_mutex);
       } else {
          dtls_peer_t *peer = dtls_get_peer(ctx, &app->destination);
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+         if (!peer && dtls_session_restore(app, ctx)) {
+            // continue the restored session without handshake
+            return sendto_peer(app, ctx);
+         }
+         dtls_session_clear();
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
          if (peer) {
             dtls_reset_peer(ctx, peer);
          }
          ui_led_op(LED_COLOR_GREEN, LED_SET);
          ++dtls_handshakes;
+         dtls_handshake_datagrams = 0;
+         dtls_handshake_time = k_uptime_get();
+         dtls_exchange_statistic_handshake();
          app->send_request_pending = 1;
          app->retransmission = 0;
          app->dtls_next_flight = 1;
@@ -1441,6 +2047,9 @@ sendto_peer(dtls_app_data_t *app, struct dtls_context_t *ctx)
       if (coap_message_len) {
          dtls_info("send %d bytes.", coap_message_len);
          if (ctx) {
+#ifdef CONFIG_DTLS_SESSION_PERSIST
+            dtls_session_check(app, ctx);
+#endif /* CONFIG_DTLS_SESSION_PERSIST */
             result = dtls_write(ctx, &app->destination, (uint8_t *)coap_message_buf, coap_message_len);
             if (result < 0) {
                dtls_warn("Failed to send CoAP request with %d bytes via DTLS, %d (%s)",
@@ -1476,6 +2085,65 @@ sendto_peer(dtls_app_data_t *app, struct dtls_context_t *ctx)
    return result;
 }
 
+#if (COAP_MAX_TRANSACTIONS > 0)
+static void
+dtls_coap_transactions(dtls_app_data_t *app, struct dtls_context_t *ctx)
+{
+   coap_transaction_t *transaction;
+   int64_t now = k_uptime_get();
+
+   while ((transaction = coap_client_transaction_expired(now)) != NULL) {
+      if (transaction->retransmission >= COAP_MAX_RETRANSMISSION) {
+         dtls_info("CoAP transaction %u receive timeout %d s", transaction->mid, transaction->timeout);
+         dtls_coap_transaction_result(app, transaction, false);
+      } else if (app->dtls_pending) {
+         // wait for the handshake
+         transaction->timeout_time = now + transaction->timeout * MSEC_PER_SEC;
+      } else {
+         const uint8_t *coap_message_buf = NULL;
+         int coap_message_len = transaction->handler.get_message(&coap_message_buf);
+
+         transaction->timeout <<= 1;
+         transaction->timeout_time = now + transaction->timeout * MSEC_PER_SEC;
+         ++transaction->retransmission;
+         dtls_info("CoAP transaction %u resend, timeout %d s", transaction->mid, transaction->timeout);
+         if (coap_message_len <= 0 ||
+             dtls_coap_transaction_send(app, ctx, coap_message_buf, coap_message_len) < 0) {
+            dtls_coap_transaction_result(app, transaction, false);
+         }
+      }
+   }
+
+#ifdef CONFIG_COAP_UPDATE
+   /* fetch the next block, while the main request waits for its response */
+   if ((RECEIVE == app->request_state || WAIT_RESPONSE == app->request_state) &&
+       !app->dtls_pending && app->download_progress &&
+       app->coap_handler.parse_data != coap_update_client_handler.parse_data &&
+       appl_update_coap_pending_next()) {
+      if (appl_update_coap_next() > 0) {
+         int index = coap_client_transaction_add(&coap_update_client_handler,
+                                                 network_timeout_scale(coap_timeout));
+         if (index >= 0) {
+            const uint8_t *coap_message_buf = NULL;
+            int coap_message_len = coap_update_client_handler.get_message(&coap_message_buf);
+
+            dtls_info("next download request, transaction %d", index);
+            if (dtls_coap_transaction_send(app, ctx, coap_message_buf, coap_message_len) < 0) {
+               transaction = coap_client_transaction_find(coap_message_buf, coap_message_len);
+               if (transaction) {
+                  dtls_coap_transaction_result(app, transaction, false);
+               }
+            }
+         } else {
+            dtls_info("no free transaction, %d", index);
+            appl_update_coap_cancel(UPDATE_CANCEL_NO_TRANSACTION);
+         }
+      }
+   }
+#endif /* CONFIG_COAP_UPDATE */
+}
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
+
 /*---------------------------------------------------------------------------*/
 
 static dtls_handler_t cb = {
@@ -1938,6 +2606,9 @@ static int dtls_loop(dtls_app_data_t *app, int reboot)
             f = dtls_coap_inc_failures();
             dtls_info("no registration, failures %d.", f);
             reopen_cause = "modem not registered, failure.";
+#ifdef CONFIG_APPL_STORE_FORWARD
+            appl_queue_snapshot("no registration");
+#endif /* CONFIG_APPL_STORE_FORWARD */
          } else {
             reopen_cause = "modem registered";
          }
@@ -2071,8 +2742,11 @@ static int dtls_loop(dtls_app_data_t *app, int reboot)
          udp_poll[1].revents = 0;
       }
 #endif /*CONFIG_UDP_WAKEUP_ENABLE && (CONFIG_UDP_WAKEUP_PORT != 0) */
+#if (COAP_MAX_TRANSACTIONS > 0)
+      dtls_coap_transactions(app, dtls_context);
+#endif /* COAP_MAX_TRANSACTIONS > 0 */
 #ifdef CONFIG_COAP_UPDATE
-      if (dtls_no_pending_request(app->request_state)) {
+      if (dtls_no_pending_request(app->request_state) && !coap_client_transactions_pending()) {
          bool pending = appl_update_coap_pending();
          if (pending) {
             if (!appl_update_coap_pending_next() &&
@@ -2087,7 +2761,7 @@ static int dtls_loop(dtls_app_data_t *app, int reboot)
                   ++loops;
                   if (loops > 30) {
                      dtls_info("wait for download timeout!");
-                     appl_update_coap_cancel();
+                     appl_update_coap_cancel(UPDATE_CANCEL_TIMEOUT);
                      break;
                   }
                }
@@ -2122,17 +2796,34 @@ static int dtls_loop(dtls_app_data_t *app, int reboot)
                   sendto_peer(app, dtls_context);
                   continue;
                }
-            } else {
+            } else if (!appl_update_coap_downloaded()) {
                dtls_info("download canceled");
             }
          }
          if (!pending && app->download_progress &&
              app->download_progress < DOWNLOAD_PROGRESS_STATUS_MESSAGE) {
-            app->download_progress = 0;
-            dtls_coap_set_request_state("download canceled", app, WAIT_SUSPEND);
+            if (appl_update_coap_downloaded()) {
+               /* finished by the io_job_queue after the last block */
+               app->download_progress = DOWNLOAD_PROGRESS_LAST_STATUS_MESSAGE;
+               dtls_trigger("download finished", true);
+            } else {
+               app->download_progress = 0;
+               dtls_coap_set_request_state("download canceled", app, WAIT_SUSPEND);
+            }
          }
       }
 #endif /* CONFIG_COAP_UPDATE */
+#ifdef CONFIG_COAP_UPLOAD
+      /* upload in the background, regular requests first, don't connect only for uploads */
+      if (dtls_no_pending_request(app->request_state) && !coap_client_transactions_pending() &&
+          !lte_power_off && !dtls_trigger_pending() &&
+          atomic_test_bit(&general_states, LTE_CONNECTED) && dtls_upload_next(app)) {
+         loops = 0;
+         dtls_info("next upload request");
+         sendto_peer(app, dtls_context);
+         continue;
+      }
+#endif /* CONFIG_COAP_UPLOAD */
 
       if (atomic_test_and_clear_bit(&general_states, LTE_INCOMING_DATA)) {
          if (NONE == app->request_state || WAIT_SUSPEND == app->request_state) {
@@ -2141,9 +2832,10 @@ static int dtls_loop(dtls_app_data_t *app, int reboot)
          }
       }
 
-      bool poll_recv = NONE != app->request_state;
+      bool poll_recv = NONE != app->request_state || coap_client_transactions_pending();
 
       if (dtls_trigger_pending()) {
+         /* the triggered request is sent without waiting for the pending transactions */
          poll_recv = dtls_pending_request(app->request_state);
       }
 
@@ -2227,6 +2919,12 @@ static int dtls_loop(dtls_app_data_t *app, int reboot)
 #else  /* CONFIG_COAP_UPDATE */
                   app->rai = 1;
 #endif /* CONFIG_COAP_UPDATE */
+#ifdef CONFIG_COAP_UPLOAD
+                  if (coap_upload_pending()) {
+                     /* keep the connection for the upload blocks */
+                     app->rai = 0;
+                  }
+#endif /* CONFIG_COAP_UPLOAD */
                }
                if (res < 0) {
                   dtls_coap_failure(app, "prepare post");
@@ -2302,7 +3000,11 @@ static int dtls_loop(dtls_app_data_t *app, int reboot)
                   if (app->retransmission == 0) {
                      network_adjust_initial_timeout(app, false);
                   }
+#ifdef CONFIG_COAP_ADAPTIVE_RTO
+                  app->timeout = coap_rto_backoff(app->timeout);
+#else  /* CONFIG_COAP_ADAPTIVE_RTO */
                   app->timeout <<= 1;
+#endif /* CONFIG_COAP_ADAPTIVE_RTO */
                   if (app->retransmission == 0) {
                      int rat = CONFIG_UDP_PSM_RETRANS_RAT;
                      if ((app->timeout + 4) > rat) {
@@ -2669,6 +3371,12 @@ static int sh_cmd_coap_timeout(const char *parameter)
       } else {
          LOG_INF("%sinitial coap timeout %us(+%us)", cur, timeout, atimeout);
       }
+#ifdef CONFIG_COAP_ADAPTIVE_RTO
+      char rto[128];
+      if (coap_rto_dump(rto, sizeof(rto)) > 0) {
+         LOG_INF("adaptive RTO: %s", rto);
+      }
+#endif /* CONFIG_COAP_ADAPTIVE_RTO */
    }
    return res;
 }
@@ -2745,6 +3453,21 @@ static flags_definition_t coap_send_flags_definitions[] = {
 #else  /* CONFIG_LOCATION_ENABLE */
     {.name = "loc", .desc = "location info", .flag = 0},
 #endif /* CONFIG_LOCATION_ENABLE */
+#ifdef CONFIG_COAP_SENML
+    {.name = "senml", .desc = "SenML-CBOR payload", .flag = COAP_SEND_FLAG_SENML},
+#else  /* CONFIG_COAP_SENML */
+    {.name = "senml", .desc = "SenML-CBOR payload", .flag = 0},
+#endif /* CONFIG_COAP_SENML */
+#ifdef CONFIG_APPL_STORE_FORWARD
+    {.name = "queue", .desc = "store-and-forward queue", .flag = COAP_SEND_FLAG_QUEUE},
+#else  /* CONFIG_APPL_STORE_FORWARD */
+    {.name = "queue", .desc = "store-and-forward queue", .flag = 0},
+#endif /* CONFIG_APPL_STORE_FORWARD */
+#ifdef CONFIG_APPL_ENERGY
+    {.name = "energy", .desc = "energy accounting", .flag = COAP_SEND_FLAG_ENERGY},
+#else  /* CONFIG_APPL_ENERGY */
+    {.name = "energy", .desc = "energy accounting", .flag = 0},
+#endif /* CONFIG_APPL_ENERGY */
     {.name = NULL, .desc = NULL, .flag = 0},
 };
 
@@ -19,6 +19,9 @@
 
 #define COAP_MAX_RETRANSMISSION 3
 
+/* size of the receive buffer for UDP messages */
+#define DTLS_CLIENT_MAX_APPL_BUF 1600
+
 #define DTLS_CLIENT_RETRY_STRATEGY_DTLS_HANDSHAKE 1
 #define DTLS_CLIENT_RETRY_STRATEGY_OFFLINE 2
 #define DTLS_CLIENT_RETRY_STRATEGY_OFF 4
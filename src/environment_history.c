@@ -20,6 +20,17 @@
 
 #if (defined CONFIG_ENVIRONMENT_SENSOR) || (defined CONFIG_SHT21)
 
+int16_t environment_scale_value(double value, int scale)
+{
+   value *= scale;
+   if (value >= INT16_MAX) {
+      return INT16_MAX;
+   } else if (value <= INT16_MIN) {
+      return INT16_MIN;
+   }
+   return (int16_t)(value < 0 ? value - 0.5 : value + 0.5);
+}
+
 #if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
 
 LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
@@ -28,17 +39,58 @@ LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
 #define SENSOR_HISTORY_DEF(T, S) \
    typedef struct {              \
       int64_t next_time;         \
-      uint8_t size;              \
+      uint16_t size;             \
+      uint16_t head;             \
       T history[S];              \
    } SENSOR_HISTORY(T)
 
-static struct k_spinlock environment_history_lock;
+/*
+ * Ring buffers of scaled integer values.
+ * "head" is the index of the latest value, the size is the number
+ * of valid values. Adding a value is O(1), the values are returned
+ * starting with the latest one.
+ */
 
-SENSOR_HISTORY_DEF(double, CONFIG_ENVIRONMENT_HISTORY_SIZE);
+static struct k_spinlock environment_history_lock;
 
-static SENSOR_HISTORY(double) s_temperature_history;
-static SENSOR_HISTORY(double) s_humidity_history;
-static SENSOR_HISTORY(double) s_pressure_history;
+SENSOR_HISTORY_DEF(int16_t, CONFIG_ENVIRONMENT_HISTORY_SIZE);
+
+static SENSOR_HISTORY(int16_t) s_temperature_history;
+static SENSOR_HISTORY(int16_t) s_humidity_history;
+static SENSOR_HISTORY(int16_t) s_pressure_history;
+
+#define HISTORY_PREVIOUS_INDEX(I) ((I) ? (I) - 1 : CONFIG_ENVIRONMENT_HISTORY_SIZE - 1)
+#define HISTORY_NEXT_INDEX(I) (((I) + 1) < CONFIG_ENVIRONMENT_HISTORY_SIZE ? (I) + 1 : 0)
+
+#define HISTORY_INIT(H)   \
+   do {                   \
+      (H)->size = 0;      \
+      (H)->head = 0;      \
+      (H)->next_time = 0; \
+   } while (0)
+
+#define HISTORY_GET(H, V, S)                  \
+   do {                                       \
+      uint16_t index;                         \
+      uint16_t pos = (H)->head;               \
+      if ((H)->size < (S)) {                  \
+         (S) = (H)->size;                     \
+      }                                       \
+      for (index = 0; index < (S); ++index) { \
+         (V)[index] = (H)->history[pos];      \
+         pos = HISTORY_PREVIOUS_INDEX(pos);   \
+      }                                       \
+   } while (0)
+
+#define HISTORY_ADD(H, V, N)                                                       \
+   do {                                                                            \
+      if ((H)->size < CONFIG_ENVIRONMENT_HISTORY_SIZE) {                           \
+         ++(H)->size;                                                              \
+      }                                                                            \
+      (H)->head = HISTORY_NEXT_INDEX((H)->head);                                   \
+      (H)->history[(H)->head] = (V);                                               \
+      (H)->next_time = (N) + CONFIG_ENVIRONMENT_HISTORY_INTERVAL_S * MSEC_PER_SEC; \
+   } while (0)
 
 #ifdef CONFIG_BME680_BSEC
 
@@ -48,29 +100,17 @@ static SENSOR_HISTORY(uint16_t) s_iaq_history;
 
 static void environment_init_uint16_history(SENSOR_HISTORY(uint16_t) * history)
 {
-   uint8_t index;
    K_SPINLOCK(&environment_history_lock)
    {
-      history->size = 0;
-      history->next_time = 0;
-      for (index = 0; index < CONFIG_ENVIRONMENT_HISTORY_SIZE; ++index) {
-         history->history[index] = 0.0;
-      }
+      HISTORY_INIT(history);
    }
 }
 
-static int environment_get_uint16_history(SENSOR_HISTORY(uint16_t) * history, uint16_t *values, uint8_t size)
+static int environment_get_uint16_history(SENSOR_HISTORY(uint16_t) * history, uint16_t *values, uint16_t size)
 {
-   uint8_t index;
-
    K_SPINLOCK(&environment_history_lock)
    {
-      if (history->size < size) {
-         size = history->size;
-      }
-      for (index = 0; index < size; ++index) {
-         values[index] = history->history[index];
-      }
+      HISTORY_GET(history, values, size);
    }
 
    return size;
@@ -78,20 +118,12 @@ static int environment_get_uint16_history(SENSOR_HISTORY(uint16_t) * history, ui
 
 static void environment_add_uint16_history(SENSOR_HISTORY(uint16_t) * history, uint16_t value, bool force)
 {
-   uint8_t index;
    int64_t now = k_uptime_get();
 
    K_SPINLOCK(&environment_history_lock)
    {
       if (force || (now - history->next_time) >= 0) {
-         if (history->size < CONFIG_ENVIRONMENT_HISTORY_SIZE) {
-            ++history->size;
-         }
-         for (index = history->size - 1; index > 0; --index) {
-            history->history[index] = history->history[index - 1];
-         }
-         history->history[0] = value;
-         history->next_time = now + CONFIG_ENVIRONMENT_HISTORY_INTERVAL_S * MSEC_PER_SEC;
+         HISTORY_ADD(history, value, now);
       }
    }
 }
@@ -120,92 +152,72 @@ static void environment_history_work_fn(struct k_work *work)
 }
 #endif
 
-static void environment_init_double_history(SENSOR_HISTORY(double) * history)
+static void environment_init_int16_history(SENSOR_HISTORY(int16_t) * history)
 {
-   uint8_t index;
-
    K_SPINLOCK(&environment_history_lock)
    {
-      history->size = 0;
-      history->next_time = 0;
-      for (index = 0; index < CONFIG_ENVIRONMENT_HISTORY_SIZE; ++index) {
-         history->history[index] = 0.0;
-      }
+      HISTORY_INIT(history);
    }
 }
 
-static int environment_get_double_history(SENSOR_HISTORY(double) * history, double *values, uint8_t size)
+static int environment_get_int16_history(SENSOR_HISTORY(int16_t) * history, int16_t *values, uint16_t size)
 {
-   uint8_t index;
-
    K_SPINLOCK(&environment_history_lock)
    {
-      if (history->size < size) {
-         size = history->size;
-      }
-      for (index = 0; index < size; ++index) {
-         values[index] = history->history[index];
-      }
+      HISTORY_GET(history, values, size);
    }
 
    return size;
 }
 
-static void environment_add_double_history(SENSOR_HISTORY(double) * history, double value, bool force)
+static void environment_add_int16_history(SENSOR_HISTORY(int16_t) * history, double value, int scale, bool force)
 {
-   uint8_t index;
+   int16_t scaled_value = environment_scale_value(value, scale);
    int64_t now = k_uptime_get();
 
    K_SPINLOCK(&environment_history_lock)
    {
       if (force || (now - history->next_time) >= 0) {
-         if (history->size < CONFIG_ENVIRONMENT_HISTORY_SIZE) {
-            ++history->size;
-         }
-         for (index = history->size - 1; index > 0; --index) {
-            history->history[index] = history->history[index - 1];
-         }
-         history->history[0] = value;
-         history->next_time = now + CONFIG_ENVIRONMENT_HISTORY_INTERVAL_S * MSEC_PER_SEC;
+         HISTORY_ADD(history, scaled_value, now);
       }
    }
 }
 
-int environment_get_temperature_history(double *values, uint8_t size)
+int environment_get_temperature_history(int16_t *values, uint16_t size)
 {
-   return environment_get_double_history(&s_temperature_history, values, size);
+   return environment_get_int16_history(&s_temperature_history, values, size);
 }
 
 void environment_add_temperature_history(double value, bool force)
 {
-   environment_add_double_history(&s_temperature_history, value, force);
+   environment_add_int16_history(&s_temperature_history, value, ENVIRONMENT_TEMPERATURE_SCALE, force);
 }
 
-int environment_get_humidity_history(double *values, uint8_t size)
+int environment_get_humidity_history(int16_t *values, uint16_t size)
 {
-   return environment_get_double_history(&s_humidity_history, values, size);
+   return environment_get_int16_history(&s_humidity_history, values, size);
 }
 
 void environment_add_humidity_history(double value, bool force)
 {
-   environment_add_double_history(&s_humidity_history, value, force);
+   environment_add_int16_history(&s_humidity_history, value, ENVIRONMENT_HUMIDITY_SCALE, force);
 }
 
-int environment_get_pressure_history(double *values, uint8_t size)
+int environment_get_pressure_history(int16_t *values, uint16_t size)
 {
-   return environment_get_double_history(&s_pressure_history, values, size);
+   return environment_get_int16_history(&s_pressure_history, values, size);
 }
 
 void environment_add_pressure_history(double value, bool force)
 {
-   environment_add_double_history(&s_pressure_history, value, force);
+   environment_add_int16_history(&s_pressure_history, value, ENVIRONMENT_PRESSURE_SCALE, force);
 }
 
 void environment_init_history(void)
 {
-   environment_init_double_history(&s_temperature_history);
-   environment_init_double_history(&s_humidity_history);
-   environment_init_double_history(&s_pressure_history);
+   environment_init_int16_history(&s_temperature_history);
+   environment_init_int16_history(&s_humidity_history);
+   environment_init_int16_history(&s_pressure_history);
 #ifdef CONFIG_BME680_BSEC
    environment_init_uint16_history(&s_iaq_history);
 #endif
@@ -214,7 +226,7 @@ void environment_init_history(void)
 #endif
 }
 
-int environment_get_iaq_history(uint16_t *values, uint8_t size)
+int environment_get_iaq_history(uint16_t *values, uint16_t size)
 {
 #ifdef CONFIG_BME680_BSEC
    return environment_get_uint16_history(&s_iaq_history, values, size);
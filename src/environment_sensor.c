@@ -16,6 +16,7 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
+#include "appl_histogram.h"
 #include "environment_sensor.h"
 #include "io_job_queue.h"
 #include "parse.h"
@@ -303,6 +304,8 @@ static const struct environment_sensor *all_sensors[] = {
 
 static const unsigned int all_sensors_size = ARRAY_SIZE(all_sensors);
 
+APPL_HISTOGRAM_DEFINE(sensor, "ms");
+
 int environment_sensor_fetch(bool force)
 {
    static int64_t environment_sensor_next_fetch = 0;
@@ -320,7 +323,9 @@ int environment_sensor_fetch(bool force)
                }
             }
             if (dev) {
+               int64_t time = k_uptime_get();
                err = sensor_sample_fetch_chan(dev, SENSOR_CHAN_ALL);
+               APPL_HISTOGRAM_ADD(sensor, (uint32_t)(k_uptime_get() - time));
 #ifdef CONFIG_ENVIRONMENT_PRESSURE_DELTA
                if (err == -EAGAIN) {
                   err = 0;
@@ -25,6 +25,7 @@
 #if (defined CONFIG_ENVIRONMENT_SENSOR) || (defined CONFIG_SHT21)
 
 #include <stdbool.h>
+#include <stdint.h>
 
 int environment_init(void);
 
@@ -47,21 +48,29 @@ const char *environment_get_iaq_description(int32_t value);
 #define IAQ_ACCURANCY_HIST(X) ((X & 3) << 14)
 
 
+/* scales of the history values, 0.01 °C, 0.01 %H, 0.1 hPa */
+#define ENVIRONMENT_TEMPERATURE_SCALE 100
+#define ENVIRONMENT_HUMIDITY_SCALE 100
+#define ENVIRONMENT_PRESSURE_SCALE 10
+
+/* scale, round and clamp value to the int16 history value */
+int16_t environment_scale_value(double value, int scale);
+
 #if (CONFIG_ENVIRONMENT_HISTORY_SIZE > 0)
 
-int environment_get_temperature_history(double *values, uint8_t size);
+int environment_get_temperature_history(int16_t *values, uint16_t size);
 
 void environment_add_temperature_history(double value, bool force);
 
-int environment_get_humidity_history(double *values, uint8_t size);
+int environment_get_humidity_history(int16_t *values, uint16_t size);
 
 void environment_add_humidity_history(double value, bool force);
 
-int environment_get_pressure_history(double *values, uint8_t size);
+int environment_get_pressure_history(int16_t *values, uint16_t size);
 
 void environment_add_pressure_history(double value, bool force);
 
-int environment_get_iaq_history(uint16_t *values, uint8_t size);
+int environment_get_iaq_history(uint16_t *values, uint16_t size);
 
 void environment_add_iaq_history(uint16_t value, bool force);
 
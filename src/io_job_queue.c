@@ -14,6 +14,7 @@
 #include <zephyr/init.h>
 #include <zephyr/logging/log.h>
 
+#include "appl_histogram.h"
 #include "io_job_queue.h"
 
 LOG_MODULE_REGISTER(WORK_QUEUE, CONFIG_WORK_QUEUE_LOG_LEVEL);
@@ -86,6 +87,43 @@ static int queues_init(void)
    return 0;
 }
 
+#ifdef CONFIG_APPL_HISTOGRAM
+/* a probe is queued ahead of the submitted work and measures its waiting time */
+struct work_probe {
+   struct k_work work;
+   struct appl_histogram *histogram;
+   int64_t time;
+};
+
+APPL_HISTOGRAM_DEFINE(cmd_queue, "ms");
+
+static void work_probe_fn(struct k_work *work)
+{
+   struct work_probe *probe = CONTAINER_OF(work, struct work_probe, work);
+   appl_histogram_add(probe->histogram, (uint32_t)(k_uptime_get() - probe->time));
+}
+
+#ifdef CONFIG_USE_IO_JOB_QUEUE
+APPL_HISTOGRAM_DEFINE(io_queue, "ms");
+
+static struct work_probe io_queue_probe = {
+    .work = Z_WORK_INITIALIZER(work_probe_fn),
+    .histogram = &histogram_io_queue};
+#endif /* CONFIG_USE_IO_JOB_QUEUE */
+
+static struct work_probe cmd_queue_probe = {
+    .work = Z_WORK_INITIALIZER(work_probe_fn),
+    .histogram = &histogram_cmd_queue};
+
+static void work_probe_submit(struct k_work_q *queue, struct work_probe *probe)
+{
+   if (!k_work_busy_get(&probe->work)) {
+      probe->time = k_uptime_get();
+      k_work_submit_to_queue(queue, &probe->work);
+   }
+}
+#endif /* CONFIG_APPL_HISTOGRAM */
+
 #define APPLICATION_PREINIT_PRIORITY 89
 SYS_INIT(queues_init, APPLICATION, APPLICATION_PREINIT_PRIORITY);
 
@@ -112,6 +150,9 @@ int work_reschedule_for_io_queue(struct k_work_delayable *dwork,
 int work_submit_to_io_queue(struct k_work *work)
 {
 #ifdef CONFIG_USE_IO_JOB_QUEUE
+#ifdef CONFIG_APPL_HISTOGRAM
+   work_probe_submit(&io_job_queue, &io_queue_probe);
+#endif /* CONFIG_APPL_HISTOGRAM */
    return k_work_submit_to_queue(&io_job_queue, work);
 #else
    return k_work_submit(work);
@@ -132,5 +173,8 @@ int work_reschedule_for_cmd_queue(struct k_work_delayable *dwork,
 
 int work_submit_to_cmd_queue(struct k_work *work)
 {
+#ifdef CONFIG_APPL_HISTOGRAM
+   work_probe_submit(&cmd_queue, &cmd_queue_probe);
+#endif /* CONFIG_APPL_HISTOGRAM */
    return k_work_submit_to_queue(&cmd_queue, work);
 }
@@ -20,6 +20,7 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
+#include "appl_energy.h"
 #include "io_job_queue.h"
 #include "location.h"
 #include "ui.h"
@@ -223,6 +224,7 @@ static void location_event_handler(const struct modem_gnss_state *gnss_state)
    }
 
    location_stop_works(timeout);
+   appl_energy_add(APPL_ENERGY_GNSS, gnss_state->execution_time);
 
    k_mutex_lock(&location_mutex, K_FOREVER);
    s_location_last_result = now;
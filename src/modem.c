@@ -23,6 +23,10 @@
 #include <zephyr/sys/slist.h>
 
 #include "appl_diagnose.h"
+#include "appl_energy.h"
+#ifdef CONFIG_COAP_UPLOAD
+#include "coap_upload.h"
+#endif /* CONFIG_COAP_UPLOAD */
 #include "io_job_queue.h"
 #include "modem.h"
 #include "modem_at.h"
@@ -114,6 +118,12 @@ static int64_t lte_psm_delay_time = 0;
 static struct lte_modem_info modem_info;
 static struct lte_network_info network_info;
 static struct lte_ce_info ce_info;
+/* transfer values of AT%XCONNSTAT */
+static struct lte_network_statistic xconnstat;
+/* temperature of AT%XTEMP in °C */
+static int xtemp;
+/* uptime of the last refresh of the status parts, 0 if not available */
+static int64_t status_times[MODEM_STATUS_PARTS];
 
 static int64_t transmission_time = 0;
 static int64_t network_search_time = 0;
@@ -449,6 +459,7 @@ static void lte_start_search(void)
    ++lte_searchs;
    if (network_search_time) {
       lte_search_time += (now - network_search_time);
+      appl_energy_add(APPL_ENERGY_SEARCH, now - network_search_time);
    }
    network_search_time = now;
    k_mutex_unlock(&lte_mutex);
@@ -459,8 +470,10 @@ static void lte_end_search(void)
 {
    k_mutex_lock(&lte_mutex, K_FOREVER);
    if (network_search_time) {
-      lte_search_time += (k_uptime_get() - network_search_time);
+      int64_t time = k_uptime_get() - network_search_time;
+      lte_search_time += time;
       network_search_time = 0;
+      appl_energy_add(APPL_ENERGY_SEARCH, time);
    }
    k_mutex_unlock(&lte_mutex);
    ui_led_op(LED_SEARCH, LED_CLEAR);
@@ -483,6 +496,7 @@ static void lte_inc_wakeups(int64_t time)
    ++lte_wakeups;
    lte_wakeup_time += time;
    k_mutex_unlock(&lte_mutex);
+   appl_energy_add(APPL_ENERGY_CONNECTED, time);
 }
 
 static void lte_add_connected(int64_t time)
@@ -490,6 +504,7 @@ static void lte_add_connected(int64_t time)
    k_mutex_lock(&lte_mutex, K_FOREVER);
    lte_connected_time += time;
    k_mutex_unlock(&lte_mutex);
+   appl_energy_add(APPL_ENERGY_CONNECTED, time);
 }
 
 #if defined(CONFIG_LTE_LC_MODEM_SLEEP_MODULE)
@@ -498,6 +513,7 @@ static void lte_add_asleep(int64_t time)
    k_mutex_lock(&lte_mutex, K_FOREVER);
    lte_asleep_time += time;
    k_mutex_unlock(&lte_mutex);
+   appl_energy_add(APPL_ENERGY_IDLE, time);
 }
 #endif /* CONFIG_LTE_LC_MODEM_SLEEP_MODULE */
 
@@ -728,6 +744,40 @@ int modem_clear_last_neighbor_cell_meas(void)
    return res;
 }
 
+#ifdef CONFIG_COAP_UPLOAD
+static size_t modem_neighbor_cell_upload_offset = 0;
+static size_t modem_neighbor_cell_upload_len = 0;
+
+static int modem_neighbor_cell_upload_start(void)
+{
+   int res = -ENODATA;
+   k_mutex_lock(&lte_mutex, K_FOREVER);
+   if (modem_last_neighbor_cell_meas_len) {
+      modem_neighbor_cell_upload_offset = 0;
+      modem_neighbor_cell_upload_len = modem_last_neighbor_cell_meas_len;
+      res = modem_neighbor_cell_upload_len;
+   }
+   k_mutex_unlock(&lte_mutex);
+   return res;
+}
+
+static int modem_neighbor_cell_upload_read(uint8_t *buf, size_t len)
+{
+   int res = -ENODATA;
+   k_mutex_lock(&lte_mutex, K_FOREVER);
+   if (modem_last_neighbor_cell_meas_len == modem_neighbor_cell_upload_len) {
+      res = MIN(modem_neighbor_cell_upload_len - modem_neighbor_cell_upload_offset, len);
+      memcpy(buf, &modem_last_neighbor_cell_meas[modem_neighbor_cell_upload_offset], res);
+      modem_neighbor_cell_upload_offset += res;
+   }
+   k_mutex_unlock(&lte_mutex);
+   return res;
+}
+
+COAP_UPLOAD_PRODUCER(neighbors, "last neighbor cell measurement.", modem_neighbor_cell_upload_start,
+                     modem_neighbor_cell_upload_read, NULL);
+#endif /* CONFIG_COAP_UPLOAD */
+
 #if defined(CONFIG_LTE_LC_NEIGHBOR_CELL_MEAS_MODULE)
 
 #define RSRP(X) ((X) - 140)
@@ -929,6 +979,7 @@ static void lte_handler(const struct lte_lc_evt *const evt)
 {
    static uint8_t phase = 0;
    static int64_t phase_start_time = 0;
+   static int64_t sleep_start_time = 0;
    static int active_time = -1;
 
    if (appl_reboots()) {
@@ -1054,10 +1105,15 @@ static void lte_handler(const struct lte_lc_evt *const evt)
                LOG_INF("LTE modem sleeps %s", mode);
             }
             phase = 0;
+            sleep_start_time = now;
             lte_network_sleeping_set(true);
             break;
          }
       case LTE_LC_EVT_MODEM_SLEEP_EXIT:
+         if (sleep_start_time) {
+            appl_energy_add(APPL_ENERGY_PSM, now - sleep_start_time);
+            sleep_start_time = 0;
+         }
          phase = 1;
          phase_start_time = now;
          lte_network_sleeping_set(false);
@@ -2118,18 +2174,72 @@ void modem_set_scan_time(void)
 int psm_parse(const char *active_time_str, const char *tau_ext_str,
               const char *tau_legacy_str, struct lte_lc_psm_cfg *psm_cfg);
 
+static long modem_band(long value)
+{
+   return (0 <= value && value < 90) ? value : 0;
+}
+
+static long modem_tac(long value)
+{
+   return (0 <= value && value < 0x10000) ? value : 0;
+}
+
+static long modem_snr(long value)
+{
+   return value == 127 ? INVALID_SIGNAL_VALUE : value - 25;
+}
+
+static long modem_xmonitor_rsrp(long value)
+{
+   return value == 255 ? INVALID_SIGNAL_VALUE : value - 141;
+}
+
+static long modem_xmonitor_rsrq(long value)
+{
+   return value == 127 ? INVALID_SIGNAL_VALUE : value - 40;
+}
+
+struct modem_xmonitor {
+   struct lte_network_info info;
+   int32_t status;
+   int32_t mode;
+   int16_t rsrp;
+   int16_t snr;
+   int16_t rsrq;
+   char edrx[5];
+   char act[9];
+   char tau_ext[9];
+   char tau[9];
+};
+
+// %XMONITOR: 1,"","","26201","B8C0",7,20,"01CC2B00",206,6300,42,23,"","11100000","00001000","00111000",24
+static const struct parse_field xmonitor_fields[] = {
+    PARSE_FIELD(0, PARSE_DEC, struct modem_xmonitor, status, NULL),
+    PARSE_FIELD(3, PARSE_TEXT, struct modem_xmonitor, info.provider, NULL),
+    PARSE_FIELD(4, PARSE_HEX, struct modem_xmonitor, info.tac, modem_tac),
+    PARSE_FIELD(5, PARSE_DEC, struct modem_xmonitor, mode, NULL),
+    PARSE_FIELD(6, PARSE_DEC, struct modem_xmonitor, info.band, modem_band),
+    PARSE_FIELD(7, PARSE_HEX, struct modem_xmonitor, info.cell, NULL),
+    PARSE_FIELD(9, PARSE_DEC, struct modem_xmonitor, info.earfcn, NULL),
+    PARSE_FIELD(10, PARSE_DEC, struct modem_xmonitor, rsrp, modem_xmonitor_rsrp),
+    PARSE_FIELD(11, PARSE_DEC, struct modem_xmonitor, snr, modem_snr),
+    PARSE_FIELD(12, PARSE_TEXT, struct modem_xmonitor, edrx, NULL),
+    PARSE_FIELD(13, PARSE_TEXT, struct modem_xmonitor, act, NULL),
+    PARSE_FIELD(14, PARSE_TEXT, struct modem_xmonitor, tau_ext, NULL),
+    PARSE_FIELD(15, PARSE_TEXT, struct modem_xmonitor, tau, NULL),
+    PARSE_FIELD(16, PARSE_DEC, struct modem_xmonitor, rsrq, modem_xmonitor_rsrq),
+};
+
 int modem_read_network_info(struct lte_network_info *info, bool callbacks)
 {
    int result;
    char buf[160];
+   struct modem_xmonitor xmonitor;
    struct lte_network_info temp;
    int16_t rsrp = NONE_SIGNAL_VALUE;
    int16_t rsrq = NONE_SIGNAL_VALUE;
    int16_t snr = NONE_SIGNAL_VALUE;
 
-   long value;
-   const char *cur = buf;
-   const char *n = cur;
    const char *edrx = NULL;
    const char *act = NULL;
    const char *tau_ext = NULL;
@@ -2144,13 +2254,20 @@ int modem_read_network_info(struct lte_network_info *info, bool callbacks)
    }
    LOG_INF("XMONITOR: %s", buf);
 
+   memset(&xmonitor, 0, sizeof(xmonitor));
    memset(&temp, 0, sizeof(temp));
-   n = parse_next_long(cur, 10, &value);
-   if (cur != n) {
-      switch (value) {
+   xmonitor.status = -1;
+   xmonitor.mode = -1;
+   xmonitor.rsrp = NONE_SIGNAL_VALUE;
+   xmonitor.snr = NONE_SIGNAL_VALUE;
+   xmonitor.rsrq = NONE_SIGNAL_VALUE;
+   result = parse_fields(buf, xmonitor_fields, ARRAY_SIZE(xmonitor_fields), &xmonitor);
+   if (result & 1) {
+      switch (xmonitor.status) {
          case LTE_LC_NW_REG_REGISTERED_HOME:
          case LTE_LC_NW_REG_REGISTERED_ROAMING:
-            temp.status = (enum lte_lc_nw_reg_status)value;
+            temp = xmonitor.info;
+            temp.status = (enum lte_lc_nw_reg_status)xmonitor.status;
             temp.registered = LTE_NETWORK_STATE_ON;
             break;
          case LTE_LC_NW_REG_NOT_REGISTERED:
@@ -2158,7 +2275,7 @@ int modem_read_network_info(struct lte_network_info *info, bool callbacks)
          case LTE_LC_NW_REG_REGISTRATION_DENIED:
          case LTE_LC_NW_REG_UNKNOWN:
          case LTE_LC_NW_REG_UICC_FAIL:
-            temp.status = (enum lte_lc_nw_reg_status)value;
+            temp.status = (enum lte_lc_nw_reg_status)xmonitor.status;
             temp.registered = LTE_NETWORK_STATE_OFF;
             break;
          default:
@@ -2167,155 +2284,30 @@ int modem_read_network_info(struct lte_network_info *info, bool callbacks)
             break;
       }
    }
-   if (temp.registered == LTE_NETWORK_STATE_ON && *n == ',') {
-      cur = n + 1;
-      // skip 2 parameter .
-      n = parse_next_chars(cur, ',', 2);
-      if (*n == '"') {
-         cur = n;
-         // plmn
-         LOG_DBG("PLMN> %s", cur);
-         n = parse_next_qtext(cur, '"', temp.provider, sizeof(temp.provider));
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // tac
-         LOG_DBG("TAC> %s", cur);
-         n = parse_next_long_qtext(cur, '"', 16, &value);
-         if (cur != n && 0 <= value && value < 0x10000) {
-            temp.tac = (uint16_t)value;
-         }
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // Act LTE-M/NB-IoT
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            switch (value) {
-               case LTE_LC_LTE_MODE_NONE:
-               case LTE_LC_LTE_MODE_NBIOT:
-               case LTE_LC_LTE_MODE_LTEM:
-                  temp.mode = (enum lte_lc_lte_mode)value;
-                  break;
-               default:
-                  break;
-            }
-         }
+   if (temp.registered == LTE_NETWORK_STATE_ON) {
+      switch (xmonitor.mode) {
+         case LTE_LC_LTE_MODE_NONE:
+         case LTE_LC_LTE_MODE_NBIOT:
+         case LTE_LC_LTE_MODE_LTEM:
+            temp.mode = (enum lte_lc_lte_mode)xmonitor.mode;
+            break;
+         default:
+            break;
       }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // Band
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n && 0 <= value && value < 90) {
-            temp.band = (uint8_t)value;
-         }
-      }
-      if (*n == ',') {
-         // skip ,"
-         cur = n + 1;
-         // copy 8 character cell
-         LOG_DBG("CELL> %s", cur);
-         n = parse_next_long_qtext(cur, '"', 16, &value);
-         if (cur != n) {
-            temp.cell = (uint32_t)value;
-         }
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // skip Physical Cell ID
-         n = parse_next_long(cur, 10, &value);
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // earfcn
-         LOG_DBG("EARFCN> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            temp.earfcn = (uint32_t)value;
-         }
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // rsrp
-         LOG_DBG("RSRP> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            if (value == 255) {
-               rsrp = INVALID_SIGNAL_VALUE;
-            } else {
-               rsrp = (int16_t)(value - 141);
-            }
-         }
+      rsrp = xmonitor.rsrp;
+      snr = xmonitor.snr;
+      rsrq = xmonitor.rsrq;
+      if (xmonitor.edrx[0]) {
+         edrx = xmonitor.edrx;
       }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // snr
-         LOG_DBG("SNR> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            if (value == 127) {
-               snr = INVALID_SIGNAL_VALUE;
-            } else {
-               snr = (int16_t)(value - 25);
-            }
-         }
+      if (xmonitor.act[0]) {
+         act = xmonitor.act;
       }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         LOG_DBG("eDRX> %s", cur);
-         edrx = cur;
-         t = &buf[edrx - buf]; // t = edrx
-         n = parse_next_qtext(cur, '"', t, 5);
-         if (n == cur) {
-            edrx = NULL;
-         }
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         LOG_DBG("Act> %s", cur);
-         act = cur;
-         t = &buf[act - buf];
-         n = parse_next_qtext(cur, '"', t, 9);
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // tau_ext
-         tau_ext = cur;
-         LOG_DBG("TauExt> %s", cur);
-         t = &buf[tau_ext - buf];
-         n = parse_next_qtext(cur, '"', t, 9);
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         tau = cur;
-         LOG_DBG("Tau> %s", cur);
-         t = &buf[tau - buf];
-         n = parse_next_qtext(cur, '"', t, 9);
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // snr
-         LOG_DBG("RSRQ> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            if (value == 127) {
-               rsrq = INVALID_SIGNAL_VALUE;
-            } else {
-               rsrq = (int16_t)(value - 40);
-            }
-         }
+      if (xmonitor.tau_ext[0]) {
+         tau_ext = xmonitor.tau_ext;
+      }
+      if (xmonitor.tau[0]) {
+         tau = xmonitor.tau;
       }
    }
 
@@ -2387,6 +2379,7 @@ int modem_read_network_info(struct lte_network_info *info, bool callbacks)
    temp.plmn_lock = network_info.plmn_lock;
    temp.sleeping = network_info.sleeping;
    network_info = temp;
+   status_times[MODEM_STATUS_NETWORK] = k_uptime_get();
    if (rsrp != NONE_SIGNAL_VALUE) {
       ce_info.rsrp = rsrp;
    }
@@ -2456,6 +2449,7 @@ int modem_read_pdn_info(struct lte_network_info *info)
          memcpy(network_info.apn, temp.apn, sizeof(temp.apn));
          memcpy(network_info.local_ip, temp.local_ip, sizeof(temp.local_ip));
          memcpy(network_info.local_ip6, temp.local_ip6, sizeof(temp.local_ip6));
+         status_times[MODEM_STATUS_PDN] = k_uptime_get();
          k_mutex_unlock(&lte_mutex);
          if (info) {
             info->pdn_active = temp.pdn_active;
@@ -2469,21 +2463,40 @@ int modem_read_pdn_info(struct lte_network_info *info)
    return result;
 }
 
-int modem_read_statistic(struct lte_network_statistic *statistic)
+// %XCONNSTAT: 0,0,12,8,1152,224
+static const struct parse_field xconnstat_fields[] = {
+    PARSE_FIELD(2, PARSE_DEC, struct lte_network_statistic, transmitted, NULL),
+    PARSE_FIELD(3, PARSE_DEC, struct lte_network_statistic, received, NULL),
+    PARSE_FIELD(4, PARSE_DEC, struct lte_network_statistic, max_packet_size, NULL),
+    PARSE_FIELD(5, PARSE_DEC, struct lte_network_statistic, average_packet_size, NULL),
+};
+
+static int modem_read_xconnstat(void)
 {
    int err;
    char buf[64];
+   struct lte_network_statistic temp;
 
-   memset(statistic, 0, sizeof(struct lte_network_statistic));
+   memset(&temp, 0, sizeof(temp));
    err = modem_at_cmd(buf, sizeof(buf), "%XCONNSTAT: ", "AT%XCONNSTAT?");
    if (err > 0) {
-      sscanf(buf, " %*u,%*u,%u,%u,%hu,%hu",
-             &statistic->transmitted,
-             &statistic->received,
-             &statistic->max_packet_size,
-             &statistic->average_packet_size);
+      parse_fields(buf, xconnstat_fields, ARRAY_SIZE(xconnstat_fields), &temp);
+      k_mutex_lock(&lte_mutex, K_FOREVER);
+      xconnstat = temp;
+      status_times[MODEM_STATUS_STATISTIC] = k_uptime_get();
+      k_mutex_unlock(&lte_mutex);
    }
+   return err;
+}
+
+static void modem_copy_statistic(struct lte_network_statistic *statistic)
+{
+   memset(statistic, 0, sizeof(struct lte_network_statistic));
    k_mutex_lock(&lte_mutex, K_FOREVER);
+   statistic->transmitted = xconnstat.transmitted;
+   statistic->received = xconnstat.received;
+   statistic->max_packet_size = xconnstat.max_packet_size;
+   statistic->average_packet_size = xconnstat.average_packet_size;
    statistic->searchs = lte_searchs;
    statistic->search_time = MSEC_TO_SEC(lte_search_time);
    statistic->psm_delays = lte_psm_delays;
@@ -2495,9 +2508,187 @@ int modem_read_statistic(struct lte_network_statistic *statistic)
    statistic->connected_time = MSEC_TO_SEC(lte_connected_time);
    statistic->asleep_time = MSEC_TO_SEC(lte_asleep_time);
    k_mutex_unlock(&lte_mutex);
+}
+
+int modem_read_statistic(struct lte_network_statistic *statistic)
+{
+   modem_read_xconnstat();
+   modem_copy_statistic(statistic);
+   return 0;
+}
+
+static bool modem_status_expired(enum modem_status_part part)
+{
+   int64_t age = modem_get_status_age(part);
+
+   return age < 0 || age > CONFIG_MODEM_STATUS_MAX_AGE * MSEC_PER_SEC;
+}
+
+int modem_get_statistic(struct lte_network_statistic *statistic)
+{
+   if (modem_status_expired(MODEM_STATUS_STATISTIC)) {
+      modem_read_xconnstat();
+   }
+   modem_copy_statistic(statistic);
    return 0;
 }
 
+static int modem_read_xtemp(void)
+{
+   char buf[32];
+   long value = 0;
+   int err = modem_at_cmd(buf, sizeof(buf), "%XTEMP: ", "AT%XTEMP?");
+
+   if (err > 0) {
+      const char *cur = parse_next_long(buf, 10, &value);
+      if (cur == buf) {
+         return -EINVAL;
+      }
+      k_mutex_lock(&lte_mutex, K_FOREVER);
+      xtemp = (int)value;
+      status_times[MODEM_STATUS_TEMPERATURE] = k_uptime_get();
+      k_mutex_unlock(&lte_mutex);
+   } else if (err == 0) {
+      err = -ENODATA;
+   }
+   return err;
+}
+
+int modem_get_temperature(int *temperature)
+{
+   int err = 0;
+
+   if (modem_status_expired(MODEM_STATUS_TEMPERATURE)) {
+      err = modem_read_xtemp();
+   }
+   k_mutex_lock(&lte_mutex, K_FOREVER);
+   if (status_times[MODEM_STATUS_TEMPERATURE]) {
+      *temperature = xtemp;
+      err = 0;
+   } else if (!err) {
+      err = -ENODATA;
+   }
+   k_mutex_unlock(&lte_mutex);
+   return err;
+}
+
+int64_t modem_get_status_age(enum modem_status_part part)
+{
+   int64_t age = -1;
+
+   if (part < MODEM_STATUS_PARTS) {
+      k_mutex_lock(&lte_mutex, K_FOREVER);
+      if (status_times[part]) {
+         age = k_uptime_get() - status_times[part];
+      }
+      k_mutex_unlock(&lte_mutex);
+   }
+   return age;
+}
+
+int modem_refresh_status(bool all)
+{
+   int parts = 0;
+   bool registered;
+   bool global_ip6;
+
+   if ((all || modem_status_expired(MODEM_STATUS_NETWORK)) && modem_read_network_info(NULL, false) >= 0) {
+      ++parts;
+   }
+   k_mutex_lock(&lte_mutex, K_FOREVER);
+   registered = network_info.registered == LTE_NETWORK_STATE_ON;
+   global_ip6 = !strstart(network_info.local_ip6, "0000:0000:0000:0000:", false);
+   k_mutex_unlock(&lte_mutex);
+   if (!registered) {
+      return parts;
+   }
+   /* the global IPv6 prefix is assigned after the registration */
+   if ((all || !global_ip6 || modem_status_expired(MODEM_STATUS_PDN)) && modem_read_pdn_info(NULL) > 0) {
+      ++parts;
+   }
+   if ((all || modem_status_expired(MODEM_STATUS_CE)) && modem_read_coverage_enhancement_info(NULL) >= 0) {
+      ++parts;
+   }
+   if ((all || modem_status_expired(MODEM_STATUS_STATISTIC)) && modem_read_xconnstat() > 0) {
+      ++parts;
+   }
+   if ((all || modem_status_expired(MODEM_STATUS_TEMPERATURE)) && modem_read_xtemp() > 0) {
+      ++parts;
+   }
+   return parts;
+}
+
+static void modem_refresh_status_work_fn(struct k_work *work)
+{
+   (void)work;
+   modem_refresh_status(true);
+}
+
+static K_WORK_DEFINE(modem_refresh_status_work, modem_refresh_status_work_fn);
+
+void modem_schedule_status_refresh(void)
+{
+   work_submit_to_cmd_queue(&modem_refresh_status_work);
+}
+
+static long modem_coneval_rsrp(long value)
+{
+   if (value == 255) {
+      return INVALID_SIGNAL_VALUE;
+   }
+   return value > 0 ? value - 141 : value - 140;
+}
+
+static long modem_coneval_rsrq(long value)
+{
+   if (value == 255) {
+      return INVALID_SIGNAL_VALUE;
+   } else if (value < 0) {
+      return value - 39;
+   } else if (value < 34) {
+      return value - 40;
+   }
+   return value - 41;
+}
+
+struct modem_coneval {
+   int32_t result;
+   int32_t state;
+   struct lte_ce_info info;
+};
+
+/* coneval_fields of the repetitions */
+#define CONEVAL_REPETITIONS ((1 << 5) | (1 << 6))
+
+// %CONEVAL: 0,0,7,30,16,31,"01CC2B00","26201",289,1300,3,0,0,18,1,8,122
+static const struct parse_field coneval_fields[] = {
+    PARSE_FIELD(0, PARSE_DEC, struct modem_coneval, result, NULL),
+    PARSE_FIELD(1, PARSE_DEC, struct modem_coneval, state, NULL),
+    PARSE_FIELD(3, PARSE_DEC, struct modem_coneval, info.rsrp, modem_coneval_rsrp),
+    PARSE_FIELD(4, PARSE_DEC, struct modem_coneval, info.rsrq, modem_coneval_rsrq),
+    PARSE_FIELD(5, PARSE_DEC, struct modem_coneval, info.snr, modem_snr),
+    PARSE_FIELD(14, PARSE_DEC, struct modem_coneval, info.uplink_repetition, NULL),
+    PARSE_FIELD(15, PARSE_DEC, struct modem_coneval, info.downlink_repetition, NULL),
+};
+
+/* returns the bitmask of the decoded coneval_fields, < 0, if the evaluation failed */
+static int modem_decode_coneval(const char *buf, struct lte_ce_info *info)
+{
+   struct modem_coneval coneval;
+   uint32_t decoded;
+
+   coneval.result = -1;
+   coneval.state = 0;
+   coneval.info = *info;
+   decoded = parse_fields(buf, coneval_fields, ARRAY_SIZE(coneval_fields), &coneval);
+   if (!(decoded & 1) || coneval.result != 0) {
+      return -ENODATA;
+   }
+   *info = coneval.info;
+   info->state = 1 == coneval.state ? 'C' : 'I';
+   return decoded;
+}
+
 int modem_read_coverage_enhancement_info(struct lte_ce_info *info)
 {
    int err;
@@ -2566,9 +2757,8 @@ int modem_read_coverage_enhancement_info(struct lte_ce_info *info)
          return err;
       }
 #else  /* CONFIG_MODEM_USE_CEINFO */
-   const char *cur = buf;
-   const char *n = cur;
-   long value;
+   int decoded;
+
    err = modem_at_cmd(buf, sizeof(buf), "%CONEVAl: ", "AT%CONEVAl");
 
    if (err < 0) {
@@ -2578,89 +2768,10 @@ int modem_read_coverage_enhancement_info(struct lte_ce_info *info)
    }
    LOG_INF("CONEVAl: %s", buf);
 
-   // %CONEVAL: 0,0,7,30,16,31,"01CC2B00","26201",289,1300,3,0,0,18,1,8,122
-
-   n = parse_next_long(cur, 10, &value);
-
-   if (cur != n && 0 == value && *n == ',') {
-      // success
-      cur = n + 1;
-      n = parse_next_long(cur, 10, &value);
-      temp.state = 1 == value ? 'C' : 'I';
-      // skip 1 parameter
-      n = parse_next_chars(cur, ',', 2);
-      if (*n) {
-         cur = n;
-         // rsrp
-         LOG_DBG("RSRP> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            if (value == 255) {
-               temp.rsrp = INVALID_SIGNAL_VALUE;
-            } else {
-               temp.rsrp = (int16_t)(value - 140);
-               if (value > 0) {
-                  --temp.rsrp;
-               }
-            }
-         }
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // rsrq
-         LOG_DBG("RSRQ> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            if (value == 255) {
-               temp.rsrq = INVALID_SIGNAL_VALUE;
-            } else {
-               if (value < 0) {
-                  temp.rsrq = (int16_t)(value - 39);
-               } else if (value < 34) {
-                  temp.rsrq = (int16_t)(value - 40);
-               } else {
-                  temp.rsrq = (int16_t)(value - 41);
-               }
-            }
-         }
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // snr
-         LOG_DBG("SNR> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            if (value == 127) {
-               temp.snr = INVALID_SIGNAL_VALUE;
-            } else {
-               temp.snr = (int16_t)(value - 25);
-            }
-         }
-      }
-      // skip 9 parameter
-      n = parse_next_chars(cur, ',', 9);
-      if (*n) {
-         cur = n;
-         // up_repetition
-         LOG_DBG("UP.REP> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            temp.uplink_repetition = value;
-            temp.ce_supported = 1;
-         }
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // down_repetition
-         LOG_DBG("DOWN.REP> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            temp.downlink_repetition = value;
-            temp.ce_supported = 1;
-         }
+   decoded = modem_decode_coneval(buf, &temp);
+   if (decoded >= 0) {
+      if (decoded & CONEVAL_REPETITIONS) {
+         temp.ce_supported = 1;
       }
 #endif /* CONFIG_MODEM_USE_CEINFO */
 
@@ -2686,6 +2797,7 @@ int modem_read_coverage_enhancement_info(struct lte_ce_info *info)
          }
       }
       ce_info = temp;
+      status_times[MODEM_STATUS_CE] = k_uptime_get();
       k_mutex_unlock(&lte_mutex);
       if (info) {
          *info = temp;
@@ -2698,9 +2810,6 @@ int modem_read_connection_info(struct lte_ce_info *info)
 {
    int err;
    char buf[128];
-   const char *cur = buf;
-   const char *n = cur;
-   long value;
    struct lte_ce_info temp;
 
    if (info) {
@@ -2730,89 +2839,7 @@ int modem_read_connection_info(struct lte_ce_info *info)
    }
    LOG_INF("CONEVAl: %s", buf);
 
-   // %CONEVAL: 0,0,7,30,16,31,"01CC2B00","26201",289,1300,3,0,0,18,1,8,122
-
-   n = parse_next_long(cur, 10, &value);
-
-   if (cur != n && 0 == value && *n == ',') {
-      // success
-      cur = n + 1;
-      n = parse_next_long(cur, 10, &value);
-      temp.state = 1 == value ? 'C' : 'I';
-      // skip 1 parameter
-      n = parse_next_chars(cur, ',', 2);
-      if (*n) {
-         cur = n;
-         // rsrp
-         LOG_DBG("RSRP> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            if (value == 255) {
-               temp.rsrp = INVALID_SIGNAL_VALUE;
-            } else {
-               temp.rsrp = (int16_t)(value - 140);
-               if (value > 0) {
-                  --temp.rsrp;
-               }
-            }
-         }
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // rsrq
-         LOG_DBG("RSRQ> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            if (value == 255) {
-               temp.rsrq = INVALID_SIGNAL_VALUE;
-            } else {
-               if (value < 0) {
-                  temp.rsrq = (int16_t)(value - 39);
-               } else if (value < 34) {
-                  temp.rsrq = (int16_t)(value - 40);
-               } else {
-                  temp.rsrq = (int16_t)(value - 41);
-               }
-            }
-         }
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // snr
-         LOG_DBG("SNR> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            if (value == 127) {
-               temp.snr = INVALID_SIGNAL_VALUE;
-            } else {
-               temp.snr = (int16_t)(value - 25);
-            }
-         }
-      }
-      // skip 9 parameter
-      n = parse_next_chars(cur, ',', 9);
-      if (*n) {
-         cur = n;
-         // up_repetition
-         LOG_DBG("UP.REP> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            temp.uplink_repetition = value;
-         }
-      }
-      if (*n == ',') {
-         // skip ,
-         cur = n + 1;
-         // down_repetition
-         LOG_DBG("DOWN.REP> %s", cur);
-         n = parse_next_long(cur, 10, &value);
-         if (cur != n) {
-            temp.downlink_repetition = value;
-         }
-      }
-
+   if (modem_decode_coneval(buf, &temp) >= 0) {
       k_mutex_lock(&lte_mutex, K_FOREVER);
       if (network_info.rrc_active != LTE_NETWORK_STATE_ON) {
          if (temp.downlink_repetition == 0) {
@@ -2835,6 +2862,7 @@ int modem_read_connection_info(struct lte_ce_info *info)
          }
       }
       ce_info = temp;
+      status_times[MODEM_STATUS_CE] = k_uptime_get();
       k_mutex_unlock(&lte_mutex);
       if (info) {
          *info = temp;
@@ -3358,6 +3386,34 @@ int modem_read_statistic(struct lte_network_statistic *statistic)
    return -ENODATA;
 }
 
+int modem_get_statistic(struct lte_network_statistic *statistic)
+{
+   (void)statistic;
+   return -ENODATA;
+}
+
+int64_t modem_get_status_age(enum modem_status_part part)
+{
+   (void)part;
+   return -1;
+}
+
+int modem_get_temperature(int *temperature)
+{
+   (void)temperature;
+   return -ENODATA;
+}
+
+int modem_refresh_status(bool all)
+{
+   (void)all;
+   return 0;
+}
+
+void modem_schedule_status_refresh(void)
+{
+}
+
 int modem_read_coverage_enhancement_info(struct lte_ce_info *info)
 {
    (void)info;
@@ -98,6 +98,15 @@ typedef struct lte_ce_info {
    int16_t snr;
 } lte_ce_info_t;
 
+enum modem_status_part {
+   MODEM_STATUS_NETWORK,
+   MODEM_STATUS_CE,
+   MODEM_STATUS_STATISTIC,
+   MODEM_STATUS_PDN,
+   MODEM_STATUS_TEMPERATURE,
+   MODEM_STATUS_PARTS
+};
+
 typedef struct lte_network_statistic {
    uint32_t searchs;
    uint32_t psm_delays;
@@ -207,6 +216,24 @@ int modem_read_pdn_info(struct lte_network_info *info);
 
 int modem_read_statistic(struct lte_network_statistic* statistic);
 
+/* statistic from the status snapshot, reads it from the modem, if it's too old */
+int modem_get_statistic(struct lte_network_statistic* statistic);
+
+/* age of the status snapshot part in milliseconds, -1, if not available */
+int64_t modem_get_status_age(enum modem_status_part part);
+
+/* modem temperature in °C from the status snapshot, reads it from the modem, if it's too old */
+int modem_get_temperature(int *temperature);
+
+/*
+ * Read the parts of the status snapshot older than CONFIG_MODEM_STATUS_MAX_AGE,
+ * or all parts, from the modem. Returns the number of read parts.
+ */
+int modem_refresh_status(bool all);
+
+/* refresh the status snapshot on the cmd queue after an exchange */
+void modem_schedule_status_refresh(void);
+
 int modem_read_coverage_enhancement_info(struct lte_ce_info* info);
 
 int modem_read_connection_info(struct lte_ce_info* info);
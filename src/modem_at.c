@@ -18,6 +18,7 @@
 #include <zephyr/logging/log.h>
 
 #include "appl_diagnose.h"
+#include "appl_histogram.h"
 #include "io_job_queue.h"
 #include "modem_at.h"
 #include "parse.h"
@@ -37,6 +38,8 @@ LOG_MODULE_DECLARE(MODEM, CONFIG_MODEM_LOG_LEVEL);
 static K_MUTEX_DEFINE(lte_at_mutex);
 static char lte_at_buf[INTERNAL_BUF_SIZE];
 
+APPL_HISTOGRAM_DEFINE(at_cmd, "ms");
+
 static volatile int lte_at_counter = 0;
 static volatile bool lte_at_warn = true;
 
@@ -72,13 +75,16 @@ int modem_at_cmd(char *buf, size_t len, const char *skip, const char *cmd)
 {
    int err;
    int at_len;
+   int64_t time;
 
    LOG_DBG("%s", cmd);
    err = modem_at_lock_internal();
    if (err) {
       return err;
    }
+   time = k_uptime_get();
    err = nrf_modem_at_cmd(lte_at_buf, sizeof(lte_at_buf) - 1, "%s", cmd);
+   APPL_HISTOGRAM_ADD(at_cmd, (uint32_t)(k_uptime_get() - time));
    if (err < 0) {
       if (lte_at_warn) {
          LOG_WRN(">> %s:", cmd);
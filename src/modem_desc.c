@@ -11,7 +11,7 @@
  * SPDX-License-Identifier: EPL-2.0
  */
 
-#if defined(CONFIG_NRF_MODEM_LIB)
+#if defined(CONFIG_NRF_MODEM_LIB) || defined(CONFIG_MODEM_FAKE)
 #include <modem/lte_lc.h>
 
 #include "modem_desc.h"
@@ -0,0 +1,1315 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+
+#include "appl_energy.h"
+#include "io_job_queue.h"
+#include "modem.h"
+#include "modem_at.h"
+#include "modem_desc.h"
+#include "modem_sim.h"
+#include "parse.h"
+#include "sh_cmd.h"
+
+LOG_MODULE_REGISTER(MODEM, CONFIG_MODEM_LOG_LEVEL);
+
+/*
+ * Scripted fake of modem.c, modem_at.c and modem_sim.c for native_sim.
+ * The sockets are the host's sockets, the fake only emits the modem
+ * events and keeps the status, which dtls_loop and the payload use.
+ */
+
+#define MSEC_TO_SEC(X) (((X) + (MSEC_PER_SEC / 2)) / MSEC_PER_SEC)
+
+#define FAKE_IMEI "350000000000000"
+#define FAKE_ICCID "89000000000000000000"
+#define FAKE_IMSI "001010000000000"
+#define FAKE_PLMN "00101"
+#define FAKE_APN "fake"
+#define FAKE_LOCAL_IP "127.0.0.1"
+
+/* APN rate control, reported as %APNRATECTRL: 1,0,256,86400 */
+#define FAKE_RATE_LIMIT 256
+#define FAKE_RATE_LIMIT_PERIOD 86400
+
+/* RRC release after the last transmission, if RAI is used */
+#define FAKE_RAI_LAST_RELEASE_MS 100
+#define FAKE_RAI_ONE_RESPONSE_RELEASE_MS 1000
+
+/* sleeping is only reported for longer sleeps, see LTE_LC_MODEM_SLEEP_NOTIFICATIONS_THRESHOLD_MS */
+#define FAKE_SLEEP_THRESHOLD_S 30
+
+static K_MUTEX_DEFINE(fake_mutex);
+static K_CONDVAR_DEFINE(fake_condvar_ready);
+static K_MUTEX_DEFINE(fake_at_mutex);
+static struct k_spinlock fake_lock;
+
+static sys_slist_t fake_ready_list = SYS_SLIST_STATIC_INIT(&fake_ready_list);
+static bool fake_signal_ready = false;
+
+static lte_state_change_callback_handler_t fake_state_handler = NULL;
+
+static bool fake_initialized = false;
+static bool fake_on = false;
+static bool fake_network = true;
+static bool fake_interrupt = false;
+static int fake_search_ms = 2000;
+static int fake_idle_ms = 10000;
+static int fake_network_tau = -1;
+static int fake_psm_rat = -1;
+static enum rai_mode fake_rai_mode = RAI_MODE_OFF;
+static enum lte_network_rai fake_rai_network = LTE_NETWORK_AS_RAI;
+static int fake_rai_time = -1;
+static int64_t fake_rate_limit_end = 0;
+
+static int64_t fake_search_start = 0;
+static int64_t fake_connect_start = 0;
+static int64_t fake_sleep_start = 0;
+static int64_t fake_transmission_time = 0;
+
+static uint32_t fake_starts = 0;
+static uint32_t fake_searchs = 0;
+static uint32_t fake_wakeups = 0;
+static int64_t fake_search_time = 0;
+static int64_t fake_connected_time = 0;
+static int64_t fake_asleep_time = 0;
+
+static struct lte_network_info network_info;
+static struct lte_ce_info ce_info = {
+    .rsrp = INVALID_SIGNAL_VALUE,
+    .rsrq = INVALID_SIGNAL_VALUE,
+    .cinr = INVALID_SIGNAL_VALUE,
+    .snr = INVALID_SIGNAL_VALUE};
+static struct lte_lc_psm_cfg psm_status = {.tau = 0, .active_time = -1};
+static struct lte_lc_edrx_cfg edrx_status = {.mode = LTE_LC_LTE_MODE_NONE};
+
+static const char *fake_script = CONFIG_MODEM_FAKE_SCRIPT;
+static char fake_script_event[32];
+
+struct modem_state_change_callback {
+   struct k_work work;
+   enum lte_state_type type;
+   bool active;
+};
+
+static void modem_state_change_callback_work_fn(struct k_work *work)
+{
+   lte_state_change_callback_handler_t callback = fake_state_handler;
+   if (callback) {
+      struct modem_state_change_callback *call = CONTAINER_OF(work, struct modem_state_change_callback, work);
+      callback(call->type, call->active);
+   }
+}
+
+#define MODEM_STATE_CHANGE(WORK, E, A)                                  \
+   struct modem_state_change_callback WORK = {                          \
+       .work = Z_WORK_INITIALIZER(modem_state_change_callback_work_fn), \
+       .type = E,                                                       \
+       .active = A}
+
+static MODEM_STATE_CHANGE(modem_on_callback_work, LTE_STATE_ON, true);
+static MODEM_STATE_CHANGE(modem_off_callback_work, LTE_STATE_ON, false);
+static MODEM_STATE_CHANGE(modem_registered_callback_work, LTE_STATE_REGISTRATION, true);
+static MODEM_STATE_CHANGE(modem_unregistered_callback_work, LTE_STATE_REGISTRATION, false);
+static MODEM_STATE_CHANGE(modem_ready_callback_work, LTE_STATE_READY, true);
+static MODEM_STATE_CHANGE(modem_not_ready_callback_work, LTE_STATE_READY, false);
+static MODEM_STATE_CHANGE(modem_connected_callback_work, LTE_STATE_CONNECTED, true);
+static MODEM_STATE_CHANGE(modem_unconnected_callback_work, LTE_STATE_CONNECTED, false);
+static MODEM_STATE_CHANGE(modem_power_management_resume_work, LTE_STATE_SLEEPING, false);
+static MODEM_STATE_CHANGE(modem_power_management_suspend_work, LTE_STATE_SLEEPING, true);
+static MODEM_STATE_CHANGE(modem_psm_active_work, LTE_STATE_PSM_ACTIVE, true);
+static MODEM_STATE_CHANGE(modem_psm_inactive_work, LTE_STATE_PSM_ACTIVE, false);
+
+#define MODEM_STATE_CHANGE_CALLBACK(CHANGE) work_submit_to_io_queue(&((CHANGE)->work))
+
+static struct k_work *modem_fake_ready_get_next_work(void)
+{
+   sys_snode_t *node = sys_slist_get(&fake_ready_list);
+   if (node) {
+      return CONTAINER_OF(node, struct k_work, node);
+   }
+   return NULL;
+}
+
+static void modem_fake_ready_work_fn(struct k_work *work)
+{
+   struct k_work *work_on_ready = NULL;
+   lte_state_change_callback_handler_t callback = fake_state_handler;
+
+   if (callback) {
+      callback(LTE_STATE_READY_1S, true);
+   }
+   K_SPINLOCK(&fake_lock)
+   {
+      fake_signal_ready = true;
+      while ((work_on_ready = modem_fake_ready_get_next_work())) {
+         work_submit_to_io_queue(work_on_ready);
+      }
+   }
+}
+
+static K_WORK_DELAYABLE_DEFINE(modem_fake_ready_work, modem_fake_ready_work_fn);
+
+/* requires fake_mutex, returns true, if PSM gets active or inactive */
+static bool modem_fake_update_psm(void)
+{
+   bool active = psm_status.active_time >= 0;
+
+   if (fake_network_tau >= 0 && fake_psm_rat >= 0) {
+      psm_status.tau = fake_network_tau;
+      psm_status.active_time = fake_psm_rat;
+   } else {
+      psm_status.tau = 0;
+      psm_status.active_time = -1;
+   }
+   return active != (psm_status.active_time >= 0);
+}
+
+static void modem_fake_psm_changed(bool active)
+{
+   if (active) {
+      MODEM_STATE_CHANGE_CALLBACK(&modem_psm_active_work);
+   } else {
+      MODEM_STATE_CHANGE_CALLBACK(&modem_psm_inactive_work);
+   }
+}
+
+/* requires fake_mutex */
+static int modem_fake_release_delay(void)
+{
+   if (fake_rai_network != LTE_NETWORK_NO_RAI) {
+      if (fake_rai_mode == RAI_MODE_LAST) {
+         return FAKE_RAI_LAST_RELEASE_MS;
+      } else if (fake_rai_mode == RAI_MODE_ONE_RESPONSE) {
+         return FAKE_RAI_ONE_RESPONSE_RELEASE_MS;
+      }
+   }
+   return fake_idle_ms;
+}
+
+static void modem_fake_sleep_work_fn(struct k_work *work)
+{
+   bool sleep = false;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (network_info.registered == LTE_NETWORK_STATE_ON &&
+       network_info.rrc_active != LTE_NETWORK_STATE_ON &&
+       network_info.sleeping != LTE_NETWORK_STATE_ON &&
+       psm_status.active_time >= 0 && psm_status.tau > FAKE_SLEEP_THRESHOLD_S) {
+      network_info.sleeping = LTE_NETWORK_STATE_ON;
+      fake_sleep_start = k_uptime_get();
+      sleep = true;
+   }
+   k_mutex_unlock(&fake_mutex);
+   if (sleep) {
+      LOG_INF("Modem sleeping, PSM");
+      MODEM_STATE_CHANGE_CALLBACK(&modem_power_management_suspend_work);
+   }
+}
+
+static K_WORK_DELAYABLE_DEFINE(modem_fake_sleep_work, modem_fake_sleep_work_fn);
+
+static void modem_fake_release_work_fn(struct k_work *work)
+{
+   int64_t now = k_uptime_get();
+   int64_t time = 0;
+   int active_time = -1;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (network_info.rrc_active != LTE_NETWORK_STATE_ON) {
+      k_mutex_unlock(&fake_mutex);
+      return;
+   }
+   network_info.rrc_active = LTE_NETWORK_STATE_OFF;
+   time = now - fake_connect_start;
+   fake_connected_time += time;
+   fake_rai_time = (int)(now - fake_transmission_time);
+   active_time = psm_status.active_time;
+   k_mutex_unlock(&fake_mutex);
+
+   appl_energy_add(APPL_ENERGY_CONNECTED, time);
+   LOG_INF("RRC mode: Idle after %lld ms (%d ms inactivity)", time, fake_rai_time);
+   MODEM_STATE_CHANGE_CALLBACK(&modem_unconnected_callback_work);
+   if (active_time >= 0) {
+      work_reschedule_for_io_queue(&modem_fake_sleep_work, K_SECONDS(active_time));
+   }
+}
+
+static K_WORK_DELAYABLE_DEFINE(modem_fake_release_work, modem_fake_release_work_fn);
+
+/* radio activity, wakes up from PSM and connects RRC */
+static void modem_fake_activity(void)
+{
+   int64_t now = k_uptime_get();
+   int64_t sleep_time = -1;
+   bool connect = false;
+   int release;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (network_info.registered != LTE_NETWORK_STATE_ON) {
+      k_mutex_unlock(&fake_mutex);
+      return;
+   }
+   if (network_info.sleeping == LTE_NETWORK_STATE_ON) {
+      network_info.sleeping = LTE_NETWORK_STATE_OFF;
+      sleep_time = now - fake_sleep_start;
+      fake_asleep_time += sleep_time;
+   }
+   if (network_info.rrc_active != LTE_NETWORK_STATE_ON) {
+      network_info.rrc_active = LTE_NETWORK_STATE_ON;
+      fake_connect_start = now;
+      ++fake_wakeups;
+      connect = true;
+   }
+   fake_transmission_time = now;
+   release = modem_fake_release_delay();
+   k_mutex_unlock(&fake_mutex);
+
+   k_work_cancel_delayable(&modem_fake_sleep_work);
+   if (sleep_time >= 0) {
+      appl_energy_add(APPL_ENERGY_PSM, sleep_time);
+      LOG_INF("Modem wakeup after %lld ms", sleep_time);
+      MODEM_STATE_CHANGE_CALLBACK(&modem_power_management_resume_work);
+   }
+   if (connect) {
+      LOG_INF("RRC mode: Connected");
+      MODEM_STATE_CHANGE_CALLBACK(&modem_connected_callback_work);
+   }
+   work_reschedule_for_io_queue(&modem_fake_release_work, K_MSEC(release));
+}
+
+static void modem_fake_register_work_fn(struct k_work *work)
+{
+   int64_t now = k_uptime_get();
+   int64_t time = 0;
+   bool psm = false;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (!fake_on || !fake_network || network_info.registered == LTE_NETWORK_STATE_ON) {
+      k_mutex_unlock(&fake_mutex);
+      return;
+   }
+   time = now - fake_search_start;
+   fake_search_time += time;
+   network_info.registered = LTE_NETWORK_STATE_ON;
+   network_info.pdn_active = LTE_NETWORK_STATE_ON;
+   network_info.rrc_active = LTE_NETWORK_STATE_OFF;
+   network_info.sleeping = LTE_NETWORK_STATE_OFF;
+   network_info.status = LTE_LC_NW_REG_REGISTERED_HOME;
+   network_info.mode = LTE_LC_LTE_MODE_LTEM;
+   network_info.band = 20;
+   network_info.tac = 1;
+   network_info.cell = 1;
+   network_info.earfcn = 6300;
+   strncpy(network_info.provider, FAKE_PLMN, sizeof(network_info.provider) - 1);
+   strncpy(network_info.apn, FAKE_APN, sizeof(network_info.apn) - 1);
+   strncpy(network_info.local_ip, FAKE_LOCAL_IP, sizeof(network_info.local_ip) - 1);
+   ce_info.rsrp = -90;
+   ce_info.snr = 20;
+   if (edrx_status.mode != LTE_LC_LTE_MODE_NONE) {
+      edrx_status.mode = network_info.mode;
+   }
+   modem_fake_update_psm();
+   psm = psm_status.active_time >= 0;
+   k_condvar_broadcast(&fake_condvar_ready);
+   k_mutex_unlock(&fake_mutex);
+
+   appl_energy_add(APPL_ENERGY_SEARCH, time);
+   LOG_INF("Network registered in %lld ms", time);
+   MODEM_STATE_CHANGE_CALLBACK(&modem_registered_callback_work);
+   MODEM_STATE_CHANGE_CALLBACK(&modem_ready_callback_work);
+   if (psm) {
+      MODEM_STATE_CHANGE_CALLBACK(&modem_psm_active_work);
+   }
+   work_reschedule_for_io_queue(&modem_fake_ready_work, K_SECONDS(1));
+   /* the attach is a RRC connection as well */
+   modem_fake_activity();
+}
+
+static K_WORK_DELAYABLE_DEFINE(modem_fake_register_work, modem_fake_register_work_fn);
+
+static void modem_fake_unregister(void)
+{
+   int64_t now = k_uptime_get();
+   int64_t connected_time = -1;
+   bool registered = false;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   registered = network_info.registered == LTE_NETWORK_STATE_ON;
+   if (network_info.rrc_active == LTE_NETWORK_STATE_ON) {
+      connected_time = now - fake_connect_start;
+      fake_connected_time += connected_time;
+   }
+   if (network_info.sleeping == LTE_NETWORK_STATE_ON) {
+      fake_asleep_time += now - fake_sleep_start;
+   }
+   network_info.registered = LTE_NETWORK_STATE_OFF;
+   network_info.pdn_active = LTE_NETWORK_STATE_OFF;
+   network_info.rrc_active = LTE_NETWORK_STATE_OFF;
+   network_info.sleeping = LTE_NETWORK_STATE_OFF;
+   network_info.status = fake_on ? LTE_LC_NW_REG_SEARCHING : LTE_LC_NW_REG_NOT_REGISTERED;
+   ce_info.rsrp = INVALID_SIGNAL_VALUE;
+   ce_info.snr = INVALID_SIGNAL_VALUE;
+   if (registered && fake_on) {
+      ++fake_searchs;
+      fake_search_start = now;
+   }
+   k_mutex_unlock(&fake_mutex);
+
+   k_work_cancel_delayable(&modem_fake_release_work);
+   k_work_cancel_delayable(&modem_fake_sleep_work);
+   k_work_cancel_delayable(&modem_fake_ready_work);
+   K_SPINLOCK(&fake_lock)
+   {
+      fake_signal_ready = false;
+   }
+   if (connected_time >= 0) {
+      appl_energy_add(APPL_ENERGY_CONNECTED, connected_time);
+      MODEM_STATE_CHANGE_CALLBACK(&modem_unconnected_callback_work);
+   }
+   if (registered) {
+      LOG_INF("Network unregistered");
+      MODEM_STATE_CHANGE_CALLBACK(&modem_not_ready_callback_work);
+      MODEM_STATE_CHANGE_CALLBACK(&modem_unregistered_callback_work);
+   }
+}
+
+static int modem_fake_switch(bool on)
+{
+   int64_t now = k_uptime_get();
+   bool changed = false;
+   bool network = false;
+   int delay = 0;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   changed = fake_on != on;
+   fake_on = on;
+   if (changed && on) {
+      ++fake_starts;
+      ++fake_searchs;
+      fake_search_start = now;
+      network_info.status = LTE_LC_NW_REG_SEARCHING;
+   }
+   network = fake_network;
+   delay = fake_search_ms;
+   k_mutex_unlock(&fake_mutex);
+
+   if (changed) {
+      if (on) {
+         LOG_INF("Modem on");
+         MODEM_STATE_CHANGE_CALLBACK(&modem_on_callback_work);
+         if (network) {
+            work_reschedule_for_io_queue(&modem_fake_register_work, K_MSEC(delay));
+         }
+      } else {
+         k_work_cancel_delayable(&modem_fake_register_work);
+         modem_fake_unregister();
+         LOG_INF("Modem off");
+         MODEM_STATE_CHANGE_CALLBACK(&modem_off_callback_work);
+      }
+   }
+   return 0;
+}
+
+static int modem_fake_event(const char *event)
+{
+   char name[8];
+   char value[8];
+   long value1 = -1;
+   long value2 = -1;
+   const char *cur = event;
+   bool off = false;
+   bool psm_changed = false;
+   bool psm = false;
+
+   memset(name, 0, sizeof(name));
+   memset(value, 0, sizeof(value));
+   cur = parse_next_text(cur, ' ', name, sizeof(name));
+   parse_next_text(cur, ' ', value, sizeof(value));
+   cur = parse_next_long(cur, 10, &value1);
+   parse_next_long(cur, 10, &value2);
+   off = !stricmp("off", value);
+
+   LOG_INF("Modem event: %s", event);
+   if (!stricmp("reg", name)) {
+      bool on = false;
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      fake_network = true;
+      on = fake_on;
+      k_mutex_unlock(&fake_mutex);
+      if (on) {
+         work_reschedule_for_io_queue(&modem_fake_register_work, K_NO_WAIT);
+      }
+   } else if (!stricmp("unreg", name)) {
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      fake_network = false;
+      k_mutex_unlock(&fake_mutex);
+      k_work_cancel_delayable(&modem_fake_register_work);
+      modem_fake_unregister();
+   } else if (!stricmp("search", name) && value1 >= 0) {
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      fake_search_ms = (int)value1;
+      k_mutex_unlock(&fake_mutex);
+   } else if (!stricmp("idle", name) && value1 >= 0) {
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      fake_idle_ms = (int)value1;
+      k_mutex_unlock(&fake_mutex);
+   } else if (!stricmp("psm", name) && (off || value1 >= 0)) {
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      fake_network_tau = off ? -1 : (int)value1;
+      psm_changed = modem_fake_update_psm() && network_info.registered == LTE_NETWORK_STATE_ON;
+      psm = psm_status.active_time >= 0;
+      k_mutex_unlock(&fake_mutex);
+      if (psm_changed) {
+         modem_fake_psm_changed(psm);
+      }
+   } else if (!stricmp("edrx", name) && (off || value1 >= 0)) {
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      if (off) {
+         edrx_status.mode = LTE_LC_LTE_MODE_NONE;
+      } else {
+         edrx_status.mode = LTE_LC_LTE_MODE_LTEM;
+         edrx_status.edrx = (float)value1;
+         edrx_status.ptw = value2 > 0 ? (float)value2 : 0.0F;
+      }
+      k_mutex_unlock(&fake_mutex);
+   } else if (!stricmp("rai", name) && value[0]) {
+      enum lte_network_rai rai = LTE_NETWORK_RAI_UNKNOWN;
+      if (!stricmp("none", value)) {
+         rai = LTE_NETWORK_NO_RAI;
+      } else if (!stricmp("cp", value)) {
+         rai = LTE_NETWORK_CP_RAI;
+      } else if (!stricmp("as", value)) {
+         rai = LTE_NETWORK_AS_RAI;
+      } else {
+         return -EINVAL;
+      }
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      fake_rai_network = rai;
+      k_mutex_unlock(&fake_mutex);
+   } else if (!stricmp("rate", name) && value1 >= 0) {
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      if (value1 > 0) {
+         fake_rate_limit_end = k_uptime_get() + value1 * MSEC_PER_SEC;
+         network_info.rate_limit = FAKE_RATE_LIMIT;
+         network_info.rate_limit_period = FAKE_RATE_LIMIT_PERIOD;
+         network_info.rate_limit_time = (uint32_t)value1;
+      } else {
+         fake_rate_limit_end = 0;
+         network_info.rate_limit = 0;
+         network_info.rate_limit_period = 0;
+         network_info.rate_limit_time = 0;
+      }
+      k_mutex_unlock(&fake_mutex);
+   } else {
+      LOG_INF("Modem event '%s' not supported.", event);
+      return -EINVAL;
+   }
+   return 0;
+}
+
+static void modem_fake_script_next(void);
+
+static void modem_fake_script_work_fn(struct k_work *work)
+{
+   modem_fake_event(fake_script_event);
+   modem_fake_script_next();
+}
+
+static K_WORK_DELAYABLE_DEFINE(modem_fake_script_work, modem_fake_script_work_fn);
+
+static void modem_fake_script_next(void)
+{
+   char entry[48];
+   long delay = 0;
+   const char *cur = NULL;
+
+   while (*fake_script) {
+      memset(entry, 0, sizeof(entry));
+      fake_script = parse_next_text(fake_script, ';', entry, sizeof(entry));
+      if (!entry[0]) {
+         continue;
+      }
+      cur = parse_next_long(entry, 10, &delay);
+      if (cur == entry || delay < 0) {
+         LOG_WRN("Modem script: invalid entry '%s'", entry);
+         continue;
+      }
+      while (*cur == ' ') {
+         ++cur;
+      }
+      strncpy(fake_script_event, cur, sizeof(fake_script_event) - 1);
+      work_schedule_for_io_queue(&modem_fake_script_work, K_MSEC(delay));
+      return;
+   }
+}
+
+int modem_init(int config, lte_state_change_callback_handler_t state_handler)
+{
+   ARG_UNUSED(config);
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (fake_initialized) {
+      k_mutex_unlock(&fake_mutex);
+      return 0;
+   }
+   fake_initialized = true;
+   fake_state_handler = state_handler;
+   network_info.status = LTE_LC_NW_REG_NOT_REGISTERED;
+   k_mutex_unlock(&fake_mutex);
+
+   LOG_INF("Fake modem, script '%s'", CONFIG_MODEM_FAKE_SCRIPT);
+   modem_fake_script_next();
+   return 0;
+}
+
+int modem_reinit(bool lib)
+{
+   ARG_UNUSED(lib);
+   return 0;
+}
+
+int modem_start(const k_timeout_t timeout, bool save)
+{
+   int64_t time;
+   int err;
+
+   ARG_UNUSED(save);
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   fake_rai_time = -1;
+   k_mutex_unlock(&fake_mutex);
+
+   modem_fake_switch(true);
+   time = k_uptime_get();
+   err = modem_wait_ready(timeout);
+   time = k_uptime_get() - time;
+   if (!err) {
+      LOG_INF("LTE attached in %ld [ms]", (long)time);
+   } else {
+      LOG_INF("LTE attachment failed, %ld [ms]", (long)time);
+   }
+   return err;
+}
+
+int modem_start_search(void)
+{
+   LOG_INF("Modem starts search.");
+   return 0;
+}
+
+int modem_wait_ready(const k_timeout_t timeout)
+{
+   int err = 0;
+   int64_t timeout_ms = k_ticks_to_ms_floor64(timeout.ticks);
+   int64_t start = k_uptime_get();
+   int64_t left = 0;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   fake_interrupt = false;
+   while (network_info.registered != LTE_NETWORK_STATE_ON) {
+      left = timeout_ms - (k_uptime_get() - start);
+      if (fake_interrupt) {
+         err = -EINPROGRESS;
+         break;
+      } else if (left <= 0) {
+         err = -1;
+         break;
+      }
+      k_condvar_wait(&fake_condvar_ready, &fake_mutex, K_MSEC(left));
+   }
+   k_mutex_unlock(&fake_mutex);
+   LOG_INF("Modem network %sconnected in %ld s", err ? "not " : "", (long)MSEC_TO_SEC(k_uptime_get() - start));
+   return err;
+}
+
+bool modem_on_ready(struct k_work *work)
+{
+   bool res = false;
+
+   K_SPINLOCK(&fake_lock)
+   {
+      if (fake_signal_ready) {
+         res = true;
+         work_submit_to_io_queue(work);
+      } else {
+         k_work_cancel(work);
+         sys_slist_append(&fake_ready_list, &work->node);
+      }
+   }
+   return res;
+}
+
+void modem_interrupt_wait(void)
+{
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   fake_interrupt = true;
+   k_condvar_broadcast(&fake_condvar_ready);
+   k_mutex_unlock(&fake_mutex);
+}
+
+int modem_get_power_state(enum lte_power_state *state)
+{
+   int res = 0;
+
+   if (state) {
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      if (!fake_on) {
+         *state = LTE_POWER_STATE_OFF;
+      } else if (network_info.sleeping == LTE_NETWORK_STATE_ON) {
+         *state = LTE_POWER_STATE_SLEEPING;
+      } else if (network_info.rrc_active == LTE_NETWORK_STATE_ON) {
+         *state = LTE_POWER_STATE_ACTIVE;
+      } else if (network_info.rrc_active == LTE_NETWORK_STATE_OFF) {
+         *state = LTE_POWER_STATE_IDLE;
+      } else {
+         res = -ENODATA;
+      }
+      k_mutex_unlock(&fake_mutex);
+   }
+   return res;
+}
+
+bool modem_set_preference(enum preference_mode mode)
+{
+   ARG_UNUSED(mode);
+   return false;
+}
+
+bool modem_uses_preference(void)
+{
+   return false;
+}
+
+int modem_get_recv_interval_ms(void)
+{
+   int res = -ENODATA;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (0 > psm_status.active_time) {
+      if (LTE_LC_LTE_MODE_NONE == edrx_status.mode) {
+         res = 2560;
+      } else {
+         res = (int)(edrx_status.edrx * MSEC_PER_SEC);
+      }
+   }
+   k_mutex_unlock(&fake_mutex);
+   return res;
+}
+
+int modem_get_edrx_status(struct lte_lc_edrx_cfg *edrx)
+{
+   int res = 0;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (edrx) {
+      *edrx = edrx_status;
+   }
+#ifndef CONFIG_UDP_EDRX_ENABLE
+   if (LTE_LC_LTE_MODE_NONE == edrx_status.mode) {
+      res = -ENODATA;
+   }
+#endif
+   k_mutex_unlock(&fake_mutex);
+   return res;
+}
+
+int modem_get_psm_status(struct lte_lc_psm_cfg *psm)
+{
+   int res = 0;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (psm) {
+      *psm = psm_status;
+   }
+#ifndef CONFIG_UDP_PSM_ENABLE
+   if (psm_status.active_time < 0) {
+      res = -ENODATA;
+   }
+#endif
+   k_mutex_unlock(&fake_mutex);
+   return res;
+}
+
+int modem_get_rai_status(enum lte_network_rai *rai)
+{
+   enum lte_network_rai state = LTE_NETWORK_RAI_UNKNOWN;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (network_info.registered == LTE_NETWORK_STATE_ON) {
+      state = fake_rai_network;
+   }
+   k_mutex_unlock(&fake_mutex);
+   if (rai) {
+      *rai = state;
+   }
+   return state == LTE_NETWORK_RAI_UNKNOWN ? -ENODATA : 0;
+}
+
+int modem_get_network_info(struct lte_network_info *info)
+{
+   if (info) {
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      *info = network_info;
+      k_mutex_unlock(&fake_mutex);
+   }
+   return 0;
+}
+
+int modem_get_mcc(char *mcc)
+{
+   if (mcc) {
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      strncpy(mcc, network_info.provider, 3);
+      k_mutex_unlock(&fake_mutex);
+   }
+   return 0;
+}
+
+int modem_get_coverage_enhancement_info(struct lte_ce_info *info)
+{
+   if (info) {
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      *info = ce_info;
+      k_mutex_unlock(&fake_mutex);
+   }
+   return 0;
+}
+
+int modem_get_modem_info(struct lte_modem_info *info)
+{
+   if (info) {
+      memset(info, 0, sizeof(struct lte_modem_info));
+      strncpy(info->version, "fake", sizeof(info->version) - 1);
+      strncpy(info->firmware, "fake", sizeof(info->firmware) - 1);
+      strncpy(info->imei, FAKE_IMEI, sizeof(info->imei) - 1);
+   }
+   return 0;
+}
+
+int modem_get_imei(char *buf, size_t len)
+{
+   if (buf && len) {
+      --len;
+      strncpy(buf, FAKE_IMEI, len);
+      buf[len] = 0;
+   }
+   return strlen(FAKE_IMEI);
+}
+
+int modem_get_release_time(void)
+{
+   return fake_rai_time;
+}
+
+int modem_get_time_scale(void)
+{
+   /* no repetitions, good signal */
+   return 100;
+}
+
+void modem_set_transmission_time(void)
+{
+   modem_fake_activity();
+}
+
+void modem_set_scan_time(void)
+{
+}
+
+int modem_read_network_info(struct lte_network_info *info, bool callbacks)
+{
+   ARG_UNUSED(callbacks);
+   return modem_get_network_info(info);
+}
+
+int modem_read_pdn_info(struct lte_network_info *info)
+{
+   int res = 0;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (info) {
+      info->pdn_active = network_info.pdn_active;
+      memcpy(info->apn, network_info.apn, sizeof(info->apn));
+      memcpy(info->local_ip, network_info.local_ip, sizeof(info->local_ip));
+      memcpy(info->local_ip6, network_info.local_ip6, sizeof(info->local_ip6));
+   }
+   res = network_info.pdn_active == LTE_NETWORK_STATE_ON ? 1 : 0;
+   k_mutex_unlock(&fake_mutex);
+   return res;
+}
+
+int modem_read_statistic(struct lte_network_statistic *statistic)
+{
+   return modem_get_statistic(statistic);
+}
+
+int modem_get_statistic(struct lte_network_statistic *statistic)
+{
+   memset(statistic, 0, sizeof(struct lte_network_statistic));
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   statistic->searchs = fake_searchs;
+   statistic->search_time = MSEC_TO_SEC(fake_search_time);
+   statistic->restarts = fake_starts > 0 ? fake_starts - 1 : 0;
+   statistic->wakeups = fake_wakeups;
+   statistic->connected_time = MSEC_TO_SEC(fake_connected_time);
+   statistic->asleep_time = MSEC_TO_SEC(fake_asleep_time);
+   k_mutex_unlock(&fake_mutex);
+   return 0;
+}
+
+int64_t modem_get_status_age(enum modem_status_part part)
+{
+   /* the status is always current */
+   return part < MODEM_STATUS_PARTS ? 0 : -1;
+}
+
+int modem_get_temperature(int *temperature)
+{
+   ARG_UNUSED(temperature);
+   return -ENODATA;
+}
+
+int modem_refresh_status(bool all)
+{
+   ARG_UNUSED(all);
+   return 0;
+}
+
+void modem_schedule_status_refresh(void)
+{
+}
+
+int modem_read_coverage_enhancement_info(struct lte_ce_info *info)
+{
+   return modem_get_coverage_enhancement_info(info);
+}
+
+int modem_read_connection_info(struct lte_ce_info *info)
+{
+   return modem_get_coverage_enhancement_info(info);
+}
+
+int modem_read_rate_limit_time(uint32_t *time)
+{
+   uint32_t rate_limit_time = 0;
+   int64_t now = k_uptime_get();
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   if (fake_rate_limit_end > now) {
+      rate_limit_time = (uint32_t)MSEC_TO_SEC(fake_rate_limit_end - now);
+   }
+   network_info.rate_limit_time = rate_limit_time;
+   k_mutex_unlock(&fake_mutex);
+   if (rate_limit_time) {
+      LOG_INF("APNRATECTRL STATUS: 0,0,0,%u", rate_limit_time);
+   }
+   if (time) {
+      *time = rate_limit_time;
+   }
+   return rate_limit_time ? 1 : 0;
+}
+
+int modem_set_reduced_mobility(int mode)
+{
+   ARG_UNUSED(mode);
+   return -ENOTSUP;
+}
+
+int modem_get_reduced_mobility(void)
+{
+   return -ENOTSUP;
+}
+
+int modem_set_power_level(int mode)
+{
+   ARG_UNUSED(mode);
+   return -ENOTSUP;
+}
+
+int modem_get_power_level(void)
+{
+   return -ENOTSUP;
+}
+
+int modem_set_power_indication(int mode)
+{
+   ARG_UNUSED(mode);
+   return -ENOTSUP;
+}
+
+int modem_set_psm_for_connect(void)
+{
+#ifdef CONFIG_UDP_PSM_ENABLE
+   return modem_set_psm(CONFIG_UDP_PSM_CONNECT_RAT, K_SECONDS(5));
+#else
+   return 0;
+#endif
+}
+
+int modem_set_psm(int16_t active_time_s, const k_timeout_t timeout)
+{
+#ifdef CONFIG_UDP_PSM_ENABLE
+   bool changed = false;
+   bool psm = false;
+
+   ARG_UNUSED(timeout);
+
+   if (active_time_s < -1) {
+      active_time_s = -1;
+   }
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   fake_psm_rat = active_time_s;
+   changed = modem_fake_update_psm() && network_info.registered == LTE_NETWORK_STATE_ON;
+   psm = psm_status.active_time >= 0;
+   k_mutex_unlock(&fake_mutex);
+   if (active_time_s < 0) {
+      LOG_INF("PSM disable");
+   } else {
+      LOG_INF("PSM enable, act: %d s", active_time_s);
+   }
+   if (changed) {
+      modem_fake_psm_changed(psm);
+   }
+#else
+   ARG_UNUSED(active_time_s);
+   ARG_UNUSED(timeout);
+#endif
+   return 0;
+}
+
+int modem_set_rai_mode(enum rai_mode mode, int socket)
+{
+   ARG_UNUSED(socket);
+
+#if defined(CONFIG_CP_RAI_ON) || defined(CONFIG_AS_RAI_ON)
+   if (mode == RAI_MODE_NOW) {
+      bool release = false;
+
+      k_mutex_lock(&fake_mutex, K_FOREVER);
+      release = network_info.rrc_active == LTE_NETWORK_STATE_ON &&
+                fake_rai_network != LTE_NETWORK_NO_RAI;
+      k_mutex_unlock(&fake_mutex);
+      if (release) {
+         work_reschedule_for_io_queue(&modem_fake_release_work, K_MSEC(FAKE_RAI_LAST_RELEASE_MS));
+      }
+      return 0;
+   }
+#else
+   mode = RAI_MODE_OFF;
+#endif
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   fake_rai_mode = mode;
+   k_mutex_unlock(&fake_mutex);
+   /*
+    * dtls_loop calls this before each sendto. The only other call,
+    * on closing the socket, is followed by a reopen and a send.
+    */
+   modem_fake_activity();
+   return 0;
+}
+
+int modem_set_edrx(int16_t edrx_time_s)
+{
+   LOG_INF("eDRX request %d s, granted by script only", edrx_time_s);
+   return 0;
+}
+
+int modem_set_ptw(int16_t ptw_time_s)
+{
+   ARG_UNUSED(ptw_time_s);
+   return 0;
+}
+
+void modem_lock_psm(bool on)
+{
+   ARG_UNUSED(on);
+}
+
+void modem_lock_rai(bool on)
+{
+   ARG_UNUSED(on);
+}
+
+void modem_lock_plmn(bool on)
+{
+   ARG_UNUSED(on);
+}
+
+int modem_get_last_neighbor_cell_meas(char *buf, size_t len)
+{
+   ARG_UNUSED(len);
+   if (buf) {
+      buf[0] = 0;
+   }
+   return 0;
+}
+
+int modem_clear_last_neighbor_cell_meas(void)
+{
+   return 0;
+}
+
+int modem_get_edrx_multiplier(int edrx_code)
+{
+   ARG_UNUSED(edrx_code);
+   return 0;
+}
+
+int modem_print_edrx(const char *desc, struct lte_lc_edrx_cfg *edrx_cfg, char *buf, size_t len)
+{
+   const char *sep = (*desc == 0 || strend(desc, " ", false)) ? "" : " ";
+   const char *mode = NULL;
+   switch (edrx_cfg->mode) {
+      case LTE_LC_LTE_MODE_NONE:
+         return snprintf(buf, len, "eDRX %s%sdisabled.", desc, sep);
+      case LTE_LC_LTE_MODE_LTEM:
+         mode = "CAT-M1";
+         break;
+      case LTE_LC_LTE_MODE_NBIOT:
+         mode = "NB-IoT";
+         break;
+      default:
+         return snprintf(buf, len, "eDRX %s%sunknown.", desc, sep);
+   }
+   if (mode != NULL) {
+      if (edrx_cfg->edrx < 1.0F) {
+         return snprintf(buf, len, "eDRX %s%s%s disabled.", desc, sep, mode);
+      } else if (edrx_cfg->ptw < 1.0F) {
+         return snprintf(buf, len, "eDRX %s%s%s %.2fs", desc, sep, mode, (double)edrx_cfg->edrx);
+      } else {
+         return snprintf(buf, len, "eDRX %s%s%s %.2fs, ptw %.2fs", desc, sep, mode, (double)edrx_cfg->edrx, (double)edrx_cfg->ptw);
+      }
+   }
+   return 0;
+}
+
+int modem_factory_reset(void)
+{
+   return 0;
+}
+
+int modem_at_lock(const k_timeout_t timeout)
+{
+   return k_mutex_lock(&fake_at_mutex, timeout) ? -EBUSY : 0;
+}
+
+int modem_at_lock_no_warn(const k_timeout_t timeout)
+{
+   return modem_at_lock(timeout);
+}
+
+int modem_at_unlock(void)
+{
+   return k_mutex_unlock(&fake_at_mutex);
+}
+
+int modem_at_cmdf(char *buf, size_t len, const char *skip, const char *cmd, ...)
+{
+   ARG_UNUSED(buf);
+   ARG_UNUSED(len);
+   ARG_UNUSED(skip);
+   LOG_DBG("AT %s not supported.", cmd);
+   return -ENOTSUP;
+}
+
+int modem_at_cmd(char *buf, size_t len, const char *skip, const char *cmd)
+{
+   ARG_UNUSED(buf);
+   ARG_UNUSED(len);
+   ARG_UNUSED(skip);
+   LOG_DBG("AT %s not supported.", cmd);
+   return -ENOTSUP;
+}
+
+int modem_at_cmdf_async(modem_at_response_handler_t handler, const char *skip, const char *cmd, ...)
+{
+   ARG_UNUSED(handler);
+   ARG_UNUSED(skip);
+   LOG_INF("AT %s not supported.", cmd);
+   return -ENOTSUP;
+}
+
+int modem_at_cmd_async(modem_at_response_handler_t handler, const char *skip, const char *cmd)
+{
+   ARG_UNUSED(handler);
+   ARG_UNUSED(skip);
+   LOG_INF("AT %s not supported.", cmd);
+   return -ENOTSUP;
+}
+
+bool modem_at_async_pending(void)
+{
+   return false;
+}
+
+bool modem_at_is_on(void)
+{
+   bool on;
+
+   k_mutex_lock(&fake_mutex, K_FOREVER);
+   on = fake_on;
+   k_mutex_unlock(&fake_mutex);
+   return on;
+}
+
+int modem_at_push_off(void)
+{
+   return 0;
+}
+
+int modem_at_restore(void)
+{
+   return 0;
+}
+
+int modem_at_set_offline(void)
+{
+   return modem_fake_switch(false);
+}
+
+int modem_at_set_lte_offline(void)
+{
+   return modem_fake_switch(false);
+}
+
+int modem_at_set_normal(void)
+{
+   return modem_fake_switch(true);
+}
+
+int modem_at_power_off(void)
+{
+   return modem_fake_switch(false);
+}
+
+int modem_at_system_mode_get(enum lte_lc_system_mode *mode,
+                             enum lte_lc_system_mode_preference *preference)
+{
+   if (mode) {
+      *mode = LTE_LC_SYSTEM_MODE_LTEM;
+   }
+   if (preference) {
+      *preference = LTE_LC_SYSTEM_MODE_PREFER_AUTO;
+   }
+   return 0;
+}
+
+int modem_at_system_mode_set(enum lte_lc_system_mode mode,
+                             enum lte_lc_system_mode_preference preference)
+{
+   ARG_UNUSED(mode);
+   ARG_UNUSED(preference);
+   return 0;
+}
+
+int modem_at_psm_req(bool enable)
+{
+   ARG_UNUSED(enable);
+   return 0;
+}
+
+int modem_at_edrx_req(bool enable)
+{
+   ARG_UNUSED(enable);
+   return 0;
+}
+
+void modem_sim_init(void)
+{
+}
+
+void modem_sim_network(bool registered)
+{
+   ARG_UNUSED(registered);
+}
+
+bool modem_sim_automatic_multi_imsi(void)
+{
+   return false;
+}
+
+bool modem_sim_apply_iccid_preference(void)
+{
+   return false;
+}
+
+int modem_sim_get_info(struct lte_sim_info *info)
+{
+   if (info) {
+      memset(info, 0, sizeof(struct lte_sim_info));
+      info->valid = true;
+      info->edrx_cycle_support = true;
+      strncpy(info->iccid, FAKE_ICCID, sizeof(info->iccid) - 1);
+      strncpy(info->imsi, FAKE_IMSI, sizeof(info->imsi) - 1);
+   }
+   return 0;
+}
+
+int modem_sim_read_info(struct lte_sim_info *info, bool init)
+{
+   ARG_UNUSED(init);
+   return modem_sim_get_info(info);
+}
+
+int modem_sim_ready(void)
+{
+   return 0;
+}
+
+int modem_sim_reset(bool restart)
+{
+   ARG_UNUSED(restart);
+   return 0;
+}
+
+#ifdef CONFIG_SH_CMD
+
+static int sh_cmd_fake(const char *parameter)
+{
+   if (!parameter[0]) {
+      struct lte_network_info info;
+
+      modem_get_network_info(&info);
+      LOG_INF("Modem %s, %s, %s.", modem_at_is_on() ? "on" : "off",
+              info.registered == LTE_NETWORK_STATE_ON ? "registered" : "not registered",
+              info.rrc_active == LTE_NETWORK_STATE_ON ? "connected" : "idle");
+      return 0;
+   }
+   return modem_fake_event(parameter);
+}
+
+static void sh_cmd_fake_help(void)
+{
+   LOG_INF("> help fake:");
+   LOG_INF("  fake                     : show fake modem state.");
+   LOG_INF("  fake reg                 : network available, register.");
+   LOG_INF("  fake unreg               : network lost.");
+   LOG_INF("  fake search <ms>         : registration time after switching on.");
+   LOG_INF("  fake idle <ms>           : RRC inactivity timer.");
+   LOG_INF("  fake psm <tau-s>|off     : network grants PSM.");
+   LOG_INF("  fake edrx <s> [<ptw-s>]  : network grants eDRX.");
+   LOG_INF("  fake edrx off            : network rejects eDRX.");
+   LOG_INF("  fake rai none|cp|as      : network RAI support.");
+   LOG_INF("  fake rate <s>            : APN rate limit exceeded for <s> seconds.");
+}
+
+SH_CMD(fake, NULL, "fake modem event.", sh_cmd_fake, sh_cmd_fake_help, 0);
+
+#endif /* CONFIG_SH_CMD */
@@ -26,6 +26,11 @@ LOG_MODULE_DECLARE(MODEM, CONFIG_MODEM_LOG_LEVEL);
 
 #include <zephyr/drivers/uart.h>
 
+#ifdef CONFIG_COAP_UPLOAD
+#include "coap_upload.h"
+#endif /* CONFIG_COAP_UPLOAD */
+#include "io_job_queue.h"
+
 #define READ_BUF_SIZE CONFIG_NRF_MODEM_LIB_TRACE_BACKEND_FLASH_BUF_SIZE
 
 #define UART1_DT_NODE DT_NODELABEL(uart1)
@@ -43,17 +48,196 @@ static void print_uart1(char *buf, int len)
    }
 }
 
+#define TRACE_READ_UART 1
+#define TRACE_READ_UPLOAD 2
+
+static atomic_t trace_read_busy = ATOMIC_INIT(0);
+
+static bool modem_trace_read_acquire(int reader)
+{
+   if (atomic_cas(&trace_read_busy, 0, reader)) {
+      return true;
+   }
+   LOG_INF("Reading modem trace already pending.");
+   return false;
+}
+
+#ifdef CONFIG_UART_ASYNC_API
+
+/*
+ * Double buffered DMA transfer.
+ * The work reads the next chunk from flash, while the other buffer
+ * is sent by the UART.
+ */
+
+enum trace_buffer_state {
+   TRACE_BUFFER_FREE,
+   TRACE_BUFFER_FILLED,
+   TRACE_BUFFER_SENDING,
+};
+
+struct trace_buffer {
+   enum trace_buffer_state state;
+   size_t len;
+   uint8_t data[READ_BUF_SIZE];
+};
+
+static void modem_trace_uart_fn(struct k_work *work);
+
+static K_WORK_DEFINE(modem_trace_uart_work, modem_trace_uart_fn);
+
+static struct k_spinlock trace_uart_lock;
+static struct trace_buffer trace_buffers[2];
+static uint8_t trace_fill_index = 0;
+static uint8_t trace_send_index = 0;
+static bool trace_uart_end = false;
+static size_t trace_uart_bytes = 0;
+static bool trace_uart_async = false;
+static uint8_t *const read_buf = trace_buffers[0].data;
+
+static void modem_trace_uart_send(void)
+{
+   K_SPINLOCK(&trace_uart_lock)
+   {
+      struct trace_buffer *buffer = &trace_buffers[trace_send_index];
+      if (buffer->state == TRACE_BUFFER_FILLED) {
+         buffer->state = TRACE_BUFFER_SENDING;
+         if (uart_tx(uart_dev, buffer->data, buffer->len, SYS_FOREVER_US)) {
+            /* drop the other filled buffer as well, the work releases the reader */
+            trace_buffers[0].state = TRACE_BUFFER_FREE;
+            trace_buffers[1].state = TRACE_BUFFER_FREE;
+            trace_uart_end = true;
+         }
+      }
+   }
+}
+
+static void modem_trace_uart_callback(const struct device *dev,
+                                      struct uart_event *evt,
+                                      void *user_data)
+{
+   // interrupt context!
+   if (evt->type == UART_TX_DONE || evt->type == UART_TX_ABORTED) {
+      K_SPINLOCK(&trace_uart_lock)
+      {
+         trace_buffers[trace_send_index].state = TRACE_BUFFER_FREE;
+         trace_send_index ^= 1;
+      }
+      modem_trace_uart_send();
+      work_submit_to_io_queue(&modem_trace_uart_work);
+   }
+}
+
+static void modem_trace_uart_fn(struct k_work *work)
+{
+   struct trace_buffer *buffer = NULL;
+   bool filled = false;
+   bool done = false;
+   int ret;
+
+   while (true) {
+      K_SPINLOCK(&trace_uart_lock)
+      {
+         buffer = &trace_buffers[trace_fill_index];
+         if (trace_uart_end || buffer->state != TRACE_BUFFER_FREE) {
+            buffer = NULL;
+         }
+      }
+      if (!buffer) {
+         break;
+      }
+      ret = nrf_modem_lib_trace_read(buffer->data, READ_BUF_SIZE);
+      K_SPINLOCK(&trace_uart_lock)
+      {
+         /* a failed uart_tx may have ended the transfer meanwhile */
+         filled = ret > 0 && !trace_uart_end;
+         if (filled) {
+            buffer->len = ret;
+            buffer->state = TRACE_BUFFER_FILLED;
+            trace_fill_index ^= 1;
+         } else {
+            trace_uart_end = true;
+         }
+      }
+      if (filled) {
+         trace_uart_bytes += ret;
+         modem_trace_uart_send();
+      } else if (ret < 0 && ret != -ENODATA) {
+         LOG_ERR("Error reading modem traces: %d", ret);
+      }
+   }
+   K_SPINLOCK(&trace_uart_lock)
+   {
+      done = trace_uart_end && trace_buffers[0].state == TRACE_BUFFER_FREE &&
+             trace_buffers[1].state == TRACE_BUFFER_FREE;
+   }
+   if (done && atomic_cas(&trace_read_busy, TRACE_READ_UART, 0)) {
+      /* uart1 has no other user, remove the callback again */
+      uart_callback_set(uart_dev, NULL, NULL);
+      trace_uart_async = false;
+      LOG_INF("Total trace bytes read from flash: %d", trace_uart_bytes);
+   }
+}
+
+static int modem_trace_uart_start(void)
+{
+#if DT_HAS_CHOSEN(zephyr_console)
+   if (DT_SAME_NODE(DT_CHOSEN(zephyr_console), UART1_DT_NODE)) {
+      /* the uart manager keeps its callback on the console */
+      return -ENOTSUP;
+   }
+#endif
+   if (!trace_uart_async) {
+      if (uart_callback_set(uart_dev, modem_trace_uart_callback, NULL)) {
+         return -ENOTSUP;
+      }
+      trace_uart_async = true;
+   }
+   K_SPINLOCK(&trace_uart_lock)
+   {
+      trace_buffers[0].state = TRACE_BUFFER_FREE;
+      trace_buffers[1].state = TRACE_BUFFER_FREE;
+      trace_fill_index = 0;
+      trace_send_index = 0;
+      trace_uart_end = false;
+   }
+   trace_uart_bytes = 0;
+   work_submit_to_io_queue(&modem_trace_uart_work);
+   return 0;
+}
+#else  /* CONFIG_UART_ASYNC_API */
+
 static uint8_t read_buf[READ_BUF_SIZE];
 
+static inline int modem_trace_uart_start(void)
+{
+   return -ENOTSUP;
+}
+#endif /* CONFIG_UART_ASYNC_API */
+
 static int modem_trace_cmd_print_traces(const char *config)
 {
    (void)config;
    int ret = 0;
    size_t read_offset = 0;
 
+   if (!modem_trace_read_acquire(TRACE_READ_UART)) {
+      return -EBUSY;
+   }
+   if (!device_is_ready(uart_dev)) {
+      atomic_clear(&trace_read_busy);
+      LOG_ERR("uart1 device not found/ready!");
+      return -ENODEV;
+   }
+
    ret = nrf_modem_lib_trace_data_size();
    LOG_INF("Reading out %d bytes of trace data", ret);
 
+   if (ret > 0 && !modem_trace_uart_start()) {
+      // continues in background
+      return 0;
+   }
+
    /* Read out the trace data from flash */
    while (ret > 0) {
       ret = nrf_modem_lib_trace_read(read_buf, READ_BUF_SIZE);
@@ -72,12 +256,56 @@ static int modem_trace_cmd_print_traces(const char *config)
       read_offset += ret;
       print_uart1(read_buf, ret);
    }
+   atomic_clear(&trace_read_busy);
    LOG_INF("Total trace bytes read from flash: %d", read_offset);
    return 0;
 }
 
 SH_CMD(trout, NULL, "read modem trace", modem_trace_cmd_print_traces, NULL, 0);
 
+#ifdef CONFIG_COAP_UPLOAD
+static int modem_trace_upload_read(uint8_t *buf, size_t len)
+{
+   int ret = nrf_modem_lib_trace_read(buf, len);
+
+   if (ret == -ENODATA) {
+      ret = 0;
+   } else if (ret < 0) {
+      LOG_ERR("Error reading modem traces: %d", ret);
+   }
+   return ret;
+}
+
+static int modem_trace_upload_start(void)
+{
+   int ret;
+
+   if (atomic_get(&trace_read_busy) == TRACE_READ_UPLOAD) {
+      /* restart, but the already read traces can't be read again */
+      return -ENOTSUP;
+   }
+   ret = nrf_modem_lib_trace_data_size();
+
+   if (ret <= 0) {
+      LOG_INF("No modem trace data to upload.");
+      return ret < 0 ? ret : -ENODATA;
+   }
+   if (!modem_trace_read_acquire(TRACE_READ_UPLOAD)) {
+      return -EBUSY;
+   }
+   return ret;
+}
+
+static void modem_trace_upload_finish(bool success)
+{
+   (void)success;
+   atomic_cas(&trace_read_busy, TRACE_READ_UPLOAD, 0);
+}
+
+COAP_UPLOAD_PRODUCER(trace, "modem trace.", modem_trace_upload_start,
+                     modem_trace_upload_read, modem_trace_upload_finish);
+#endif /* CONFIG_COAP_UPLOAD */
+
 #endif
 
 typedef struct trace_level_definition {
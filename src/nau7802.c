@@ -207,6 +207,9 @@ static void scale_save_external_calibration(struct scale_config *scale_dev)
       sys_put_be24(scale_dev->external_calibration.calibration_temperature, &calibration[6]);
       sys_put_be16(scale_dev->external_calibration.avref, &calibration[9]);
       rc = appl_storage_write_bytes_item(scale_dev->storage_config->id, calibration, sizeof(calibration));
+      if (!rc) {
+         rc = appl_storage_sync(scale_dev->storage_config->id);
+      }
       if (rc) {
          LOG_INF("ADC %s saving external calibration failed, %d (%s).", scale_dev->channel_name, rc, strerror(-rc));
       } else {
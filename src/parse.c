@@ -12,6 +12,7 @@
  */
 
 #include <ctype.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -289,3 +290,109 @@ int strtrunc2(char *value, char quote1, char quote2)
    }
    return index;
 }
+
+int parse_params(const char *value, struct parse_param *params, size_t count)
+{
+   size_t index = 0;
+   bool quoted = false;
+
+   if (!count) {
+      return 0;
+   }
+   params[0].value = value;
+   params[0].len = 0;
+   for (; *value; ++value) {
+      if (*value == '"') {
+         if (!quoted && params[index].value == value) {
+            params[index].value = value + 1;
+         }
+         quoted = !quoted;
+      } else if (*value == ',' && !quoted) {
+         if (++index == count) {
+            return index;
+         }
+         params[index].value = value + 1;
+         params[index].len = 0;
+      } else {
+         params[index].len = value + 1 - params[index].value;
+      }
+   }
+   return index + 1;
+}
+
+bool parse_param_long(const struct parse_param *param, int base, long *result)
+{
+   long value = 0;
+   bool negative = false;
+   const char *cur = param->value;
+   const char *end = cur + param->len;
+
+   if (cur < end && *cur == '-') {
+      negative = true;
+      ++cur;
+   }
+   if (cur == end) {
+      return false;
+   }
+   for (; cur < end; ++cur) {
+      int digit;
+      if ('0' <= *cur && *cur <= '9') {
+         digit = *cur - '0';
+      } else if ('a' <= *cur && *cur <= 'f') {
+         digit = *cur - 'a' + 10;
+      } else if ('A' <= *cur && *cur <= 'F') {
+         digit = *cur - 'A' + 10;
+      } else {
+         return false;
+      }
+      if (digit >= base || value > (LONG_MAX - digit) / base) {
+         return false;
+      }
+      value = value * base + digit;
+   }
+   *result = negative ? -value : value;
+   return true;
+}
+
+uint32_t parse_fields(const char *value, const struct parse_field *fields, size_t count, void *result)
+{
+   static const uint8_t bases[] = {10, 16, 2};
+   struct parse_param params[PARSE_MAX_PARAMS];
+   uint32_t decoded = 0;
+   int n = parse_params(value, params, PARSE_MAX_PARAMS);
+
+   for (int index = 0; index < count; ++index) {
+      const struct parse_field *field = &fields[index];
+      const struct parse_param *param = &params[field->param];
+      uint8_t *dest = (uint8_t *)result + field->offset;
+      long l = 0;
+
+      if (field->param >= n) {
+         continue;
+      }
+      if (field->type == PARSE_TEXT) {
+         size_t len = param->len < field->size ? param->len : field->size - 1;
+         memcpy(dest, param->value, len);
+         dest[len] = 0;
+      } else if (field->type < sizeof(bases) && parse_param_long(param, bases[field->type], &l)) {
+         if (field->convert) {
+            l = field->convert(l);
+         }
+         if (field->size == sizeof(uint8_t)) {
+            *dest = (uint8_t)l;
+         } else if (field->size == sizeof(uint16_t)) {
+            uint16_t v = (uint16_t)l;
+            memcpy(dest, &v, sizeof(v));
+         } else if (field->size == sizeof(uint32_t)) {
+            uint32_t v = (uint32_t)l;
+            memcpy(dest, &v, sizeof(v));
+         } else {
+            continue;
+         }
+      } else {
+         continue;
+      }
+      decoded |= (1 << index);
+   }
+   return decoded;
+}
@@ -53,4 +53,68 @@ int strtrunc(char *value, char quote);
 
 int strtrunc2(char *value, char quote1, char quote2);
 
+/* maximum number of parameters of a AT response */
+#define PARSE_MAX_PARAMS 24
+
+struct parse_param {
+   const char *value;
+   size_t len;
+};
+
+typedef enum {
+   PARSE_DEC,
+   PARSE_HEX,
+   PARSE_BIN,
+   PARSE_TEXT,
+} parse_type_t;
+
+/*
+ * Decoding of a parameter into a field of a struct.
+ * Numbers are stored with the size of the field (1, 2 or 4 bytes), text
+ * is zero terminated and truncated to the size of the field.
+ */
+struct parse_field {
+   uint8_t param;
+   uint8_t type;
+   uint16_t offset;
+   uint16_t size;
+   long (*convert)(long value);
+};
+
+#define PARSE_FIELD(P, T, S, F, C) \
+   {.param = (P), .type = (T), .offset = offsetof(S, F), .size = sizeof(((S *)0)->F), .convert = (C)}
+
+/**
+ * Split comma separated parameters in a single pass.
+ *
+ * Quotes are removed from the parameter, commas within quotes are kept.
+ *
+ * @param value parameters, e.g. AT response without prefix
+ * @param params parameters
+ * @param count maximum number of parameters
+ * @return number of parameters
+ */
+int parse_params(const char *value, struct parse_param *params, size_t count);
+
+/**
+ * Decode a number parameter.
+ *
+ * @param param parameter
+ * @param base base of the number
+ * @param result decoded number
+ * @return true, if the whole parameter is decoded, false, otherwise.
+ */
+bool parse_param_long(const struct parse_param *param, int base, long *result);
+
+/**
+ * Decode the parameters into the fields of a struct.
+ *
+ * @param value parameters, e.g. AT response without prefix
+ * @param fields table with the fields to decode
+ * @param count number of fields
+ * @param result struct for the decoded fields
+ * @return bitmask of decoded fields, bit 0 for fields[0].
+ */
+uint32_t parse_fields(const char *value, const struct parse_field *fields, size_t count, void *result);
+
 #endif /* PARSE_H */
@@ -40,6 +40,7 @@ LOG_MODULE_DECLARE(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
 struct sh_cmd_queue {
    void *queue_reserved;
    k_timeout_t delay;
+   bool report;
    char data[]; /* Null-terminated cmd string */
 };
 
@@ -62,6 +63,14 @@ static atomic_t sh_cmd_state = ATOMIC_INIT(SH_CMD_PROTECTED);
 static struct k_spinlock sh_cmd_app_active_lock;
 static int64_t sh_cmd_app_active_end = 0;
 
+/* result of a remote cmd, reported with the next message */
+static bool sh_cmd_report = false;
+static struct k_spinlock sh_cmd_report_lock;
+/* the result is kept until a report with it is acknowledged */
+static bool sh_cmd_report_sent = false;
+static size_t sh_cmd_report_len = 0;
+static char sh_cmd_report_buf[128];
+
 static K_WORK_DELAYABLE_DEFINE(sh_cmd_app_inactive_work, sh_cmd_app_inactive_fn);
 static K_WORK_DELAYABLE_DEFINE(sh_cmd_schedule_work, sh_cmd_execute_fn);
 static K_WORK_DEFINE(sh_cmd_execute_work, sh_cmd_execute_fn);
@@ -86,6 +95,28 @@ static int line_length(const uint8_t *data, size_t length)
    return len;
 }
 
+static const char *sh_cmd_result_desc(int res)
+{
+   switch (res) {
+      case -EFAULT:
+         return "off";
+      case -EBUSY:
+         return "busy";
+      case -EINVAL:
+         return "invalid parameter";
+      case -ESHUTDOWN:
+         return "in shutdown";
+      case -EINPROGRESS:
+         return "in progress";
+      case -ENOTSUP:
+         return "not supported";
+      case -ETIME:
+         return "timeout";
+      default:
+         return strerror(-res);
+   }
+}
+
 static void sh_cmd_result(int res)
 {
    bool finish = atomic_test_and_clear_bit(&sh_cmd_state, BIT_SH_CMD_EXECUTING);
@@ -93,34 +124,7 @@ static void sh_cmd_result(int res)
       // noops
    } else {
       if (res < -1) {
-         const char *desc = "";
-         switch (res) {
-            case -EFAULT:
-               desc = "off";
-               break;
-            case -EBUSY:
-               desc = "busy";
-               break;
-            case -EINVAL:
-               desc = "invalid parameter";
-               break;
-            case -ESHUTDOWN:
-               desc = "in shutdown";
-               break;
-            case -EINPROGRESS:
-               desc = "in progress";
-               break;
-            case -ENOTSUP:
-               desc = "not supported";
-               break;
-            case -ETIME:
-               desc = "timeout";
-               break;
-            default:
-               desc = strerror(-res);
-               break;
-         }
-         LOG_INF("ERROR %d (%s)\n", -res, desc);
+         LOG_INF("ERROR %d (%s)\n", -res, sh_cmd_result_desc(res));
       }
 
       if (finish) {
@@ -134,6 +138,27 @@ static void sh_cmd_result(int res)
    }
 }
 
+static void sh_cmd_report_result(const char *cmd, int res)
+{
+   K_SPINLOCK(&sh_cmd_report_lock)
+   {
+      if (res > 0) {
+         sh_cmd_report_len = snprintf(sh_cmd_report_buf, sizeof(sh_cmd_report_buf), "Cmd: %s => pending", cmd);
+      } else if (res == 0) {
+         sh_cmd_report_len = snprintf(sh_cmd_report_buf, sizeof(sh_cmd_report_buf), "Cmd: %s => OK", cmd);
+      } else if (res == -1) {
+         sh_cmd_report_len = snprintf(sh_cmd_report_buf, sizeof(sh_cmd_report_buf), "Cmd: %s => ERROR", cmd);
+      } else {
+         sh_cmd_report_len = snprintf(sh_cmd_report_buf, sizeof(sh_cmd_report_buf), "Cmd: %s => ERROR %d (%s)",
+                                      cmd, -res, sh_cmd_result_desc(res));
+      }
+      if (sh_cmd_report_len >= sizeof(sh_cmd_report_buf)) {
+         sh_cmd_report_len = sizeof(sh_cmd_report_buf) - 1;
+      }
+      sh_cmd_report_sent = false;
+   }
+}
+
 static void at_coneval_result(const char *result)
 {
    unsigned int status = 0;
@@ -501,6 +526,10 @@ static void sh_cmd_execute_fn(struct k_work *work)
       // scheduled from remote
       LOG_INF("...> %s", sh_cmd_buf);
       res = sh_cmd(sh_cmd_buf, false);
+      if (sh_cmd_report) {
+         sh_cmd_report = false;
+         sh_cmd_report_result(sh_cmd_buf, res);
+      }
    } else {
       // executed from sh
       res = sh_cmd(sh_cmd_buf, true);
@@ -515,6 +544,7 @@ static void sh_cmd_wait_fn(struct k_work *work)
       if (sh_cmd) {
          uint32_t delay_ms = (uint32_t)k_ticks_to_ms_floor64(sh_cmd->delay.ticks);
          strncpy(sh_cmd_buf, sh_cmd->data, sizeof(sh_cmd_buf) - 1);
+         sh_cmd_report = sh_cmd->report;
          LOG_INF("> cmd '%s' scheduled (%u ms).", sh_cmd_buf, delay_ms);
          k_work_reschedule_for_queue(&sh_cmd_work_q, &sh_cmd_schedule_work, sh_cmd->delay);
          k_heap_free(&sh_cmd_heap, sh_cmd);
@@ -553,18 +583,20 @@ int sh_cmd_schedule(const char *cmd, const k_timeout_t delay)
    }
    if (!atomic_test_and_set_bit(&sh_cmd_state, BIT_SH_CMD_EXECUTING)) {
       strncpy(sh_cmd_buf, cmd, sizeof(sh_cmd_buf) - 1);
+      sh_cmd_report = false;
       k_work_reschedule_for_queue(&sh_cmd_work_q, &sh_cmd_schedule_work, delay);
       return 0;
    }
    return -EBUSY;
 }
 
-static int sh_cmd_put(bool head, const char *cmd, const k_timeout_t delay)
+static int sh_cmd_put(bool head, const char *cmd, const k_timeout_t delay, bool report)
 {
    size_t len = sizeof(struct sh_cmd_queue) + strlen(cmd) + sizeof(char);
    struct sh_cmd_queue *item = k_heap_alloc(&sh_cmd_heap, len, K_NO_WAIT);
    if (item) {
       item->delay = delay;
+      item->report = report;
       strcpy(item->data, cmd);
       if (head) {
          k_queue_prepend(&sh_cmd_queue, item);
@@ -583,12 +615,44 @@ static int sh_cmd_put(bool head, const char *cmd, const k_timeout_t delay)
 
 int sh_cmd_prepend(const char *cmd, const k_timeout_t delay)
 {
-   return sh_cmd_put(true, cmd, delay);
+   return sh_cmd_put(true, cmd, delay, false);
 }
 
 int sh_cmd_append(const char *cmd, const k_timeout_t delay)
 {
-   return sh_cmd_put(false, cmd, delay);
+   return sh_cmd_put(false, cmd, delay, false);
+}
+
+int sh_cmd_append_reported(const char *cmd, const k_timeout_t delay)
+{
+   return sh_cmd_put(false, cmd, delay, true);
+}
+
+int sh_cmd_get_reported_result(char *buf, size_t len)
+{
+   int res = 0;
+
+   K_SPINLOCK(&sh_cmd_report_lock)
+   {
+      if (sh_cmd_report_len && sh_cmd_report_len < len) {
+         memcpy(buf, sh_cmd_report_buf, sh_cmd_report_len);
+         buf[sh_cmd_report_len] = 0;
+         res = sh_cmd_report_len;
+         sh_cmd_report_sent = true;
+      }
+   }
+   return res;
+}
+
+void sh_cmd_reported_result_delivered(void)
+{
+   K_SPINLOCK(&sh_cmd_report_lock)
+   {
+      if (sh_cmd_report_sent) {
+         sh_cmd_report_sent = false;
+         sh_cmd_report_len = 0;
+      }
+   }
 }
 
 int sh_busy(void)
@@ -60,6 +60,9 @@ int sh_cmd_schedule(const char *cmd, const k_timeout_t delay);
 
 int sh_cmd_prepend(const char *cmd, const k_timeout_t delay);
 int sh_cmd_append(const char *cmd, const k_timeout_t delay);
+int sh_cmd_append_reported(const char *cmd, const k_timeout_t delay);
+int sh_cmd_get_reported_result(char *buf, size_t len);
+void sh_cmd_reported_result_delivered(void);
 
 int sh_busy(void);
 int sh_protected(void);
@@ -92,6 +95,21 @@ static inline int sh_cmd_append(const char *cmd, const k_timeout_t delay) {
    return 0;
 }
 
+static inline int sh_cmd_append_reported(const char *cmd, const k_timeout_t delay) {
+   (void) cmd;
+   (void) delay;
+   return 0;
+}
+
+static inline int sh_cmd_get_reported_result(char *buf, size_t len) {
+   (void) buf;
+   (void) len;
+   return 0;
+}
+
+static inline void sh_cmd_reported_result_delivered(void) {
+}
+
 static inline int sh_busy(void) {
    return 0;
 }
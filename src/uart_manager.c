@@ -50,7 +50,6 @@ LOG_MODULE_REGISTER(UART_MANAGER, CONFIG_UART_MANAGER_LOG_LEVEL);
 #define CONFIG_UART_RX_CHECK_INTERVAL_MS 50
 #define CONFIG_UART_RX_CHECK_INTERVAL_S 60
 #define CONFIG_UART_RX_INPUT_TIMEOUT_S 30
-#define CONFIG_UART_TX_OUTPUT_TIMEOUT_MS 1500
 
 static void uart_enable_rx_fn(struct k_work *work);
 static void uart_pause_tx_fn(struct k_work *work);
@@ -81,7 +80,16 @@ static struct k_spinlock uart_lock;
 #define UART_UPDATE 4
 #define UART_UPDATE_START 5
 #define UART_UPDATE_APPLY 6
-#define UART_UPDATE_FLAGS (BIT(UART_UPDATE) | BIT(UART_UPDATE_START) | BIT(UART_UPDATE_APPLY))
+#define UART_UPDATE_STREAM 7
+#define UART_UPDATE_EOT 8
+#define UART_UPDATE_FLAGS (BIT(UART_UPDATE) | BIT(UART_UPDATE_START) | BIT(UART_UPDATE_APPLY) | \
+                           BIT(UART_UPDATE_STREAM) | BIT(UART_UPDATE_EOT))
+
+#ifdef CONFIG_UART_UPDATE_STREAMING
+#define XMODEM_STREAM_RETRIES 3
+#else
+#define XMODEM_STREAM_RETRIES 0
+#endif
 
 static void uart_xmodem_process_fn(struct k_work *work);
 static void uart_xmodem_start_fn(struct k_work *work);
@@ -93,7 +101,7 @@ static K_WORK_DELAYABLE_DEFINE(uart_xmodem_nak_work, uart_xmodem_process_fn);
 static K_WORK_DELAYABLE_DEFINE(uart_xmodem_ack_work, uart_xmodem_process_fn);
 static K_WORK_DELAYABLE_DEFINE(uart_xmodem_timeout_work, uart_xmodem_process_fn);
 static K_WORK_DEFINE(uart_xmodem_write_work, uart_xmodem_process_fn);
-static K_WORK_DEFINE(uart_xmodem_ready_work, uart_xmodem_process_fn);
+static K_WORK_DELAYABLE_DEFINE(uart_xmodem_ready_work, uart_xmodem_process_fn);
 
 static inline bool uart_update_pending(void)
 {
@@ -191,12 +199,36 @@ static K_WORK_DELAYABLE_DEFINE(uart_end_pause_tx_work, uart_pause_tx_fn);
 static bool uart_tx_in_pause = false;
 #endif
 
-static K_SEM_DEFINE(uart_tx_sem, 0, 1);
-
 static uint8_t uart_tx_buf[256];
 static atomic_t uart_tx_buf_offset = ATOMIC_INIT(0);
 static atomic_t uart_tx_buf_lines = ATOMIC_INIT(0);
 
+#ifndef CONFIG_LOG_MODE_IMMEDIATE
+/*
+ * Single producer (log thread), single consumer (TX done callback).
+ * The head is only moved by the log thread, the tail only by the
+ * callback. A transfer sends the continuous part up to the head or
+ * the end of the ring, the callback starts the next one.
+ * The log thread writes a message at the stage and publishes it
+ * by moving the head only, if the whole message fits.
+ */
+#define UART_TX_RING_SIZE CONFIG_LOG_BACKEND_UART_BUFFER_SIZE
+#define UART_TX_DROPPED_RESERVE 64
+
+static uint8_t uart_tx_ring[UART_TX_RING_SIZE];
+static atomic_t uart_tx_ring_head = ATOMIC_INIT(0);
+static atomic_t uart_tx_ring_tail = ATOMIC_INIT(0);
+static atomic_t uart_tx_ring_sending = ATOMIC_INIT(0);
+static size_t uart_tx_ring_stage = 0;
+static atomic_t uart_tx_dropped = ATOMIC_INIT(0);
+static bool uart_tx_drop_message = false;
+
+#ifdef CONFIG_LOG_BACKEND_UART_THROTTLE
+static void uart_tx_throttle_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(uart_tx_throttle_work, uart_tx_throttle_fn);
+#endif /* CONFIG_LOG_BACKEND_UART_THROTTLE */
+#endif /* CONFIG_LOG_MODE_IMMEDIATE */
+
 static void uart_tx_pause(bool pause)
 {
 #ifdef CONFIG_LOG_MODE_IMMEDIATE
@@ -221,16 +253,146 @@ static void uart_tx_off(bool off)
    atomic_set_bit_to(&uart_state, UART_TX_ENABLED, !off);
 }
 
+static inline bool uart_tx_pending(void)
+{
+   return atomic_test_bit(&uart_state, UART_PENDING);
+}
+
+#ifdef CONFIG_LOG_MODE_IMMEDIATE
+
+static inline void uart_tx_kick(void)
+{
+   // empty
+}
+
 static inline void uart_tx_ready(void)
 {
-   k_sem_give(&uart_tx_sem);
+   // empty
 }
 
-static inline bool uart_tx_pending(void)
+#else /* CONFIG_LOG_MODE_IMMEDIATE */
+
+static inline size_t uart_tx_ring_free(void)
 {
-   return atomic_test_bit(&uart_state, UART_PENDING);
+   size_t tail = atomic_get(&uart_tx_ring_tail);
+
+   return (tail + UART_TX_RING_SIZE - uart_tx_ring_stage - 1) % UART_TX_RING_SIZE;
 }
 
+/* log thread, stages the data, drops the whole message, if a part doesn't fit */
+static void uart_tx_ring_put(const uint8_t *data, size_t length)
+{
+   size_t stage = uart_tx_ring_stage;
+   size_t first;
+
+   if (uart_tx_drop_message || !length) {
+      return;
+   }
+   if (length > uart_tx_ring_free()) {
+      uart_tx_drop_message = true;
+      return;
+   }
+   first = MIN(length, UART_TX_RING_SIZE - stage);
+   memcpy(&uart_tx_ring[stage], data, first);
+   if (length > first) {
+      memcpy(uart_tx_ring, data + first, length - first);
+   }
+   uart_tx_ring_stage = (stage + length) % UART_TX_RING_SIZE;
+}
+
+/* log thread, publishes the staged message, or discards it, if a part didn't fit */
+static bool uart_tx_ring_commit(void)
+{
+   bool complete = !uart_tx_drop_message;
+
+   if (complete) {
+      atomic_set(&uart_tx_ring_head, uart_tx_ring_stage);
+   } else {
+      uart_tx_ring_stage = atomic_get(&uart_tx_ring_head);
+      uart_tx_drop_message = false;
+   }
+   return complete;
+}
+
+/* start the next transfer, if none is pending. Called by the log thread and the TX callback. */
+static void uart_tx_kick(void)
+{
+   size_t head;
+   size_t tail;
+   size_t length = 0;
+
+   K_SPINLOCK(&uart_lock)
+   {
+      head = atomic_get(&uart_tx_ring_head);
+      tail = atomic_get(&uart_tx_ring_tail);
+      if (head != tail &&
+          !atomic_test_bit(&uart_state, UART_PANIC) &&
+          !atomic_test_bit(&uart_state, UART_SUSPENDED) &&
+          !atomic_test_and_set_bit(&uart_state, UART_PENDING)) {
+         length = head > tail ? head - tail : UART_TX_RING_SIZE - tail;
+         atomic_set(&uart_tx_ring_sending, length);
+      }
+   }
+   if (length) {
+      /* SYS_FOREVER_US disable timeout */
+      if (uart_tx(uart_dev, &uart_tx_ring[tail], length, SYS_FOREVER_US)) {
+         // keep the data for the next message
+         atomic_set(&uart_tx_ring_sending, 0);
+         atomic_clear_bit(&uart_state, UART_PENDING);
+      }
+   }
+}
+
+#ifdef CONFIG_LOG_BACKEND_UART_THROTTLE
+static void uart_tx_throttle_fn(struct k_work *work)
+{
+   ARG_UNUSED(work);
+   uart_tx_kick();
+}
+#endif /* CONFIG_LOG_BACKEND_UART_THROTTLE */
+
+/* TX done or aborted, interrupt context! An aborted transfer is dropped. */
+static void uart_tx_ready(void)
+{
+   size_t length = atomic_set(&uart_tx_ring_sending, 0);
+
+   if (length) {
+      atomic_set(&uart_tx_ring_tail, (atomic_get(&uart_tx_ring_tail) + length) % UART_TX_RING_SIZE);
+   }
+   atomic_clear_bit(&uart_state, UART_PENDING);
+#ifdef CONFIG_LOG_BACKEND_UART_THROTTLE
+   k_work_schedule_for_queue(&uart_work_q, &uart_tx_throttle_work, K_MSEC(4));
+#else  /* CONFIG_LOG_BACKEND_UART_THROTTLE */
+   uart_tx_kick();
+#endif /* CONFIG_LOG_BACKEND_UART_THROTTLE */
+}
+
+/* send the not transmitted data of the ring with polling */
+static void uart_tx_ring_panic(void)
+{
+   size_t head = atomic_get(&uart_tx_ring_head);
+   size_t tail = atomic_get(&uart_tx_ring_tail);
+
+   if (uart_tx_pending()) {
+      uart_tx_abort(uart_dev);
+   }
+   while (tail != head) {
+      uart_poll_out(uart_dev, uart_tx_ring[tail]);
+      tail = (tail + 1) % UART_TX_RING_SIZE;
+   }
+   atomic_set(&uart_tx_ring_tail, tail);
+}
+
+static void uart_tx_message_end(void)
+{
+   if (!uart_tx_ring_commit()) {
+      atomic_inc(&uart_tx_dropped);
+   }
+   uart_tx_kick();
+}
+
+#endif /* CONFIG_LOG_MODE_IMMEDIATE */
+
 static int uart_tx_out(uint8_t *data, size_t length)
 {
 #ifdef CONFIG_LOG_MODE_IMMEDIATE
@@ -238,33 +400,12 @@ static int uart_tx_out(uint8_t *data, size_t length)
       uart_poll_out(uart_dev, data[i]);
    }
 #else
-   bool panic = atomic_test_bit(&uart_state, UART_PANIC);
-   if (panic) {
+   if (atomic_test_bit(&uart_state, UART_PANIC)) {
       for (size_t i = 0; i < length; i++) {
          uart_poll_out(uart_dev, data[i]);
       }
-   } else if (!atomic_test_bit(&uart_state, UART_SUSPENDED)) {
-      if (length == 1) {
-         uart_poll_out(uart_dev, data[0]);
-      } else {
-         bool send;
-         K_SPINLOCK(&uart_lock)
-         {
-            send = !atomic_test_bit(&uart_state, UART_SUSPENDED);
-            if (send) {
-               atomic_set_bit(&uart_state, UART_PENDING);
-            }
-         }
-         if (send) {
-            k_sem_reset(&uart_tx_sem);
-
-            /* SYS_FOREVER_US disable timeout */
-            uart_tx(uart_dev, data, length, SYS_FOREVER_US);
-
-            k_sem_take(&uart_tx_sem, K_MSEC(CONFIG_UART_TX_OUTPUT_TIMEOUT_MS));
-            atomic_clear_bit(&uart_state, UART_PENDING);
-         }
-      }
+   } else {
+      uart_tx_ring_put(data, length);
    }
 #endif
    return length;
@@ -310,8 +451,44 @@ static void uart_tx_out_flush(void)
    uart_tx_out_nl();
    uart_tx_out(uart_tx_buf, atomic_get(&uart_tx_buf_offset));
    atomic_set(&uart_tx_buf_offset, 0);
+#ifndef CONFIG_LOG_MODE_IMMEDIATE
+   uart_tx_message_end();
+#endif
+}
+
+#ifdef CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY
+static int uart_dict_out(uint8_t *data, size_t length, void *ctx)
+{
+   ARG_UNUSED(ctx);
+   return uart_tx_out(data, length);
 }
 
+static uint8_t uart_dict_buf[64];
+
+LOG_OUTPUT_DEFINE(uart_dict_output, uart_dict_out, uart_dict_buf, sizeof(uart_dict_buf));
+#endif /* CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY */
+
+#ifndef CONFIG_LOG_MODE_IMMEDIATE
+/* report dropped messages, if the ring has space again */
+static void uart_tx_report_dropped(void)
+{
+   uint32_t dropped = atomic_get(&uart_tx_dropped);
+
+   if (dropped && uart_tx_ring_free() > UART_TX_DROPPED_RESERVE) {
+#ifdef CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY
+      log_dict_output_dropped_process(&uart_dict_output, dropped);
+#else  /* CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY */
+      char line[UART_TX_DROPPED_RESERVE];
+      int length = snprintf(line, sizeof(line), "--- %u messages dropped by UART ---\r\n", dropped);
+      uart_tx_ring_put((const uint8_t *)line, MIN(length, sizeof(line) - 1));
+#endif /* CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY */
+      if (uart_tx_ring_commit()) {
+         atomic_sub(&uart_tx_dropped, dropped);
+      }
+   }
+}
+#endif /* CONFIG_LOG_MODE_IMMEDIATE */
+
 static int uart_tx_out_func(int c, void *ctx)
 {
    ARG_UNUSED(ctx);
@@ -413,6 +590,17 @@ static void uart_log_process(const struct log_backend *const backend,
             k_mutex_unlock(&uart_tx_mutex);
          }
 #endif
+#ifndef CONFIG_LOG_MODE_IMMEDIATE
+         if (!panic) {
+            uart_tx_report_dropped();
+         }
+#endif
+#ifdef CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY
+         // format id and raw arguments, rendered by the host
+         log_dict_output_msg_process(&uart_dict_output, &msg->log, 0);
+         uart_tx_message_end();
+         return;
+#endif /* CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY */
          if (level) {
             uint32_t cycles = sys_clock_hw_cycles_per_sec();
             log_timestamp_t seconds = (msg->log.hdr.timestamp / cycles) % 100;
@@ -429,15 +617,9 @@ static void uart_log_process(const struct log_backend *const backend,
             cbpprintf(uart_tx_out_func, NULL, package);
          }
          uart_tx_out_flush();
-#ifdef CONFIG_LOG_BACKEND_UART_THROTTLE
-         k_sleep(K_MSEC(4));
-#endif /* CONFIG_LOG_BACKEND_UART_THROTTLE */
          if (dlen) {
             uart_log_dump_hex(prefix, data, dlen);
             uart_tx_out_flush();
-#ifdef CONFIG_LOG_BACKEND_UART_THROTTLE
-            k_sleep(K_MSEC(4));
-#endif /* CONFIG_LOG_BACKEND_UART_THROTTLE */
          }
       }
    }
@@ -454,15 +636,29 @@ static void uart_log_panic(struct log_backend const *const backend)
 {
    ARG_UNUSED(backend);
    atomic_set_bit(&uart_state, UART_PANIC);
+#ifndef CONFIG_LOG_MODE_IMMEDIATE
+   uart_tx_ring_panic();
+#endif
+#ifndef CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY
    uart_tx_out_flush();
+#endif /* CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY */
 }
 
 static void uart_log_dropped(const struct log_backend *const backend, uint32_t cnt)
 {
    ARG_UNUSED(backend);
+#ifdef CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY
+   log_dict_output_dropped_process(&uart_dict_output, cnt);
+   if (!uart_tx_ring_commit()) {
+      /* reported with the next message */
+      atomic_add(&uart_tx_dropped, cnt);
+   }
+   uart_tx_kick();
+#else  /* CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY */
    cbprintf(uart_tx_out_func, NULL,
             "--- %u  messages dropped ---", cnt);
    uart_tx_out_flush();
+#endif /* CONFIG_LOG_BACKEND_UART_MANAGER_DICTIONARY */
 }
 
 const struct log_backend_api uart_log_backend_api = {
@@ -489,6 +685,11 @@ static inline void uart_tx_ready(void)
    // empty
 }
 
+static inline void uart_tx_kick(void)
+{
+   // empty
+}
+
 static inline bool uart_tx_pending(void)
 {
    return false;
@@ -511,6 +712,8 @@ static void uart_enable_rx_fn(struct k_work *work)
          pm_device_action_run(uart_dev, PM_DEVICE_ACTION_RESUME);
       }
       atomic_clear_bit(&uart_state, UART_SUSPENDED);
+      // send the buffered messages
+      uart_tx_kick();
 #ifdef CONFIG_UART_LED
       ui_led_op(LED_UART, LED_SET);
 #endif /* CONFIG_UART_LED */
@@ -650,14 +853,22 @@ static void uart_xmodem_start_fn(struct k_work *work)
       ui_led_op(LED_COLOR_ALL, LED_BLINK);
    }
 
-   if (retry < 3) {
+   if (retry < XMODEM_STREAM_RETRIES) {
+      // CRC, streaming without ACKs (YMODEM-g)
+      atomic_set_bit(&uart_state, UART_UPDATE_STREAM);
+      appl_update_xmodem_start(true, true);
+      uart_poll_out(uart_dev, XMODEM_STREAM);
+      work_reschedule_for_cmd_queue(&uart_xmodem_start_work, K_MSEC(2000));
+   } else if (retry < XMODEM_STREAM_RETRIES + 3) {
       // CRC
-      appl_update_xmodem_start(uart_cmd_buf, sizeof(uart_cmd_buf), true);
+      atomic_clear_bit(&uart_state, UART_UPDATE_STREAM);
+      appl_update_xmodem_start(true, false);
       uart_poll_out(uart_dev, XMODEM_CRC);
       work_reschedule_for_cmd_queue(&uart_xmodem_start_work, K_MSEC(2000));
-   } else if (retry < 6) {
+   } else if (retry < XMODEM_STREAM_RETRIES + 6) {
       // CHECKSUM
-      appl_update_xmodem_start(uart_cmd_buf, sizeof(uart_cmd_buf), false);
+      atomic_clear_bit(&uart_state, UART_UPDATE_STREAM);
+      appl_update_xmodem_start(false, false);
       uart_poll_out(uart_dev, XMODEM_NAK);
       work_reschedule_for_cmd_queue(&uart_xmodem_start_work, K_MSEC(2000));
    } else {
@@ -668,32 +879,58 @@ static void uart_xmodem_start_fn(struct k_work *work)
    }
 }
 
+static void uart_xmodem_started(void)
+{
+   if (atomic_test_and_clear_bit(&uart_state, UART_UPDATE_START)) {
+      k_work_cancel_delayable(&uart_xmodem_start_work);
+   }
+   atomic_set(&xmodem_retries, 0);
+   k_work_cancel_delayable(&uart_xmodem_ack_work);
+   work_reschedule_for_cmd_queue(&uart_xmodem_timeout_work, K_SECONDS(15));
+}
+
 static void uart_xmodem_process_fn(struct k_work *work)
 {
    bool start = atomic_test_bit(&uart_state, UART_UPDATE_START);
+   bool stream = atomic_test_bit(&uart_state, UART_UPDATE_STREAM);
    bool retry = false;
    bool cancel = false;
    int rc = 9;
 
    if (&uart_xmodem_write_work == work) {
       k_work_cancel_delayable(&uart_xmodem_nak_work);
-      rc = appl_update_xmodem_write_block();
-      if (rc < 0) {
-         retry = true;
-      } else if (rc == XMODEM_DUPLICATE) {
-         if (!start) {
-            // small delay, maybe the next block is already in flight
-            work_reschedule_for_cmd_queue(&uart_xmodem_ack_work, K_MSEC(500));
-         }
-         return;
-      } else {
-         if (start && atomic_test_and_clear_bit(&uart_state, UART_UPDATE_START)) {
-            k_work_cancel_delayable(&uart_xmodem_start_work);
+      while ((rc = appl_update_xmodem_verify_block()) != XMODEM_NONE) {
+         if (rc < 0) {
+            retry = true;
+            break;
+         } else if (rc == XMODEM_DUPLICATE) {
+            if (!start && !stream) {
+               // small delay, maybe the next block is already in flight
+               work_reschedule_for_cmd_queue(&uart_xmodem_ack_work, K_MSEC(500));
+            }
+         } else if (rc == XMODEM_HEADER) {
+            if (atomic_test_bit(&uart_state, UART_UPDATE_EOT)) {
+               // empty header, YMODEM batch end
+               work_reschedule_for_cmd_queue(&uart_xmodem_ready_work, K_NO_WAIT);
+               return;
+            }
+            uart_xmodem_started();
+            uart_poll_out(uart_dev, XMODEM_STREAM);
+         } else {
+            uart_xmodem_started();
+            if (!stream) {
+               // ACK verified block, next block is received while writing
+               uart_poll_out(uart_dev, XMODEM_ACK);
+            }
+            rc = appl_update_xmodem_write_block();
+            if (rc < 0) {
+               cancel = true;
+               LOG_INF("XMODEM write failed. %d", rc);
+               break;
+            }
          }
-         atomic_set(&xmodem_retries, 0);
-         k_work_cancel_delayable(&uart_xmodem_ack_work);
-         work_reschedule_for_cmd_queue(&uart_xmodem_timeout_work, K_SECONDS(15));
-         uart_poll_out(uart_dev, XMODEM_ACK);
+      }
+      if (!retry && !cancel) {
          return;
       }
    } else if (&uart_xmodem_nak_work.work == work) {
@@ -707,12 +944,21 @@ static void uart_xmodem_process_fn(struct k_work *work)
       return;
    } else {
       bool apply = atomic_test_bit(&uart_state, UART_UPDATE_APPLY);
+      if (stream && !atomic_test_and_set_bit(&uart_state, UART_UPDATE_EOT)) {
+         // YMODEM-g, request the empty header for the batch end
+         uart_poll_out(uart_dev, XMODEM_ACK);
+         uart_poll_out(uart_dev, XMODEM_STREAM);
+         work_reschedule_for_cmd_queue(&uart_xmodem_ready_work, K_MSEC(1000));
+         return;
+      }
       k_work_cancel_delayable(&uart_xmodem_nak_work);
       k_work_cancel_delayable(&uart_xmodem_ack_work);
       k_work_cancel_delayable(&uart_xmodem_timeout_work);
       rc = appl_update_finish();
       atomic_and(&uart_state, ~UART_UPDATE_FLAGS);
-      uart_poll_out(uart_dev, XMODEM_ACK);
+      if (!stream) {
+         uart_poll_out(uart_dev, XMODEM_ACK);
+      }
       k_sleep(K_MSEC(100));
       uart_tx_off(false);
       if (!rc) {
@@ -733,11 +979,15 @@ static void uart_xmodem_process_fn(struct k_work *work)
       }
       return;
    }
-   if (start) {
+   if (start && !cancel) {
       return;
    }
    if (retry) {
-      if (atomic_inc(&xmodem_retries) < 10) {
+      if (stream) {
+         // no retransmission without ACKs
+         cancel = true;
+         LOG_INF("XMODEM stream failed.");
+      } else if (atomic_inc(&xmodem_retries) < 10) {
          uart_poll_out(uart_dev, XMODEM_NAK);
       } else {
          cancel = true;
@@ -745,27 +995,43 @@ static void uart_xmodem_process_fn(struct k_work *work)
       }
    }
    if (cancel) {
+      k_work_cancel_delayable(&uart_xmodem_start_work);
       appl_update_cancel();
       atomic_and(&uart_state, ~UART_UPDATE_FLAGS);
-      uart_poll_out(uart_dev, XMODEM_NAK);
+      if (stream) {
+         uart_poll_out(uart_dev, XMODEM_CAN);
+         uart_poll_out(uart_dev, XMODEM_CAN);
+      } else {
+         uart_poll_out(uart_dev, XMODEM_NAK);
+      }
       uart_tx_off(false);
    }
 }
 
 static void uart_xmodem_handler(const char *buffer, size_t len)
 {
-   int rc = appl_update_xmodem_append(buffer, len);
-
-   switch (rc) {
-      case XMODEM_NOT_OK:
-         work_reschedule_for_cmd_queue(&uart_xmodem_nak_work, K_MSEC(2000));
-         break;
-      case XMODEM_BLOCK_READY:
-         work_submit_to_cmd_queue(&uart_xmodem_write_work);
-         break;
-      case XMODEM_READY:
-         work_submit_to_cmd_queue(&uart_xmodem_ready_work);
-         break;
+   // interrupt context!
+   while (len) {
+      size_t used = len;
+      int rc = appl_update_xmodem_append(buffer, len, &used);
+
+      buffer += used;
+      len -= used;
+      switch (rc) {
+         case XMODEM_NOT_OK:
+            if (atomic_test_bit(&uart_state, UART_UPDATE_STREAM)) {
+               work_schedule_for_cmd_queue(&uart_xmodem_nak_work, K_NO_WAIT);
+            } else {
+               work_reschedule_for_cmd_queue(&uart_xmodem_nak_work, K_MSEC(2000));
+            }
+            return;
+         case XMODEM_BLOCK_READY:
+            work_submit_to_cmd_queue(&uart_xmodem_write_work);
+            break;
+         case XMODEM_READY:
+            work_reschedule_for_cmd_queue(&uart_xmodem_ready_work, K_NO_WAIT);
+            break;
+      }
    }
 }
 
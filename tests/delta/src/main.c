@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/ztest.h>
+
+#include "appl_update.h"
+#include "appl_update_delta.h"
+#include "delta_gen.h"
+
+LOG_MODULE_REGISTER(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
+
+#define IMAGE_SIZE 0x8000
+/* the new function is inserted at that offset */
+#define INSERT_OFFSET 0x2000
+#define INSERT_SIZE 200
+/* one address every POINTER_DISTANCE bytes */
+#define POINTER_DISTANCE 64
+#define IMAGE_ADDRESS 0x10000
+
+static uint8_t source[IMAGE_SIZE];
+static uint8_t target[IMAGE_SIZE + INSERT_SIZE];
+static uint8_t result[IMAGE_SIZE + INSERT_SIZE];
+static size_t result_len;
+
+static struct flash_area source_area = {
+    .fa_size = IMAGE_SIZE,
+};
+
+/* mocks for the running image and the secondary slot */
+
+int flash_area_open(uint8_t id, const struct flash_area **fa)
+{
+   *fa = &source_area;
+   return 0;
+}
+
+void flash_area_close(const struct flash_area *fa)
+{
+}
+
+int flash_area_read(const struct flash_area *fa, off_t off, void *dst, size_t len)
+{
+   if (off < 0 || off + len > sizeof(source)) {
+      return -EINVAL;
+   }
+   memcpy(dst, &source[off], len);
+   return 0;
+}
+
+int appl_update_write(const uint8_t *data, size_t len)
+{
+   if (result_len + len > sizeof(result)) {
+      return -ENOMEM;
+   }
+   memcpy(&result[result_len], data, len);
+   result_len += len;
+   return 0;
+}
+
+static uint32_t random_value(uint32_t *seed)
+{
+   *seed = *seed * 1103515245 + 12345;
+   return *seed >> 8;
+}
+
+/* code with absolute addresses, the new image has a function inserted */
+static void create_images(void)
+{
+   uint32_t seed = 4711;
+   size_t offset;
+
+   for (offset = 0; offset < IMAGE_SIZE; ++offset) {
+      source[offset] = random_value(&seed);
+   }
+   for (offset = 0; offset < IMAGE_SIZE; offset += POINTER_DISTANCE) {
+      sys_put_le32(IMAGE_ADDRESS + random_value(&seed) % IMAGE_SIZE, &source[offset]);
+   }
+   memcpy(target, source, INSERT_OFFSET);
+   for (offset = 0; offset < INSERT_SIZE; ++offset) {
+      target[INSERT_OFFSET + offset] = random_value(&seed);
+   }
+   memcpy(&target[INSERT_OFFSET + INSERT_SIZE], &source[INSERT_OFFSET], IMAGE_SIZE - INSERT_OFFSET);
+   for (offset = 0; offset < IMAGE_SIZE; offset += POINTER_DISTANCE) {
+      uint32_t address = sys_get_le32(&source[offset]);
+
+      if (address >= IMAGE_ADDRESS + INSERT_OFFSET) {
+         sys_put_le32(address + INSERT_SIZE,
+                      &target[offset < INSERT_OFFSET ? offset : offset + INSERT_SIZE]);
+      }
+   }
+}
+
+static int apply_patch(const uint8_t *patch, size_t len, size_t chunk)
+{
+   int res = appl_update_delta_start();
+
+   result_len = 0;
+   while (!res && len > 0) {
+      size_t size = MIN(len, chunk);
+      res = appl_update_delta_write(patch, size);
+      patch += size;
+      len -= size;
+   }
+   if (!res) {
+      res = appl_update_delta_finish();
+   } else {
+      appl_update_delta_cancel();
+   }
+   return res;
+}
+
+static void round_trip(const uint8_t *new_image, size_t new_len, size_t *patch_len)
+{
+   static const size_t chunks[] = {1, 7, 64, 1024, 0x10000};
+   uint8_t *patch = delta_gen_create(source, sizeof(source), new_image, new_len, patch_len);
+
+   zassert_not_null(patch, "create patch failed");
+   for (int index = 0; index < ARRAY_SIZE(chunks); ++index) {
+      zassert_equal(apply_patch(patch, *patch_len, chunks[index]), 0,
+                    "apply patch in chunks of %u failed", (unsigned int)chunks[index]);
+      zassert_equal(result_len, new_len, "result length differs");
+      zassert_mem_equal(result, new_image, new_len, "result differs");
+   }
+   free(patch);
+}
+
+static void *delta_setup(void)
+{
+   create_images();
+   return NULL;
+}
+
+static void delta_before(void *f)
+{
+   ARG_UNUSED(f);
+   result_len = 0;
+}
+
+ZTEST(delta, test_identical)
+{
+   size_t patch_len = 0;
+
+   round_trip(source, sizeof(source), &patch_len);
+   /* header and one COPY */
+   zassert_equal(patch_len, 16 + 9, "patch with %u bytes", (unsigned int)patch_len);
+}
+
+ZTEST(delta, test_moved_code)
+{
+   size_t patch_len = 0;
+
+   round_trip(target, sizeof(target), &patch_len);
+   TC_PRINT("patch %u bytes, image %u bytes\n", (unsigned int)patch_len, (unsigned int)sizeof(target));
+   zassert_true(patch_len * 10 < sizeof(target), "patch with %u bytes", (unsigned int)patch_len);
+}
+
+ZTEST(delta, test_unrelated)
+{
+   static uint8_t unrelated[0x1000];
+   uint32_t seed = 815;
+   size_t patch_len = 0;
+
+   for (size_t offset = 0; offset < sizeof(unrelated); ++offset) {
+      unrelated[offset] = random_value(&seed);
+   }
+   round_trip(unrelated, sizeof(unrelated), &patch_len);
+   /* header and one INSERT */
+   zassert_equal(patch_len, 16 + 5 + sizeof(unrelated), "patch with %u bytes", (unsigned int)patch_len);
+}
+
+ZTEST(delta, test_source_mismatch)
+{
+   size_t patch_len = 0;
+   uint8_t *patch = delta_gen_create(source, sizeof(source), target, sizeof(target), &patch_len);
+
+   zassert_not_null(patch, "create patch failed");
+   source[100] ^= 0xff;
+   zassert_equal(apply_patch(patch, patch_len, 64), -EINVAL, "changed source accepted");
+   source[100] ^= 0xff;
+   zassert_equal(result_len, 0, "data written");
+   free(patch);
+}
+
+ZTEST(delta, test_incomplete)
+{
+   size_t patch_len = 0;
+   uint8_t *patch = delta_gen_create(source, sizeof(source), target, sizeof(target), &patch_len);
+
+   zassert_not_null(patch, "create patch failed");
+   zassert_equal(apply_patch(patch, patch_len - 1, 64), -EINVAL, "incomplete patch accepted");
+   free(patch);
+}
+
+ZTEST(delta, test_invalid_add)
+{
+   uint8_t patch[16 + 9 + 2];
+   uint8_t *cur = patch;
+
+   memcpy(cur, DELTA_MAGIC, 4);
+   sys_put_be32(sizeof(source), cur + 4);
+   sys_put_be32(delta_gen_crc32(source, sizeof(source)), cur + 8);
+   sys_put_be32(16, cur + 12);
+   cur += 16;
+   *cur++ = DELTA_OPCODE_ADD;
+   sys_put_be32(0, cur);
+   sys_put_be32(16, cur + 4);
+   cur += 8;
+   /* run exceeds the ADD length */
+   *cur++ = 10;
+   *cur++ = 10;
+   zassert_equal(apply_patch(patch, sizeof(patch), 64), -EINVAL, "invalid run accepted");
+
+   /* ADD exceeds the source */
+   sys_put_be32(sizeof(source) - 8, &patch[17]);
+   zassert_equal(apply_patch(patch, sizeof(patch), 64), -EINVAL, "invalid add accepted");
+}
+
+ZTEST_SUITE(delta, NULL, delta_setup, delta_before, NULL, NULL);
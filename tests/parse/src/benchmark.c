@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/*
+ * Cycles per decoded AT response. On qemu_cortex_m3 the instructions are
+ * counted, on native_sim the cycles don't advance while the CPU is busy.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "parse.h"
+
+#define BENCHMARK_ITERATIONS 2000
+
+struct benchmark_xmonitor {
+   int32_t status;
+   char provider[7];
+   uint16_t tac;
+   int32_t mode;
+   uint8_t band;
+   uint32_t cell;
+   uint32_t earfcn;
+   int16_t rsrp;
+   int16_t snr;
+   char edrx[5];
+   char act[9];
+   char tau_ext[9];
+   char tau[9];
+   int16_t rsrq;
+};
+
+struct benchmark_xconnstat {
+   uint32_t transmitted;
+   uint32_t received;
+   uint16_t max_packet_size;
+   uint16_t average_packet_size;
+};
+
+/* same layout as the tables in modem.c */
+static const struct parse_field xmonitor_fields[] = {
+    PARSE_FIELD(0, PARSE_DEC, struct benchmark_xmonitor, status, NULL),
+    PARSE_FIELD(3, PARSE_TEXT, struct benchmark_xmonitor, provider, NULL),
+    PARSE_FIELD(4, PARSE_HEX, struct benchmark_xmonitor, tac, NULL),
+    PARSE_FIELD(5, PARSE_DEC, struct benchmark_xmonitor, mode, NULL),
+    PARSE_FIELD(6, PARSE_DEC, struct benchmark_xmonitor, band, NULL),
+    PARSE_FIELD(7, PARSE_HEX, struct benchmark_xmonitor, cell, NULL),
+    PARSE_FIELD(9, PARSE_DEC, struct benchmark_xmonitor, earfcn, NULL),
+    PARSE_FIELD(10, PARSE_DEC, struct benchmark_xmonitor, rsrp, NULL),
+    PARSE_FIELD(11, PARSE_DEC, struct benchmark_xmonitor, snr, NULL),
+    PARSE_FIELD(12, PARSE_TEXT, struct benchmark_xmonitor, edrx, NULL),
+    PARSE_FIELD(13, PARSE_TEXT, struct benchmark_xmonitor, act, NULL),
+    PARSE_FIELD(14, PARSE_TEXT, struct benchmark_xmonitor, tau_ext, NULL),
+    PARSE_FIELD(15, PARSE_TEXT, struct benchmark_xmonitor, tau, NULL),
+    PARSE_FIELD(16, PARSE_DEC, struct benchmark_xmonitor, rsrq, NULL),
+};
+
+static const struct parse_field xconnstat_fields[] = {
+    PARSE_FIELD(2, PARSE_DEC, struct benchmark_xconnstat, transmitted, NULL),
+    PARSE_FIELD(3, PARSE_DEC, struct benchmark_xconnstat, received, NULL),
+    PARSE_FIELD(4, PARSE_DEC, struct benchmark_xconnstat, max_packet_size, NULL),
+    PARSE_FIELD(5, PARSE_DEC, struct benchmark_xconnstat, average_packet_size, NULL),
+};
+
+static const char xmonitor[] =
+    "1,\"\",\"\",\"26201\",\"B8C0\",7,20,\"01CC2B00\",206,6300,42,23,\"\",\"11100000\",\"00001000\",\"00111000\",24";
+
+static const char xconnstat[] = "0,0,12,8,1152,224";
+
+static void benchmark_print(const char *name, uint32_t cycles)
+{
+   TC_PRINT("%-24s: %u cycles/call, %u ns/call\n", name, cycles / BENCHMARK_ITERATIONS,
+            (uint32_t)(k_cyc_to_ns_floor64(cycles) / BENCHMARK_ITERATIONS));
+}
+
+ZTEST(parse_benchmark, test_parse_params)
+{
+   struct parse_param params[PARSE_MAX_PARAMS];
+   uint32_t start = k_cycle_get_32();
+   int n = 0;
+
+   for (int iteration = 0; iteration < BENCHMARK_ITERATIONS; ++iteration) {
+      n += parse_params(xmonitor, params, PARSE_MAX_PARAMS);
+   }
+   benchmark_print("parse_params XMONITOR", k_cycle_get_32() - start);
+   zassert_equal(n, 17 * BENCHMARK_ITERATIONS, "%d params", n);
+}
+
+ZTEST(parse_benchmark, test_parse_fields_xmonitor)
+{
+   struct benchmark_xmonitor result;
+   uint32_t start = k_cycle_get_32();
+   uint32_t decoded = 0;
+
+   for (int iteration = 0; iteration < BENCHMARK_ITERATIONS; ++iteration) {
+      decoded |= parse_fields(xmonitor, xmonitor_fields, ARRAY_SIZE(xmonitor_fields), &result);
+   }
+   benchmark_print("parse_fields XMONITOR", k_cycle_get_32() - start);
+   zassert_equal(decoded, BIT_MASK(ARRAY_SIZE(xmonitor_fields)), "decoded 0x%x", decoded);
+   zassert_equal(result.tac, 0xB8C0, "tac 0x%x", result.tac);
+   zassert_equal(result.cell, 0x01CC2B00, "cell 0x%x", result.cell);
+   zassert_str_equal(result.tau, "00111000", "tau %s", result.tau);
+}
+
+ZTEST(parse_benchmark, test_parse_fields_xconnstat)
+{
+   struct benchmark_xconnstat result;
+   uint32_t start = k_cycle_get_32();
+   uint32_t decoded = 0;
+
+   for (int iteration = 0; iteration < BENCHMARK_ITERATIONS; ++iteration) {
+      decoded |= parse_fields(xconnstat, xconnstat_fields, ARRAY_SIZE(xconnstat_fields), &result);
+   }
+   benchmark_print("parse_fields XCONNSTAT", k_cycle_get_32() - start);
+   zassert_equal(decoded, BIT_MASK(ARRAY_SIZE(xconnstat_fields)), "decoded 0x%x", decoded);
+   zassert_equal(result.received, 8, "received %u", result.received);
+}
+
+ZTEST_SUITE(parse_benchmark, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+
+#include "parse.h"
+
+#define FUZZ_ITERATIONS 20000
+#define FUZZ_MAX_TOKENS (PARSE_MAX_PARAMS + 6)
+#define FUZZ_MAX_TOKEN_LEN 12
+#define FUZZ_BUFFER_SIZE (FUZZ_MAX_TOKENS * (FUZZ_MAX_TOKEN_LEN + 3) + 1)
+
+#define CANARY 0x5a
+
+struct fuzz_token {
+   char value[FUZZ_MAX_TOKEN_LEN + 1];
+   bool quoted;
+};
+
+struct fuzz_result {
+   uint8_t u8;
+   uint16_t u16;
+   uint32_t u32;
+   uint32_t hex;
+   uint8_t bin;
+   char text1[1];
+   char text5[5];
+   char text9[9];
+   int32_t converted;
+   int32_t far;
+};
+
+struct fuzz_guarded_result {
+   uint8_t head[16];
+   struct fuzz_result result;
+   uint8_t tail[16];
+};
+
+static long fuzz_convert(long value)
+{
+   return value - 141;
+}
+
+static const struct parse_field fuzz_fields[] = {
+    PARSE_FIELD(0, PARSE_DEC, struct fuzz_result, u8, NULL),
+    PARSE_FIELD(1, PARSE_DEC, struct fuzz_result, u16, NULL),
+    PARSE_FIELD(2, PARSE_DEC, struct fuzz_result, u32, NULL),
+    PARSE_FIELD(3, PARSE_HEX, struct fuzz_result, hex, NULL),
+    PARSE_FIELD(4, PARSE_BIN, struct fuzz_result, bin, NULL),
+    PARSE_FIELD(5, PARSE_TEXT, struct fuzz_result, text1, NULL),
+    PARSE_FIELD(6, PARSE_TEXT, struct fuzz_result, text5, NULL),
+    PARSE_FIELD(7, PARSE_TEXT, struct fuzz_result, text9, NULL),
+    PARSE_FIELD(8, PARSE_DEC, struct fuzz_result, converted, fuzz_convert),
+    PARSE_FIELD(PARSE_MAX_PARAMS - 1, PARSE_DEC, struct fuzz_result, far, NULL),
+    /* invalid type, never decoded */
+    {.param = 0, .type = 99, .offset = offsetof(struct fuzz_result, u8), .size = 1, .convert = NULL},
+};
+
+static uint32_t random_value(uint32_t *seed)
+{
+   *seed = *seed * 1103515245 + 12345;
+   return *seed >> 8;
+}
+
+static char random_char(uint32_t *seed, bool quoted)
+{
+   static const char plain[] = "0123456789abcdefABCDEF-+. xyz";
+   uint32_t value = random_value(seed) % (sizeof(plain) + 2);
+
+   if (quoted && value >= sizeof(plain) - 1) {
+      return ',';
+   }
+   return plain[value % (sizeof(plain) - 1)];
+}
+
+/* comma separated tokens, quoted tokens may contain commas */
+static size_t create_tokens(uint32_t *seed, struct fuzz_token *tokens, char *buf)
+{
+   size_t count = 1 + random_value(seed) % FUZZ_MAX_TOKENS;
+   char *cur = buf;
+
+   for (size_t index = 0; index < count; ++index) {
+      struct fuzz_token *token = &tokens[index];
+      size_t len = random_value(seed) % (FUZZ_MAX_TOKEN_LEN + 1);
+
+      token->quoted = random_value(seed) & 1;
+      for (size_t pos = 0; pos < len; ++pos) {
+         token->value[pos] = random_char(seed, token->quoted);
+      }
+      token->value[len] = 0;
+      cur += sprintf(cur, token->quoted ? "%s\"%s\"" : "%s%s", index ? "," : "", token->value);
+   }
+   return count;
+}
+
+/* random bytes, commas and quotes are more likely */
+static void create_random(uint32_t *seed, char *buf, size_t size)
+{
+   size_t len = random_value(seed) % size;
+
+   for (size_t pos = 0; pos < len; ++pos) {
+      uint32_t value = random_value(seed) % 300;
+
+      if (value < 20) {
+         buf[pos] = ',';
+      } else if (value < 40) {
+         buf[pos] = '"';
+      } else {
+         buf[pos] = 1 + value % 255;
+      }
+   }
+   buf[len] = 0;
+}
+
+static void check_params_bounds(const char *buf, const struct parse_param *params, int count)
+{
+   const char *end = buf + strlen(buf);
+
+   for (int index = 0; index < count; ++index) {
+      zassert_true(buf <= params[index].value && params[index].value <= end, "param %d out of bounds", index);
+      zassert_true(params[index].value + params[index].len <= end, "param %d exceeds input", index);
+   }
+}
+
+ZTEST(parse, test_params_round_trip)
+{
+   uint32_t seed = 4711;
+   char buf[FUZZ_BUFFER_SIZE];
+   struct fuzz_token tokens[FUZZ_MAX_TOKENS];
+   struct parse_param params[PARSE_MAX_PARAMS];
+
+   for (int iteration = 0; iteration < FUZZ_ITERATIONS; ++iteration) {
+      size_t count = create_tokens(&seed, tokens, buf);
+      int n = parse_params(buf, params, PARSE_MAX_PARAMS);
+
+      zassert_equal(n, MIN(count, PARSE_MAX_PARAMS), "%d params for %u tokens of '%s'", n,
+                    (unsigned int)count, buf);
+      check_params_bounds(buf, params, n);
+      for (int index = 0; index < n; ++index) {
+         zassert_equal(params[index].len, strlen(tokens[index].value), "param %d of '%s'", index, buf);
+         zassert_mem_equal(params[index].value, tokens[index].value, params[index].len,
+                           "param %d of '%s'", index, buf);
+      }
+   }
+}
+
+ZTEST(parse, test_params_random)
+{
+   uint32_t seed = 815;
+   char buf[128];
+   struct parse_param params[PARSE_MAX_PARAMS + 1];
+
+   for (int iteration = 0; iteration < FUZZ_ITERATIONS; ++iteration) {
+      size_t count = random_value(&seed) % (PARSE_MAX_PARAMS + 1);
+      int n;
+
+      create_random(&seed, buf, sizeof(buf));
+      memset(params, CANARY, sizeof(params));
+      n = parse_params(buf, params, count);
+      zassert_true(count ? (1 <= n && n <= count) : !n, "%d params, %u max.", n, (unsigned int)count);
+      check_params_bounds(buf, params, n);
+      zassert_equal(((uint8_t *)&params[count])[0], CANARY, "param %u written", (unsigned int)count);
+   }
+}
+
+static int print_long(char *buf, long value, int base)
+{
+   char digits[sizeof(long) * 8 + 2];
+   unsigned long abs_value = value < 0 ? 0UL - value : (unsigned long)value;
+   int index = sizeof(digits);
+   int len = 0;
+
+   do {
+      digits[--index] = "0123456789abcdef"[abs_value % base];
+      abs_value /= base;
+   } while (abs_value);
+   if (value < 0) {
+      buf[len++] = '-';
+   }
+   memcpy(&buf[len], &digits[index], sizeof(digits) - index);
+   len += sizeof(digits) - index;
+   buf[len] = 0;
+   return len;
+}
+
+ZTEST(parse, test_param_long)
+{
+   static const int bases[] = {2, 10, 16};
+   uint32_t seed = 42;
+   char buf[sizeof(long) * 8 + 2];
+   struct parse_param param = {.value = buf};
+   long result;
+
+   for (int iteration = 0; iteration < FUZZ_ITERATIONS; ++iteration) {
+      /* random magnitudes up to LONG_MAX */
+      unsigned long bits = ((unsigned long)random_value(&seed) << 16) ^ random_value(&seed);
+      long value = (long)((bits & LONG_MAX) >> (random_value(&seed) % (sizeof(long) * 8)));
+      int base = bases[iteration % ARRAY_SIZE(bases)];
+
+      if (iteration & 8) {
+         value = -value;
+      }
+      param.len = print_long(buf, value, base);
+      result = value + 1;
+      zassert_true(parse_param_long(&param, base, &result), "'%s' base %d failed", buf, base);
+      zassert_equal(result, value, "'%s' base %d", buf, base);
+   }
+
+   param.len = print_long(buf, LONG_MAX, 10);
+   zassert_true(parse_param_long(&param, 10, &result), "LONG_MAX failed");
+   zassert_equal(result, LONG_MAX, "LONG_MAX");
+
+   /* not decoded, result unchanged */
+   result = 4711;
+   strcpy(buf, "99999999999999999999999");
+   param.len = strlen(buf);
+   zassert_false(parse_param_long(&param, 10, &result), "overflow decoded");
+   strcpy(buf, "-");
+   param.len = strlen(buf);
+   zassert_false(parse_param_long(&param, 10, &result), "sign decoded");
+   param.len = 0;
+   zassert_false(parse_param_long(&param, 10, &result), "empty decoded");
+   strcpy(buf, "12a");
+   param.len = strlen(buf);
+   zassert_false(parse_param_long(&param, 10, &result), "hex digit decoded");
+   strcpy(buf, "102");
+   param.len = strlen(buf);
+   zassert_false(parse_param_long(&param, 2, &result), "invalid binary decoded");
+   zassert_equal(result, 4711, "result changed");
+}
+
+static void check_fields(const char *buf)
+{
+   struct fuzz_guarded_result guarded;
+   struct fuzz_result *result = &guarded.result;
+   struct parse_param params[PARSE_MAX_PARAMS];
+   int n = parse_params(buf, params, PARSE_MAX_PARAMS);
+   uint32_t decoded;
+
+   memset(&guarded, CANARY, sizeof(guarded));
+   decoded = parse_fields(buf, fuzz_fields, ARRAY_SIZE(fuzz_fields), result);
+
+   for (int index = 0; index < sizeof(guarded.head); ++index) {
+      zassert_equal(guarded.head[index], CANARY, "head overwritten by '%s'", buf);
+      zassert_equal(guarded.tail[index], CANARY, "tail overwritten by '%s'", buf);
+   }
+   zassert_false(decoded & ~BIT_MASK(ARRAY_SIZE(fuzz_fields) - 1), "invalid field decoded");
+   for (int index = 0; index < ARRAY_SIZE(fuzz_fields); ++index) {
+      const struct parse_field *field = &fuzz_fields[index];
+
+      if (field->param >= n) {
+         zassert_false(decoded & BIT(index), "missing param %d decoded", field->param);
+      } else if (field->type == PARSE_TEXT) {
+         const char *text = (const char *)result + field->offset;
+         size_t len = MIN(params[field->param].len, field->size - 1);
+
+         zassert_true(decoded & BIT(index), "text param %d not decoded", field->param);
+         zassert_equal(text[len], 0, "text param %d not terminated", field->param);
+         zassert_mem_equal(text, params[field->param].value, len, "text param %d differs", field->param);
+      }
+   }
+   if (decoded & BIT(1)) {
+      long value = 0;
+
+      zassert_true(parse_param_long(&params[1], 10, &value), "param 1 not a number");
+      zassert_equal(result->u16, (uint16_t)value, "u16 differs");
+   }
+   if (decoded & BIT(8)) {
+      long value = 0;
+
+      zassert_true(parse_param_long(&params[8], 10, &value), "param 8 not a number");
+      zassert_equal(result->converted, (int32_t)(value - 141), "converted differs");
+   }
+}
+
+ZTEST(parse, test_fields_random)
+{
+   uint32_t seed = 1234;
+   char buf[FUZZ_BUFFER_SIZE];
+   struct fuzz_token tokens[FUZZ_MAX_TOKENS];
+
+   for (int iteration = 0; iteration < FUZZ_ITERATIONS; ++iteration) {
+      if (iteration & 1) {
+         create_random(&seed, buf, sizeof(buf));
+      } else {
+         create_tokens(&seed, tokens, buf);
+      }
+      check_fields(buf);
+   }
+}
+
+ZTEST(parse, test_fields)
+{
+   struct fuzz_result result;
+   uint32_t decoded;
+
+   memset(&result, 0, sizeof(result));
+   decoded = parse_fields("200,65535,4000000000,\"01CC2B00\",101,\"x\",\"abcdef\",\"a,b\",100", fuzz_fields,
+                          ARRAY_SIZE(fuzz_fields), &result);
+   zassert_equal(decoded, BIT_MASK(9), "decoded 0x%x", decoded);
+   zassert_equal(result.u8, 200, "u8 %u", result.u8);
+   zassert_equal(result.u16, 65535, "u16 %u", result.u16);
+   zassert_equal(result.u32, 4000000000U, "u32 %u", result.u32);
+   zassert_equal(result.hex, 0x01CC2B00, "hex 0x%x", result.hex);
+   zassert_equal(result.bin, 5, "bin %u", result.bin);
+   zassert_str_equal(result.text1, "", "text1 %s", result.text1);
+   zassert_str_equal(result.text5, "abcd", "text5 %s", result.text5);
+   zassert_str_equal(result.text9, "a,b", "text9 %s", result.text9);
+   zassert_equal(result.converted, -41, "converted %d", result.converted);
+
+   /* empty and invalid numbers are not decoded */
+   decoded = parse_fields(",x,,\"\",2", fuzz_fields, ARRAY_SIZE(fuzz_fields), &result);
+   zassert_equal(decoded, 0, "decoded 0x%x", decoded);
+}
+
+ZTEST_SUITE(parse, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/* Replaces the tinydtls logging for the tests. */
+
+#ifndef DTLS_DEBUG_H_
+#define DTLS_DEBUG_H_
+
+#include <zephyr/logging/log.h>
+
+#define dtls_info(...) LOG_INF(__VA_ARGS__)
+#define dtls_warn(...) LOG_WRN(__VA_ARGS__)
+#define dtls_debug(...) LOG_DBG(__VA_ARGS__)
+
+#endif /* DTLS_DEBUG_H_ */
@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/ztest.h>
+
+/* auto generated header file during west build */
+#include "ncs_version.h"
+
+#include "coap_appl_client.h"
+#include "coap_appl_senml.h"
+
+#include "mocks.h"
+
+#define SENML_FLAGS (COAP_SEND_FLAG_MODEM_INFO | COAP_SEND_FLAG_SIM_INFO | COAP_SEND_FLAG_NET_INFO | \
+                     COAP_SEND_FLAG_NET_STATS | COAP_SEND_FLAG_ENV_INFO | COAP_SEND_FLAG_SCALE_INFO |   \
+                     COAP_SEND_FLAG_NET_SCAN_INFO)
+
+#define TEXT_ENV_HISTORY            \
+   "!22.41,22.38,22.30,22.29 C\n"  \
+   "!41.27,41.30,41.35,41.41 %H\n" \
+   "!1003.2,1003.1,1003.1,1003.0 hPa"
+
+static const char text_env_history[] = TEXT_ENV_HISTORY;
+
+/* The text report with the same values, formatted as coap_appl_client.c does. */
+static const char text_report[] =
+    "108 [s], Thingy:91 v0.7.108+1, 0*1, 1*0, 2*0, 3*0, failures 0\n"
+    "NCS: " NCS_VERSION_STRING ", HW: B1A, MFW: 1.3.5, IMEI: 350457791234567\n"
+    "!4985 mV 78%\n"
+    "RETRANS: 0, RTT: 312 ms, CT: 245 ms\n"
+    "ICCID: 89882280666012345678, eDRX cycle: off, HPPLMN interval: 10 [h]\n"
+    "IMSI: 901405101234567\n"
+    "Network: CAT-M1,roaming,Band 20,#PLMN 26202,TAC 47490,Cell 30776066,EARFCN 6300\n"
+    "PSM: TAU 90000 [s], Act 0 [s], Released: 2032 ms\n"
+    "!CE: down: 8, up: 1, RSRP: -114 dBm, CINR: -1 dB, SNR: 0 dB\n"
+    "Stat: tx 1 kB, rx 0 kB, max 748 B, avg 146 B\n"
+    "Cell updates 1, Network searchs 1 (3 s), PSM delays 0 (0 s)\n"
+    "Modem Restarts 0, Sockets 1, DTLS handshakes 1\n"
+    "Wakeups 1, 1 s, connected 7 s, asleep 0 s\n"
+    TEXT_ENV_HISTORY "\n"
+    "!CHA 32.25 kg, 18.5°C, CHB 29.75 kg, 18.2°C\n" MOCK_NEIGHBOR_CELLS;
+
+#define MAX_RECORDS 64
+#define MAX_NAME 16
+
+struct senml_record {
+   char name[MAX_NAME];
+   float value;
+   const uint8_t *text;
+   uint16_t text_len;
+   int32_t time;
+   bool base_time;
+};
+
+struct cbor_reader {
+   const uint8_t *buf;
+   size_t len;
+   size_t index;
+};
+
+static uint8_t payload[1024];
+static struct senml_record records[MAX_RECORDS];
+
+static int cbor_get_head(struct cbor_reader *reader, uint8_t *major, uint32_t *value)
+{
+   uint8_t info;
+   size_t len;
+
+   zassert_true(reader->index < reader->len, "CBOR truncated");
+   *major = reader->buf[reader->index] >> 5;
+   info = reader->buf[reader->index] & 0x1f;
+   ++reader->index;
+   if (info < 24) {
+      *value = info;
+      return 0;
+   }
+   zassert_true(info <= 26, "CBOR additional info %u not supported", info);
+   len = 1 << (info - 24);
+   zassert_true(reader->index + len <= reader->len, "CBOR truncated");
+   if (len == 1) {
+      *value = reader->buf[reader->index];
+   } else if (len == 2) {
+      *value = sys_get_be16(&reader->buf[reader->index]);
+   } else {
+      *value = sys_get_be32(&reader->buf[reader->index]);
+   }
+   reader->index += len;
+   return 0;
+}
+
+static int32_t cbor_get_int(struct cbor_reader *reader)
+{
+   uint8_t major;
+   uint32_t value;
+
+   cbor_get_head(reader, &major, &value);
+   zassert_true(major <= 1, "CBOR int expected, major %u", major);
+   return major ? -1 - (int32_t)value : (int32_t)value;
+}
+
+static const uint8_t *cbor_get_text(struct cbor_reader *reader, uint16_t *len)
+{
+   const uint8_t *text;
+   uint8_t major;
+   uint32_t value;
+
+   cbor_get_head(reader, &major, &value);
+   zassert_equal(major, 3, "CBOR text expected, major %u", major);
+   zassert_true(reader->index + value <= reader->len, "CBOR text truncated");
+   text = &reader->buf[reader->index];
+   reader->index += value;
+   *len = value;
+   return text;
+}
+
+static void cbor_skip_value(struct cbor_reader *reader)
+{
+   uint8_t head = reader->buf[reader->index];
+   uint16_t len;
+
+   if (head == 0xfa) {
+      reader->index += 5;
+   } else if (head == 0xfb) {
+      reader->index += 9;
+   } else if ((head >> 5) == 3) {
+      cbor_get_text(reader, &len);
+   } else {
+      cbor_get_int(reader);
+   }
+   zassert_true(reader->index <= reader->len, "CBOR value truncated");
+}
+
+static int senml_decode(const uint8_t *buf, size_t len)
+{
+   struct cbor_reader reader = {.buf = buf, .len = len, .index = 0};
+   char base_name[MAX_NAME] = {0};
+   uint8_t major;
+   uint32_t count;
+   uint32_t fields;
+
+   cbor_get_head(&reader, &major, &count);
+   zassert_equal(major, 4, "SenML pack must be an array");
+   zassert_true(count <= MAX_RECORDS, "too many records %u", count);
+
+   memset(records, 0, sizeof(records));
+   for (int index = 0; index < count; ++index) {
+      struct senml_record *record = &records[index];
+      char name[MAX_NAME] = {0};
+
+      cbor_get_head(&reader, &major, &fields);
+      zassert_equal(major, 5, "SenML record %d must be a map", index);
+      for (; fields > 0; --fields) {
+         int32_t label = cbor_get_int(&reader);
+         const uint8_t *text;
+         uint16_t text_len;
+
+         if (label == 0) {
+            text = cbor_get_text(&reader, &text_len);
+            zassert_true(text_len < MAX_NAME, "name too long");
+            memcpy(name, text, text_len);
+         } else if (label == -2) {
+            text = cbor_get_text(&reader, &text_len);
+            zassert_true(text_len < MAX_NAME, "base name too long");
+            memset(base_name, 0, sizeof(base_name));
+            memcpy(base_name, text, text_len);
+         } else if (label == 2 && reader.buf[reader.index] == 0xfa) {
+            uint32_t bits = sys_get_be32(&reader.buf[reader.index + 1]);
+
+            memcpy(&record->value, &bits, sizeof(bits));
+            reader.index += 5;
+         } else if (label == 3) {
+            record->text = cbor_get_text(&reader, &record->text_len);
+         } else if (label == 6) {
+            record->time = cbor_get_int(&reader);
+         } else if (label == -3) {
+            cbor_get_int(&reader);
+            record->base_time = true;
+         } else {
+            cbor_skip_value(&reader);
+         }
+      }
+      /* RFC 8428, 4.5.1. name = base name + name */
+      zassert_true(strlen(base_name) + strlen(name) < MAX_NAME, "name too long");
+      strcpy(record->name, base_name);
+      strcat(record->name, name);
+      zassert_true(record->name[0], "SenML record %d without name", index);
+   }
+   zassert_equal(reader.index, len, "%u trailing bytes", len - reader.index);
+   return count;
+}
+
+static int senml_count(int count, const char *name)
+{
+   int res = 0;
+
+   for (int index = 0; index < count; ++index) {
+      if (!strcmp(records[index].name, name)) {
+         ++res;
+      }
+   }
+   return res;
+}
+
+static const struct senml_record *senml_find(int count, const char *name)
+{
+   for (int index = 0; index < count; ++index) {
+      if (!strcmp(records[index].name, name)) {
+         return &records[index];
+      }
+   }
+   return NULL;
+}
+
+static void *senml_setup(void)
+{
+   mock_neighbor_cells = MOCK_NEIGHBOR_CELLS;
+   return NULL;
+}
+
+static void senml_before(void *fixture)
+{
+   ARG_UNUSED(fixture);
+   mock_neighbor_cells = MOCK_NEIGHBOR_CELLS;
+   mock_env_history = true;
+   memset(payload, 0xa5, sizeof(payload));
+}
+
+ZTEST(senml, test_pack)
+{
+   int len = coap_appl_senml_encode(payload, sizeof(payload), SENML_FLAGS, "cmd");
+   int count;
+
+   zassert_true(len > 0, "encode failed %d", len);
+   count = senml_decode(payload, len);
+   zassert_true(records[0].base_time, "base time missing");
+   for (int index = 1; index < count; ++index) {
+      zassert_false(records[index].base_time, "base time in record %d", index);
+   }
+   /* names are unique, except the history values with different times */
+   for (int index = 0; index < count; ++index) {
+      for (int next = index + 1; next < count; ++next) {
+         zassert_false(!strcmp(records[index].name, records[next].name) &&
+                           records[index].time == records[next].time,
+                       "duplicate record %s", records[index].name);
+      }
+   }
+   zassert_equal(senml_count(count, "bat"), 1);
+   zassert_equal(senml_count(count, "batlvl"), 1);
+   zassert_equal(senml_count(count, "temp"), 4);
+   zassert_equal(senml_count(count, "cha"), 1);
+   zassert_equal(senml_count(count, "cha_temp"), 1);
+   zassert_equal(senml_count(count, "chb"), 1);
+   zassert_equal(senml_count(count, "chb_temp"), 1);
+   zassert_equal(senml_count(count, "ncells"), 1);
+}
+
+ZTEST(senml, test_net_scan)
+{
+   const struct senml_record *record;
+   int len = coap_appl_senml_encode(payload, sizeof(payload), COAP_SEND_FLAG_NET_SCAN_INFO, NULL);
+   int count;
+
+   zassert_true(len > 0, "encode failed %d", len);
+   count = senml_decode(payload, len);
+   zassert_equal(count, 1);
+   record = senml_find(count, "ncells");
+   zassert_not_null(record);
+   zassert_equal(record->text_len, strlen(MOCK_NEIGHBOR_CELLS));
+   zassert_mem_equal(record->text, MOCK_NEIGHBOR_CELLS, record->text_len);
+
+   mock_neighbor_cells = NULL;
+   len = coap_appl_senml_encode(payload, sizeof(payload), COAP_SEND_FLAG_NET_SCAN_INFO, NULL);
+   zassert_equal(senml_decode(payload, len), 0);
+}
+
+ZTEST(senml, test_env_value)
+{
+   const struct senml_record *record;
+   int len;
+   int count;
+
+   mock_env_history = false;
+   len = coap_appl_senml_encode(payload, sizeof(payload), COAP_SEND_FLAG_ENV_INFO, NULL);
+   zassert_true(len > 0, "encode failed %d", len);
+   count = senml_decode(payload, len);
+   zassert_equal(count, 3);
+
+   /* rounded to the history scale */
+   record = senml_find(count, "temp");
+   zassert_not_null(record);
+   zassert_within(record->value, 22.42f, 0.001f);
+   record = senml_find(count, "hum");
+   zassert_not_null(record);
+   zassert_within(record->value, -0.01f, 0.001f);
+   record = senml_find(count, "press");
+   zassert_not_null(record);
+   zassert_within(record->value, 100330.0f, 0.5f);
+}
+
+ZTEST(senml, test_overflow)
+{
+   int len = coap_appl_senml_encode(payload, sizeof(payload), SENML_FLAGS, "cmd");
+
+   zassert_true(len > 0, "encode failed %d", len);
+
+   /* the neighbor cell text is copied in place, it must not exceed the buffer */
+   for (int limit = len - 1; limit > len - (int)sizeof(MOCK_NEIGHBOR_CELLS) - 8; --limit) {
+      memset(payload, 0xa5, sizeof(payload));
+      zassert_equal(coap_appl_senml_encode(payload, limit, SENML_FLAGS, "cmd"), -ENOMEM,
+                    "%d bytes must not fit into %d", len, limit);
+      zassert_equal(payload[limit], 0xa5, "buffer overrun with limit %d", limit);
+   }
+   zassert_equal(coap_appl_senml_encode(payload, 2, SENML_FLAGS, NULL), -ENOMEM);
+}
+
+ZTEST(senml, test_payload_size)
+{
+   size_t text_len = strlen(text_report);
+   int len = coap_appl_senml_encode(payload, sizeof(payload), SENML_FLAGS, NULL);
+
+   zassert_true(len > 0, "encode failed %d", len);
+   TC_PRINT("report: text/plain %u bytes, application/senml+cbor %d bytes (%d%%)\n",
+            (unsigned int)text_len, len, (int)((len * 100) / text_len));
+   zassert_true(len < text_len, "SenML %d bytes, text %u bytes", len, (unsigned int)text_len);
+
+   text_len = strlen(text_env_history);
+   len = coap_appl_senml_encode(payload, sizeof(payload), COAP_SEND_FLAG_ENV_INFO, NULL);
+   zassert_true(len > 0, "encode failed %d", len);
+   TC_PRINT("environment history: text/plain %u bytes, application/senml+cbor %d bytes (%d%%)\n",
+            (unsigned int)text_len, len, (int)((len * 100) / text_len));
+}
+
+ZTEST_SUITE(senml, NULL, senml_setup, senml_before, NULL, NULL);
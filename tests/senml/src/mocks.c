@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+/* Fixed values of a recorded report, see docu/CONFIGURATION.md. */
+
+#include <string.h>
+#include <zephyr/logging/log.h>
+
+#include "appl_diagnose.h"
+#include "appl_time.h"
+#include "dtls_client.h"
+#include "environment_sensor.h"
+#include "modem.h"
+#include "modem_desc.h"
+#include "modem_sim.h"
+#include "nau7802.h"
+#include "power_manager.h"
+
+#include "mocks.h"
+
+LOG_MODULE_REGISTER(COAP_CLIENT, CONFIG_COAP_CLIENT_LOG_LEVEL);
+
+unsigned int transmissions[COAP_MAX_RETRANSMISSION + 1] = {1, 0, 0, 0};
+unsigned int connect_time_ms = 245;
+unsigned int coap_rtt_ms = 312;
+unsigned int retransmissions = 0;
+unsigned int failures = 0;
+unsigned int sockets = 1;
+unsigned int dtls_handshakes = 1;
+
+const char *mock_neighbor_cells = MOCK_NEIGHBOR_CELLS;
+bool mock_env_history = true;
+
+const char *appl_get_version(void)
+{
+   return "v0.7.108+1";
+}
+
+void appl_get_now(int64_t *now)
+{
+   *now = 1695208116000LL;
+}
+
+int power_manager_status(uint8_t *level, uint16_t *voltage, power_manager_status_t *status, int16_t *forecast)
+{
+   *level = 78;
+   *voltage = 4985;
+   return 0;
+}
+
+int modem_get_modem_info(struct lte_modem_info *info)
+{
+   strcpy(info->version, "B1A");
+   strcpy(info->firmware, "1.3.5");
+   strcpy(info->imei, "350457791234567");
+   return 0;
+}
+
+int modem_sim_get_info(struct lte_sim_info *info)
+{
+   info->valid = true;
+   strcpy(info->iccid, "89882280666012345678");
+   strcpy(info->imsi, "901405101234567");
+   return 0;
+}
+
+int modem_get_network_info(struct lte_network_info *info)
+{
+   info->registered = LTE_NETWORK_STATE_ON;
+   info->mode = LTE_LC_LTE_MODE_LTEM;
+   info->band = 20;
+   strcpy(info->provider, "26202");
+   info->tac = 47490;
+   info->cell = 30776066;
+   info->earfcn = 6300;
+   return 0;
+}
+
+const char *modem_get_network_mode_description(enum lte_lc_lte_mode mode)
+{
+   return "CAT-M1";
+}
+
+int modem_get_psm_status(struct lte_lc_psm_cfg *psm)
+{
+   psm->tau = 90000;
+   psm->active_time = 0;
+   return 0;
+}
+
+int modem_get_release_time(void)
+{
+   return 2032;
+}
+
+int modem_get_coverage_enhancement_info(struct lte_ce_info *info)
+{
+   info->ce_supported = 1;
+   info->downlink_repetition = 8;
+   info->uplink_repetition = 1;
+   info->rsrp = -114;
+   info->rsrq = INVALID_SIGNAL_VALUE;
+   info->cinr = -1;
+   info->snr = 0;
+   return 0;
+}
+
+int modem_get_statistic(struct lte_network_statistic *statistic)
+{
+   statistic->transmitted = 1;
+   statistic->received = 0;
+   statistic->cell_updates = 1;
+   statistic->searchs = 1;
+   statistic->search_time = 3;
+   statistic->wakeups = 1;
+   statistic->wakeup_time = 1;
+   statistic->connected_time = 7;
+   statistic->asleep_time = 0;
+   return 0;
+}
+
+int modem_get_last_neighbor_cell_meas(char *buf, size_t len)
+{
+   int res = 0;
+
+   if (mock_neighbor_cells) {
+      res = MIN(strlen(mock_neighbor_cells), len - 1);
+      if (buf) {
+         memcpy(buf, mock_neighbor_cells, res);
+      }
+   }
+   if (buf) {
+      buf[res] = 0;
+   }
+   return res;
+}
+
+/* same as environment_history.c */
+int16_t environment_scale_value(double value, int scale)
+{
+   value *= scale;
+   if (value >= INT16_MAX) {
+      return INT16_MAX;
+   } else if (value <= INT16_MIN) {
+      return INT16_MIN;
+   }
+   return (int16_t)(value < 0 ? value - 0.5 : value + 0.5);
+}
+
+static const int16_t temperatures[] = {2241, 2238, 2230, 2229};
+static const int16_t humidities[] = {4127, 4130, 4135, 4141};
+static const int16_t pressures[] = {10032, 10031, 10031, 10030};
+
+int environment_get_temperature_history(int16_t *values, uint16_t size)
+{
+   if (!mock_env_history) {
+      return 0;
+   }
+   size = MIN(size, ARRAY_SIZE(temperatures));
+   memcpy(values, temperatures, size * sizeof(int16_t));
+   return size;
+}
+
+int environment_get_humidity_history(int16_t *values, uint16_t size)
+{
+   if (!mock_env_history) {
+      return 0;
+   }
+   size = MIN(size, ARRAY_SIZE(humidities));
+   memcpy(values, humidities, size * sizeof(int16_t));
+   return size;
+}
+
+int environment_get_pressure_history(int16_t *values, uint16_t size)
+{
+   if (!mock_env_history) {
+      return 0;
+   }
+   size = MIN(size, ARRAY_SIZE(pressures));
+   memcpy(values, pressures, size * sizeof(int16_t));
+   return size;
+}
+
+int environment_get_temperature(double *value)
+{
+   *value = MOCK_TEMPERATURE;
+   return 0;
+}
+
+int environment_get_humidity(double *value)
+{
+   *value = MOCK_HUMIDITY;
+   return 0;
+}
+
+int environment_get_pressure(double *value)
+{
+   *value = MOCK_PRESSURE;
+   return 0;
+}
+
+int scale_sample(double *valueA, double *valueB, double *temperatureA, double *temperatureB)
+{
+   *valueA = 32.25;
+   *temperatureA = 18.5;
+   *valueB = 29.75;
+   *temperatureB = 18.25;
+   return 3;
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#ifndef MOCKS_H
+#define MOCKS_H
+
+#include <stdbool.h>
+
+#define MOCK_NEIGHBOR_CELLS "Neighbor-cells: 6300,290,-112,-14;6300,23,-120,-18;6400,101,-121,-20"
+
+/* current values, if no history is available */
+#define MOCK_TEMPERATURE 22.419
+#define MOCK_HUMIDITY -0.006
+#define MOCK_PRESSURE 1003.26
+
+/* NULL, if no neighbor cell measurement is available */
+extern const char *mock_neighbor_cells;
+
+/* false, if no environment history is available */
+extern bool mock_env_history;
+
+#endif /* MOCKS_H */
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2023 Achim Kraus CloudCoap.net
+ *
+ * See the NOTICE file(s) distributed with this work for additional
+ * information regarding copyright ownership.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ */
+
+#include <string.h>
+#include <zephyr/device.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/ztest.h>
+
+#include "appl_storage.h"
+#include "appl_storage_config.h"
+#include "appl_time.h"
+
+#define TEST_ID 1
+#define TEST_RECORDS_ID 2
+/* with the 6 bytes time an item uses 16 bytes */
+#define TEST_VALUE_SIZE 10
+#define TEST_PAGES 4
+/* erase-block-size of the native_sim flash */
+#define TEST_PAGE_SIZE 4096
+#define TEST_ITEMS 5000
+
+const struct storage_config storage_configs[] = {
+    {
+     .storage_device = DEVICE_DT_GET(DT_ALIAS(appl_storage_flash)),
+     .desc = "test",
+     .is_flash_device = true,
+     .id = TEST_ID,
+     .magic = 0x01200399,
+     .version = 1,
+     .value_size = TEST_VALUE_SIZE,
+     .pages = TEST_PAGES
+    },
+    {
+     .storage_device = DEVICE_DT_GET(DT_ALIAS(appl_storage_flash)),
+     .desc = "records",
+     .is_flash_device = true,
+     .id = TEST_RECORDS_ID,
+     .magic = 0x0120039a,
+     .version = 1,
+     .value_size = 100,
+     .pages = TEST_PAGES,
+     .records = true
+    },
+};
+
+const size_t storage_config_count = ARRAY_SIZE(storage_configs);
+
+void appl_get_now(int64_t *now)
+{
+   *now = 1695208116000LL + k_uptime_get();
+}
+
+static void write_item(uint32_t index)
+{
+   uint8_t value[TEST_VALUE_SIZE];
+
+   memset(value, 0, sizeof(value));
+   sys_put_be32(index, value);
+   zassert_equal(appl_storage_write_bytes_item(TEST_ID, value, sizeof(value)), 0, "write item %u failed", index);
+}
+
+static uint32_t read_item(size_t index)
+{
+   int64_t time = 0;
+   uint8_t value[TEST_VALUE_SIZE];
+
+   zassert_equal(appl_storage_read_bytes_item(TEST_ID, index, &time, value, sizeof(value)), sizeof(value),
+                 "read item %u failed", (unsigned int)index);
+   return sys_get_be32(value);
+}
+
+static void storage_before(void *f)
+{
+   ARG_UNUSED(f);
+   for (int index = 0; index < ARRAY_SIZE(storage_configs); ++index) {
+      const struct storage_config *config = &storage_configs[index];
+      /* the storages are placed one after the other */
+      off_t header = index * TEST_PAGES * TEST_PAGE_SIZE;
+
+      /* the missing header formats the storage on adding it again */
+      zassert_equal(appl_storage_erase_memory(config, header, TEST_PAGE_SIZE), 0, "erase header failed");
+      zassert_equal(appl_storage_add(config), 0, "add storage failed");
+   }
+}
+
+ZTEST(storage, test_write_amplification)
+{
+   uint32_t items = 0;
+   uint32_t writes = 0;
+
+   for (uint32_t index = 0; index < TEST_ITEMS; ++index) {
+      write_item(index);
+   }
+   zassert_equal(appl_storage_sync(TEST_ID), 0, "sync failed");
+   zassert_equal(appl_storage_get_writes(TEST_ID, &items, &writes), 0, "get writes failed");
+
+   TC_PRINT("cache %d bytes: %u items of %d bytes in %u device writes, %u.%02u writes per item\n",
+            CONFIG_APPL_STORAGE_WRITE_CACHE, items, TEST_VALUE_SIZE + 6, writes,
+            writes / items, (writes * 100 / items) % 100);
+   zassert_equal(items, TEST_ITEMS, "%u items", items);
+#if CONFIG_APPL_STORAGE_WRITE_CACHE > 0
+   /* at least half of the items of a full cache per write */
+   zassert_true(writes * CONFIG_APPL_STORAGE_WRITE_CACHE / (TEST_VALUE_SIZE + 6) / 2 <= items,
+                "%u writes", writes);
+#else  /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+   zassert_equal(writes, items, "%u writes", writes);
+#endif /* CONFIG_APPL_STORAGE_WRITE_CACHE > 0 */
+   zassert_equal(read_item(0), TEST_ITEMS - 1, "newest item differs");
+   zassert_equal(read_item(10), TEST_ITEMS - 11, "item differs");
+}
+
+ZTEST(storage, test_read_cached)
+{
+   for (uint32_t index = 0; index < 3; ++index) {
+      write_item(index);
+   }
+   /* not yet synced items are read from the cache */
+   zassert_equal(read_item(0), 2, "newest item differs");
+   zassert_equal(read_item(2), 0, "oldest item differs");
+   zassert_equal(appl_storage_sync(TEST_ID), 0, "sync failed");
+   zassert_equal(read_item(0), 2, "newest item differs after sync");
+   zassert_equal(read_item(2), 0, "oldest item differs after sync");
+}
+
+ZTEST(storage, test_sync_persists)
+{
+   for (uint32_t index = 0; index < 300; ++index) {
+      write_item(index);
+   }
+   zassert_equal(appl_storage_sync(0), 0, "sync failed");
+   /* initialize from the flash again */
+   zassert_equal(appl_storage_add(&storage_configs[0]), 0, "add storage failed");
+   zassert_equal(read_item(0), 299, "newest item differs");
+   zassert_equal(read_item(299), 0, "oldest item differs");
+   write_item(300);
+   zassert_equal(read_item(0), 300, "appended item differs");
+}
+
+ZTEST(storage, test_records)
+{
+   int64_t now = 0;
+   int64_t time = 0;
+   uint8_t type = 0;
+   uint8_t data[100];
+   int count = 0;
+   int rc;
+   struct appl_storage_iterator iter;
+
+   /* more than 4 pages, the oldest records are overwritten */
+   for (uint32_t index = 0; index < 1000; ++index) {
+      memset(data, index, sizeof(data));
+      sys_put_be32(index, data);
+      zassert_equal(appl_storage_write_record(TEST_RECORDS_ID, index & 1 ? 'B' : 'N', data,
+                                              index & 1 ? 4 + (index % 4) : sizeof(data)),
+                    0, "write record %u failed", index);
+   }
+   zassert_not_equal(appl_storage_write_record(TEST_ID, 'B', data, 2), 0, "record in item storage");
+   zassert_not_equal(appl_storage_write_record(TEST_RECORDS_ID, 'N', data, sizeof(data) + 1), 0,
+                     "record too large");
+
+   appl_get_now(&now);
+   zassert_equal(appl_storage_iterator_init(&iter, TEST_RECORDS_ID, 0, now + MSEC_PER_SEC), 0,
+                 "iterator init failed");
+   while ((rc = appl_storage_iterator_next(&iter, &time, &type, data, sizeof(data))) >= 0) {
+      uint32_t index = 999 - count;
+
+      zassert_equal(sys_get_be32(data), index, "record %d differs", count);
+      zassert_equal(type, index & 1 ? 'B' : 'N', "type of record %d differs", count);
+      zassert_equal(rc, index & 1 ? 4 + (index % 4) : sizeof(data), "length of record %d differs", count);
+      ++count;
+   }
+   zassert_equal(rc, -ENODATA, "iterator failed %d", rc);
+   TC_PRINT("%d of 1000 records in %d pages\n", count, TEST_PAGES);
+   /* the pages before the current one are kept, a pair of records uses up to 121 bytes */
+   zassert_true(count >= 2 * ((TEST_PAGES - 1) * TEST_PAGE_SIZE / 121) && count < 1000, "%d records", count);
+}
+
+ZTEST_SUITE(storage, NULL, NULL, storage_before, NULL, NULL);